@@ -6755,21 +6755,53 @@ namespace Legion {
        *              profiling while each number greater than zero will
        *              profile on that number of nodes.
        * -lg:serializer <string> Specify the kind of serializer to use:
-       *              'ascii' or 'binary'. The default is 'binary'.
+       *              'ascii', 'binary' or 'summary'. The default is 
+       *              'binary'. The 'summary' serializer does not write
+       *              out individual records but instead aggregates them
+       *              into histograms of task execution, wait and queue
+       *              times, copy bandwidths, and mapper call latencies 
+       *              which are logged to the 'legion_prof_summary' logger.
        * -lg:prof_logfile <filename> If using a binary serializer the
        *              name of the output file to write to.
-       * -lg:prof_footprint <int> The maximum goal size of Legion Prof 
-       *              footprint during runtime in MBs. If the total data 
-       *              captured by the profiler exceeds this footprint, the 
-       *              runtime will begin dumping data out to the output file 
-       *              in a minimally invasive way while the application is 
-       *              still running. The default is 512 (MB).
+       * -lg:prof_footprint <int> The maximum size in MBs of profiling
+       *              data that threads have handed off to be written out
+       *              while the application is still running. If the 
+       *              writer falls behind by more than this, records are
+       *              dropped and the number of dropped records is reported
+       *              at the end of the run. The default is 128 (MB).
        * -lg:prof_latency <int> The goal latency in microseconds of 
-       *              intermediate profiling tasks to be writing to output
-       *              files if the maximum footprint size is exceeded.
-       *              This allows control over the granularity so they
-       *              can be made small enough to interleave with other
-       *              runtime work. The default is 100 (us).
+       *              the profiling tasks that write data to the output
+       *              file while the application is running. This allows
+       *              control over the granularity so they can be made 
+       *              small enough to interleave with other runtime work.
+       *              The default is 100 (us).
+       * -lg:prof_summary <int> The interval in seconds at which the
+       *              'summary' serializer logs its aggregated statistics.
+       *              A summary is always logged at the end of the run and
+       *              zero will only log that one. The default is 60 (s).
+       * -lg:prof_sample <int> Only profile one in this many tasks,
+       *              copies, fills and meta-tasks. Tasks are counted 
+       *              separately for each task ID so that the first 
+       *              launch of every task is profiled. All copies share
+       *              one count and all fills another. The sampling rate
+       *              is recorded in the output and the 'summary' 
+       *              serializer scales its counts and totals by it.
+       *              The default is 1 which profiles everything.
+       * -lg:prof_counters Also record hardware performance counters
+       *              (cycles, instructions, last-level cache misses and
+       *              front-end and back-end stall cycles) for each 
+       *              profiled application task using the Linux 
+       *              perf_event interface. Counters that the hardware
+       *              does not provide are reported as -1.
+       * -lg:op_stages Record when each operation reaches each stage of
+       *              the pipeline (dependence analysis, mapping, 
+       *              execution, completion and commit) and aggregate 
+       *              the latencies of the stages into histograms for each
+       *              kind of operation. The cumulative time in each stage
+       *              is also exported as a Realm sampling gauge named
+       *              'legion/op_stages/<op kind>/<stage>'. At shutdown 
+       *              the histograms are written to the profiler if it 
+       *              is enabled and logged otherwise.
        *
        * @param argc the number of input arguments
        * @param argv pointer to an array of string arguments of size argc
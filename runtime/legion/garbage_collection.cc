@@ -1160,6 +1160,24 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
+      if ((runtime->reference_batch_size > 0) && (target == owner_space))
+      {
+        // Removing references from the owner late can only keep it 
+        // alive longer (and its distributed ID cannot be recycled while
+        // we still hold them) so we buffer removals and send them in 
+        // batches. Additions have to go right away but they can cancel
+        // out any removals that we have not sent yet.
+        if (!add)
+        {
+          runtime->defer_remote_reference_removal(target, did, VALID_REF_KIND,
+                                                  count);
+          return;
+        }
+        count = runtime->cancel_remote_reference_removals(target, did,
+                                                  VALID_REF_KIND, count);
+        if (count == 0)
+          return;
+      }
       int signed_count = count;
       RtUserEvent done_event = RtUserEvent::NO_RT_USER_EVENT;
       if (!add)
@@ -1189,6 +1207,20 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
+      // See the comment in send_remote_valid_update
+      if ((runtime->reference_batch_size > 0) && (target == owner_space))
+      {
+        if (!add)
+        {
+          runtime->defer_remote_reference_removal(target, did, GC_REF_KIND,
+                                                  count);
+          return;
+        }
+        count = runtime->cancel_remote_reference_removals(target, did,
+                                                  GC_REF_KIND, count);
+        if (count == 0)
+          return;
+      }
       int signed_count = count;
       RtUserEvent done_event = RtUserEvent::NO_RT_USER_EVENT;
       if (!add)
@@ -1218,6 +1250,20 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
+      // See the comment in send_remote_valid_update
+      if ((runtime->reference_batch_size > 0) && (target == owner_space))
+      {
+        if (!add)
+        {
+          runtime->defer_remote_reference_removal(target, did, 
+                                                  RESOURCE_REF_KIND, count);
+          return;
+        }
+        count = runtime->cancel_remote_reference_removals(target, did,
+                                                  RESOURCE_REF_KIND, count);
+        if (count == 0)
+          return;
+      }
       int signed_count = count;
       if (!add)
         signed_count = -signed_count;
@@ -1470,6 +1516,53 @@ namespace Legion {
         delete target;
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void DistributedCollectable::handle_did_remote_batch_update(
+                                         Runtime *runtime, Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      size_t num_updates;
+      derez.deserialize(num_updates);
+      for (unsigned idx = 0; idx < num_updates; idx++)
+      {
+        DistributedID did;
+        derez.deserialize(did);
+        unsigned valid_refs, gc_refs, resource_refs;
+        derez.deserialize(valid_refs);
+        derez.deserialize(gc_refs);
+        derez.deserialize(resource_refs);
+        // Batches are only ever sent to the owner node
+        DistributedCollectable *target = 
+          runtime->find_distributed_collectable(did);
+        // Remove the references in the same order the state machine 
+        // would see them go away: valid references before gc references
+        // before resource references. Only the last removal can be the
+        // one that allows the object to be deleted.
+        bool remove = false;
+        if (valid_refs > 0)
+          remove = target->remove_base_valid_ref(REMOTE_DID_REF, NULL,
+                                                 valid_refs);
+        if (gc_refs > 0)
+        {
+#ifdef DEBUG_LEGION
+          assert(!remove);
+#endif
+          remove = target->remove_base_gc_ref(REMOTE_DID_REF, NULL, gc_refs);
+        }
+        if (resource_refs > 0)
+        {
+#ifdef DEBUG_LEGION
+          assert(!remove);
+#endif
+          remove = target->remove_base_resource_ref(REMOTE_DID_REF,
+                                                    resource_refs);
+        }
+        if (remove)
+          delete target;
+      }
+    }
+
     //--------------------------------------------------------------------------
     /*static*/ void DistributedCollectable::handle_did_remote_invalidate(
                                           Runtime *runtime, Deserializer &derez)
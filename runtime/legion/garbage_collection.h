@@ -427,6 +427,8 @@ namespace Legion {
                                               Deserializer &derez);
       static void handle_did_remote_resource_update(Runtime *runtime,
                                                     Deserializer &derez);
+      static void handle_did_remote_batch_update(Runtime *runtime,
+                                                 Deserializer &derez);
       static void handle_did_remote_invalidate(Runtime *runtime,
                                                Deserializer &derez);
       static void handle_did_remote_deactivate(Runtime *runtime,
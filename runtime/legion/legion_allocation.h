@@ -27,6 +27,7 @@
 #include <stddef.h>
 #include <functional>
 #include <stdlib.h>
+#include <pthread.h>
 #ifndef __MACH__
 #include <malloc.h>
 #endif
@@ -143,6 +144,11 @@ namespace Legion {
       TASK_IMPL_ALLOC,
       VARIANT_IMPL_ALLOC,
       LAYOUT_CONSTRAINTS_ALLOC,
+      INDEX_SPACE_NODE_ALLOC,
+      INDEX_PART_NODE_ALLOC,
+      REGION_NODE_ALLOC,
+      PARTITION_NODE_ALLOC,
+      SLAB_ALLOC,
       LAST_ALLOC, // must be last
     };
 
@@ -417,6 +423,315 @@ namespace Legion {
       free(ptr);
     }
 
+    /**
+     * \struct SlabAllocationTrait
+     * Select which kinds of allocations are served out of the
+     * type-specific slab allocators rather than from the heap.
+     * By default this is only done for the region tree nodes and
+     * their per-context state which can number in the millions.
+     * Slab allocation can be turned off entirely by defining
+     * LEGION_DISABLE_SLAB_ALLOCATION (e.g. when debugging memory
+     * errors with valgrind or address sanitizer).
+     */
+    template<AllocationType A>
+    struct SlabAllocationTrait {
+      static const bool value = false;
+    };
+#ifndef LEGION_DISABLE_SLAB_ALLOCATION
+#define LEGION_SLAB_ALLOCATION_TYPE(type)                   \
+    template<>                                              \
+    struct SlabAllocationTrait<type> {                      \
+      static const bool value = true;                       \
+    };
+    LEGION_SLAB_ALLOCATION_TYPE(INDEX_SPACE_NODE_ALLOC)
+    LEGION_SLAB_ALLOCATION_TYPE(INDEX_PART_NODE_ALLOC)
+    LEGION_SLAB_ALLOCATION_TYPE(REGION_NODE_ALLOC)
+    LEGION_SLAB_ALLOCATION_TYPE(PARTITION_NODE_ALLOC)
+    LEGION_SLAB_ALLOCATION_TYPE(CURRENT_STATE_ALLOC)
+    LEGION_SLAB_ALLOCATION_TYPE(VERSION_MANAGER_ALLOC)
+#undef LEGION_SLAB_ALLOCATION_TYPE
+#endif
+
+    /**
+     * \class SlabAllocator
+     * A type-specific allocator that carves objects out of large
+     * slabs of memory and recycles them through a free list. Each
+     * thread keeps a small cache of free objects in front of the
+     * shared free list so that most allocations and frees do not
+     * need to synchronize with other threads. A thread's cache is
+     * given back to the shared free list when the thread exits.
+     * Slabs are never returned to the system, they are only 
+     * recycled for new objects of the same type. With allocation 
+     * tracing, SLAB_ALLOC only counts the unused part of the slabs
+     * since objects in use are counted under their own type.
+     */
+    template<typename T>
+    class SlabAllocator {
+    public:
+      struct FreeObject {
+        FreeObject *next;
+      };
+      static const size_t ALIGNMENT =
+        (AlignmentTrait<T>::AlignmentOf > sizeof(FreeObject*)) ?
+          AlignmentTrait<T>::AlignmentOf : sizeof(FreeObject*);
+      static const size_t OBJECT_SIZE =
+        ((sizeof(T) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+      static const size_t OBJECTS_PER_SLAB =
+        (LEGION_SLAB_ALLOCATION_SIZE > OBJECT_SIZE) ?
+          (LEGION_SLAB_ALLOCATION_SIZE / OBJECT_SIZE) : 1;
+      static const unsigned CACHE_SIZE = LEGION_SLAB_THREAD_CACHE_SIZE;
+    public:
+      static inline void* allocate(void);
+      static inline void deallocate(void *ptr);
+    protected:
+      static void refill_local_cache(void);
+      static void flush_local_cache(unsigned count);
+      static inline void acquire_lock(void);
+      static inline void release_lock(void);
+      static void create_thread_key(void);
+      static void thread_exit(void *arg);
+    protected:
+      // Shared state across all threads
+      static volatile int slab_lock;
+      static FreeObject *global_free;
+      // For returning a thread's cache when it exits
+      static pthread_once_t thread_key_once;
+      static pthread_key_t thread_key;
+      // Per-thread cache of free objects
+      static __thread FreeObject *local_free;
+      static __thread unsigned local_count;
+      static __thread bool local_registered;
+    };
+
+    template<typename T>
+    volatile int SlabAllocator<T>::slab_lock = 0;
+    template<typename T>
+    typename SlabAllocator<T>::FreeObject* SlabAllocator<T>::global_free = 0;
+    template<typename T>
+    __thread typename SlabAllocator<T>::FreeObject*
+                                      SlabAllocator<T>::local_free = 0;
+    template<typename T>
+    pthread_once_t SlabAllocator<T>::thread_key_once = PTHREAD_ONCE_INIT;
+    template<typename T>
+    pthread_key_t SlabAllocator<T>::thread_key;
+    template<typename T>
+    __thread unsigned SlabAllocator<T>::local_count = 0;
+    template<typename T>
+    __thread bool SlabAllocator<T>::local_registered = false;
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void* SlabAllocator<T>::allocate(void)
+    //--------------------------------------------------------------------------
+    {
+      if (local_free == NULL)
+        refill_local_cache();
+      FreeObject *result = local_free;
+      local_free = result->next;
+      local_count--;
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_free(SLAB_ALLOC, OBJECT_SIZE);
+#endif
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void SlabAllocator<T>::deallocate(void *ptr)
+    //--------------------------------------------------------------------------
+    {
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_allocation(SLAB_ALLOC, OBJECT_SIZE);
+#endif
+      FreeObject *object = static_cast<FreeObject*>(ptr);
+      object->next = local_free;
+      local_free = object;
+      // If our cache gets too big then give half of it back
+      if (++local_count >= (2 * CACHE_SIZE))
+        flush_local_cache(CACHE_SIZE);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ void SlabAllocator<T>::refill_local_cache(void)
+    //--------------------------------------------------------------------------
+    {
+      // Make sure our cache isn't stranded when this thread exits
+      if (!local_registered)
+      {
+        pthread_once(&thread_key_once, create_thread_key);
+        // The value just has to be non-NULL for the destructor to run
+        pthread_setspecific(thread_key, &local_registered);
+        local_registered = true;
+      }
+      acquire_lock();
+      // See if we can pull a batch of objects off the shared list
+      while ((global_free != NULL) && (local_count < CACHE_SIZE))
+      {
+        FreeObject *object = global_free;
+        global_free = object->next;
+        object->next = local_free;
+        local_free = object;
+        local_count++;
+      }
+      release_lock();
+      if (local_free != NULL)
+        return;
+      // Otherwise we need to make a new slab
+      char *slab = static_cast<char*>(
+        legion_alloc_aligned<OBJECT_SIZE,ALIGNMENT,true/*bytes*/>(
+                                              OBJECTS_PER_SLAB * OBJECT_SIZE));
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_allocation(SLAB_ALLOC,
+                                         OBJECTS_PER_SLAB * OBJECT_SIZE);
+#endif
+      // Keep up to the cache size locally and give the rest away
+      FreeObject *shared_head = NULL, *shared_tail = NULL;
+      for (unsigned idx = 0; idx < OBJECTS_PER_SLAB; idx++)
+      {
+        FreeObject *object =
+          reinterpret_cast<FreeObject*>(slab + idx * OBJECT_SIZE);
+        if (local_count < CACHE_SIZE)
+        {
+          object->next = local_free;
+          local_free = object;
+          local_count++;
+        }
+        else
+        {
+          object->next = shared_head;
+          if (shared_head == NULL)
+            shared_tail = object;
+          shared_head = object;
+        }
+      }
+      if (shared_head != NULL)
+      {
+        acquire_lock();
+        shared_tail->next = global_free;
+        global_free = shared_head;
+        release_lock();
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ void SlabAllocator<T>::flush_local_cache(unsigned count)
+    //--------------------------------------------------------------------------
+    {
+      if (count == 0)
+        return;
+      FreeObject *head = local_free, *tail = local_free;
+      for (unsigned idx = 1; idx < count; idx++)
+        tail = tail->next;
+      local_free = tail->next;
+      local_count -= count;
+      acquire_lock();
+      tail->next = global_free;
+      global_free = head;
+      release_lock();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ void SlabAllocator<T>::create_thread_key(void)
+    //--------------------------------------------------------------------------
+    {
+      pthread_key_create(&thread_key, thread_exit);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ void SlabAllocator<T>::thread_exit(void *arg)
+    //--------------------------------------------------------------------------
+    {
+      // Give everything in our cache back to the shared free list
+      flush_local_cache(local_count);
+      local_registered = false;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void SlabAllocator<T>::acquire_lock(void)
+    //--------------------------------------------------------------------------
+    {
+      while (__sync_lock_test_and_set(&slab_lock, 1))
+        while (slab_lock) { }
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void SlabAllocator<T>::release_lock(void)
+    //--------------------------------------------------------------------------
+    {
+      __sync_lock_release(&slab_lock);
+    }
+
+    // A class for Legion objects to inherit from to have their dynamic
+    // memory allocations served out of a type-specific slab allocator
+    // if slab allocation is enabled for their allocation type
+    template<typename T>
+    class LegionSlabify {
+    public:
+      static inline void* operator new(size_t count);
+      static inline void* operator new(size_t count, void *ptr);
+    public:
+      static inline void operator delete(void *ptr, size_t count);
+      static inline void operator delete(void *ptr, void *place);
+    };
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void* LegionSlabify<T>::operator new(size_t count)
+    //--------------------------------------------------------------------------
+    {
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_allocation(T::alloc_type, count);
+#endif
+      if (SlabAllocationTrait<T::alloc_type>::value && (count == sizeof(T)))
+        return SlabAllocator<T>::allocate();
+      return legion_alloc_aligned<T,true/*bytes*/>(count);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void* LegionSlabify<T>::operator new(size_t count,
+                                                           void *ptr)
+    //--------------------------------------------------------------------------
+    {
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_allocation(T::alloc_type, count);
+#endif
+      return ptr;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void LegionSlabify<T>::operator delete(void *ptr,
+                                                             size_t count)
+    //--------------------------------------------------------------------------
+    {
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_free(T::alloc_type, count);
+#endif
+      if (SlabAllocationTrait<T::alloc_type>::value && (count == sizeof(T)))
+        SlabAllocator<T>::deallocate(ptr);
+      else
+        free(ptr);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void LegionSlabify<T>::operator delete(void *ptr,
+                                                             void *place)
+    //--------------------------------------------------------------------------
+    {
+#ifdef TRACE_ALLOCATION
+      LegionAllocation::trace_free(T::alloc_type, sizeof(T));
+#endif
+      // Nothing to free, the memory belongs to the caller
+    }
+
     /**
      * \class AlignedAllocator
      * A class for doing aligned allocation of memory for
@@ -602,7 +602,7 @@ namespace Legion {
      * is effectively all the information at the analysis
      * wavefront for this particular logical region.
      */
-    class LogicalState : public LegionHeapify<LogicalState> {
+    class LogicalState : public LegionSlabify<LogicalState> {
     public:
       static const AllocationType alloc_type = CURRENT_STATE_ALLOC;
     public:
@@ -889,7 +889,7 @@ namespace Legion {
      * for a given logical region or partition will be assigned
      * to be the owner.
      */
-    class VersionManager : public LegionHeapify<VersionManager> {
+    class VersionManager : public LegionSlabify<VersionManager> {
     public:
       struct ProjectionEpoch {
       public:
@@ -293,6 +293,22 @@
 #define LEGION_DEFAULT_GC_EPOCH_SIZE           (DEFAULT_GC_EPOCH_SIZE)
 #endif
 #endif
+// Maximum number of intersection and dominance test results
+// cached by the region tree forest on each node. Setting
+// this to zero will leave the cache unbounded.
+#ifndef LEGION_DEFAULT_INTERSECTION_CACHE_SIZE
+#define LEGION_DEFAULT_INTERSECTION_CACHE_SIZE 65536
+#endif
+// Number of independently locked shards in the intersection cache
+#ifndef LEGION_INTERSECTION_CACHE_SHARDS
+#define LEGION_INTERSECTION_CACHE_SHARDS       16
+#endif
+// Maximum number of evicted intersections that each shard of the
+// intersection cache keeps alive for operations that might still
+// be using them, beyond this the oldest ones are destroyed
+#ifndef LEGION_MAX_RETIRED_INTERSECTIONS
+#define LEGION_MAX_RETIRED_INTERSECTIONS       1024
+#endif
 
 // Used for debugging memory leaks
 // How often tracing information is dumped
@@ -314,6 +330,94 @@
 #define LEGION_MAX_ALIGNMENT            16
 #endif
 
+// The number of bytes in each slab used for
+// allocating region tree nodes and their state
+#ifndef LEGION_SLAB_ALLOCATION_SIZE
+#define LEGION_SLAB_ALLOCATION_SIZE       65536
+#endif
+
+// The number of free objects of each type that
+// every thread caches in front of the shared
+// free list of a slab allocator
+#ifndef LEGION_SLAB_THREAD_CACHE_SIZE
+#define LEGION_SLAB_THREAD_CACHE_SIZE     64
+#endif
+
+// Maximum number of distinct distributed IDs with remote
+// reference removals buffered for each target node before
+// they are flushed together in a single message. Setting
+// this to zero sends every reference update immediately.
+#ifndef LEGION_DEFAULT_REFERENCE_BATCH_SIZE
+#define LEGION_DEFAULT_REFERENCE_BATCH_SIZE 256
+#endif
+
+// Minimum number of ready tasks that a processor must have
+// waiting to be mapped before the runtime will let idle
+// processors of the same kind steal work from it. Setting
+// this to zero leaves all stealing up to the mappers.
+#ifndef LEGION_DEFAULT_LOAD_BALANCE_THRESHOLD
+#define LEGION_DEFAULT_LOAD_BALANCE_THRESHOLD 0
+#endif
+
+// Maximum number of back-to-back scheduling passes that a
+// processor will perform in a single scheduler meta-task 
+// while the mappers keep selecting tasks to map before it
+// launches a new meta-task to let other runtime work run
+#ifndef LEGION_DEFAULT_SCHEDULER_PASSES
+#define LEGION_DEFAULT_SCHEDULER_PASSES 4
+#endif
+
+// Minimum number of task launches in a repeating sequence
+// before the runtime will automatically trace it in contexts
+// that are not already being traced by the application.
+// Setting this to zero disables automatic trace detection.
+#ifndef LEGION_DEFAULT_AUTO_TRACE_MIN_LENGTH
+#define LEGION_DEFAULT_AUTO_TRACE_MIN_LENGTH 0
+#endif
+
+// Longest repeating sequence of task launches that the
+// automatic trace detection will look for
+#ifndef LEGION_AUTO_TRACE_MAX_LENGTH
+#define LEGION_AUTO_TRACE_MAX_LENGTH      64
+#endif
+
+// Number of back-to-back repetitions of a sequence that
+// have to be observed before it is automatically traced
+#ifndef LEGION_AUTO_TRACE_MIN_REPEATS
+#define LEGION_AUTO_TRACE_MIN_REPEATS     3
+#endif
+
+// Maximum number of replayable templates that are kept
+// for each physical trace. When a new template is captured
+// the least recently replayed template is deleted. Setting
+// this to zero places no bound on the number of templates.
+#ifndef LEGION_DEFAULT_MAX_TRACE_TEMPLATES
+#define LEGION_DEFAULT_MAX_TRACE_TEMPLATES 16
+#endif
+
+// Physical templates with at least this many instructions
+// are optimized by a meta-task in the background and are
+// replayed without optimizations until it is done. Setting
+// this to zero always optimizes templates when they are
+// captured.
+#ifndef LEGION_DEFAULT_BACKGROUND_OPTIMIZATION_THRESHOLD
+#define LEGION_DEFAULT_BACKGROUND_OPTIMIZATION_THRESHOLD 4096
+#endif
+
+// The size in bytes of the per-thread profiling buffers. A thread
+// hands its buffer to the profiler writer once it has buffered
+// this much data.
+#ifndef LEGION_PROF_CHUNK_SIZE
+#define LEGION_PROF_CHUNK_SIZE (1 << 20)
+#endif
+
+// The number of children of an index partition
+// that are created together by each meta-task
+// when all the children are made in bulk
+#ifndef LEGION_CHILD_CREATION_CHUNK_SIZE
+#define LEGION_CHILD_CREATION_CHUNK_SIZE  1024
+#endif
+
 // Give an ideal upper bound on the maximum
 // number of operations Legion should keep
 // available for recycling. Where possible
@@ -1172,6 +1276,7 @@ typedef enum legion_error_t {
   LEGION_WARNING_EXTERNAL_GARBAGE_PRIORITY = 1095,
   LEGION_WARNING_MAPPER_INVALID_INSTANCE = 1096,
   LEGION_WARNING_NON_REPLAYABLE_COUNT_EXCEEDED = 1097,
+  LEGION_WARNING_PROFILER_DROPPED_RECORDS = 1098,
   
   
   LEGION_FATAL_MUST_EPOCH_NOADDRESS = 2000,
@@ -2130,7 +2130,10 @@ namespace Legion {
         total_children_count(0), total_close_count(0), total_summary_count(0),
         outstanding_children_count(0), outstanding_prepipeline(0),
         outstanding_dependence(false), current_trace(NULL),previous_trace(NULL),
-        valid_wait_event(false), outstanding_subtasks(0), pending_subtasks(0), 
+        auto_trace_detector(NULL), auto_trace(NULL), auto_trace_position(0),
+        auto_trace_count(0), auto_trace_observed(0), auto_trace_captured(0), auto_trace_replayed(0),
+        auto_trace_divergences(0), valid_wait_event(false), 
+        outstanding_subtasks(0), pending_subtasks(0), 
         pending_frames(0), currently_active_context(false),
         current_mapping_fence(NULL), mapping_fence_gen(0), 
         current_mapping_fence_index(0), current_execution_fence_index(0) 
@@ -2148,6 +2151,10 @@ namespace Legion {
       context_configuration.meta_task_vector_width = 
         runtime->initial_meta_task_vector_width;
       context_configuration.mutable_priority = false;
+      if (!remote_context && !runtime->no_tracing &&
+          (runtime->auto_trace_min_length > 0))
+        auto_trace_detector = 
+          new AutoTraceDetector(runtime->auto_trace_min_length);
 #ifdef DEBUG_LEGION
       assert(tree_context.exists());
       runtime->forest->check_context_state(tree_context);
@@ -2193,6 +2200,32 @@ namespace Legion {
           delete (it->second);
       }
       traces.clear();
+      for (std::vector<DynamicTrace*>::const_iterator it = 
+            retired_traces.begin(); it != retired_traces.end(); it++)
+      {
+        if ((*it)->remove_reference())
+          delete (*it);
+      }
+      retired_traces.clear();
+      if (auto_trace_detector != NULL)
+      {
+        for (std::map<std::vector<uint64_t>,DynamicTrace*>::const_iterator it =
+              auto_traces.begin(); it != auto_traces.end(); it++)
+        {
+          if (it->second->remove_reference())
+            delete (it->second);
+        }
+        auto_traces.clear();
+        for (std::deque<std::pair<DynamicTrace*,ApEvent> >::const_iterator
+              it = retired_auto_traces.begin(); it != 
+              retired_auto_traces.end(); it++)
+        {
+          if (it->first->remove_reference())
+            delete (it->first);
+        }
+        retired_auto_traces.clear();
+        delete auto_trace_detector;
+      }
       // Clean up any locks and barriers that the user
       // asked us to destroy
       while (!context_locks.empty())
@@ -4537,6 +4570,11 @@ namespace Legion {
                       const std::vector<StaticDependence> *dependences)
     //--------------------------------------------------------------------------
     {
+      // See if the runtime should start or stop tracing on its own
+      // before the child is given its index in the context
+      if ((auto_trace_detector != NULL) &&
+          ((current_trace == NULL) || (current_trace == auto_trace)))
+        record_auto_trace_operation(op);
       // If we are performing a trace mark that the child has a trace
       if (current_trace != NULL)
         op->set_trace(current_trace, !current_trace->is_fixed(), dependences);
@@ -5366,6 +5404,9 @@ namespace Legion {
       log_run.debug("Beginning a trace in task %s (ID %lld)",
                     get_task_name(), get_unique_id());
 #endif
+      // Application traces always take precedence over our own
+      if (auto_trace != NULL)
+        finish_auto_trace(false/*diverged*/);
       // No need to hold the lock here, this is only ever called
       // by the one thread that is running the task.
       if (current_trace != NULL)
@@ -5373,7 +5414,7 @@ namespace Legion {
           "Illegal nested trace with ID %d attempted in "
                        "task %s (ID %lld)", tid, get_task_name(),
                        get_unique_id())
-      std::map<TraceID,DynamicTrace*>::const_iterator finder = traces.find(tid);
+      std::map<TraceID,DynamicTrace*>::iterator finder = traces.find(tid);
       DynamicTrace* dynamic_trace = NULL;
       if (finder == traces.end())
       {
@@ -5381,6 +5422,33 @@ namespace Legion {
         dynamic_trace = new DynamicTrace(tid, this, logical_only);
         dynamic_trace->add_reference();
         traces[tid] = dynamic_trace;
+        // See if we can reuse the dependence analysis from a previous run,
+        // the files for the trace are named by the parent task, the trace,
+        // the node and a hash of the operations in the trace
+        if (runtime->trace_cache_directory != NULL)
+        {
+          char prefix[4096];
+          snprintf(prefix, sizeof(prefix), "%s/trace_%d_%d_%d",
+                   runtime->trace_cache_directory, owner_task->task_id, tid,
+                   runtime->address_space);
+          if (dynamic_trace->attach_cache_files(prefix,
+                DynamicTrace::compute_machine_hash(runtime)))
+            log_run.info("Replaying trace %d in task %s (UID %lld) from "
+                         "trace cache files %s_*", tid, get_task_name(),
+                         get_unique_id(), prefix);
+        }
+      }
+      else if (finder->second->has_diverged_cache())
+      {
+        // The trace loaded from the cache file did not match what the
+        // application is doing so retire it and capture the trace again
+        // which will also write out a new version of the cache file
+        dynamic_trace = new DynamicTrace(tid, this, logical_only);
+        dynamic_trace->add_reference();
+        dynamic_trace->attach_cache_files(finder->second->get_cache_prefix(),
+            DynamicTrace::compute_machine_hash(runtime), false/*load*/);
+        retired_traces.push_back(finder->second);
+        finder->second = dynamic_trace;
       }
       else
         dynamic_trace = finder->second;
@@ -5418,7 +5486,7 @@ namespace Legion {
       log_run.debug("Ending a trace in task %s (ID %lld)",
                     get_task_name(), get_unique_id());
 #endif
-      if (current_trace == NULL)
+      if ((current_trace == NULL) || (current_trace == auto_trace))
         REPORT_LEGION_ERROR(ERROR_UMATCHED_END_TRACE,
           "Unmatched end trace for ID %d in task %s "
                        "(ID %lld)", tid, get_task_name(),
@@ -5461,6 +5529,9 @@ namespace Legion {
       log_run.debug("Beginning a static trace in task %s (ID %lld)",
                     get_task_name(), get_unique_id());
 #endif
+      // Application traces always take precedence over our own
+      if (auto_trace != NULL)
+        finish_auto_trace(false/*diverged*/);
       // No need to hold the lock here, this is only ever called
       // by the one thread that is running the task.
       if (current_trace != NULL)
@@ -5485,7 +5556,7 @@ namespace Legion {
       log_run.debug("Ending a static trace in task %s (ID %lld)",
                     get_task_name(), get_unique_id());
 #endif
-      if (current_trace == NULL)
+      if ((current_trace == NULL) || (current_trace == auto_trace))
         REPORT_LEGION_ERROR(ERROR_UNMATCHED_END_STATIC_TRACE,
           "Unmatched end static trace in task %s "
                        "(ID %lld)", get_task_name(), get_unique_id())
@@ -5526,6 +5597,171 @@ namespace Legion {
         current_trace->record_blocking_call();
     }
 
+    //--------------------------------------------------------------------------
+    void InnerContext::record_auto_trace_operation(Operation *op)
+    //--------------------------------------------------------------------------
+    {
+      switch (op->get_operation_kind())
+      {
+        // These are issued for the traces themselves
+        case Operation::TRACE_CAPTURE_OP_KIND:
+        case Operation::TRACE_COMPLETE_OP_KIND:
+        case Operation::TRACE_REPLAY_OP_KIND:
+        case Operation::TRACE_BEGIN_OP_KIND:
+        case Operation::TRACE_SUMMARY_OP_KIND:
+          return;
+        case Operation::TASK_OP_KIND:
+          break;
+        default:
+          {
+            // Only task launches are fingerprinted so any other kind
+            // of operation ends the sequence and restarts detection
+            finish_auto_trace(false/*diverged*/);
+            auto_trace_detector->reset();
+            return;
+          }
+      }
+      auto_trace_observed++;
+      const uint64_t fingerprint = 
+        AutoTraceDetector::compute_fingerprint(static_cast<TaskOp*>(op));
+      if (auto_trace != NULL)
+      {
+        // If we finished another copy of the sequence then end the trace
+        if ((current_trace == auto_trace) && 
+            (auto_trace_position == auto_trace_sequence.size()))
+          end_auto_trace();
+        if (fingerprint == auto_trace_sequence[auto_trace_position])
+        {
+          if (current_trace != auto_trace)
+            begin_auto_trace();
+          if (auto_trace->is_fixed())
+            auto_trace_replayed++;
+          else
+            auto_trace_captured++;
+          auto_trace_position++;
+          return;
+        }
+        // The launch did not match the sequence we predicted
+        finish_auto_trace(true/*diverged*/);
+        auto_trace_detector->reset();
+      }
+      const unsigned length = auto_trace_detector->record_launch(fingerprint);
+      if (length == 0)
+        return;
+      // Found a sequence that has been repeated enough times, the next 
+      // launch should start another copy of it so get the trace ready
+      auto_trace_detector->get_sequence(length, auto_trace_sequence);
+      auto_trace_detector->reset();
+      std::map<std::vector<uint64_t>,DynamicTrace*>::const_iterator finder =
+        auto_traces.find(auto_trace_sequence);
+      if (finder == auto_traces.end())
+      {
+        // Give our traces IDs from the top of the range so they are
+        // easy to tell apart from application traces in messages
+        const TraceID tid = UINT_MAX - (auto_trace_count++);
+        // Automatic traces only memoize the logical dependence analysis
+        // since physical templates must know the whole sequence in advance
+        auto_trace = new DynamicTrace(tid, this, true/*logical only*/);
+        auto_trace->add_reference();
+        auto_traces[auto_trace_sequence] = auto_trace;
+      }
+      else
+        auto_trace = finder->second;
+      auto_trace_position = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::begin_auto_trace(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(auto_trace != NULL);
+      assert(current_trace == NULL);
+      assert(auto_trace_position == 0);
+#endif
+      auto_trace->clear_blocking_call();
+      TraceBeginOp *begin = runtime->get_available_begin_op();
+      begin->initialize_begin(this, auto_trace);
+      runtime->add_to_dependence_queue(this, executing_processor, begin);
+      current_trace = auto_trace;
+    }
+
+    //--------------------------------------------------------------------------
+    ApEvent InnerContext::end_auto_trace(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(auto_trace != NULL);
+      assert(current_trace == auto_trace);
+#endif
+      const bool has_blocking_call = auto_trace->has_blocking_call();
+      ApEvent fence_complete;
+      if (auto_trace->is_fixed())
+      {
+        TraceCompleteOp *complete_op = runtime->get_available_trace_op();
+        complete_op->initialize_complete(this, has_blocking_call);
+        fence_complete = complete_op->get_completion_event();
+        runtime->add_to_dependence_queue(this, executing_processor,complete_op);
+      }
+      else
+      {
+        TraceCaptureOp *capture_op = runtime->get_available_capture_op();
+        capture_op->initialize_capture(this, has_blocking_call);
+        fence_complete = capture_op->get_completion_event();
+        runtime->add_to_dependence_queue(this, executing_processor, capture_op);
+        auto_trace->fix_trace();
+      }
+      current_trace = NULL;
+      auto_trace_position = 0;
+      return fence_complete;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::finish_auto_trace(bool diverged)
+    //--------------------------------------------------------------------------
+    {
+      if (auto_trace == NULL)
+        return;
+      if (current_trace == auto_trace)
+      {
+        // Ending a replay early is safe since the trace is closed with
+        // a fence, but a capture of only part of the sequence can never
+        // be replayed so retire it and capture the sequence again later
+        const bool partial_capture = !auto_trace->is_fixed() &&
+          (auto_trace_position < auto_trace_sequence.size());
+        const ApEvent fence_complete = end_auto_trace();
+        if (partial_capture)
+        {
+          // Free the retired traces whose operations have all drained,
+          // the fence that ended each one completes after all of them
+          // and after that only the previous trace can still refer to it
+          while (!retired_auto_traces.empty() &&
+                 retired_auto_traces.front().second.has_triggered() &&
+                 (retired_auto_traces.front().first != previous_trace))
+          {
+            DynamicTrace *retired = retired_auto_traces.front().first;
+            retired_auto_traces.pop_front();
+            if (retired->remove_reference())
+              delete retired;
+          }
+          std::map<std::vector<uint64_t>,DynamicTrace*>::iterator finder =
+            auto_traces.find(auto_trace_sequence);
+#ifdef DEBUG_LEGION
+          assert(finder != auto_traces.end());
+          assert(finder->second == auto_trace);
+#endif
+          retired_auto_traces.push_back(
+              std::pair<DynamicTrace*,ApEvent>(finder->second, fence_complete));
+          auto_traces.erase(finder);
+        }
+      }
+      if (diverged)
+        auto_trace_divergences++;
+      auto_trace = NULL;
+      auto_trace_sequence.clear();
+      auto_trace_position = 0;
+    }
+
     //--------------------------------------------------------------------------
     void InnerContext::issue_frame(FrameOp *frame, ApEvent frame_termination)
     //--------------------------------------------------------------------------
@@ -6452,6 +6688,17 @@ namespace Legion {
           }
         }
       }
+      // End any trace that we started on our own and report statistics
+      if (auto_trace_detector != NULL)
+      {
+        finish_auto_trace(false/*diverged*/);
+        runtime->record_auto_trace_statistics(auto_trace_observed,
+            auto_trace_captured, auto_trace_replayed, auto_trace_divergences);
+        auto_trace_observed = 0;
+        auto_trace_captured = 0;
+        auto_trace_replayed = 0;
+        auto_trace_divergences = 0;
+      }
       // Quick check to make sure the user didn't forget to end a trace
       if (current_trace != NULL)
         REPORT_LEGION_ERROR(ERROR_TASK_FAILED_END_TRACE,
@@ -971,6 +971,12 @@ namespace Legion {
       virtual void invalidate_trace_cache(LegionTrace *trace,
                                           Operation *invalidator);
       virtual void record_blocking_call(void);
+    protected:
+      // Automatic tracing of repeated task launch sequences
+      void record_auto_trace_operation(Operation *op);
+      void begin_auto_trace(void);
+      ApEvent end_auto_trace(void);
+      void finish_auto_trace(bool diverged);
     public:
       virtual void issue_frame(FrameOp *frame, ApEvent frame_termination);
       virtual void perform_frame_issue(FrameOp *frame, 
@@ -1117,8 +1123,24 @@ namespace Legion {
     protected:
       // Traces for this task's execution
       LegionMap<TraceID,DynamicTrace*,TASK_TRACES_ALLOC>::tracked traces;
+      // Traces whose cache file did not match and were captured again
+      std::vector<DynamicTrace*> retired_traces;
       LegionTrace *current_trace;
       LegionTrace *previous_trace;
+      // Traces that the runtime detected on its own for sequences
+      // of task launches that are not traced by the application
+      AutoTraceDetector *auto_trace_detector;
+      DynamicTrace *auto_trace;
+      std::vector<uint64_t> auto_trace_sequence;
+      unsigned auto_trace_position;
+      std::map<std::vector<uint64_t>,DynamicTrace*> auto_traces;
+      // Partial captures waiting for the fence that ended them
+      std::deque<std::pair<DynamicTrace*,ApEvent> > retired_auto_traces;
+      unsigned auto_trace_count;
+      unsigned long long auto_trace_observed;
+      unsigned long long auto_trace_captured;
+      unsigned long long auto_trace_replayed;
+      unsigned long long auto_trace_divergences;
       bool valid_wait_event;
       RtUserEvent window_wait;
       std::deque<ApEvent> frame_events;
@@ -325,6 +325,13 @@ namespace Legion {
        *     operations to mutate the priority of the parent task
        *     then the mapper can use this field to alter the 
        *     priority of the parent task
+       *
+       * map_in_bulk default:false
+       *     For index space task launches, the mapper can ask the
+       *     runtime to map all the points in each slice of the launch
+       *     with a single call to map_tasks instead of performing a
+       *     separate map_task call for each point. This is ignored
+       *     for individual tasks and for must epoch launches.
        */
       struct TaskOptions {
         Processor                              initial_proc; // = current
@@ -335,6 +342,7 @@ namespace Legion {
         bool                                   memoize;  // = false
         bool                                   replicate; // = false
         TaskPriority                           parent_priority; // = current
+        bool                                   map_in_bulk; // = false
       };
       //------------------------------------------------------------------------
       virtual void select_task_options(const MapperContext    ctx,
@@ -524,6 +532,27 @@ namespace Legion {
                                   MapTaskOutput&     output) = 0;
       //------------------------------------------------------------------------
 
+      /**
+       * ----------------------------------------------------------------------
+       *  Map Tasks 
+       * ----------------------------------------------------------------------
+       * If the mapper set 'map_in_bulk' in select_task_options for an
+       * index space task launch then the runtime will map all the points
+       * of a slice with a single map_tasks call instead of invoking 
+       * map_task once per point. The 'inputs' and 'outputs' vectors are
+       * aligned with the 'tasks' vector and each pair has exactly the
+       * same meaning as for map_task. All the point tasks come from the
+       * same slice so they share their task ID, target processor and
+       * region requirement signatures which allows the mapper to make
+       * its policy decisions once for all of them. The default 
+       * implementation simply calls map_task for each point task.
+       */
+      virtual void map_tasks(const MapperContext                ctx,
+                             const std::vector<const Task*>&    tasks,
+                             const std::vector<MapTaskInput>&   inputs,
+                                   std::vector<MapTaskOutput>&  outputs);
+      //------------------------------------------------------------------------
+
       /**
        * ----------------------------------------------------------------------
        *  Select Task Variant 
@@ -92,6 +92,8 @@ namespace Legion {
       tracing = false;
       trace_local_id = (unsigned)-1;
       must_epoch = NULL;
+      if (runtime->op_stage_latencies != NULL)
+        memset(stage_times, 0, sizeof(stage_times));
 #ifdef DEBUG_LEGION
       assert(mapped_event.exists());
       assert(resolved_event.exists());
@@ -285,6 +287,7 @@ namespace Legion {
       assert(ctx != NULL);
       assert(completion_event.exists());
 #endif
+      record_stage_time(OP_CREATED_TIME);
       parent_ctx = ctx;
       track_parent = track;
       if (track_parent)
@@ -338,7 +341,9 @@ namespace Legion {
           }
         }
       }
+      record_stage_time(OP_PREPIPELINE_BEGIN_TIME);
       trigger_prepipeline_stage();
+      record_stage_time(OP_PREPIPELINE_END_TIME);
       // Trigger any guard events we might have
       if (!from_logical_analysis)
       {
@@ -704,6 +709,7 @@ namespace Legion {
         mapped = true;
       }
 #endif
+      record_stage_time(OP_MAPPED_TIME);
       Runtime::trigger_event(mapped_event, wait_on);
     }
 
@@ -719,6 +725,7 @@ namespace Legion {
             LG_THROUGHPUT_DEFERRED_PRIORITY, wait_on);
         return;
       }
+      record_stage_time(OP_EXECUTED_TIME);
       // Tell our parent context that we are done mapping
       // It's important that this is done before we mark that we
       // are executed to avoid race conditions
@@ -769,6 +776,7 @@ namespace Legion {
             LG_THROUGHPUT_DEFERRED_PRIORITY, wait_on);
         return;
       }
+      record_stage_time(OP_COMPLETED_TIME);
       bool need_trigger = false;
       // Tell our parent that we are complete
       // It's important that we do this before we mark ourselves
@@ -866,6 +874,11 @@ namespace Legion {
       // Trigger the commit event
       if (runtime->resilient_mode)
         Runtime::trigger_event(commit_event);
+      if (runtime->op_stage_latencies != NULL)
+      {
+        record_stage_time(OP_COMMITTED_TIME);
+        runtime->op_stage_latencies->record(get_operation_kind(), stage_times);
+      }
       if (do_deactivate)
         deactivate();
     }
@@ -915,6 +928,7 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(mapping_tracker == NULL);
 #endif
+      record_stage_time(OP_DEPENDENCE_BEGIN_TIME);
       // Make a dependence tracker
       mapping_tracker = new MappingDependenceTracker();
       // Register ourselves with our trace if there is one
@@ -949,6 +963,7 @@ namespace Legion {
           mapping_tracker->add_mapping_dependence(previous_mapped);
       }
 #endif
+      record_stage_time(OP_DEPENDENCE_END_TIME);
       // Cannot touch anything not on our stack after this call
       MappingDependenceTracker *tracker = mapping_tracker;
       mapping_tracker = NULL;
@@ -1553,6 +1568,210 @@ namespace Legion {
       return true;
     }
 
+    /////////////////////////////////////////////////////////////
+    // Operation Stage Latencies 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    OpStageLatencies::StageHistogram::StageHistogram(void)
+      : count(0), total(0), max(0)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < NUM_BUCKETS; idx++)
+        buckets[idx] = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned long long OpStageLatencies::StageHistogram::percentile(
+                                                         double fraction) const
+    //--------------------------------------------------------------------------
+    {
+      if (count == 0)
+        return 0;
+      // Report the upper bound of the bucket holding the percentile
+      const unsigned long long target = fraction * count;
+      unsigned long long seen = 0;
+      for (unsigned idx = 0; idx < NUM_BUCKETS; idx++)
+      {
+        seen += buckets[idx];
+        if (seen <= target)
+          continue;
+        const unsigned long long bound = 
+          (idx == (NUM_BUCKETS-1)) ? max : ((2ULL << idx) - 1);
+        return (bound < max) ? bound : max;
+      }
+      return max;
+    }
+
+    //--------------------------------------------------------------------------
+    OpStageLatencies::OpStageLatencies(Runtime *rt)
+      : runtime(rt)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned kind = 0; kind < Operation::LAST_OP_KIND; kind++)
+      {
+        op_counts[kind] = 0;
+        for (unsigned stage = 0; stage <= LAST_OP_STAGE_KIND; stage++)
+          gauges[kind][stage] = NULL;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    OpStageLatencies::OpStageLatencies(const OpStageLatencies &rhs)
+      : runtime(NULL)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+    }
+
+    //--------------------------------------------------------------------------
+    OpStageLatencies::~OpStageLatencies(void)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned kind = 0; kind < Operation::LAST_OP_KIND; kind++)
+        for (unsigned stage = 0; stage <= LAST_OP_STAGE_KIND; stage++)
+          if (gauges[kind][stage] != NULL)
+            delete gauges[kind][stage];
+    }
+
+    //--------------------------------------------------------------------------
+    OpStageLatencies& OpStageLatencies::operator=(const OpStageLatencies &rhs)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+      return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    void OpStageLatencies::record(Operation::OpKind kind, 
+                                  const long long *stage_times)
+    //--------------------------------------------------------------------------
+    {
+      // The timestamps at the start and end of each stage
+      static const Operation::OpStageTimestamp 
+        bounds[LAST_OP_STAGE_KIND][2] = {
+        { Operation::OP_CREATED_TIME, Operation::OP_DEPENDENCE_BEGIN_TIME },
+        { Operation::OP_PREPIPELINE_BEGIN_TIME, 
+          Operation::OP_PREPIPELINE_END_TIME },
+        { Operation::OP_DEPENDENCE_BEGIN_TIME, 
+          Operation::OP_DEPENDENCE_END_TIME },
+        { Operation::OP_DEPENDENCE_END_TIME, Operation::OP_READY_TIME },
+        { Operation::OP_READY_TIME, Operation::OP_MAPPED_TIME },
+        { Operation::OP_MAPPED_TIME, Operation::OP_EXECUTED_TIME },
+        { Operation::OP_EXECUTED_TIME, Operation::OP_COMPLETED_TIME },
+        { Operation::OP_COMPLETED_TIME, Operation::OP_COMMITTED_TIME },
+        { Operation::OP_CREATED_TIME, Operation::OP_COMMITTED_TIME },
+      };
+      for (unsigned stage = 0; stage < LAST_OP_STAGE_KIND; stage++)
+      {
+        const long long start = stage_times[bounds[stage][0]];
+        const long long stop = stage_times[bounds[stage][1]];
+        // Skip any stages that this operation did not go through such
+        // as operations without a prepipeline stage or point operations
+        // which are never registered with a context
+        if ((start == 0) || (stop == 0))
+          continue;
+        // Some operations finish executing before they are done
+        // mapping so clamp any overlapping stages at zero
+        const unsigned long long latency = (stop > start) ? (stop - start) : 0;
+        StageHistogram &histogram = histograms[kind][stage];
+        __sync_fetch_and_add(&histogram.count, 1);
+        const unsigned long long total = 
+          __sync_add_and_fetch(&histogram.total, latency);
+        unsigned long long current = histogram.max;
+        while (current < latency)
+        {
+          const unsigned long long previous = 
+            __sync_val_compare_and_swap(&histogram.max, current, latency);
+          if (previous == current)
+            break;
+          current = previous;
+        }
+        const unsigned bucket = (latency == 0) ? 0 :
+          (NUM_BUCKETS - 1 - __builtin_clzll(latency));
+        __sync_fetch_and_add(&histogram.buckets[bucket], 1);
+        // Racing updates can leave a gauge briefly behind the total
+        // but it will be caught up by the next operation of this kind
+        *find_gauge(kind, stage) = total;
+      }
+      *find_gauge(kind, LAST_OP_STAGE_KIND) = 
+        __sync_add_and_fetch(&op_counts[kind], 1);
+    }
+
+    //--------------------------------------------------------------------------
+    OpStageLatencies::Gauge* OpStageLatencies::find_gauge(
+                                        Operation::OpKind kind, unsigned stage)
+    //--------------------------------------------------------------------------
+    {
+      Gauge *result = gauges[kind][stage];
+      if (result != NULL)
+        return result;
+      std::string name("legion/op_stages/");
+      name += Operation::get_string_rep(kind);
+      if (stage < LAST_OP_STAGE_KIND)
+      {
+        OP_STAGE_DESCRIPTIONS(stage_names);
+        name += "/";
+        name += stage_names[stage];
+      }
+      else
+        name += "/count";
+      result = new Gauge(name, 0);
+      // If someone else beat us to it then use theirs
+      if (!__sync_bool_compare_and_swap(&gauges[kind][stage], 
+                                        (Gauge*)NULL, result))
+      {
+        delete result;
+        result = gauges[kind][stage];
+      }
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    void OpStageLatencies::report_profiling(LegionProfiler *profiler) const
+    //--------------------------------------------------------------------------
+    {
+      // The stage names were recorded when the profiler was made
+      for (unsigned kind = 0; kind < Operation::LAST_OP_KIND; kind++)
+      {
+        for (unsigned stage = 0; stage < LAST_OP_STAGE_KIND; stage++)
+        {
+          const StageHistogram &histogram = histograms[kind][stage];
+          if (histogram.count == 0)
+            continue;
+          profiler->record_op_stage(kind, (OpStageKind)stage, histogram.count,
+              histogram.total, histogram.max, histogram.percentile(0.5),
+              histogram.percentile(0.9), histogram.percentile(0.99));
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void OpStageLatencies::log_summary(void) const
+    //--------------------------------------------------------------------------
+    {
+      OP_STAGE_DESCRIPTIONS(stage_names);
+      // Times are reported in microseconds
+      for (unsigned kind = 0; kind < Operation::LAST_OP_KIND; kind++)
+      {
+        for (unsigned stage = 0; stage < LAST_OP_STAGE_KIND; stage++)
+        {
+          const StageHistogram &histogram = histograms[kind][stage];
+          if (histogram.count == 0)
+            continue;
+          log_run.print("Op Stage %s %s count %llu total %.3f p50 %.3f "
+              "p90 %.3f p99 %.3f max %.3f", 
+              Operation::get_string_rep((Operation::OpKind)kind), 
+              stage_names[stage], histogram.count, histogram.total * 1e-3,
+              histogram.percentile(0.5) * 1e-3, 
+              histogram.percentile(0.9) * 1e-3,
+              histogram.percentile(0.99) * 1e-3, histogram.max * 1e-3);
+        }
+      }
+    }
+
     /////////////////////////////////////////////////////////////
     // Predicate Operation 
     /////////////////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 #define __LEGION_OPERATIONS_H__
 
 #include "legion.h"
+#include "realm/sampling.h"
 #include "legion/runtime.h"
 #include "legion/region_tree.h"
 #include "legion/legion_mapping.h"
@@ -110,6 +111,22 @@ namespace Legion {
         "Trace Summary",            \
         "Task",                     \
       }
+      // Points in the pipeline at which we record the time for
+      // each operation when -lg:op_stages is enabled, the latency
+      // of each OpStageKind is the time between two of these
+      enum OpStageTimestamp {
+        OP_CREATED_TIME,
+        OP_PREPIPELINE_BEGIN_TIME,
+        OP_PREPIPELINE_END_TIME,
+        OP_DEPENDENCE_BEGIN_TIME,
+        OP_DEPENDENCE_END_TIME,
+        OP_READY_TIME,
+        OP_MAPPED_TIME,
+        OP_EXECUTED_TIME,
+        OP_COMPLETED_TIME,
+        OP_COMMITTED_TIME,
+        LAST_OP_TIMESTAMP,
+      };
     public:
       struct TriggerOpArgs : public LgTaskArgs<TriggerOpArgs> {
       public:
@@ -434,6 +451,9 @@ namespace Legion {
       // Quash this task and do what is necessary to the
       // rest of the operations in the graph
       void quash_operation(GenerationID gen, bool restart);
+    public:
+      // Record when this operation reached a stage of the pipeline
+      inline void record_stage_time(OpStageTimestamp stamp);
     public:
       // For operations that wish to complete early they can do so
       // using this method which will allow them to immediately 
@@ -639,6 +659,55 @@ namespace Legion {
       // Dependence trackers for detecting when it is safe to map and commit
       MappingDependenceTracker *mapping_tracker;
       CommitDependenceTracker  *commit_tracker;
+      // Times in nanoseconds at which we reached each stage of the
+      // pipeline, zero if we have not (or the stage doesn't apply)
+      long long stage_times[LAST_OP_TIMESTAMP];
+    };
+
+    /**
+     * \class OpStageLatencies
+     * Aggregates the stage timestamps recorded by operations into
+     * histograms of the latency of each stage of the pipeline for
+     * each kind of operation. The totals are also exported as Realm
+     * sampling gauges so they can be watched while the application
+     * is running, and the histograms are reported to the profiler 
+     * (or logged if it is not enabled) when the runtime shuts down.
+     */
+    class OpStageLatencies {
+    public:
+      // Power-of-two buckets in nanoseconds
+      static const unsigned NUM_BUCKETS = 64;
+      struct StageHistogram {
+      public:
+        StageHistogram(void);
+      public:
+        unsigned long long percentile(double fraction) const;
+      public:
+        unsigned long long count;
+        unsigned long long total;
+        unsigned long long max;
+        unsigned long long buckets[NUM_BUCKETS];
+      };
+      typedef Realm::ProfilingGauges::AbsoluteGauge<unsigned long long> Gauge;
+    public:
+      OpStageLatencies(Runtime *runtime);
+      OpStageLatencies(const OpStageLatencies &rhs);
+      ~OpStageLatencies(void);
+    public:
+      OpStageLatencies& operator=(const OpStageLatencies &rhs);
+    public:
+      void record(Operation::OpKind kind, const long long *stage_times);
+      void report_profiling(LegionProfiler *profiler) const;
+      void log_summary(void) const;
+    protected:
+      Gauge* find_gauge(Operation::OpKind kind, unsigned stage);
+    public:
+      Runtime *const runtime;
+    protected:
+      StageHistogram histograms[Operation::LAST_OP_KIND][LAST_OP_STAGE_KIND];
+      unsigned long long op_counts[Operation::LAST_OP_KIND];
+      // The last gauge for each kind counts the operations
+      Gauge *gauges[Operation::LAST_OP_KIND][LAST_OP_STAGE_KIND+1];
     };
 
     /**
@@ -20,6 +20,18 @@
 namespace Legion {
   namespace Internal {
 
+    /////////////////////////////////////////////////////////////
+    // Operation 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    inline void Operation::record_stage_time(OpStageTimestamp stamp)
+    //--------------------------------------------------------------------------
+    {
+      if (runtime->op_stage_latencies != NULL)
+        stage_times[stamp] = Realm::Clock::current_time_in_nanoseconds();
+    }
+
     /////////////////////////////////////////////////////////////
     // Memoizable Operation 
     /////////////////////////////////////////////////////////////
@@ -60,7 +60,7 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     LegionProfInstance::LegionProfInstance(LegionProfiler *own)
-      : owner(own)
+      : owner(own), footprint(0), next_handoff(0)
     //--------------------------------------------------------------------------
     {
     }
@@ -235,6 +235,27 @@ namespace Legion {
       owner->update_footprint(diff, this);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::process_perf_counters(
+            TaskID task_id, VariantID variant_id, UniqueID op_id,
+            const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
+            const Realm::ProfilingMeasurements::CorePerfCounters &counters)
+    //--------------------------------------------------------------------------
+    {
+      perf_counter_infos.push_back(PerfCounterInfo());
+      PerfCounterInfo &info = perf_counter_infos.back();
+      info.op_id = op_id;
+      info.task_id = task_id;
+      info.variant_id = variant_id;
+      info.proc_id = usage.proc.id;
+      info.cycles = counters.total_cycles;
+      info.instructions = counters.total_insts;
+      info.llc_misses = counters.llc_misses;
+      info.stalled_frontend = counters.stalled_cycles_frontend;
+      info.stalled_backend = counters.stalled_cycles_backend;
+      owner->update_footprint(sizeof(PerfCounterInfo), this);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfInstance::process_meta(size_t id, UniqueID op_id,
             const Realm::ProfilingMeasurements::OperationTimeline &timeline,
@@ -455,6 +476,41 @@ namespace Legion {
       owner->update_footprint(sizeof(RuntimeCallInfo), this);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::record_runtime_counter(Processor proc,
+                                  RuntimeCounterKind kind, timestamp_t time,
+                                  unsigned long long value)
+    //--------------------------------------------------------------------------
+    {
+      runtime_counter_infos.push_back(RuntimeCounterInfo());
+      RuntimeCounterInfo &info = runtime_counter_infos.back();
+      info.kind = kind;
+      info.time = time;
+      info.value = value;
+      info.proc_id = proc.id;
+      owner->update_footprint(sizeof(RuntimeCounterInfo), this);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::record_op_stage(unsigned op_kind, 
+                     OpStageKind stage, unsigned long long count, 
+                     timestamp_t total, timestamp_t max, timestamp_t p50,
+                     timestamp_t p90, timestamp_t p99)
+    //--------------------------------------------------------------------------
+    {
+      op_stage_infos.push_back(OpStageInfo());
+      OpStageInfo &info = op_stage_infos.back();
+      info.op_kind = op_kind;
+      info.stage = stage;
+      info.count = count;
+      info.total = total;
+      info.max = max;
+      info.p50 = p50;
+      info.p90 = p90;
+      info.p99 = p99;
+      owner->update_footprint(sizeof(OpStageInfo), this);
+    }
+
 #ifdef LEGION_PROF_SELF_PROFILE
     //--------------------------------------------------------------------------
     void LegionProfInstance::record_proftask(Processor proc, UniqueID op_id,
@@ -472,6 +528,83 @@ namespace Legion {
     }
 #endif
 
+    //--------------------------------------------------------------------------
+    size_t LegionProfInstance::add_footprint(size_t diff)
+    //--------------------------------------------------------------------------
+    {
+      footprint += diff;
+      return footprint;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::swap_buffers(LegionProfInstance &rhs)
+    //--------------------------------------------------------------------------
+    {
+      // Swapping deques is constant time so the thread handing
+      // off its buffers never has to walk over its records
+      task_kinds.swap(rhs.task_kinds);
+      task_variants.swap(rhs.task_variants);
+      operation_instances.swap(rhs.operation_instances);
+      multi_tasks.swap(rhs.multi_tasks);
+      slice_owners.swap(rhs.slice_owners);
+      task_infos.swap(rhs.task_infos);
+      gpu_task_infos.swap(rhs.gpu_task_infos);
+      meta_infos.swap(rhs.meta_infos);
+      copy_infos.swap(rhs.copy_infos);
+      fill_infos.swap(rhs.fill_infos);
+      inst_create_infos.swap(rhs.inst_create_infos);
+      inst_usage_infos.swap(rhs.inst_usage_infos);
+      inst_timeline_infos.swap(rhs.inst_timeline_infos);
+      partition_infos.swap(rhs.partition_infos);
+      message_infos.swap(rhs.message_infos);
+      mapper_call_infos.swap(rhs.mapper_call_infos);
+      runtime_call_infos.swap(rhs.runtime_call_infos);
+      runtime_counter_infos.swap(rhs.runtime_counter_infos);
+      perf_counter_infos.swap(rhs.perf_counter_infos);
+      op_stage_infos.swap(rhs.op_stage_infos);
+#ifdef LEGION_PROF_SELF_PROFILE
+      prof_task_infos.swap(rhs.prof_task_infos);
+#endif
+      std::swap(footprint, rhs.footprint);
+    }
+
+    //--------------------------------------------------------------------------
+    size_t LegionProfInstance::drop_records(void)
+    //--------------------------------------------------------------------------
+    {
+      // Keep the task kinds, variants, and operation descriptions
+      // since they are small and the profiles of other nodes might 
+      // still need them, but throw away all the timing records
+      size_t dropped = task_infos.size() + gpu_task_infos.size() +
+        meta_infos.size() + copy_infos.size() + fill_infos.size() +
+        inst_create_infos.size() + inst_usage_infos.size() +
+        inst_timeline_infos.size() + partition_infos.size() +
+        message_infos.size() + mapper_call_infos.size() +
+        runtime_call_infos.size() + runtime_counter_infos.size() +
+        perf_counter_infos.size() + op_stage_infos.size();
+      task_infos.clear();
+      gpu_task_infos.clear();
+      meta_infos.clear();
+      copy_infos.clear();
+      fill_infos.clear();
+      inst_create_infos.clear();
+      inst_usage_infos.clear();
+      inst_timeline_infos.clear();
+      partition_infos.clear();
+      message_infos.clear();
+      mapper_call_infos.clear();
+      runtime_call_infos.clear();
+      runtime_counter_infos.clear();
+      perf_counter_infos.clear();
+      op_stage_infos.clear();
+#ifdef LEGION_PROF_SELF_PROFILE
+      dropped += prof_task_infos.size();
+      prof_task_infos.clear();
+#endif
+      footprint = 0;
+      return dropped;
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfInstance::dump_state(LegionProfSerializer *serializer)
     //--------------------------------------------------------------------------
@@ -578,6 +711,22 @@ namespace Legion {
       {
         serializer->serialize(*it);
       }
+      for (std::deque<RuntimeCounterInfo>::const_iterator it = 
+            runtime_counter_infos.begin(); it != 
+            runtime_counter_infos.end(); it++)
+      {
+        serializer->serialize(*it);
+      }
+      for (std::deque<PerfCounterInfo>::const_iterator it = 
+            perf_counter_infos.begin(); it != perf_counter_infos.end(); it++)
+      {
+        serializer->serialize(*it);
+      }
+      for (std::deque<OpStageInfo>::const_iterator it = 
+            op_stage_infos.begin(); it != op_stage_infos.end(); it++)
+      {
+        serializer->serialize(*it);
+      }
 #ifdef LEGION_PROF_SELF_PROFILE
       for (std::deque<ProfTaskInfo>::const_iterator it = 
             prof_task_infos.begin(); it != prof_task_infos.end(); it++)
@@ -589,203 +738,26 @@ namespace Legion {
       task_variants.clear();
       operation_instances.clear();
       multi_tasks.clear();
+      slice_owners.clear();
       task_infos.clear();
       gpu_task_infos.clear();
       meta_infos.clear();
       copy_infos.clear();
+      fill_infos.clear();
       inst_create_infos.clear();
       inst_usage_infos.clear();
       inst_timeline_infos.clear();
       partition_infos.clear();
       message_infos.clear();
       mapper_call_infos.clear();
-    }
-
-    //--------------------------------------------------------------------------
-    size_t LegionProfInstance::dump_inter(LegionProfSerializer *serializer,
-                                          const double over)
-    //--------------------------------------------------------------------------
-    {
-      // Start the timing so we know how long we are taking
-      const long long t_start = Realm::Clock::current_time_in_microseconds();
-      // Scale our latency by how much we are over the space limit
-      const long long t_stop = t_start + over * owner->output_target_latency;
-      size_t diff = 0; 
-      while (!task_kinds.empty())
-      {
-        TaskKind &front = task_kinds.front();
-        serializer->serialize(front);
-        diff += sizeof(front) + strlen(front.name);
-        free(const_cast<char*>(front.name));
-        task_kinds.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!task_variants.empty())
-      {
-        TaskVariant &front = task_variants.front();
-        serializer->serialize(front);
-        diff += sizeof(front) + strlen(front.name);
-        free(const_cast<char*>(front.name));
-        task_variants.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!operation_instances.empty())
-      {
-        OperationInstance &front = operation_instances.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        operation_instances.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!multi_tasks.empty())
-      {
-        MultiTask &front = multi_tasks.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        multi_tasks.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!slice_owners.empty())
-      {
-        SliceOwner &front = slice_owners.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        slice_owners.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!task_infos.empty())
-      {
-        TaskInfo &front = task_infos.front();
-        serializer->serialize(front);
-        // Have to do all of these now
-        for (std::deque<WaitInfo>::const_iterator wit =
-              front.wait_intervals.begin(); wit != 
-              front.wait_intervals.end(); wit++)
-          serializer->serialize(*wit, front);
-        diff += sizeof(front) + front.wait_intervals.size() * sizeof(WaitInfo);
-        task_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!meta_infos.empty())
-      {
-        MetaInfo &front = meta_infos.front();
-        serializer->serialize(front);
-        // Have to do all of these now
-        for (std::deque<WaitInfo>::const_iterator wit =
-              front.wait_intervals.begin(); wit != 
-              front.wait_intervals.end(); wit++)
-          serializer->serialize(*wit, front);
-        diff += sizeof(front) + front.wait_intervals.size() * sizeof(WaitInfo);
-        meta_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!copy_infos.empty())
-      {
-        CopyInfo &front = copy_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        copy_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!fill_infos.empty())
-      {
-        FillInfo &front = fill_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        fill_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!inst_create_infos.empty())
-      {
-        InstCreateInfo &front = inst_create_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        inst_create_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!inst_timeline_infos.empty())
-      {
-        InstTimelineInfo &front = inst_timeline_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        inst_timeline_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!partition_infos.empty())
-      {
-        PartitionInfo &front = partition_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        partition_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!message_infos.empty())
-      {
-        MessageInfo &front = message_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        message_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!mapper_call_infos.empty())
-      {
-        MapperCallInfo &front = mapper_call_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        mapper_call_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
-      while (!runtime_call_infos.empty())
-      {
-        RuntimeCallInfo &front = runtime_call_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        runtime_call_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
+      runtime_call_infos.clear();
+      runtime_counter_infos.clear();
+      perf_counter_infos.clear();
+      op_stage_infos.clear();
 #ifdef LEGION_PROF_SELF_PROFILE
-      while (!prof_task_infos.empty())
-      {
-        ProfTaskInfo &front = prof_task_infos.front();
-        serializer->serialize(front);
-        diff += sizeof(front);
-        prof_task_infos.pop_front();
-        const long long t_curr = Realm::Clock::current_time_in_microseconds();
-        if (t_curr >= t_stop)
-          return diff;
-      }
+      prof_task_infos.clear();
 #endif
-      return diff;
+      footprint = 0;
     }
 
     //--------------------------------------------------------------------------
@@ -799,14 +771,19 @@ namespace Legion {
                                    const char *prof_logfile,
                                    const size_t total_runtime_instances,
                                    const size_t footprint_threshold,
-                                   const size_t target_latency)
+                                   const size_t target_latency,
+                                   const unsigned summary_interval,
+                                   const unsigned rate,
+                                   const bool counters)
       : runtime(rt), done_event(Runtime::create_rt_user_event()), 
         output_footprint_threshold(footprint_threshold), 
         output_target_latency(target_latency), target_proc(target), 
+        sample_rate((rate > 0) ? rate : 1), perf_counters(counters),
 #ifndef DEBUG_LEGION
         total_outstanding_requests(1/*start with guard*/),
 #endif
-        total_memory_footprint(0)
+        aggregate_records(false), handoff_interval(0), writer_active(false),
+        total_memory_footprint(0), total_dropped_records(0)
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
@@ -848,10 +825,26 @@ namespace Legion {
                     "<logfile_name>' instead")
         serializer = new LegionProfASCIISerializer();
       } 
+      else if (!strcmp(serializer_type, "summary"))
+      {
+        if (prof_logfile != NULL) 
+          REPORT_LEGION_WARNING(LEGION_WARNING_UNUSED_PROFILING_FILE_NAME,
+                    "You should not specify -lg:prof_logfile "
+                    "<logfile_name> when running with -lg:serializer summary"
+                    "\n       legion_prof_summary output will be written to "
+                    "'-logfile <logfile_name>' instead")
+        serializer = new LegionProfSummarySerializer(target.address_space(),
+                                                     summary_interval, 
+                                                     sample_rate);
+        // Threads hand off their records at least once per summary
+        // interval so that each summary sees the recent records
+        aggregate_records = true;
+        handoff_interval = timestamp_t(summary_interval) * 1000000000LL;
+      }
       else 
         REPORT_LEGION_ERROR(ERROR_INVALID_PROFILER_SERIALIZER,
-                "Invalid serializer (%s), must be 'binary' "
-                "or 'ascii'\n", serializer_type)
+                "Invalid serializer (%s), must be 'binary', "
+                "'ascii' or 'summary'\n", serializer_type)
 
       for (unsigned idx = 0; idx < num_meta_tasks; idx++)
       {
@@ -892,13 +885,17 @@ namespace Legion {
         total_outstanding_requests[idx] = 0;
       total_outstanding_requests[LEGION_PROF_META] = 1; // guard
 #endif
+      for (unsigned idx = 0; idx < LEGION_PROF_LAST; idx++)
+        sample_counters[idx] = 0;
+      meta_sample_counters.resize(num_meta_tasks, 0);
     }
 
     //--------------------------------------------------------------------------
     LegionProfiler::LegionProfiler(const LegionProfiler &rhs)
       : runtime(NULL), done_event(RtUserEvent::NO_RT_USER_EVENT),
         output_footprint_threshold(0), output_target_latency(0), 
-        target_proc(rhs.target_proc)
+        target_proc(rhs.target_proc), sample_rate(rhs.sample_rate),
+        perf_counters(rhs.perf_counters)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -912,7 +909,10 @@ namespace Legion {
       for (std::vector<LegionProfInstance*>::const_iterator it = 
             instances.begin(); it != instances.end(); it++)
         delete (*it);
-
+      // Chunks handed off after we finalized the profiler are dropped
+      for (std::deque<LegionProfInstance*>::const_iterator it = 
+            pending_chunks.begin(); it != pending_chunks.end(); it++)
+        delete (*it);
       // remove our serializer
       delete serializer;
     }
@@ -981,6 +981,8 @@ namespace Legion {
                                     TaskID tid, VariantID vid, SingleTask *task)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_TASK, tid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_TASK);
 #else
@@ -998,6 +1000,9 @@ namespace Legion {
                 Realm::ProfilingMeasurements::OperationProcessorUsage>();
       req.add_measurement<
                 Realm::ProfilingMeasurements::OperationEventWaits>();
+      if (perf_counters)
+        req.add_measurement<
+                Realm::ProfilingMeasurements::CorePerfCounters>();
     }
 
     //--------------------------------------------------------------------------
@@ -1005,6 +1010,8 @@ namespace Legion {
 				      TaskID tid, VariantID vid, SingleTask *task)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_GPU_TASK, tid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_GPU_TASK);
 #else
@@ -1031,6 +1038,8 @@ namespace Legion {
                                           LgTaskID tid, Operation *op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_META, tid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_META);
 #else
@@ -1073,6 +1082,8 @@ namespace Legion {
                                           Operation *op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_COPY, 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_COPY);
 #else
@@ -1094,6 +1105,8 @@ namespace Legion {
                                           Operation *op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_FILL, 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_FILL);
 #else
@@ -1163,6 +1176,8 @@ namespace Legion {
                                         TaskID tid, VariantID vid, UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_TASK, tid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_TASK);
 #else
@@ -1180,6 +1195,9 @@ namespace Legion {
                 Realm::ProfilingMeasurements::OperationProcessorUsage>();
       req.add_measurement<
                 Realm::ProfilingMeasurements::OperationEventWaits>();
+      if (perf_counters)
+        req.add_measurement<
+                Realm::ProfilingMeasurements::CorePerfCounters>();
     }
 
     //--------------------------------------------------------------------------
@@ -1187,6 +1205,8 @@ namespace Legion {
                                           LgTaskID tid, UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_META, tid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_META);
 #else
@@ -1210,6 +1230,8 @@ namespace Legion {
                                           UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_COPY, 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_COPY);
 #else
@@ -1231,6 +1253,8 @@ namespace Legion {
                                           UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_request(LEGION_PROF_FILL, 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_FILL);
 #else
@@ -1359,8 +1383,16 @@ namespace Legion {
                   Realm::ProfilingMeasurements::OperationEventWaits>(waits);
             // Ignore anything that was predicated false for now
             if (has_usage)
+            {
               thread_local_profiling_instance->process_task(info->id, 
                   info->id2, info->op_id, timeline, usage, waits);
+              // Counters are missing if the hardware does not support them
+              Realm::ProfilingMeasurements::CorePerfCounters counters;
+              if (perf_counters && response.get_measurement<
+                    Realm::ProfilingMeasurements::CorePerfCounters>(counters))
+                thread_local_profiling_instance->process_perf_counters(
+                    info->id, info->id2, info->op_id, usage, counters);
+            }
             break;
           }
         case LEGION_PROF_META:
@@ -1513,10 +1545,58 @@ namespace Legion {
 #endif
       if (!done_event.has_triggered())
         done_event.wait();
+      // Wait for any writer to finish and then prevent any more
+      // from being launched so we can use the serializer here
+      while (true)
+      {
+        RtEvent wait_on;
+        {
+          AutoLock p_lock(profiler_lock);
+          if (!writer_active)
+          {
+            writer_active = true;
+            break;
+          }
+          if (!writer_drained.exists())
+            writer_drained = Runtime::create_rt_user_event();
+          wait_on = writer_drained;
+        }
+        wait_on.wait();
+      }
+      // Record the sampling rate so tools can scale up what they see
+      if (sample_rate > 1)
+        record_runtime_counter(PROFILER_SAMPLE_RATE_COUNTER, sample_rate);
+      if (total_dropped_records > 0)
+      {
+        REPORT_LEGION_WARNING(LEGION_WARNING_PROFILER_DROPPED_RECORDS,
+            "The Legion profiler dropped %zd records on node %d because "
+            "the writer could not keep up. Consider increasing the "
+            "buffer size with -lg:prof_footprint.", total_dropped_records,
+            runtime->address_space)
+        record_runtime_counter(PROFILER_DROPPED_RECORDS_COUNTER,
+                               total_dropped_records);
+      }
+      // Other threads can still hand off chunks or make new instances
+      // so take what they have published so far under the lock
+      std::deque<LegionProfInstance*> to_dump;
+      std::vector<LegionProfInstance*> to_flush;
+      {
+        AutoLock p_lock(profiler_lock);
+        to_dump.swap(pending_chunks);
+        to_flush = instances;
+      }
+      while (!to_dump.empty())
+      {
+        LegionProfInstance *chunk = to_dump.front();
+        to_dump.pop_front();
+        chunk->dump_state(serializer);
+        delete chunk;
+      }
       for (std::vector<LegionProfInstance*>::const_iterator it = 
-            instances.begin(); it != instances.end(); it++) {
+            to_flush.begin(); it != to_flush.end(); it++) {
         (*it)->dump_state(serializer);
       }  
+      serializer->finalize();
     }
 
     //--------------------------------------------------------------------------
@@ -1608,6 +1688,60 @@ namespace Legion {
                                                            start, stop);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfiler::record_runtime_counter_kinds(const char *const *const
+                                  counter_names, unsigned int num_counter_kinds)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < num_counter_kinds; idx++)
+      {
+        LegionProfDesc::RuntimeCounterDesc counter_desc;
+        counter_desc.kind = idx;
+        counter_desc.name = counter_names[idx];
+        serializer->serialize(counter_desc);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::record_runtime_counter(RuntimeCounterKind kind,
+                                                unsigned long long value)
+    //--------------------------------------------------------------------------
+    {
+      Processor current = Processor::get_executing_processor();
+      const timestamp_t time = Realm::Clock::current_time_in_nanoseconds();
+      if (thread_local_profiling_instance == NULL)
+        create_thread_local_profiling_instance();
+      thread_local_profiling_instance->record_runtime_counter(current, kind,
+                                                              time, value);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::record_op_stage_kinds(const char *const *const
+                                      stage_names, unsigned int num_stage_kinds)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < num_stage_kinds; idx++)
+      {
+        LegionProfDesc::OpStageDesc stage_desc;
+        stage_desc.kind = idx;
+        stage_desc.name = stage_names[idx];
+        serializer->serialize(stage_desc);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::record_op_stage(unsigned op_kind, OpStageKind stage,
+                     unsigned long long count, timestamp_t total, 
+                     timestamp_t max, timestamp_t p50, timestamp_t p90,
+                     timestamp_t p99)
+    //--------------------------------------------------------------------------
+    {
+      if (thread_local_profiling_instance == NULL)
+        create_thread_local_profiling_instance();
+      thread_local_profiling_instance->record_op_stage(op_kind, stage, count,
+                                                  total, max, p50, p90, p99);
+    }
+
 #ifdef DEBUG_LEGION
     //--------------------------------------------------------------------------
     void LegionProfiler::increment_total_outstanding_requests(
@@ -1665,45 +1799,150 @@ namespace Legion {
     }
 #endif
 
+    //--------------------------------------------------------------------------
+    bool LegionProfiler::sample_request(ProfilingKind kind, unsigned id)
+    //--------------------------------------------------------------------------
+    {
+      if (sample_rate == 1)
+        return true;
+      // Counting per kind of task makes the choice deterministic for a 
+      // given launch order and keeps rare tasks from never being sampled
+      unsigned count;
+      switch (kind)
+      {
+        case LEGION_PROF_META:
+          {
+#ifdef DEBUG_LEGION
+            assert(id < meta_sample_counters.size());
+#endif
+            count = __sync_fetch_and_add(&meta_sample_counters[id], 1);
+            break;
+          }
+        case LEGION_PROF_TASK:
+        case LEGION_PROF_GPU_TASK:
+          {
+            // Application task IDs can be sparse so look them up
+            AutoLock s_lock(sample_lock);
+            count = task_sample_counters[
+              std::pair<ProfilingKind,unsigned>(kind, id)]++;
+            break;
+          }
+        default:
+          {
+            // Copies and fills share one counter for each kind
+            count = __sync_fetch_and_add(&sample_counters[kind], 1);
+            break;
+          }
+      }
+      return ((count % sample_rate) == 0);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfiler::update_footprint(size_t diff, LegionProfInstance *inst)
     //--------------------------------------------------------------------------
     {
-      size_t footprint = __sync_add_and_fetch(&total_memory_footprint, diff);
-      if (footprint > output_footprint_threshold)
+      const size_t footprint = inst->add_footprint(diff);
+      if (footprint < LEGION_PROF_CHUNK_SIZE)
+      {
+        // Summaries also need the records of threads that are slow
+        // to fill up their buffers so hand those off periodically
+        if (handoff_interval == 0)
+          return;
+        const timestamp_t now = Realm::Clock::current_time_in_nanoseconds();
+        if (inst->next_handoff == 0)
+          inst->next_handoff = now + handoff_interval;
+        if (now < inst->next_handoff)
+          return;
+        inst->next_handoff = now + handoff_interval;
+      }
+      // This thread's buffers are full so hand them off to the writer.
+      // Always let at least one chunk through, but if the writer can't
+      // keep up then drop records rather than growing without bound.
+      // Aggregating serializers are cheap enough to always keep up.
+      const size_t prev = 
+        __sync_fetch_and_add(&total_memory_footprint, footprint);
+      if (!aggregate_records && (prev > 0) && 
+          ((prev + footprint) > output_footprint_threshold))
+      {
+        __sync_fetch_and_sub(&total_memory_footprint, footprint);
+        const size_t dropped = inst->drop_records();
+        __sync_fetch_and_add(&total_dropped_records, dropped);
+        return;
+      }
+      LegionProfInstance *chunk = new LegionProfInstance(this);
+      chunk->swap_buffers(*inst);
+      bool launch_writer = false;
       {
-        // An important bit of logic here, if we're over the threshold then
-        // we want to have a little bit of a feedback loop so the more over
-        // the limit we are then the more time we give the profiler to dump
-        // out things to the output file. We'll try to make this continuous
-        // so there are no discontinuities in performance. If the threshold
-        // is zero we'll just choose an arbitrarily large scale factor to 
-        // ensure that things work properly.
-        double over_scale = output_footprint_threshold == 0 ? double(1 << 20) :
-                        double(footprint) / double(output_footprint_threshold);
-        // Let's actually make this quadratic so it's not just linear
-        if (output_footprint_threshold > 0)
-          over_scale *= over_scale;
-        if (!serializer->is_thread_safe())
+        AutoLock p_lock(profiler_lock);
+        pending_chunks.push_back(chunk);
+        if (!writer_active)
+        {
+          writer_active = true;
+          launch_writer = true;
+        }
+      }
+      if (launch_writer)
+      {
+        ProfilerWriterArgs args(this);
+        runtime->issue_runtime_meta_task(args, LG_THROUGHPUT_WORK_PRIORITY);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfiler::write_pending_chunks(void)
+    //--------------------------------------------------------------------------
+    {
+      // Only one writer is ever active at a time so it owns the serializer
+      const long long t_stop = 
+        Realm::Clock::current_time_in_microseconds() + output_target_latency;
+      while (true)
+      {
+        LegionProfInstance *chunk = NULL;
+        RtUserEvent to_trigger;
         {
-          // Need a lock to protect the serializer
           AutoLock p_lock(profiler_lock);
-          diff = inst->dump_inter(serializer, over_scale);
+          if (pending_chunks.empty())
+          {
+            writer_active = false;
+            to_trigger = writer_drained;
+            writer_drained = RtUserEvent::NO_RT_USER_EVENT;
+          }
+          else
+          {
+            chunk = pending_chunks.front();
+            pending_chunks.pop_front();
+          }
+        }
+        if (chunk == NULL)
+        {
+          if (to_trigger.exists())
+            Runtime::trigger_event(to_trigger);
+          return;
+        }
+        const size_t footprint = chunk->footprint;
+        chunk->dump_state(serializer);
+        delete chunk;
+        __sync_fetch_and_sub(&total_memory_footprint, footprint);
+        serializer->checkpoint(Realm::Clock::current_time_in_nanoseconds());
+        // If we've been running for long enough then launch another
+        // writer so we don't monopolize the utility processor
+        if (Realm::Clock::current_time_in_microseconds() >= t_stop)
+        {
+          ProfilerWriterArgs args(this);
+          runtime->issue_runtime_meta_task(args, LG_THROUGHPUT_WORK_PRIORITY);
+          return;
         }
-        else
-          diff = inst->dump_inter(serializer, over_scale);
-#ifdef DEBUG_LEGION
-#ifndef NDEBUG
-        footprint = 
-#endif
-#endif
-          __sync_fetch_and_sub(&total_memory_footprint, diff);
-#ifdef DEBUG_LEGION
-        assert(footprint >= diff); // check for wrap-around
-#endif
       }
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void LegionProfiler::handle_profiler_writer(const void *args)
+    //--------------------------------------------------------------------------
+    {
+      const ProfilerWriterArgs *wargs = (const ProfilerWriterArgs*)args;
+      wargs->profiler->write_pending_chunks();
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfiler::create_thread_local_profiling_instance(void)
     //--------------------------------------------------------------------------
@@ -77,6 +77,16 @@ namespace Legion {
         unsigned kind;
         const char *name;
       };
+      struct RuntimeCounterDesc {
+      public:
+        unsigned kind;
+        const char *name;
+      };
+      struct OpStageDesc {
+      public:
+        unsigned kind;
+        const char *name;
+      };
       struct MetaDesc {
       public:
         unsigned kind;
@@ -217,6 +227,31 @@ namespace Legion {
         timestamp_t start, stop;
         ProcID proc_id;
       };
+      struct RuntimeCounterInfo {
+      public:
+        RuntimeCounterKind kind;
+        timestamp_t time;
+        unsigned long long value;
+        ProcID proc_id;
+      };
+      struct PerfCounterInfo {
+      public:
+        UniqueID op_id;
+        TaskID task_id;
+        VariantID variant_id;
+        ProcID proc_id;
+        // -1 for any counter the hardware could not provide
+        long long cycles, instructions, llc_misses;
+        long long stalled_frontend, stalled_backend;
+      };
+      struct OpStageInfo {
+      public:
+        unsigned op_kind;
+        OpStageKind stage;
+        unsigned long long count;
+        // All in nanoseconds
+        timestamp_t total, max, p50, p90, p99;
+      };
 #ifdef LEGION_PROF_SELF_PROFILE
       struct ProfTaskInfo {
       public:
@@ -249,6 +284,10 @@ namespace Legion {
             const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
             const Realm::ProfilingMeasurements::OperationEventWaits &waits,
             const Realm::ProfilingMeasurements::OperationTimelineGPU &timeline_gpu);
+      void process_perf_counters(TaskID task_id, VariantID variant_id,
+            UniqueID op_id, 
+            const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
+            const Realm::ProfilingMeasurements::CorePerfCounters &counters);
       void process_meta(size_t id, UniqueID op_id,
             const Realm::ProfilingMeasurements::OperationTimeline &timeline,
             const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
@@ -279,16 +318,32 @@ namespace Legion {
                               timestamp_t stop);
       void record_runtime_call(Processor proc, RuntimeCallKind kind,
                                timestamp_t start, timestamp_t stop);
+      void record_runtime_counter(Processor proc, RuntimeCounterKind kind,
+                                  timestamp_t time, unsigned long long value);
+      void record_op_stage(unsigned op_kind, OpStageKind stage,
+                           unsigned long long count, timestamp_t total,
+                           timestamp_t max, timestamp_t p50,
+                           timestamp_t p90, timestamp_t p99);
 #ifdef LEGION_PROF_SELF_PROFILE
     public:
       void record_proftask(Processor p, UniqueID op_id, timestamp_t start,
                            timestamp_t stop);
 #endif
+    public:
+      // Only the thread that owns this instance appends to it
+      // so these don't need any synchronization
+      size_t add_footprint(size_t diff);
+      void swap_buffers(LegionProfInstance &rhs);
+      size_t drop_records(void);
     public:
       void dump_state(LegionProfSerializer *serializer);
-      size_t dump_inter(LegionProfSerializer *serializer, const double over);
-    private:
+    public:
       LegionProfiler *const owner;
+      // Bytes buffered since the last hand-off to the writer
+      size_t footprint;
+      // When the buffers are next handed off even if they are not full
+      timestamp_t next_handoff;
+    private:
       std::deque<TaskKind>          task_kinds;
       std::deque<TaskVariant>       task_variants;
       std::deque<OperationInstance> operation_instances;
@@ -308,6 +363,9 @@ namespace Legion {
       std::deque<MessageInfo> message_infos;
       std::deque<MapperCallInfo> mapper_call_infos;
       std::deque<RuntimeCallInfo> runtime_call_infos;
+      std::deque<RuntimeCounterInfo> runtime_counter_infos;
+      std::deque<PerfCounterInfo> perf_counter_infos;
+      std::deque<OpStageInfo> op_stage_infos;
 #ifdef LEGION_PROF_SELF_PROFILE
     private:
       std::deque<ProfTaskInfo> prof_task_infos;
@@ -336,6 +394,15 @@ namespace Legion {
         size_t id, id2;
         UniqueID op_id;
       };
+      struct ProfilerWriterArgs : public LgTaskArgs<ProfilerWriterArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_PROFILER_WRITER_TASK_ID;
+      public:
+        ProfilerWriterArgs(LegionProfiler *p)
+          : LgTaskArgs<ProfilerWriterArgs>(0), profiler(p) { }
+      public:
+        LegionProfiler *const profiler;
+      };
     public:
       // Statically known information passed through the constructor
       // so that it can be deduplicated
@@ -348,7 +415,10 @@ namespace Legion {
                      const char *prof_logname,
                      const size_t total_runtime_instances,
                      const size_t footprint_threshold,
-                     const size_t target_latency);
+                     const size_t target_latency,
+                     const unsigned summary_interval,
+                     const unsigned sample_rate,
+                     const bool perf_counters);
       LegionProfiler(const LegionProfiler &rhs);
       virtual ~LegionProfiler(void);
     public:
@@ -426,6 +496,18 @@ namespace Legion {
       void record_runtime_call(RuntimeCallKind kind, timestamp_t start,
                                timestamp_t stop);
     public:
+      void record_runtime_counter_kinds(const char *const *const counter_names,
+                                        unsigned int num_counter_kinds);
+      void record_runtime_counter(RuntimeCounterKind kind, 
+                                  unsigned long long value);
+    public:
+      void record_op_stage_kinds(const char *const *const stage_names,
+                                 unsigned int num_stage_kinds);
+      void record_op_stage(unsigned op_kind, OpStageKind stage,
+                           unsigned long long count, timestamp_t total,
+                           timestamp_t max, timestamp_t p50,
+                           timestamp_t p90, timestamp_t p99);
+    public:
 #ifdef DEBUG_LEGION
       void increment_total_outstanding_requests(ProfilingKind kind,
                                                 unsigned cnt = 1);
@@ -435,22 +517,36 @@ namespace Legion {
       void increment_total_outstanding_requests(unsigned cnt = 1);
       void decrement_total_outstanding_requests(unsigned cnt = 1);
 #endif
+    public:
+      // Decide whether to profile the next operation of this kind
+      bool sample_request(ProfilingKind kind, unsigned id);
     public:
       void update_footprint(size_t diff, LegionProfInstance *inst);
+      void write_pending_chunks(void);
+      static void handle_profiler_writer(const void *args);
     private:
       void create_thread_local_profiling_instance(void);
     public:
       Runtime *const runtime;
       // Event to trigger once the profiling is actually done
       const RtUserEvent done_event;
-      // Size in bytes of the footprint before we start dumping
+      // Size in bytes of the buffers waiting on the writer
+      // before we start dropping records
       const size_t output_footprint_threshold;
-      // The goal size in microseconds of the output tasks
+      // The goal size in microseconds of the writer tasks
       const long long output_target_latency;
       // Target processor on which to launch jobs
       const Processor target_proc;
+      // Only profile one in this many tasks, copies, fills and meta-tasks
+      const unsigned sample_rate;
+      // Collect hardware performance counters for application tasks
+      const bool perf_counters;
     private:
       LegionProfSerializer* serializer;
+      // Serializers that only aggregate never have records dropped and
+      // get the buffers of each thread at least this often (nanoseconds)
+      bool aggregate_records;
+      timestamp_t handoff_interval;
       mutable LocalLock profiler_lock;
       std::vector<LegionProfInstance*> instances;
 #ifdef DEBUG_LEGION
@@ -459,8 +555,23 @@ namespace Legion {
       unsigned total_outstanding_requests;
 #endif
     private:
-      // For knowing when we need to start dumping early
+      // Buffers handed off by threads waiting to be written out
+      std::deque<LegionProfInstance*> pending_chunks;
+      RtUserEvent writer_drained;
+      bool writer_active;
+      // For knowing when we need to start dropping records
       size_t total_memory_footprint;
+      size_t total_dropped_records;
+    private:
+      // Counters for sampling kept for each task ID so that each kind
+      // of task is sampled on its own and its first launch is always
+      // profiled. Copies and fills have no ID so each of them shares
+      // a single counter for its profiling kind.
+      unsigned sample_counters[LEGION_PROF_LAST];
+      // Meta-task IDs are dense so they are indexed directly
+      std::vector<unsigned> meta_sample_counters;
+      mutable LocalLock sample_lock;
+      std::map<std::pair<ProfilingKind,unsigned>,unsigned> task_sample_counters;
     };
 
     class DetailedProfiler {
@@ -13,6 +13,7 @@ namespace Legion {
   namespace Internal {
 
     extern Realm::Logger log_prof;
+    extern Realm::Logger log_prof_summary;
 
     //--------------------------------------------------------------------------
     LegionProfBinarySerializer::LegionProfBinarySerializer(std::string filename)
@@ -66,6 +67,18 @@ namespace Legion {
          << "name:string:" << "-1"
          << "}" << std::endl;
 
+      ss << "RuntimeCounterDesc {" 
+         << "id:" << RUNTIME_COUNTER_DESC_ID        << delim
+         << "kind:unsigned:"     << sizeof(unsigned) << delim
+         << "name:string:" << "-1"
+         << "}" << std::endl;
+
+      ss << "OpStageDesc {" 
+         << "id:" << OP_STAGE_DESC_ID               << delim
+         << "kind:unsigned:"     << sizeof(unsigned) << delim
+         << "name:string:" << "-1"
+         << "}" << std::endl;
+
       ss << "MetaDesc {" 
          << "id:" << META_DESC_ID                   << delim
          << "kind:unsigned:"     << sizeof(unsigned) << delim
@@ -259,6 +272,39 @@ namespace Legion {
          << "proc_id:ProcID:"       << sizeof(ProcID)
          << "}" << std::endl;
 
+      ss << "RuntimeCounterInfo {"
+         << "id:" << RUNTIME_COUNTER_INFO_ID                         << delim
+         << "kind:RuntimeCounterKind:" << sizeof(RuntimeCounterKind) << delim
+         << "time:timestamp_t:"        << sizeof(timestamp_t)        << delim
+         << "value:unsigned long long:" << sizeof(unsigned long long) << delim
+         << "proc_id:ProcID:"          << sizeof(ProcID)
+         << "}" << std::endl;
+
+      ss << "PerfCounterInfo {"
+         << "id:" << PERF_COUNTER_INFO_ID                          << delim
+         << "op_id:UniqueID:"             << sizeof(UniqueID)      << delim
+         << "task_id:TaskID:"             << sizeof(TaskID)        << delim
+         << "variant_id:VariantID:"       << sizeof(VariantID)     << delim
+         << "proc_id:ProcID:"             << sizeof(ProcID)        << delim
+         << "cycles:long long:"           << sizeof(long long)     << delim
+         << "instructions:long long:"     << sizeof(long long)     << delim
+         << "llc_misses:long long:"       << sizeof(long long)     << delim
+         << "stalled_frontend:long long:" << sizeof(long long)     << delim
+         << "stalled_backend:long long:"  << sizeof(long long)
+         << "}" << std::endl;
+
+      ss << "OpStageInfo {"
+         << "id:" << OP_STAGE_INFO_ID                               << delim
+         << "op_kind:unsigned:"         << sizeof(unsigned)          << delim
+         << "stage:OpStageKind:"        << sizeof(OpStageKind)       << delim
+         << "count:unsigned long long:" << sizeof(unsigned long long) << delim
+         << "total:timestamp_t:"        << sizeof(timestamp_t)       << delim
+         << "max:timestamp_t:"          << sizeof(timestamp_t)       << delim
+         << "p50:timestamp_t:"          << sizeof(timestamp_t)       << delim
+         << "p90:timestamp_t:"          << sizeof(timestamp_t)       << delim
+         << "p99:timestamp_t:"          << sizeof(timestamp_t)
+         << "}" << std::endl;
+
 #ifdef LEGION_PROF_SELF_PROFILE
       ss << "ProfTaskInfo {"
          << "id:" << PROFTASK_INFO_ID                        << delim
@@ -312,6 +358,28 @@ namespace Legion {
       lp_fwrite(f, runtime_call_desc.name, strlen(runtime_call_desc.name) + 1);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                          const LegionProfDesc::RuntimeCounterDesc &counter_desc)
+    //--------------------------------------------------------------------------
+    {
+      int ID = RUNTIME_COUNTER_DESC_ID;
+      lp_fwrite(f, (char*)&ID, sizeof(ID));
+      lp_fwrite(f, (char*)&(counter_desc.kind), sizeof(counter_desc.kind));
+      lp_fwrite(f, counter_desc.name, strlen(counter_desc.name) + 1);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                                const LegionProfDesc::OpStageDesc &stage_desc)
+    //--------------------------------------------------------------------------
+    {
+      int ID = OP_STAGE_DESC_ID;
+      lp_fwrite(f, (char*)&ID, sizeof(ID));
+      lp_fwrite(f, (char*)&(stage_desc.kind), sizeof(stage_desc.kind));
+      lp_fwrite(f, stage_desc.name, strlen(stage_desc.name) + 1);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfBinarySerializer::serialize(
                                       const LegionProfDesc::MetaDesc& meta_desc)
@@ -672,6 +740,60 @@ namespace Legion {
                 sizeof(runtime_call_info.proc_id));
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                      const LegionProfInstance::RuntimeCounterInfo& counter_info)
+    //--------------------------------------------------------------------------
+    {
+      int ID = RUNTIME_COUNTER_INFO_ID;
+      lp_fwrite(f, (char*)&ID, sizeof(ID));
+      lp_fwrite(f, (char*)&(counter_info.kind),    sizeof(counter_info.kind));
+      lp_fwrite(f, (char*)&(counter_info.time),    sizeof(counter_info.time));
+      lp_fwrite(f, (char*)&(counter_info.value),   sizeof(counter_info.value));
+      lp_fwrite(f, (char*)&(counter_info.proc_id), 
+                sizeof(counter_info.proc_id));
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                      const LegionProfInstance::PerfCounterInfo& perf_info)
+    //--------------------------------------------------------------------------
+    {
+      int ID = PERF_COUNTER_INFO_ID;
+      lp_fwrite(f, (char*)&ID, sizeof(ID));
+      lp_fwrite(f, (char*)&(perf_info.op_id),      sizeof(perf_info.op_id));
+      lp_fwrite(f, (char*)&(perf_info.task_id),    sizeof(perf_info.task_id));
+      lp_fwrite(f, (char*)&(perf_info.variant_id), 
+                sizeof(perf_info.variant_id));
+      lp_fwrite(f, (char*)&(perf_info.proc_id),    sizeof(perf_info.proc_id));
+      lp_fwrite(f, (char*)&(perf_info.cycles),     sizeof(perf_info.cycles));
+      lp_fwrite(f, (char*)&(perf_info.instructions), 
+                sizeof(perf_info.instructions));
+      lp_fwrite(f, (char*)&(perf_info.llc_misses), 
+                sizeof(perf_info.llc_misses));
+      lp_fwrite(f, (char*)&(perf_info.stalled_frontend), 
+                sizeof(perf_info.stalled_frontend));
+      lp_fwrite(f, (char*)&(perf_info.stalled_backend), 
+                sizeof(perf_info.stalled_backend));
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                      const LegionProfInstance::OpStageInfo& stage_info)
+    //--------------------------------------------------------------------------
+    {
+      int ID = OP_STAGE_INFO_ID;
+      lp_fwrite(f, (char*)&ID, sizeof(ID));
+      lp_fwrite(f, (char*)&(stage_info.op_kind), sizeof(stage_info.op_kind));
+      lp_fwrite(f, (char*)&(stage_info.stage),   sizeof(stage_info.stage));
+      lp_fwrite(f, (char*)&(stage_info.count),   sizeof(stage_info.count));
+      lp_fwrite(f, (char*)&(stage_info.total),   sizeof(stage_info.total));
+      lp_fwrite(f, (char*)&(stage_info.max),     sizeof(stage_info.max));
+      lp_fwrite(f, (char*)&(stage_info.p50),     sizeof(stage_info.p50));
+      lp_fwrite(f, (char*)&(stage_info.p90),     sizeof(stage_info.p90));
+      lp_fwrite(f, (char*)&(stage_info.p99),     sizeof(stage_info.p99));
+    }
+
 #ifdef LEGION_PROF_SELF_PROFILE
     //--------------------------------------------------------------------------
     void LegionProfBinarySerializer::serialize(
@@ -735,6 +857,24 @@ namespace Legion {
                      runtime_call_desc.kind, runtime_call_desc.name);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                          const LegionProfDesc::RuntimeCounterDesc &counter_desc)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Runtime Counter Desc %u %s", 
+                     counter_desc.kind, counter_desc.name);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                                const LegionProfDesc::OpStageDesc &stage_desc)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Op Stage Desc %u %s", 
+                     stage_desc.kind, stage_desc.name);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfASCIISerializer::serialize(
                                       const LegionProfDesc::MetaDesc &meta_desc)
@@ -973,6 +1113,40 @@ namespace Legion {
                      runtime_call_info.start, runtime_call_info.stop);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                      const LegionProfInstance::RuntimeCounterInfo& counter_info)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Runtime Counter Info %u " IDFMT " %llu %llu",
+                     counter_info.kind, counter_info.proc_id, 
+                     counter_info.time, counter_info.value);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                      const LegionProfInstance::PerfCounterInfo& perf_info)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Perf Counter Info %llu %u %u " IDFMT 
+                     " %lld %lld %lld %lld %lld", perf_info.op_id, 
+                     perf_info.task_id, perf_info.variant_id, 
+                     perf_info.proc_id, perf_info.cycles, 
+                     perf_info.instructions, perf_info.llc_misses,
+                     perf_info.stalled_frontend, perf_info.stalled_backend);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                      const LegionProfInstance::OpStageInfo& stage_info)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Op Stage Info %u %u %llu %llu %llu %llu %llu %llu",
+                     stage_info.op_kind, stage_info.stage, stage_info.count,
+                     stage_info.total, stage_info.max, stage_info.p50,
+                     stage_info.p90, stage_info.p99);
+    }
+
 #ifdef LEGION_PROF_SELF_PROFILE
     //--------------------------------------------------------------------------
     void LegionProfASCIISerializer::serialize(
@@ -991,6 +1165,569 @@ namespace Legion {
     {
     }
 
+    ///////////////////////// LegionProfSummarySerializer /////////////////////
+
+    //--------------------------------------------------------------------------
+    LegionProfSummarySerializer::Histogram::Histogram(void)
+      : count(0), total(0), min(0), max(0)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < NUM_HISTOGRAM_BUCKETS; idx++)
+        buckets[idx] = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::Histogram::record(
+                                                      unsigned long long value)
+    //--------------------------------------------------------------------------
+    {
+      if ((count == 0) || (value < min))
+        min = value;
+      if (value > max)
+        max = value;
+      count++;
+      total += value;
+      // Bucket i holds values in [2^i,2^(i+1)) with zero in bucket 0
+      const unsigned bucket = (value == 0) ? 0 : 
+        (NUM_HISTOGRAM_BUCKETS - 1 - __builtin_clzll(value));
+      buckets[bucket]++;
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned long long LegionProfSummarySerializer::Histogram::percentile(
+                                                         double fraction) const
+    //--------------------------------------------------------------------------
+    {
+      if (count == 0)
+        return 0;
+      // Report the upper bound of the bucket holding the percentile
+      // clamped to the range of values that we actually saw
+      const unsigned long long target = fraction * count;
+      unsigned long long seen = 0;
+      for (unsigned idx = 0; idx < NUM_HISTOGRAM_BUCKETS; idx++)
+      {
+        seen += buckets[idx];
+        if (seen <= target)
+          continue;
+        const unsigned long long bound = (idx == (NUM_HISTOGRAM_BUCKETS-1)) ?
+          max : ((2ULL << idx) - 1);
+        if (bound < min)
+          return min;
+        return (bound < max) ? bound : max;
+      }
+      return max;
+    }
+
+    //--------------------------------------------------------------------------
+    LegionProfSummarySerializer::LegionProfSummarySerializer(
+                                    AddressSpaceID n, unsigned interval_seconds,
+                                    unsigned rate)
+      : node(n), interval(timestamp_t(interval_seconds) * 1000000000ULL),
+        sample_rate(rate), next_summary(0)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    LegionProfSummarySerializer::~LegionProfSummarySerializer()
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    // Serialize Methods
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                const LegionProfDesc::MessageDesc &message_desc)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                         const LegionProfDesc::MapperCallDesc &mapper_call_desc)
+    //--------------------------------------------------------------------------
+    {
+      mapper_call_names[mapper_call_desc.kind] = mapper_call_desc.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                       const LegionProfDesc::RuntimeCallDesc &runtime_call_desc)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                          const LegionProfDesc::RuntimeCounterDesc &counter_desc)
+    //--------------------------------------------------------------------------
+    {
+      counter_names[counter_desc.kind] = counter_desc.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                const LegionProfDesc::OpStageDesc &stage_desc)
+    //--------------------------------------------------------------------------
+    {
+      stage_names[stage_desc.kind] = stage_desc.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                      const LegionProfDesc::MetaDesc &meta_desc)
+    //--------------------------------------------------------------------------
+    {
+      meta_names[meta_desc.kind] = meta_desc.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                          const LegionProfDesc::OpDesc &op_desc)
+    //--------------------------------------------------------------------------
+    {
+      op_names[op_desc.kind] = op_desc.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                      const LegionProfDesc::ProcDesc &proc_desc)
+    //--------------------------------------------------------------------------
+    {
+      proc_kinds[proc_desc.proc_id] = proc_desc.kind;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                        const LegionProfDesc::MemDesc &mem_desc)
+    //--------------------------------------------------------------------------
+    {
+      mem_kinds[mem_desc.mem_id] = mem_desc.kind;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                 const LegionProfInstance::TaskKind &task_kind)
+    //--------------------------------------------------------------------------
+    {
+      // Names are freed after serialization so we need our own copy
+      std::map<TaskID,std::string>::iterator finder = 
+        task_names.find(task_kind.task_id);
+      if ((finder == task_names.end()) || task_kind.overwrite)
+        task_names[task_kind.task_id] = task_kind.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                           const LegionProfInstance::TaskVariant &task_variant)
+    //--------------------------------------------------------------------------
+    {
+      variant_names[std::pair<TaskID,VariantID>(task_variant.task_id,
+                      task_variant.variant_id)] = task_variant.name;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                     const LegionProfInstance::OperationInstance &operation_inst)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                               const LegionProfInstance::MultiTask &multi_task)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                             const LegionProfInstance::SliceOwner &slice_owner)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::WaitInfo wait_info,
+                                  const LegionProfInstance::TaskInfo& task_info)
+    //--------------------------------------------------------------------------
+    {
+      // Wait intervals are accounted for with their task
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::WaitInfo wait_info,
+                            const LegionProfInstance::GPUTaskInfo& gpu_info)
+    //--------------------------------------------------------------------------
+    {
+      // Wait intervals are accounted for with their task
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::WaitInfo wait_info,
+                                  const LegionProfInstance::MetaInfo& meta_info)
+    //--------------------------------------------------------------------------
+    {
+      // Wait intervals are accounted for with their meta-task
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::TaskInfo& task_info)
+    //--------------------------------------------------------------------------
+    {
+      const std::pair<std::pair<TaskID,VariantID>,ProcID> key(
+          std::pair<TaskID,VariantID>(task_info.task_id, task_info.variant_id),
+          task_info.proc_id);
+      record_task(task_stats[key], task_info.ready, task_info.start,
+                  task_info.stop, task_info.wait_intervals);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::MetaInfo& meta_info)
+    //--------------------------------------------------------------------------
+    {
+      const std::pair<unsigned,ProcID> key(meta_info.lg_id, meta_info.proc_id);
+      record_task(meta_stats[key], meta_info.ready, meta_info.start,
+                  meta_info.stop, meta_info.wait_intervals);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::CopyInfo& copy_info)
+    //--------------------------------------------------------------------------
+    {
+      ChannelStats &stats = channel_stats[
+        std::pair<MemID,MemID>(copy_info.src, copy_info.dst)];
+      const timestamp_t duration = (copy_info.stop > copy_info.start) ?
+        (copy_info.stop - copy_info.start) : 0;
+      stats.bytes += copy_info.size;
+      stats.busy += duration;
+      // Bytes per nanosecond is GB/s so scale up to get MB/s
+      if (duration > 0)
+        stats.bandwidth.record((copy_info.size * 1000) / duration);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                                  const LegionProfInstance::FillInfo& fill_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                       const LegionProfInstance::InstCreateInfo& inst_create_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                         const LegionProfInstance::InstUsageInfo& inst_usage_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                   const LegionProfInstance::InstTimelineInfo& inst_timeline_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                        const LegionProfInstance::PartitionInfo& partition_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                            const LegionProfInstance::MessageInfo& message_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                     const LegionProfInstance::MapperCallInfo& mapper_call_info)
+    //--------------------------------------------------------------------------
+    {
+      const timestamp_t duration = 
+        (mapper_call_info.stop > mapper_call_info.start) ?
+        (mapper_call_info.stop - mapper_call_info.start) : 0;
+      mapper_call_stats[mapper_call_info.kind].record(duration);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                   const LegionProfInstance::RuntimeCallInfo& runtime_call_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                         const LegionProfInstance::RuntimeCounterInfo& counter)
+    //--------------------------------------------------------------------------
+    {
+      counter_values[counter.kind] = counter.value;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                         const LegionProfInstance::PerfCounterInfo& perf_info)
+    //--------------------------------------------------------------------------
+    {
+      PerfStats &stats = perf_stats[std::pair<TaskID,VariantID>(
+                            perf_info.task_id, perf_info.variant_id)];
+      stats.count++;
+#define ACCUMULATE(field) \
+      if ((stats.field < 0) || (perf_info.field < 0)) \
+        stats.field = -1; \
+      else \
+        stats.field += perf_info.field;
+      ACCUMULATE(cycles)
+      ACCUMULATE(instructions)
+      ACCUMULATE(llc_misses)
+      ACCUMULATE(stalled_frontend)
+      ACCUMULATE(stalled_backend)
+#undef ACCUMULATE
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                         const LegionProfInstance::OpStageInfo& stage_info)
+    //--------------------------------------------------------------------------
+    {
+      // These are already aggregated by the runtime
+      const std::pair<unsigned,unsigned> key(stage_info.op_kind, 
+                                             stage_info.stage);
+      op_stage_stats[key] = stage_info;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                            const LegionProfInstance::GPUTaskInfo& gpu_info)
+    //--------------------------------------------------------------------------
+    {
+      const std::pair<std::pair<TaskID,VariantID>,ProcID> key(
+          std::pair<TaskID,VariantID>(gpu_info.task_id, gpu_info.variant_id),
+          gpu_info.proc_id);
+      record_task(task_stats[key], gpu_info.ready, gpu_info.start,
+                  gpu_info.stop, gpu_info.wait_intervals);
+    }
+
+#ifdef LEGION_PROF_SELF_PROFILE
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::serialize(
+                          const LegionProfInstance::ProfTaskInfo& proftask_info)
+    //--------------------------------------------------------------------------
+    {
+    }
+#endif
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::checkpoint(timestamp_t now)
+    //--------------------------------------------------------------------------
+    {
+      check_summary(now);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::finalize(void)
+    //--------------------------------------------------------------------------
+    {
+      log_summary("final");
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::record_task(TaskStats &stats,
+                           timestamp_t ready, timestamp_t start,
+                           timestamp_t stop,
+                           const std::deque<LegionProfInstance::WaitInfo> &waits)
+    //--------------------------------------------------------------------------
+    {
+      timestamp_t wait = 0;
+      for (std::deque<LegionProfInstance::WaitInfo>::const_iterator it = 
+            waits.begin(); it != waits.end(); it++)
+        if (it->wait_end > it->wait_start)
+          wait += (it->wait_end - it->wait_start);
+      const timestamp_t running = (stop > start) ? (stop - start) : 0;
+      stats.execution.record((running > wait) ? (running - wait) : 0);
+      stats.wait.record(wait);
+      stats.queue.record((start > ready) ? (start - ready) : 0);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::check_summary(timestamp_t now)
+    //--------------------------------------------------------------------------
+    {
+      // Driven by the writer so summaries are logged on time even
+      // when the records themselves are handed off late
+      if (interval == 0)
+        return;
+      if (next_summary == 0)
+      {
+        next_summary = now + interval;
+        return;
+      }
+      if (now < next_summary)
+        return;
+      log_summary("periodic");
+      while (next_summary <= now)
+        next_summary += interval;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfSummarySerializer::log_summary(const char *when)
+    //--------------------------------------------------------------------------
+    {
+      // All statistics are cumulative since the start of the run,
+      // times are reported in microseconds. Counts and totals of sampled
+      // records are estimates scaled up by the sampling rate.
+#define HISTOGRAM_FORMAT "count %llu total %.3f min %.3f p50 %.3f " \
+                         "p90 %.3f p99 %.3f max %.3f"
+#define HISTOGRAM_ARGS(h, scale) (h).count * (scale), \
+        (h).total * (scale) * 1e-3, (h).min * 1e-3, \
+        (h).percentile(0.5) * 1e-3, (h).percentile(0.9) * 1e-3, \
+        (h).percentile(0.99) * 1e-3, (h).max * 1e-3
+      log_prof_summary.print("Summary %s node %d sample rate %d", 
+                             when, node, sample_rate);
+      for (std::map<std::pair<std::pair<TaskID,VariantID>,ProcID>,TaskStats>::
+            const_iterator it = task_stats.begin(); 
+            it != task_stats.end(); it++)
+      {
+        const std::pair<TaskID,VariantID> &variant = it->first.first;
+        std::map<TaskID,std::string>::const_iterator task_name = 
+          task_names.find(variant.first);
+        std::map<std::pair<TaskID,VariantID>,std::string>::const_iterator
+          variant_name = variant_names.find(variant);
+        const char *name = (task_name != task_names.end()) ?
+          task_name->second.c_str() : "unknown";
+        const char *vname = (variant_name != variant_names.end()) ?
+          variant_name->second.c_str() : "unknown";
+        log_prof_summary.print("Task %d %s variant %d %s proc " IDFMT
+            " execution " HISTOGRAM_FORMAT, variant.first, name, 
+            variant.second, vname, it->first.second,
+            HISTOGRAM_ARGS(it->second.execution, sample_rate));
+        log_prof_summary.print("Task %d %s variant %d %s proc " IDFMT
+            " wait " HISTOGRAM_FORMAT, variant.first, name, 
+            variant.second, vname, it->first.second,
+            HISTOGRAM_ARGS(it->second.wait, sample_rate));
+        log_prof_summary.print("Task %d %s variant %d %s proc " IDFMT
+            " queue " HISTOGRAM_FORMAT, variant.first, name, 
+            variant.second, vname, it->first.second,
+            HISTOGRAM_ARGS(it->second.queue, sample_rate));
+      }
+      for (std::map<std::pair<unsigned,ProcID>,TaskStats>::const_iterator it =
+            meta_stats.begin(); it != meta_stats.end(); it++)
+      {
+        std::map<unsigned,std::string>::const_iterator meta_name = 
+          meta_names.find(it->first.first);
+        const char *name = (meta_name != meta_names.end()) ?
+          meta_name->second.c_str() : "unknown";
+        log_prof_summary.print("Meta %d %s proc " IDFMT " execution "
+            HISTOGRAM_FORMAT, it->first.first, name, it->first.second,
+            HISTOGRAM_ARGS(it->second.execution, sample_rate));
+        log_prof_summary.print("Meta %d %s proc " IDFMT " queue "
+            HISTOGRAM_FORMAT, it->first.first, name, it->first.second,
+            HISTOGRAM_ARGS(it->second.queue, sample_rate));
+      }
+      for (std::map<std::pair<MemID,MemID>,ChannelStats>::const_iterator it =
+            channel_stats.begin(); it != channel_stats.end(); it++)
+      {
+        const Histogram &bw = it->second.bandwidth;
+        // Aggregate bandwidth over the time the channel was busy in MB/s
+        const double average = (it->second.busy == 0) ? 0.0 :
+          (double(it->second.bytes) * 1e3) / double(it->second.busy);
+        log_prof_summary.print("Copy " IDFMT " " IDFMT " count %llu "
+            "bytes %llu busy %.3f bandwidth MB/s average %.3f min %llu "
+            "p50 %llu p99 %llu max %llu", it->first.first, it->first.second,
+            bw.count * sample_rate, it->second.bytes * sample_rate, 
+            it->second.busy * sample_rate * 1e-3, average,
+            bw.min, bw.percentile(0.5), bw.percentile(0.99), bw.max);
+      }
+      for (std::map<std::pair<TaskID,VariantID>,PerfStats>::const_iterator it =
+            perf_stats.begin(); it != perf_stats.end(); it++)
+      {
+        std::map<TaskID,std::string>::const_iterator task_name = 
+          task_names.find(it->first.first);
+        std::map<std::pair<TaskID,VariantID>,std::string>::const_iterator
+          variant_name = variant_names.find(it->first);
+        const PerfStats &stats = it->second;
+        // Ratios are -1 when the counters they need were not available
+        const double ipc = ((stats.cycles > 0) && (stats.instructions >= 0)) ?
+          double(stats.instructions) / double(stats.cycles) : -1.0;
+        const double mpki = 
+          ((stats.instructions > 0) && (stats.llc_misses >= 0)) ?
+          (1e3 * stats.llc_misses) / double(stats.instructions) : -1.0;
+        const double frontend = 
+          ((stats.cycles > 0) && (stats.stalled_frontend >= 0)) ?
+          (1e2 * stats.stalled_frontend) / double(stats.cycles) : -1.0;
+        const double backend = 
+          ((stats.cycles > 0) && (stats.stalled_backend >= 0)) ?
+          (1e2 * stats.stalled_backend) / double(stats.cycles) : -1.0;
+        // Counts are for the sampled tasks only, the ratios are unaffected
+        log_prof_summary.print("Counters Task %d %s variant %d %s count %llu "
+            "cycles %lld instructions %lld llc_misses %lld ipc %.3f "
+            "llc_mpki %.3f frontend_stall %.1f%% backend_stall %.1f%%",
+            it->first.first, (task_name != task_names.end()) ?
+            task_name->second.c_str() : "unknown", it->first.second,
+            (variant_name != variant_names.end()) ?
+            variant_name->second.c_str() : "unknown", stats.count,
+            stats.cycles, stats.instructions, stats.llc_misses,
+            ipc, mpki, frontend, backend);
+      }
+      for (std::map<unsigned,Histogram>::const_iterator it = 
+            mapper_call_stats.begin(); it != mapper_call_stats.end(); it++)
+      {
+        std::map<unsigned,std::string>::const_iterator call_name = 
+          mapper_call_names.find(it->first);
+        // Mapper calls are never sampled
+        log_prof_summary.print("Mapper Call %d %s " HISTOGRAM_FORMAT,
+            it->first, (call_name != mapper_call_names.end()) ?
+            call_name->second.c_str() : "unknown", 
+            HISTOGRAM_ARGS(it->second, 1));
+      }
+      for (std::map<std::pair<unsigned,unsigned>,
+            LegionProfInstance::OpStageInfo>::const_iterator it = 
+            op_stage_stats.begin(); it != op_stage_stats.end(); it++)
+      {
+        std::map<unsigned,std::string>::const_iterator op_name = 
+          op_names.find(it->first.first);
+        std::map<unsigned,std::string>::const_iterator stage_name = 
+          stage_names.find(it->first.second);
+        const LegionProfInstance::OpStageInfo &info = it->second;
+        // Operation stages are never sampled
+        log_prof_summary.print("Op Stage %d %s %s count %llu total %.3f "
+            "p50 %.3f p90 %.3f p99 %.3f max %.3f", it->first.first,
+            (op_name != op_names.end()) ? op_name->second.c_str() : "unknown",
+            (stage_name != stage_names.end()) ? 
+            stage_name->second.c_str() : "unknown", info.count,
+            info.total * 1e-3, info.p50 * 1e-3, info.p90 * 1e-3,
+            info.p99 * 1e-3, info.max * 1e-3);
+      }
+      for (std::map<unsigned,unsigned long long>::const_iterator it = 
+            counter_values.begin(); it != counter_values.end(); it++)
+      {
+        std::map<unsigned,std::string>::const_iterator counter_name = 
+          counter_names.find(it->first);
+        log_prof_summary.print("Counter %d %s %llu", it->first,
+            (counter_name != counter_names.end()) ?
+            counter_name->second.c_str() : "unknown", it->second);
+      }
+#undef HISTOGRAM_FORMAT
+#undef HISTOGRAM_ARGS
+    }
+
   }; // namespace Internal
 }; // namespace Legion
 
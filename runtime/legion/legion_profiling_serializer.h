@@ -46,6 +46,8 @@ namespace Legion {
       virtual void serialize(const LegionProfDesc::MessageDesc&) = 0;
       virtual void serialize(const LegionProfDesc::MapperCallDesc&) = 0;
       virtual void serialize(const LegionProfDesc::RuntimeCallDesc&) = 0;
+      virtual void serialize(const LegionProfDesc::RuntimeCounterDesc&) = 0;
+      virtual void serialize(const LegionProfDesc::OpStageDesc&) = 0;
       virtual void serialize(const LegionProfDesc::MetaDesc&) = 0;
       virtual void serialize(const LegionProfDesc::OpDesc&) = 0;
       virtual void serialize(const LegionProfDesc::ProcDesc&) = 0;
@@ -72,10 +74,17 @@ namespace Legion {
       virtual void serialize(const LegionProfInstance::MessageInfo&) = 0;
       virtual void serialize(const LegionProfInstance::MapperCallInfo&) = 0;
       virtual void serialize(const LegionProfInstance::RuntimeCallInfo&) = 0;
+      virtual void serialize(const LegionProfInstance::RuntimeCounterInfo&) = 0;
+      virtual void serialize(const LegionProfInstance::PerfCounterInfo&) = 0;
+      virtual void serialize(const LegionProfInstance::OpStageInfo&) = 0;
       virtual void serialize(const LegionProfInstance::GPUTaskInfo&) = 0;
 #ifdef LEGION_PROF_SELF_PROFILE
       virtual void serialize(const LegionProfInstance::ProfTaskInfo&) = 0;
 #endif
+      // Called by the writer with the current time after each chunk
+      virtual void checkpoint(timestamp_t now) { }
+      // Called once after all the records have been serialized
+      virtual void finalize(void) { }
     };
 
     // This is the Internal Binary Format Serializer
@@ -91,6 +100,8 @@ namespace Legion {
       void serialize(const LegionProfDesc::MessageDesc&);
       void serialize(const LegionProfDesc::MapperCallDesc&);
       void serialize(const LegionProfDesc::RuntimeCallDesc&);
+      void serialize(const LegionProfDesc::RuntimeCounterDesc&);
+      void serialize(const LegionProfDesc::OpStageDesc&);
       void serialize(const LegionProfDesc::MetaDesc&);
       void serialize(const LegionProfDesc::OpDesc&);
       void serialize(const LegionProfDesc::ProcDesc&);
@@ -117,6 +128,9 @@ namespace Legion {
       void serialize(const LegionProfInstance::MessageInfo&);
       void serialize(const LegionProfInstance::MapperCallInfo&);
       void serialize(const LegionProfInstance::RuntimeCallInfo&);
+      void serialize(const LegionProfInstance::RuntimeCounterInfo&);
+      void serialize(const LegionProfInstance::PerfCounterInfo&);
+      void serialize(const LegionProfInstance::OpStageInfo&);
       void serialize(const LegionProfInstance::GPUTaskInfo&);
 #ifdef LEGION_PROF_SELF_PROFILE
       void serialize(const LegionProfInstance::ProfTaskInfo&);
@@ -154,6 +168,11 @@ namespace Legion {
         MAPPER_CALL_INFO_ID,
         RUNTIME_CALL_INFO_ID,
         GPU_TASK_INFO_ID,
+        RUNTIME_COUNTER_DESC_ID,
+        RUNTIME_COUNTER_INFO_ID,
+        PERF_COUNTER_INFO_ID,
+        OP_STAGE_DESC_ID,
+        OP_STAGE_INFO_ID,
 #ifdef LEGION_PROF_SELF_PROFILE
         PROFTASK_INFO_ID
 #endif
@@ -171,6 +190,8 @@ namespace Legion {
       void serialize(const LegionProfDesc::MessageDesc&);
       void serialize(const LegionProfDesc::MapperCallDesc&);
       void serialize(const LegionProfDesc::RuntimeCallDesc&);
+      void serialize(const LegionProfDesc::RuntimeCounterDesc&);
+      void serialize(const LegionProfDesc::OpStageDesc&);
       void serialize(const LegionProfDesc::MetaDesc&);
       void serialize(const LegionProfDesc::OpDesc&);
       void serialize(const LegionProfDesc::ProcDesc&);
@@ -197,11 +218,135 @@ namespace Legion {
       void serialize(const LegionProfInstance::MessageInfo&);
       void serialize(const LegionProfInstance::MapperCallInfo&);
       void serialize(const LegionProfInstance::RuntimeCallInfo&);
+      void serialize(const LegionProfInstance::RuntimeCounterInfo&);
+      void serialize(const LegionProfInstance::PerfCounterInfo&);
+      void serialize(const LegionProfInstance::OpStageInfo&);
       void serialize(const LegionProfInstance::GPUTaskInfo&);
 #ifdef LEGION_PROF_SELF_PROFILE
       void serialize(const LegionProfInstance::ProfTaskInfo&);
 #endif
     };
+
+    // This is the In-Situ Summary Serializer which aggregates records
+    // into histograms instead of writing them out and periodically
+    // logs a compact summary of them
+    class LegionProfSummarySerializer: public LegionProfSerializer {
+    public:
+      // Power-of-two buckets so we can cover all 64-bit values
+      static const unsigned NUM_HISTOGRAM_BUCKETS = 64;
+      struct Histogram {
+      public:
+        Histogram(void);
+      public:
+        void record(unsigned long long value);
+        unsigned long long percentile(double fraction) const;
+      public:
+        unsigned long long count, total, min, max;
+        unsigned long long buckets[NUM_HISTOGRAM_BUCKETS];
+      };
+      // All times in nanoseconds
+      struct TaskStats {
+      public:
+        Histogram execution, wait, queue;
+      };
+      struct ChannelStats {
+      public:
+        ChannelStats(void) : bytes(0), busy(0) { }
+      public:
+        Histogram bandwidth; // MB/s of each copy
+        unsigned long long bytes, busy;
+      };
+      // Totals are -1 if any task was missing that counter
+      struct PerfStats {
+      public:
+        PerfStats(void) : count(0), cycles(0), instructions(0), 
+          llc_misses(0), stalled_frontend(0), stalled_backend(0) { }
+      public:
+        unsigned long long count;
+        long long cycles, instructions, llc_misses;
+        long long stalled_frontend, stalled_backend;
+      };
+    public:
+      LegionProfSummarySerializer(AddressSpaceID node, unsigned interval,
+                                  unsigned sample_rate);
+      ~LegionProfSummarySerializer();
+
+      bool is_thread_safe(void) const { return false; }
+      // Serialize Methods
+      void serialize(const LegionProfDesc::MessageDesc&);
+      void serialize(const LegionProfDesc::MapperCallDesc&);
+      void serialize(const LegionProfDesc::RuntimeCallDesc&);
+      void serialize(const LegionProfDesc::RuntimeCounterDesc&);
+      void serialize(const LegionProfDesc::OpStageDesc&);
+      void serialize(const LegionProfDesc::MetaDesc&);
+      void serialize(const LegionProfDesc::OpDesc&);
+      void serialize(const LegionProfDesc::ProcDesc&);
+      void serialize(const LegionProfDesc::MemDesc&);
+      void serialize(const LegionProfInstance::TaskKind&);
+      void serialize(const LegionProfInstance::TaskVariant&);
+      void serialize(const LegionProfInstance::OperationInstance&);
+      void serialize(const LegionProfInstance::MultiTask&);
+      void serialize(const LegionProfInstance::SliceOwner&);
+      void serialize(const LegionProfInstance::WaitInfo, 
+                     const LegionProfInstance::TaskInfo&);
+      void serialize(const LegionProfInstance::WaitInfo,
+                     const LegionProfInstance::GPUTaskInfo&);
+      void serialize(const LegionProfInstance::WaitInfo,
+                     const LegionProfInstance::MetaInfo&);
+      void serialize(const LegionProfInstance::TaskInfo&);
+      void serialize(const LegionProfInstance::MetaInfo&);
+      void serialize(const LegionProfInstance::CopyInfo&);
+      void serialize(const LegionProfInstance::FillInfo&);
+      void serialize(const LegionProfInstance::InstCreateInfo&);
+      void serialize(const LegionProfInstance::InstUsageInfo&);
+      void serialize(const LegionProfInstance::InstTimelineInfo&);
+      void serialize(const LegionProfInstance::PartitionInfo&);
+      void serialize(const LegionProfInstance::MessageInfo&);
+      void serialize(const LegionProfInstance::MapperCallInfo&);
+      void serialize(const LegionProfInstance::RuntimeCallInfo&);
+      void serialize(const LegionProfInstance::RuntimeCounterInfo&);
+      void serialize(const LegionProfInstance::PerfCounterInfo&);
+      void serialize(const LegionProfInstance::OpStageInfo&);
+      void serialize(const LegionProfInstance::GPUTaskInfo&);
+#ifdef LEGION_PROF_SELF_PROFILE
+      void serialize(const LegionProfInstance::ProfTaskInfo&);
+#endif
+      void checkpoint(timestamp_t now);
+      void finalize(void);
+    protected:
+      void record_task(TaskStats &stats, timestamp_t ready, timestamp_t start,
+                       timestamp_t stop,
+                       const std::deque<LegionProfInstance::WaitInfo> &waits);
+      void check_summary(timestamp_t now);
+      void log_summary(const char *when);
+    private:
+      const AddressSpaceID node;
+      // Nanoseconds between summaries or zero for only at the end
+      const timestamp_t interval;
+      // Only one in this many tasks, meta-tasks and copies are profiled
+      // so we scale up their counts and totals by this much
+      const unsigned sample_rate;
+      timestamp_t next_summary;
+      std::map<TaskID,std::string> task_names;
+      std::map<std::pair<TaskID,VariantID>,std::string> variant_names;
+      std::map<unsigned,std::string> meta_names;
+      std::map<unsigned,std::string> mapper_call_names;
+      std::map<unsigned,std::string> counter_names;
+      std::map<unsigned,std::string> op_names;
+      std::map<unsigned,std::string> stage_names;
+      std::map<ProcID,ProcKind> proc_kinds;
+      std::map<MemID,MemKind> mem_kinds;
+    private:
+      std::map<std::pair<std::pair<TaskID,VariantID>,ProcID>,
+               TaskStats> task_stats;
+      std::map<std::pair<unsigned,ProcID>,TaskStats> meta_stats;
+      std::map<std::pair<MemID,MemID>,ChannelStats> channel_stats;
+      std::map<std::pair<TaskID,VariantID>,PerfStats> perf_stats;
+      std::map<unsigned,Histogram> mapper_call_stats;
+      std::map<unsigned,unsigned long long> counter_values;
+      std::map<std::pair<unsigned,unsigned>,
+               LegionProfInstance::OpStageInfo> op_stage_stats;
+    };
   }; // namespace Internal
 }; // namespace Legion
 
@@ -779,6 +779,7 @@ namespace Legion {
       stealable = false;
       options_selected = false;
       map_origin = false;
+      map_in_bulk = false;
       true_guard = PredEvent::NO_PRED_EVENT;
       false_guard = PredEvent::NO_PRED_EVENT;
       local_cached = false;
@@ -788,6 +789,7 @@ namespace Legion {
       must_epoch = NULL;
       must_epoch_task = false;
       orig_proc = Processor::NO_PROC; // for is_remote
+      next_ready_task = NULL;
     }
 
     //--------------------------------------------------------------------------
@@ -857,6 +859,7 @@ namespace Legion {
       for (unsigned idx = 0; idx < regions.size(); idx++)
         rez.serialize(parent_req_indexes[idx]);
       rez.serialize(map_origin);
+      rez.serialize(map_in_bulk);
       if (map_origin)
       {
         rez.serialize<size_t>(atomic_locks.size());
@@ -894,6 +897,7 @@ namespace Legion {
       for (unsigned idx = 0; idx < parent_req_indexes.size(); idx++)
         derez.deserialize(parent_req_indexes[idx]);
       derez.deserialize(map_origin);
+      derez.deserialize(map_in_bulk);
       if (map_origin)
       {
         size_t num_atomic;
@@ -1065,6 +1069,7 @@ namespace Legion {
       options.valid_instances = true;
       options.memoize = false;
       options.replicate = false;
+      options.map_in_bulk = false;
       const TaskPriority parent_priority = parent_ctx->is_priority_mutable() ?
         parent_ctx->get_current_priority() : 0;
       options.parent_priority = parent_priority;
@@ -1073,6 +1078,7 @@ namespace Legion {
       target_proc = options.initial_proc;
       stealable = options.stealable;
       map_origin = options.map_locally;
+      map_in_bulk = options.map_in_bulk;
       if (parent_priority != options.parent_priority)
       {
         // Request for priority change see if it is legal or not
@@ -1915,6 +1921,7 @@ namespace Legion {
       this->speculated = rhs->speculated;
       this->parent_task = rhs->parent_task;
       this->map_origin = rhs->map_origin;
+      this->map_in_bulk = rhs->map_in_bulk;
       this->sharding_space = rhs->sharding_space;
       // From TaskOp
       this->atomic_locks = rhs->atomic_locks;
@@ -2446,6 +2453,9 @@ namespace Legion {
       execution_context = NULL;
       leaf_cached = false;
       inner_cached = false;
+      bulk_input = NULL;
+      bulk_output = NULL;
+      bulk_valid_instances = NULL;
     }
 
     //--------------------------------------------------------------------------
@@ -3431,22 +3441,50 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void SingleTask::set_bulk_mapping(Mapper::MapTaskInput *input,
+                                      Mapper::MapTaskOutput *output,
+                                      std::vector<InstanceSet> *valid_instances)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bulk_output == NULL);
+#endif
+      bulk_input = input;
+      bulk_output = output;
+      bulk_valid_instances = valid_instances;
+    }
+
     //--------------------------------------------------------------------------
     void SingleTask::invoke_mapper(MustEpochOp *must_epoch_owner)
     //--------------------------------------------------------------------------
     {
-      Mapper::MapTaskInput input;
-      Mapper::MapTaskOutput output;
-      output.profiling_priority = LG_THROUGHPUT_WORK_PRIORITY;
-      // Initialize the mapping input which also does all the traversal
-      // down to the target nodes
-      std::vector<InstanceSet> valid_instances(regions.size());
-      initialize_map_task_input(input, output, must_epoch_owner, 
-                                valid_instances);
-      // Now we can invoke the mapper to do the mapping
+      Mapper::MapTaskInput local_input;
+      Mapper::MapTaskOutput local_output;
+      std::vector<InstanceSet> local_valid_instances;
       if (mapper == NULL)
         mapper = runtime->find_mapper(current_proc, map_id);
-      mapper->invoke_map_task(this, &input, &output);
+      // See if our slice already did the mapper call for us
+      const bool bulk_mapped = (bulk_output != NULL);
+      Mapper::MapTaskInput &input = bulk_mapped ? *bulk_input : local_input;
+      Mapper::MapTaskOutput &output = 
+        bulk_mapped ? *bulk_output : local_output;
+      std::vector<InstanceSet> &valid_instances = 
+        bulk_mapped ? *bulk_valid_instances : local_valid_instances;
+      bulk_input = NULL;
+      bulk_output = NULL;
+      bulk_valid_instances = NULL;
+      if (!bulk_mapped)
+      {
+        output.profiling_priority = LG_THROUGHPUT_WORK_PRIORITY;
+        // Initialize the mapping input which also does all the traversal
+        // down to the target nodes
+        valid_instances.resize(regions.size());
+        initialize_map_task_input(input, output, must_epoch_owner, 
+                                  valid_instances);
+        // Now we can invoke the mapper to do the mapping
+        mapper->invoke_map_task(this, &input, &output);
+      }
       // Sort out any profiling requests that we need to perform
       if (!output.task_prof_requests.empty())
       {
@@ -3488,6 +3526,7 @@ namespace Legion {
             case Realm::PMID_PCTRS_IPC:
             case Realm::PMID_PCTRS_TLB:
             case Realm::PMID_PCTRS_BP:
+            case Realm::PMID_PCTRS_CORE:
               {
                 // Just task
                 task_profiling_requests.push_back(*it);
@@ -4092,6 +4131,10 @@ namespace Legion {
       ApEvent task_launch_event = variant->dispatch_task(launch_processor, this,
                                  execution_context, start_condition, true_guard,
                                  task_priority, profiling_requests);
+      // Runtime load balancing counts this task as part of the backlog
+      // of its processor until it is done running
+      if (runtime->load_balance_threshold > 0)
+        runtime->record_mapped_task(launch_processor, task_launch_event);
       // Finish the chaining optimization if we're doing it
       if (perform_chaining_optimization)
         Runtime::trigger_event(chain_complete_event, task_launch_event);
@@ -8148,6 +8191,9 @@ namespace Legion {
           (*it)->commit_operation(true/*deactivate*/);
       }
       points.clear(); 
+      bulk_inputs.clear();
+      bulk_outputs.clear();
+      bulk_valid_instances.clear();
       if (!acquired_instances.empty())
         release_acquired_instances(acquired_instances);
       acquired_instances.clear();
@@ -8338,6 +8384,9 @@ namespace Legion {
           return defer_perform_mapping(version_ready_event, epoch_owner);
       }
       
+      // Must epoch launches have to map each point on its own
+      if (map_in_bulk && (epoch_owner == NULL) && (points.size() > 1))
+        map_points_in_bulk();
       std::set<RtEvent> mapped_events;
       for (unsigned idx = 0; idx < points.size(); idx++)
       {
@@ -8352,6 +8401,32 @@ namespace Legion {
       return RtEvent::NO_RT_EVENT;
     }
 
+    //--------------------------------------------------------------------------
+    void SliceTask::map_points_in_bulk(void)
+    //--------------------------------------------------------------------------
+    {
+      // Do the traversals for all the points first so that the mapper
+      // can see all of their inputs at once in a single map_tasks call,
+      // each point will then pick up its output when it maps
+      std::vector<const Task*> tasks(points.size());
+      bulk_inputs.resize(points.size());
+      bulk_outputs.resize(points.size());
+      bulk_valid_instances.resize(points.size());
+      for (unsigned idx = 0; idx < points.size(); idx++)
+      {
+        PointTask *point = points[idx];
+        tasks[idx] = point;
+        bulk_outputs[idx].profiling_priority = LG_THROUGHPUT_WORK_PRIORITY;
+        point->initialize_map_task_input(bulk_inputs[idx], bulk_outputs[idx],
+                                NULL/*must epoch*/, bulk_valid_instances[idx]);
+        point->set_bulk_mapping(&bulk_inputs[idx], &bulk_outputs[idx],
+                                &bulk_valid_instances[idx]);
+      }
+      if (mapper == NULL)
+        mapper = runtime->find_mapper(current_proc, map_id);
+      mapper->invoke_map_tasks(this, &tasks, &bulk_inputs, &bulk_outputs);
+    }
+
     //--------------------------------------------------------------------------
     void SliceTask::launch_task(void)
     //--------------------------------------------------------------------------
@@ -8412,6 +8487,8 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(!points.empty());
 #endif
+      if (map_in_bulk && (points.size() > 1))
+        map_points_in_bulk();
       // Now try mapping and then launching all the points starting
       // at the index of the last known good index
       // Copy the points onto the stack to avoid them being
@@ -382,6 +382,7 @@ namespace Legion {
       bool options_selected;
       bool memoize_selected;
       bool map_origin;
+      bool map_in_bulk;
     protected:
       // For managing predication
       PredEvent true_guard;
@@ -402,6 +403,10 @@ namespace Legion {
     public:
       // Index for this must epoch op
       unsigned must_epoch_index;
+    public:
+      // Intrusive link for the list of tasks waiting to be moved
+      // onto the ready queues of a processor manager
+      TaskOp *next_ready_task;
     public:
       // Static methods
       static void process_unpack_task(Runtime *rt,
@@ -477,6 +482,11 @@ namespace Legion {
                                     MustEpochOp *must_epoch_owner,
                                     std::vector<InstanceSet> &valid_instances); 
       void replay_map_task_output();
+      // Called by our slice when it already invoked the mapper
+      // for all its points with a single map_tasks call
+      void set_bulk_mapping(Mapper::MapTaskInput *input,
+                            Mapper::MapTaskOutput *output,
+                            std::vector<InstanceSet> *valid_instances);
     protected: // mapper helper calls
       void validate_target_processors(const std::vector<Processor> &prcs) const;
       void validate_variant_selection(MapperManager *local_mapper,
@@ -564,6 +574,12 @@ namespace Legion {
       int                                      profiling_priority;
       int                          outstanding_profiling_requests;
       RtUserEvent                              profiling_reported;
+    protected:
+      // Mapper input and output that our slice already computed for
+      // us in bulk, NULL if we still need to invoke map_task ourselves
+      Mapper::MapTaskInput                     *bulk_input;
+      Mapper::MapTaskOutput                    *bulk_output;
+      std::vector<InstanceSet>                 *bulk_valid_instances;
 #ifdef DEBUG_LEGION
     protected:
       // For checking that premapped instances didn't change during mapping
@@ -1077,6 +1093,8 @@ namespace Legion {
                                      get_acquired_instances_ref(void);
       void check_target_processors(void) const;
       void update_target_processor(void);
+    protected:
+      void map_points_in_bulk(void);
     protected:
       virtual void trigger_task_complete(void);
       virtual void trigger_task_commit(void);
@@ -1133,6 +1151,10 @@ namespace Legion {
       friend class IndexTask;
       friend class PointTask;
       std::vector<PointTask*> points;
+      // Inputs and outputs of map_tasks calls aligned with the points
+      std::vector<Mapper::MapTaskInput> bulk_inputs;
+      std::vector<Mapper::MapTaskOutput> bulk_outputs;
+      std::vector<std::vector<InstanceSet> > bulk_valid_instances;
     protected:
       unsigned num_unmapped_points;
       unsigned num_uncomplete_points;
@@ -23,6 +23,10 @@
 #include "legion/legion_views.h"
 #include "legion/legion_context.h"
 
+#include <algorithm>
+#include <unistd.h> // getpid for trace cache files
+#include <dirent.h> // listing trace cache files
+
 namespace Legion {
   namespace Internal {
 
@@ -46,6 +50,46 @@ namespace Legion {
       return out;
     }
 
+    //--------------------------------------------------------------------------
+    static inline uint64_t mix_fingerprint(uint64_t hash, uint64_t value)
+    //--------------------------------------------------------------------------
+    {
+      // FNV-1a style mixing of a whole word at a time
+      hash ^= value;
+      hash *= 0x100000001b3ULL;
+      return (hash ^ (hash >> 29));
+    }
+
+    //--------------------------------------------------------------------------
+    static inline uint64_t compute_checksum(const void *buffer, size_t size)
+    //--------------------------------------------------------------------------
+    {
+      const unsigned char *bytes = static_cast<const unsigned char*>(buffer);
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      for (size_t idx = 0; idx < size; idx++)
+      {
+        hash ^= bytes[idx];
+        hash *= 0x100000001b3ULL;
+      }
+      return hash;
+    }
+
+    // Header at the start of every trace cache file written by
+    // DynamicTrace::save_cached_trace
+    struct CachedTraceHeader {
+      uint64_t magic;
+      uint64_t version;
+      uint64_t machine;
+      uint64_t payload_bytes;
+      uint64_t checksum;
+      TraceID trace_id;
+      unsigned max_fields;
+    };
+    static const uint64_t CACHED_TRACE_MAGIC = 0x4c47545243414348ULL;
+    static const uint64_t CACHED_TRACE_VERSION = 1;
+    // Most cache files for the same trace that we will consider loading
+    static const unsigned MAX_CACHED_TRACE_FILES = 16;
+
     /////////////////////////////////////////////////////////////
     // LegionTrace 
     /////////////////////////////////////////////////////////////
@@ -476,9 +520,33 @@ namespace Legion {
     // DynamicTrace 
     /////////////////////////////////////////////////////////////
 
+    //--------------------------------------------------------------------------
+    DynamicTrace::OperationInfo::OperationInfo(Operation *op)
+      : kind(op->get_operation_kind()), count(op->get_region_count()),
+        fingerprint((kind == Operation::TASK_OP_KIND) ? 
+            AutoTraceDetector::compute_fingerprint(static_cast<TaskOp*>(op)) :
+            0)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::OperationInfo::matches(Operation *op) const
+    //--------------------------------------------------------------------------
+    {
+      if ((kind != op->get_operation_kind()) || 
+          (count != op->get_region_count()))
+        return false;
+      // Cached traces only contain task launches with fingerprints and
+      // they must be the same as the launches in the previous run
+      return ((kind == Operation::TASK_OP_KIND) && (fingerprint == 
+            AutoTraceDetector::compute_fingerprint(static_cast<TaskOp*>(op))));
+    }
+
     //--------------------------------------------------------------------------
     DynamicTrace::DynamicTrace(TraceID t, TaskContext *c, bool logical_only)
-      : LegionTrace(c, logical_only), tid(t), fixed(false), tracing(true)
+      : LegionTrace(c, logical_only), tid(t), fixed(false), tracing(true),
+        cache_machine_hash(0), check_fingerprints(false), cache_diverged(false)
     //--------------------------------------------------------------------------
     {
     }
@@ -533,8 +601,404 @@ namespace Legion {
       current_uids.clear();
       num_regions.clear();
 #endif
+      if (!cache_prefix.empty())
+        save_cached_trace();
     } 
 
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::attach_cache_files(const std::string &prefix,
+                                          unsigned long long machine_hash,
+                                          bool load_cache)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!fixed);
+      assert(tracing);
+      assert(operations.empty());
+#endif
+      cache_prefix = prefix;
+      cache_machine_hash = machine_hash;
+      if (!load_cache)
+        return false;
+      // Find all the files written for this trace by previous runs,
+      // sorted so that every run considers them in the same order
+      const size_t slash = prefix.find_last_of('/');
+      const std::string directory = (slash == std::string::npos) ? 
+        std::string(".") : prefix.substr(0, slash);
+      const std::string base = (slash == std::string::npos) ? 
+        prefix : prefix.substr(slash + 1);
+      std::vector<std::string> file_names;
+      DIR *dir = opendir(directory.c_str());
+      if (dir == NULL)
+        return false;
+      for (struct dirent *entry = readdir(dir); 
+            entry != NULL; entry = readdir(dir))
+      {
+        const std::string name(entry->d_name);
+        if ((name.size() <= (base.size() + 5)) ||
+            (name.compare(0, base.size() + 1, base + "_") != 0) ||
+            (name.compare(name.size() - 4, 4, ".lgt") != 0))
+          continue;
+        file_names.push_back(directory + "/" + name);
+      }
+      closedir(dir);
+      std::sort(file_names.begin(), file_names.end());
+      for (std::vector<std::string>::const_iterator it = 
+            file_names.begin(); it != file_names.end(); it++)
+      {
+        if (cache_candidates.size() == MAX_CACHED_TRACE_FILES)
+        {
+          log_run.warning("Ignoring trace cache files for trace %d after "
+                          "the first %d, consider cleaning up the trace "
+                          "cache directory", tid, MAX_CACHED_TRACE_FILES);
+          break;
+        }
+        cache_file = *it;
+        const bool loaded = load_cached_trace();
+        if (loaded)
+        {
+          cache_candidates.push_back(CachedTrace());
+          cache_candidates.back().file_name = cache_file;
+          swap_cache_candidate(cache_candidates.back());
+        }
+        op_info.clear();
+        dependences.clear();
+        aliased_children.clear();
+      }
+      cache_file.clear();
+      if (cache_candidates.empty())
+        return false;
+      // Start replaying the first one, the others are only used if
+      // the operations that are issued don't match it
+      swap_cache_candidate(cache_candidates.front());
+      cache_candidates.erase(cache_candidates.begin());
+      // The trace was captured by a previous run so we can start replaying
+      // it right away, but check the launches the first time we do
+      check_fingerprints = true;
+      tracing = false;
+      fixed = true;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void DynamicTrace::swap_cache_candidate(CachedTrace &candidate)
+    //--------------------------------------------------------------------------
+    {
+      cache_file.swap(candidate.file_name);
+      op_info.swap(candidate.op_info);
+      dependences.swap(candidate.dependences);
+      aliased_children.swap(candidate.aliased_children);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ unsigned long long DynamicTrace::compute_machine_hash(
+                                                               Runtime *runtime)
+    //--------------------------------------------------------------------------
+    {
+      // Traces are only reused on the same shape of machine
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      hash = mix_fingerprint(hash, runtime->total_address_spaces);
+      hash = mix_fingerprint(hash, runtime->address_space);
+      Machine::ProcessorQuery local_procs(runtime->machine);
+      local_procs.local_address_space();
+      std::map<Processor::Kind,unsigned> kind_counts;
+      for (Machine::ProcessorQuery::iterator it = local_procs.begin();
+            it != local_procs.end(); it++)
+        kind_counts[it->kind()]++;
+      for (std::map<Processor::Kind,unsigned>::const_iterator it = 
+            kind_counts.begin(); it != kind_counts.end(); it++)
+      {
+        hash = mix_fingerprint(hash, it->first);
+        hash = mix_fingerprint(hash, it->second);
+      }
+      return hash;
+    }
+
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::load_cached_trace(void)
+    //--------------------------------------------------------------------------
+    {
+      FILE *f = fopen(cache_file.c_str(), "rb");
+      if (f == NULL)
+        return false;
+      CachedTraceHeader header;
+      if (fread(&header, sizeof(header), 1, f) != 1)
+      {
+        fclose(f);
+        return false;
+      }
+      if ((header.magic != CACHED_TRACE_MAGIC) || 
+          (header.version != CACHED_TRACE_VERSION) ||
+          (header.max_fields != LEGION_MAX_FIELDS) ||
+          (header.trace_id != tid) || (header.machine != cache_machine_hash))
+      {
+        log_run.info("Ignoring trace cache file %s for trace %d because "
+                     "it was written by a different version of Legion or "
+                     "on a different machine", cache_file.c_str(), tid);
+        fclose(f);
+        return false;
+      }
+      std::vector<char> payload(header.payload_bytes);
+      const bool complete = (header.payload_bytes == 0) ||
+        (fread(&payload.front(), header.payload_bytes, 1, f) == 1);
+      fclose(f);
+      // Only trust contents that we know that we wrote out entirely
+      if (!complete || (header.payload_bytes == 0) ||
+          (compute_checksum(&payload.front(), header.payload_bytes) != 
+           header.checksum))
+      {
+        log_run.warning("Ignoring corrupted trace cache file %s for trace "
+                        "%d", cache_file.c_str(), tid);
+        return false;
+      }
+      Deserializer derez(&payload.front(), header.payload_bytes);
+      size_t num_operations;
+      derez.deserialize(num_operations);
+      op_info.resize(num_operations);
+      dependences.resize(num_operations);
+      for (unsigned idx = 0; idx < num_operations; idx++)
+      {
+        OperationInfo &info = op_info[idx];
+        derez.deserialize(info.kind);
+        derez.deserialize(info.count);
+        derez.deserialize(info.fingerprint);
+        // We can only check operations with a fingerprint when the trace
+        // is replayed, so we can't trust dependences on any others
+        if (info.fingerprint == 0)
+        {
+          log_run.info("Ignoring trace cache file %s for trace %d because "
+                       "operation %d has no fingerprint", cache_file.c_str(),
+                       tid, idx);
+          op_info.clear();
+          dependences.clear();
+          return false;
+        }
+        size_t num_dependences;
+        derez.deserialize(num_dependences);
+        LegionVector<DependenceRecord>::aligned &deps = dependences[idx];
+        for (unsigned didx = 0; didx < num_dependences; didx++)
+        {
+          int operation_idx, prev_idx, next_idx;
+          bool validates;
+          DependenceType dtype;
+          FieldMask dependent_mask;
+          derez.deserialize(operation_idx);
+          derez.deserialize(prev_idx);
+          derez.deserialize(next_idx);
+          derez.deserialize(validates);
+          derez.deserialize(dtype);
+          derez.deserialize(dependent_mask);
+          deps.push_back(DependenceRecord(operation_idx, prev_idx, next_idx,
+                                          validates, dtype, dependent_mask));
+        }
+      }
+      size_t num_aliased;
+      derez.deserialize(num_aliased);
+      for (unsigned idx = 0; idx < num_aliased; idx++)
+      {
+        unsigned op_index;
+        derez.deserialize(op_index);
+        size_t num_children;
+        derez.deserialize(num_children);
+        LegionVector<AliasChildren>::aligned &children = 
+          aliased_children[op_index];
+        for (unsigned cidx = 0; cidx < num_children; cidx++)
+        {
+          unsigned req_index, depth;
+          FieldMask mask;
+          derez.deserialize(req_index);
+          derez.deserialize(depth);
+          derez.deserialize(mask);
+          children.push_back(AliasChildren(req_index, depth, mask));
+        }
+      }
+      log_run.info("Loaded %zd operations for trace %d from trace cache "
+                   "file %s", num_operations, tid, cache_file.c_str());
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void DynamicTrace::save_cached_trace(void) const
+    //--------------------------------------------------------------------------
+    {
+      // Only task launches have fingerprints so traces with any other
+      // kinds of operations can't be checked by a later run
+      for (unsigned idx = 0; idx < op_info.size(); idx++)
+      {
+        if (op_info[idx].fingerprint != 0)
+          continue;
+        log_run.info("Not writing a trace cache file for trace %d because "
+                     "operation %d of kind %s has no fingerprint", tid, idx,
+                     Operation::get_string_rep(op_info[idx].kind));
+        return;
+      }
+      // Name the file by the operations in the trace so that runs that
+      // issue different operations in the same trace keep separate files
+      uint64_t op_hash = 0xcbf29ce484222325ULL;
+      for (unsigned idx = 0; idx < op_info.size(); idx++)
+      {
+        op_hash = mix_fingerprint(op_hash, op_info[idx].kind);
+        op_hash = mix_fingerprint(op_hash, op_info[idx].count);
+        op_hash = mix_fingerprint(op_hash, op_info[idx].fingerprint);
+      }
+      char file_suffix[32];
+      snprintf(file_suffix, sizeof(file_suffix), "_%016llx.lgt",
+               (unsigned long long)op_hash);
+      const std::string file_name = cache_prefix + file_suffix;
+      // The dependences only depend on the operations, so if another 
+      // context or run already wrote this file then we are done
+      if (access(file_name.c_str(), F_OK) == 0)
+        return;
+      Serializer rez;
+      rez.serialize<size_t>(op_info.size());
+      for (unsigned idx = 0; idx < op_info.size(); idx++)
+      {
+        const OperationInfo &info = op_info[idx];
+        rez.serialize(info.kind);
+        rez.serialize(info.count);
+        rez.serialize(info.fingerprint);
+        const LegionVector<DependenceRecord>::aligned &deps = dependences[idx];
+        rez.serialize<size_t>(deps.size());
+        for (LegionVector<DependenceRecord>::aligned::const_iterator it =
+              deps.begin(); it != deps.end(); it++)
+        {
+          rez.serialize(it->operation_idx);
+          rez.serialize(it->prev_idx);
+          rez.serialize(it->next_idx);
+          rez.serialize(it->validates);
+          rez.serialize(it->dtype);
+          rez.serialize(it->dependent_mask);
+        }
+      }
+      rez.serialize<size_t>(aliased_children.size());
+      for (std::map<unsigned,LegionVector<AliasChildren>::aligned>::
+            const_iterator it = aliased_children.begin(); it != 
+            aliased_children.end(); it++)
+      {
+        rez.serialize(it->first);
+        rez.serialize<size_t>(it->second.size());
+        for (LegionVector<AliasChildren>::aligned::const_iterator cit =
+              it->second.begin(); cit != it->second.end(); cit++)
+        {
+          rez.serialize(cit->req_index);
+          rez.serialize(cit->depth);
+          rez.serialize(cit->mask);
+        }
+      }
+      CachedTraceHeader header;
+      header.magic = CACHED_TRACE_MAGIC;
+      header.version = CACHED_TRACE_VERSION;
+      header.trace_id = tid;
+      header.max_fields = LEGION_MAX_FIELDS;
+      header.machine = cache_machine_hash;
+      header.payload_bytes = rez.get_used_bytes();
+      header.checksum = 
+        compute_checksum(rez.get_buffer(), rez.get_used_bytes());
+      // Write to a temporary file first and then rename it so that
+      // a later run can never observe a partially written file, the
+      // process ID and the trace keep concurrent writers apart
+      char temp_suffix[64];
+      snprintf(temp_suffix, sizeof(temp_suffix), ".%d.%llx.tmp", 
+               (int)getpid(), (unsigned long long)(uintptr_t)this);
+      const std::string temp_file = file_name + temp_suffix;
+      FILE *f = fopen(temp_file.c_str(), "wb");
+      if (f == NULL)
+      {
+        log_run.warning("Unable to open trace cache file %s for trace %d",
+                        temp_file.c_str(), tid);
+        return;
+      }
+      const bool success = 
+        (fwrite(&header, sizeof(header), 1, f) == 1) &&
+        (fwrite(rez.get_buffer(), rez.get_used_bytes(), 1, f) == 1);
+      if ((fclose(f) != 0) || !success || 
+          (rename(temp_file.c_str(), file_name.c_str()) != 0))
+      {
+        log_run.warning("Failed to write trace cache file %s for trace %d",
+                        file_name.c_str(), tid);
+        remove(temp_file.c_str());
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::matches_cached_operation(Operation *op,
+                                                unsigned index) const
+    //--------------------------------------------------------------------------
+    {
+      if (index >= op_info.size())
+        return false;
+      return op_info[index].matches(op);
+    }
+
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::select_cache_candidate(Operation *op, unsigned index)
+    //--------------------------------------------------------------------------
+    {
+      // Look for another cache file that issued the same operations
+      // so far and also this one, the dependences we've already used
+      // only depend on those operations so they are the same for it
+      for (std::vector<CachedTrace>::iterator it = 
+            cache_candidates.begin(); it != cache_candidates.end(); it++)
+      {
+        if ((index >= it->op_info.size()) || !it->op_info[index].matches(op))
+          continue;
+        if (!std::equal(op_info.begin(), op_info.begin() + index,
+                        it->op_info.begin()))
+          continue;
+        swap_cache_candidate(*it);
+        log_run.info("Switching trace %d to trace cache file %s at "
+                     "operation %d", tid, cache_file.c_str(), index);
+        return true;
+      }
+      return false;
+    }
+
+    //--------------------------------------------------------------------------
+    void DynamicTrace::register_conservative_dependences(Operation *op,
+                                                         GenerationID gen)
+    //--------------------------------------------------------------------------
+    {
+      if (op->is_internal_op())
+      {
+        // Our creator is the last operation in the trace and it will 
+        // depend on us so depend on everything that came before it
+        for (unsigned idx = 0; (idx + 1) < operations.size(); idx++)
+        {
+          op->register_dependence(operations[idx].first, 
+                                  operations[idx].second);
+#ifdef LEGION_SPY
+          LegionSpy::log_mapping_dependence(
+              op->get_context()->get_unique_id(),
+              get_current_uid_by_index(idx), 0,
+              op->get_unique_op_id(), 0, TRUE_DEPENDENCE);
+#endif
+        }
+        return;
+      }
+      // Every operation in the trace is ordered before one of the
+      // operations in the frontier so depending on them is enough
+      for (std::set<std::pair<Operation*,GenerationID> >::const_iterator it =
+            frontiers.begin(); it != frontiers.end(); it++)
+      {
+        op->register_dependence(it->first, it->second);
+#ifdef LEGION_SPY
+        LegionSpy::log_mapping_dependence(
+            op->get_context()->get_unique_id(), current_uids[*it], 0,
+            op->get_unique_op_id(), 0, TRUE_DEPENDENCE);
+#endif
+        it->first->remove_mapping_reference(it->second);
+      }
+      frontiers.clear();
+      const std::pair<Operation*,GenerationID> key(op,gen);
+      frontiers.insert(key);
+      operations.push_back(key);
+#ifdef LEGION_SPY
+      current_uids[key] = op->get_unique_op_id();
+      num_regions[key] = op->get_region_count();
+#endif
+      op->add_mapping_reference(gen);
+    }
+
     //--------------------------------------------------------------------------
     bool DynamicTrace::handles_region_tree(RegionTreeID tid) const
     //--------------------------------------------------------------------------
@@ -614,7 +1078,23 @@ namespace Legion {
       }
       else
       {
-        if (!op->is_internal_op())
+        // Traces loaded from a cache file might not match what the
+        // application is doing now, in which case we fall back to
+        // conservative dependences until the trace is captured again
+        if (check_fingerprints && !cache_diverged && 
+            !op->is_internal_op() && !matches_cached_operation(op, index) &&
+            !select_cache_candidate(op, index))
+        {
+          log_run.warning("Operation at index %d of trace %d in task %s "
+                          "(UID %lld) does not match trace cache file %s. "
+                          "The trace will be captured again.", index, tid,
+                          ctx->get_task_name(), ctx->get_unique_id(),
+                          cache_file.c_str());
+          cache_diverged = true;
+        }
+        if (cache_diverged)
+          register_conservative_dependences(op, gen);
+        else if (!op->is_internal_op())
         {
           frontiers.insert(key);
           // Check for exceeding the trace size
@@ -644,6 +1124,13 @@ namespace Legion {
                           index, tid, ctx->get_task_name(),
                           ctx->get_unique_id(), info.count,
                           op->get_region_count())
+          // Once all the operations of a cached trace have matched we
+          // can stop checking them against the cache file
+          if (check_fingerprints && ((index + 1) == op_info.size()))
+          {
+            check_fingerprints = false;
+            cache_candidates.clear();
+          }
           // If we make it here, everything is good
           const LegionVector<DependenceRecord>::aligned &deps = 
                                                           dependences[index];
@@ -1013,6 +1500,157 @@ namespace Legion {
       deps.push_back(record);
     }
 
+    /////////////////////////////////////////////////////////////
+    // AutoTraceDetector
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    AutoTraceDetector::AutoTraceDetector(unsigned min_len)
+      : min_length((min_len < LEGION_AUTO_TRACE_MAX_LENGTH) ?
+          min_len : LEGION_AUTO_TRACE_MAX_LENGTH),
+        history(LEGION_AUTO_TRACE_MAX_LENGTH + 1, 0),
+        match_runs(LEGION_AUTO_TRACE_MAX_LENGTH - min_length + 1, 0),
+        next_index(0), total_launches(0)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(min_length > 0);
+#endif
+    }
+
+    //--------------------------------------------------------------------------
+    AutoTraceDetector::AutoTraceDetector(const AutoTraceDetector &rhs)
+      : min_length(rhs.min_length)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+    }
+
+    //--------------------------------------------------------------------------
+    AutoTraceDetector::~AutoTraceDetector(void)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    AutoTraceDetector& AutoTraceDetector::operator=(
+                                                  const AutoTraceDetector &rhs)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+      return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned AutoTraceDetector::record_launch(uint64_t fingerprint)
+    //--------------------------------------------------------------------------
+    {
+      const unsigned size = history.size();
+      history[next_index] = fingerprint;
+      unsigned result = 0;
+      // Check every candidate length to see if this launch matches the
+      // one that was that many launches before it, a sequence has repeated
+      // enough times once all the launches in the last (repeats-1) copies
+      // match the launches one copy before them
+      for (unsigned length = min_length;
+            length <= LEGION_AUTO_TRACE_MAX_LENGTH; length++)
+      {
+        unsigned &run = match_runs[length - min_length];
+        if ((length <= total_launches) &&
+            (history[(next_index + size - length) % size] == fingerprint))
+        {
+          run++;
+          if ((result == 0) &&
+              (run >= ((LEGION_AUTO_TRACE_MIN_REPEATS - 1) * length)))
+            result = length;
+        }
+        else
+          run = 0;
+      }
+      next_index = (next_index + 1) % size;
+      total_launches++;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    void AutoTraceDetector::get_sequence(unsigned length,
+                                       std::vector<uint64_t> &sequence) const
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(length <= total_launches);
+      assert(length < history.size());
+#endif
+      const unsigned size = history.size();
+      sequence.resize(length);
+      // Return the most recent launches in the order they were issued
+      for (unsigned idx = 0; idx < length; idx++)
+        sequence[idx] = history[(next_index + size - length + idx) % size];
+    }
+
+    //--------------------------------------------------------------------------
+    void AutoTraceDetector::reset(void)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < match_runs.size(); idx++)
+        match_runs[idx] = 0;
+      next_index = 0;
+      total_launches = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ uint64_t AutoTraceDetector::compute_fingerprint(TaskOp *task)
+    //--------------------------------------------------------------------------
+    {
+      // Everything that the logical dependence analysis of the launch
+      // depends on has to be part of the fingerprint so that any two
+      // launches with the same fingerprint are interchangeable in a trace
+      uint64_t hash = 0xcbf29ce484222325ULL;
+      hash = mix_fingerprint(hash, task->task_id);
+      hash = mix_fingerprint(hash, task->is_index_space ? 1 : 0);
+      if (task->is_index_space)
+      {
+        const Domain &domain = task->index_domain;
+        hash = mix_fingerprint(hash, domain.is_id);
+        hash = mix_fingerprint(hash, domain.dim);
+        for (int idx = 0; idx < (2 * domain.dim); idx++)
+          hash = mix_fingerprint(hash, domain.rect_data[idx]);
+      }
+      hash = mix_fingerprint(hash, task->regions.size());
+      for (std::vector<RegionRequirement>::const_iterator it =
+            task->regions.begin(); it != task->regions.end(); it++)
+      {
+        hash = mix_fingerprint(hash, it->handle_type);
+        if (it->handle_type == PART_PROJECTION)
+        {
+          hash = mix_fingerprint(hash, it->partition.get_tree_id());
+          hash = mix_fingerprint(hash,
+                                 it->partition.get_index_partition().get_id());
+          hash = mix_fingerprint(hash, it->partition.get_field_space().get_id());
+        }
+        else
+        {
+          hash = mix_fingerprint(hash, it->region.get_tree_id());
+          hash = mix_fingerprint(hash, it->region.get_index_space().get_id());
+          hash = mix_fingerprint(hash, it->region.get_field_space().get_id());
+        }
+        if (it->handle_type != SINGULAR)
+          hash = mix_fingerprint(hash, it->projection);
+        hash = mix_fingerprint(hash, it->parent.get_index_space().get_id());
+        hash = mix_fingerprint(hash, it->privilege);
+        hash = mix_fingerprint(hash, it->prop);
+        hash = mix_fingerprint(hash, it->redop);
+        hash = mix_fingerprint(hash, it->privilege_fields.size());
+        for (std::set<FieldID>::const_iterator fit =
+              it->privilege_fields.begin(); fit !=
+              it->privilege_fields.end(); fit++)
+          hash = mix_fingerprint(hash, *fit);
+      }
+      return hash;
+    }
+
     /////////////////////////////////////////////////////////////
     // TraceOp 
     /////////////////////////////////////////////////////////////
@@ -1851,7 +2489,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     PhysicalTrace::PhysicalTrace(Runtime *rt, LegionTrace *lt)
       : runtime(rt), logical_trace(lt), current_template(NULL),
-        nonreplayable_count(0)
+        nonreplayable_count(0), template_clock(0)
     //--------------------------------------------------------------------------
     {
       if (runtime->replay_on_cpus)
@@ -1870,7 +2508,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     PhysicalTrace::PhysicalTrace(const PhysicalTrace &rhs)
       : runtime(NULL), logical_trace(NULL), current_template(NULL),
-        nonreplayable_count(0)
+        nonreplayable_count(0), template_clock(0)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -1925,7 +2563,23 @@ namespace Legion {
       {
         // Reset the nonreplayable count when we find a replayable template
         nonreplayable_count = 0;
+        // If we have too many templates then delete the one that
+        // has gone the longest without being replayed
+        if ((runtime->max_trace_templates > 0) &&
+            (templates.size() >= runtime->max_trace_templates))
+        {
+          std::vector<PhysicalTemplate*>::iterator victim = templates.begin();
+          for (std::vector<PhysicalTemplate*>::iterator it =
+                templates.begin(); it != templates.end(); it++)
+            if ((*it)->get_last_use() < (*victim)->get_last_use())
+              victim = it;
+          pending_deletion = (*victim)->defer_template_deletion();
+          templates.erase(victim);
+          runtime->record_template_statistics(0, 0, 0, 1/*evictions*/);
+        }
+        tpl->set_last_use(++template_clock);
         templates.push_back(tpl);
+        update_precondition_views();
       }
       return pending_deletion;
     }
@@ -1935,19 +2589,166 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       current_template = NULL;
+      if (templates.empty())
+        return;
+      // With only one template there is nothing for a signature to 
+      // choose between so just check its preconditions directly
+      if (templates.size() == 1)
+      {
+        PhysicalTemplate *tpl = templates.front();
+        if (tpl->check_preconditions())
+        {
+          select_template(tpl);
+          runtime->record_template_statistics(1/*hits*/, 0, 0, 0);
+        }
+        else
+          runtime->record_template_statistics(0, 1/*misses*/, 
+                                              1/*rerecords*/, 0);
+        return;
+      }
+      // Capture the valid fields of all the precondition views once and
+      // check every template against that instead of having each of them
+      // capture the physical state again. If the state matches the one 
+      // that some template was selected for before then try it first.
+      LegionMap<InstanceView*,FieldMask>::aligned current_valid;
+      const uint64_t signature = compute_state_signature(current_valid);
+      std::map<uint64_t,PhysicalTemplate*>::const_iterator finder =
+        template_index.find(signature);
+      PhysicalTemplate *candidate = NULL;
+      if (finder != template_index.end())
+      {
+        candidate = finder->second;
+        if (candidate->check_preconditions(current_valid))
+        {
+          select_template(candidate);
+          runtime->record_template_statistics(1/*hits*/, 0, 0, 0);
+          return;
+        }
+      }
       for (std::vector<PhysicalTemplate*>::reverse_iterator it =
            templates.rbegin(); it != templates.rend(); ++it)
-        if ((*it)->check_preconditions())
+        if (((*it) != candidate) && (*it)->check_preconditions(current_valid))
         {
+          select_template(*it);
+          template_index[signature] = *it;
+          runtime->record_template_statistics(0, 1/*misses*/, 0, 0);
+          return;
+        }
+      // No template can be replayed so the trace will be recorded again
+      runtime->record_template_statistics(0, 1/*misses*/, 1/*rerecords*/, 0);
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalTrace::select_template(PhysicalTemplate *tpl)
+    //--------------------------------------------------------------------------
+    {
 #ifdef DEBUG_LEGION
-          assert((*it)->is_replayable());
+      assert(tpl->is_replayable());
 #endif
-          // Reset the nonreplayable count when a replayable template satisfies
-          // the precondition
-          nonreplayable_count = 0;
-          current_template = *it;
-          return;
+      // Reset the nonreplayable count when a replayable template satisfies
+      // the precondition
+      nonreplayable_count = 0;
+      tpl->set_last_use(++template_clock);
+      current_template = tpl;
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalTrace::update_precondition_views(void)
+    //--------------------------------------------------------------------------
+    {
+      // The signatures depend on the set of views so they are all stale now
+      template_index.clear();
+      precondition_views.clear();
+      precondition_contexts.clear();
+      for (std::vector<PhysicalTemplate*>::const_iterator it =
+            templates.begin(); it != templates.end(); it++)
+      {
+        const PhysicalTemplate *tpl = *it;
+        for (LegionMap<InstanceView*,FieldMask>::aligned::const_iterator vit =
+              tpl->previous_valid_views.begin(); vit !=
+              tpl->previous_valid_views.end(); vit++)
+        {
+          LegionMap<InstanceView*,FieldMask>::aligned::iterator finder =
+            precondition_views.find(vit->first);
+          if (finder == precondition_views.end())
+          {
+            precondition_views[vit->first] = vit->second;
+            LegionMap<InstanceView*,ContextID>::aligned::const_iterator
+              ctx_finder = tpl->physical_contexts.find(vit->first);
+#ifdef DEBUG_LEGION
+            assert(ctx_finder != tpl->physical_contexts.end());
+#endif
+            precondition_contexts[vit->first] = ctx_finder->second;
+          }
+          else
+            finder->second |= vit->second;
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    uint64_t PhysicalTrace::compute_state_signature(
+              LegionMap<InstanceView*,FieldMask>::aligned &current_valid) const
+    //--------------------------------------------------------------------------
+    {
+      // Hash which fields of each precondition view are currently valid,
+      // capturing the physical state of each region only once, and record
+      // those fields so the templates can be checked against them
+      uint64_t signature = 0xcbf29ce484222325ULL;
+      std::map<std::pair<RegionTreeNode*,ContextID>,PhysicalState*> states;
+      for (LegionMap<InstanceView*,FieldMask>::aligned::const_iterator it =
+            precondition_views.begin(); it != precondition_views.end(); it++)
+      {
+        std::map<InstanceView*,ContextID>::const_iterator ctx_finder =
+          precondition_contexts.find(it->first);
+#ifdef DEBUG_LEGION
+        assert(ctx_finder != precondition_contexts.end());
+#endif
+        RegionTreeNode *logical_node = it->first->logical_node;
+        const std::pair<RegionTreeNode*,ContextID> key(logical_node,
+                                                       ctx_finder->second);
+        PhysicalState *state = NULL;
+        std::map<std::pair<RegionTreeNode*,ContextID>,PhysicalState*>::
+          const_iterator state_finder = states.find(key);
+        if (state_finder == states.end())
+        {
+          state = new PhysicalState(logical_node, false);
+          VersionManager &manager =
+            logical_node->get_current_version_manager(ctx_finder->second);
+          manager.update_physical_state(state);
+          state->capture_state();
+          states[key] = state;
+        }
+        else
+          state = state_finder->second;
+        FieldMask valid;
+        if (it->first->is_materialized_view())
+        {
+          LegionMap<LogicalView*,FieldMask,
+                    VALID_VIEW_ALLOC>::track_aligned::const_iterator finder =
+            state->valid_views.find(it->first);
+          if (finder != state->valid_views.end())
+            valid = finder->second & it->second;
         }
+        else
+        {
+          LegionMap<ReductionView*,FieldMask,
+                    VALID_REDUCTION_ALLOC>::track_aligned::const_iterator
+              finder = state->reduction_views.find(
+                                            it->first->as_reduction_view());
+          if (finder != state->reduction_views.end())
+            valid = finder->second & it->second;
+        }
+        signature = mix_fingerprint(signature, 
+                                    reinterpret_cast<uintptr_t>(it->first));
+        signature = mix_fingerprint(signature, valid.get_hash_key());
+        if (!!valid)
+          current_valid[it->first] = valid;
+      }
+      for (std::map<std::pair<RegionTreeNode*,ContextID>,PhysicalState*>::
+            const_iterator it = states.begin(); it != states.end(); it++)
+        delete it->second;
+      return signature;
     }
 
     //--------------------------------------------------------------------------
@@ -1979,7 +2780,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     PhysicalTemplate::PhysicalTemplate(PhysicalTrace *t, ApEvent fence_event)
       : trace(t), recording(true), replayable(true), fence_completion_id(0),
-        replay_parallelism(implicit_runtime->max_replay_parallelism)
+        replay_parallelism(implicit_runtime->max_replay_parallelism),
+        last_use(0), pending_plan(NULL)
     //--------------------------------------------------------------------------
     {
       events.push_back(fence_event);
@@ -1991,7 +2793,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     PhysicalTemplate::PhysicalTemplate(const PhysicalTemplate &rhs)
       : trace(NULL), recording(true), replayable(true), fence_completion_id(0),
-        replay_parallelism(1)
+        replay_parallelism(1), last_use(0), pending_plan(NULL)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -2002,11 +2804,17 @@ namespace Legion {
     PhysicalTemplate::~PhysicalTemplate(void)
     //--------------------------------------------------------------------------
     {
+      if (pending_plan != NULL)
+      {
+        // Install the plan so its instructions get deleted below
+        if (!optimization_done.has_triggered())
+          optimization_done.wait();
+        install_plan(*pending_plan);
+        delete pending_plan;
+      }
       {
         AutoLock tpl_lock(template_lock);
-        for (std::vector<Instruction*>::iterator it = instructions.begin();
-             it != instructions.end(); ++it)
-          delete *it;
+        delete_instructions();
         // Relesae references to instances
         for (CachedMappings::iterator it = cached_mappings.begin();
             it != cached_mappings.end(); ++it)
@@ -2028,6 +2836,14 @@ namespace Legion {
                            Runtime *runtime, ApEvent completion, bool recurrent)
     //--------------------------------------------------------------------------
     {
+      // The previous replay is done so we can switch to the optimized
+      // plan if it is ready, otherwise we keep using the current one
+      if ((pending_plan != NULL) && optimization_done.has_triggered())
+      {
+        install_plan(*pending_plan);
+        delete pending_plan;
+        pending_plan = NULL;
+      }
       fence_completion = completion;
       if (recurrent)
         for (std::map<unsigned, unsigned>::iterator it = frontiers.begin();
@@ -2189,7 +3005,7 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    bool PhysicalTemplate::check_preconditions(void)
+    bool PhysicalTemplate::check_logical_preconditions(void)
     //--------------------------------------------------------------------------
     {
       for (LegionMap<std::pair<RegionTreeNode*, ContextID>,
@@ -2212,7 +3028,6 @@ namespace Legion {
       {
 #ifdef DEBUG_LEGION
         assert(logical_contexts.find(it->first) != logical_contexts.end());
-        assert(physical_contexts.find(it->first) != physical_contexts.end());
 #endif
         RegionTreeNode *logical_node = it->first->logical_node;
         ContextID logical_ctx = logical_contexts[it->first];
@@ -2221,7 +3036,25 @@ namespace Legion {
         if (previous_open_nodes.find(key) == previous_open_nodes.end() &&
             !check_logical_open(logical_node, logical_ctx, it->second))
           return false;
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    bool PhysicalTemplate::check_preconditions(void)
+    //--------------------------------------------------------------------------
+    {
+      if (!check_logical_preconditions())
+        return false;
 
+      for (LegionMap<InstanceView*, FieldMask>::aligned::iterator it =
+           previous_valid_views.begin(); it !=
+           previous_valid_views.end(); ++it)
+      {
+#ifdef DEBUG_LEGION
+        assert(physical_contexts.find(it->first) != physical_contexts.end());
+#endif
+        RegionTreeNode *logical_node = it->first->logical_node;
         ContextID physical_ctx = physical_contexts[it->first];
         PhysicalState *state = new PhysicalState(logical_node, false);
         VersionManager &manager =
@@ -2269,6 +3102,26 @@ namespace Legion {
       return true;
     }
 
+    //--------------------------------------------------------------------------
+    bool PhysicalTemplate::check_preconditions(
+           const LegionMap<InstanceView*,FieldMask>::aligned &current_valid)
+    //--------------------------------------------------------------------------
+    {
+      if (!check_logical_preconditions())
+        return false;
+
+      for (LegionMap<InstanceView*, FieldMask>::aligned::const_iterator it =
+           previous_valid_views.begin(); it !=
+           previous_valid_views.end(); ++it)
+      {
+        LegionMap<InstanceView*, FieldMask>::aligned::const_iterator finder =
+          current_valid.find(it->first);
+        if ((finder == current_valid.end()) || !!(it->second - finder->second))
+          return false;
+      }
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     bool PhysicalTemplate::check_replayable(void) const
     //--------------------------------------------------------------------------
@@ -2373,51 +3226,176 @@ namespace Legion {
       {
         if (implicit_runtime->dump_physical_traces)
         {
-          optimize();
+          ReplayPlan plan;
+          initialize_plan(plan, false/*clone*/);
+          optimize(plan, false/*background*/);
+          install_plan(plan);
           dump_template();
         }
         return;
       }
-      optimize();
+      const unsigned threshold = 
+        implicit_runtime->background_optimization_threshold;
+      if ((threshold > 0) && (instructions.size() >= threshold) &&
+          !implicit_runtime->no_trace_optimization &&
+          !implicit_runtime->dump_physical_traces)
+      {
+        // Large templates take a long time to optimize so we replay
+        // them without the optimizations until a meta-task has made
+        // an optimized plan from a copy of the instructions
+        pending_plan = new ReplayPlan;
+        initialize_plan(*pending_plan, true/*clone*/);
+        ReplayPlan plan;
+        initialize_plan(plan, false/*clone*/);
+        prepare_parallel_replay(plan);
+        push_complete_replays(plan);
+        install_plan(plan);
+        OptimizeTemplateArgs args(this);
+        optimization_done = implicit_runtime->issue_runtime_meta_task(args,
+                                                  LG_THROUGHPUT_WORK_PRIORITY);
+      }
+      else
+      {
+        ReplayPlan plan;
+        initialize_plan(plan, false/*clone*/);
+        optimize(plan, false/*background*/);
+        install_plan(plan);
+      }
       generate_summary_operations();
       if (implicit_runtime->dump_physical_traces) dump_template();
-      size_t num_events = events.size();
-      events.clear();
-      events.resize(num_events);
+      // Reset the events in place without resizing the table since a
+      // background optimization might still be making instructions
+      // that check their events against it
+      std::fill(events.begin(), events.end(), ApEvent::NO_AP_EVENT);
       event_map.clear();
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::optimize(void)
+    void PhysicalTemplate::initialize_plan(ReplayPlan &plan, bool clone)
     //--------------------------------------------------------------------------
     {
-      std::vector<unsigned> gen;
-      if (!(implicit_runtime->no_trace_optimization ||
-            implicit_runtime->no_fence_elision))
-        elide_fences(gen);
+#ifdef DEBUG_LEGION
+      assert(instructions.size() <= events.size());
+#endif
+      // Before the optimizations the generator of events[idx]
+      // is instructions[idx] so they both have the same size
+      plan.num_events = instructions.size();
+      if (clone)
+      {
+        std::map<unsigned, unsigned> rewrite;
+        for (unsigned idx = 0; idx < plan.num_events; ++idx)
+          rewrite.insert(rewrite.end(), std::make_pair(idx, idx));
+        plan.instructions.reserve(instructions.size());
+        for (std::vector<Instruction*>::const_iterator it = 
+              instructions.begin(); it != instructions.end(); ++it)
+          plan.instructions.push_back((*it)->clone(*this, rewrite));
+        plan.frontiers = frontiers;
+      }
       else
       {
+        plan.instructions.swap(instructions);
+        plan.frontiers.swap(frontiers);
+      }
+      plan.gen.resize(plan.num_events);
+      for (unsigned idx = 0; idx < plan.num_events; ++idx)
+        plan.gen[idx] = idx;
+      assign_replay_slices(plan);
 #ifdef DEBUG_LEGION
-        assert(instructions.size() == events.size());
+      // Instructions check their events against the size of the event
+      // tables when they are made, so make room for all the events that
+      // the optimization passes can add: a merge for each instruction
+      // and a frontier for each event during fence elision, and then
+      // a crossing event for each of those when preparing the slices.
+      // Crossing events are triggered so they need user events too.
+      const size_t max_events = 2 * (2 * plan.num_events + 
+                                     plan.instructions.size());
+      if (events.size() < max_events)
+        events.resize(max_events);
+      if (user_events.size() < max_events)
+        user_events.resize(max_events);
 #endif
-        gen.resize(events.size());
-        for (unsigned idx = 0; idx < events.size(); ++idx)
-          gen[idx] = idx;
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalTemplate::install_plan(ReplayPlan &plan)
+    //--------------------------------------------------------------------------
+    {
+      // Nothing can be replaying when we get here
+      delete_instructions();
+      instructions.swap(plan.instructions);
+      frontiers.swap(plan.frontiers);
+      crossing_events.swap(plan.crossing_events);
+      slices.swap(plan.slices);
+      slice_tasks.swap(plan.slice_tasks);
+      // Events of the previous plan are never used again so
+      // there is no need to shrink the event tables
+      if (events.size() < plan.num_events)
+        events.resize(plan.num_events);
+      if (user_events.size() < plan.num_events)
+        user_events.resize(plan.num_events);
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalTemplate::delete_instructions(void)
+    //--------------------------------------------------------------------------
+    {
+      // The triggers of crossing events only live in the slices
+      std::set<Instruction*> to_delete(instructions.begin(), 
+                                       instructions.end());
+      for (std::vector<std::vector<Instruction*> >::const_iterator sit =
+            slices.begin(); sit != slices.end(); ++sit)
+        to_delete.insert(sit->begin(), sit->end());
+      for (std::set<Instruction*>::const_iterator it = to_delete.begin();
+            it != to_delete.end(); ++it)
+        delete (*it);
+      instructions.clear();
+      slices.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalTemplate::optimize(ReplayPlan &plan, bool background)
+    //--------------------------------------------------------------------------
+    {
+      unsigned long long pass_times[5] = { 0, 0, 0, 0, 0 };
+      unsigned long long start = Realm::Clock::current_time_in_microseconds();
+      if (!(implicit_runtime->no_trace_optimization ||
+            implicit_runtime->no_fence_elision))
+      {
+        elide_fences(plan);
+        const unsigned long long stop = 
+          Realm::Clock::current_time_in_microseconds();
+        pass_times[0] = stop - start;
+        start = stop;
       }
       if (!implicit_runtime->no_trace_optimization)
       {
-        propagate_merges(gen);
-        transitive_reduction();
-        propagate_copies(gen);
+        propagate_merges(plan);
+        unsigned long long stop = Realm::Clock::current_time_in_microseconds();
+        pass_times[1] = stop - start;
+        start = stop;
+        transitive_reduction(plan);
+        stop = Realm::Clock::current_time_in_microseconds();
+        pass_times[2] = stop - start;
+        start = stop;
+        propagate_copies(plan);
+        stop = Realm::Clock::current_time_in_microseconds();
+        pass_times[3] = stop - start;
+        start = stop;
       }
-      prepare_parallel_replay(gen);
-      push_complete_replays();
+      prepare_parallel_replay(plan);
+      push_complete_replays(plan);
+      pass_times[4] = Realm::Clock::current_time_in_microseconds() - start;
+      trace->runtime->record_template_optimization(background, pass_times[0],
+          pass_times[1], pass_times[2], pass_times[3], pass_times[4]);
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::elide_fences(std::vector<unsigned> &gen)
+    void PhysicalTemplate::elide_fences(ReplayPlan &plan)
     //--------------------------------------------------------------------------
     {
+      std::vector<Instruction*> &instructions = plan.instructions;
+      std::map<unsigned, unsigned> &frontiers = plan.frontiers;
+      std::vector<unsigned> &gen = plan.gen;
       // Reserve some events for merges to be added during fence elision
       unsigned num_merges = 0;
       for (std::vector<Instruction*>::iterator it = instructions.begin();
@@ -2457,8 +3435,8 @@ namespace Legion {
             }
         }
 
-      unsigned merge_starts = events.size();
-      events.resize(events.size() + num_merges);
+      unsigned merge_starts = plan.num_events;
+      plan.num_events += num_merges;
 
       // Reserve space for completion events of the previously replayed trace
       // - frontiers[idx] == (event idx from the previous trace)
@@ -2474,9 +3452,8 @@ namespace Legion {
             unsigned frontier = *uit;
             if (frontiers.find(frontier) == frontiers.end())
             {
-              unsigned next_event_id = events.size();
+              unsigned next_event_id = plan.num_events++;
               frontiers[frontier] = next_event_id;
-              events.resize(next_event_id + 1);
             }
           }
 
@@ -2484,7 +3461,7 @@ namespace Legion {
       // the generator of events[idx] is instructions[idx].
       // After fence elision, the generator of events[idx] is
       // instructions[gen[idx]].
-      gen.resize(events.size());
+      gen.resize(plan.num_events);
       std::vector<Instruction*> new_instructions;
 
       for (unsigned idx = 0; idx < instructions.size(); ++idx)
@@ -2507,7 +3484,8 @@ namespace Legion {
                    it != reqs.end(); ++it)
                 for (std::vector<FieldID>::const_iterator fit =
                      it->fields.begin(); fit != it->fields.end(); ++fit)
-                  find_last_users(it->instance, it->node, *fit, users);
+                  find_last_users(it->instance, it->node, *fit, users,
+                                  frontiers);
               precondition_idx = &replay->rhs;
               break;
             }
@@ -2517,12 +3495,14 @@ namespace Legion {
               for (unsigned idx = 0; idx < copy->src_fields.size(); ++idx)
               {
                 const CopySrcDstField &field = copy->src_fields[idx];
-                find_last_users(field.inst, copy->node, field.field_id, users);
+                find_last_users(field.inst, copy->node, field.field_id, users,
+                                frontiers);
               }
               for (unsigned idx = 0; idx < copy->dst_fields.size(); ++idx)
               {
                 const CopySrcDstField &field = copy->dst_fields[idx];
-                find_last_users(field.inst, copy->node, field.field_id, users);
+                find_last_users(field.inst, copy->node, field.field_id, users,
+                                frontiers);
               }
               precondition_idx = &copy->precondition_idx;
               break;
@@ -2533,7 +3513,8 @@ namespace Legion {
               for (unsigned idx = 0; idx < fill->fields.size(); ++idx)
               {
                 const CopySrcDstField &field = fill->fields[idx];
-                find_last_users(field.inst, fill->node, field.field_id, users);
+                find_last_users(field.inst, fill->node, field.field_id, users,
+                                frontiers);
               }
               precondition_idx = &fill->precondition_idx;
               break;
@@ -2572,9 +3553,11 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::propagate_merges(std::vector<unsigned> &gen)
+    void PhysicalTemplate::propagate_merges(ReplayPlan &plan)
     //--------------------------------------------------------------------------
     {
+      std::vector<Instruction*> &instructions = plan.instructions;
+      std::vector<unsigned> &gen = plan.gen;
       std::vector<Instruction*> new_instructions;
       std::vector<bool> used(instructions.size(), false);
 
@@ -2655,8 +3638,8 @@ namespace Legion {
       std::vector<unsigned> new_gen;
       new_gen.resize(gen.size());
       new_gen[fence_completion_id] = 0;
-      for (std::map<unsigned, unsigned>::iterator it = frontiers.begin();
-          it != frontiers.end(); ++it)
+      for (std::map<unsigned, unsigned>::iterator it = 
+            plan.frontiers.begin(); it != plan.frontiers.end(); ++it)
         new_gen[it->second] = 0;
       for (unsigned idx = 0; idx < instructions.size(); ++idx)
         if (used[idx])
@@ -2680,19 +3663,15 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::prepare_parallel_replay(
-                                               const std::vector<unsigned> &gen)
+    void PhysicalTemplate::assign_replay_slices(ReplayPlan &plan)
     //--------------------------------------------------------------------------
     {
-      slices.resize(replay_parallelism);
+      // This has to be done while the recorded operations are still
+      // valid, so never as part of an optimization in the background
+      std::vector<std::vector<TraceLocalID> > &slice_tasks = plan.slice_tasks;
+      std::map<TraceLocalID, unsigned> &slice_indices_by_owner = 
+        plan.slice_indices_by_owner;
       slice_tasks.resize(replay_parallelism);
-      std::map<TraceLocalID, unsigned> slice_indices_by_owner;
-      std::vector<unsigned> slice_indices_by_inst;
-      slice_indices_by_inst.resize(instructions.size());
-#ifdef DEBUG_LEGION
-      for (unsigned idx = 1; idx < instructions.size(); ++idx)
-        slice_indices_by_inst[idx] = -1U;
-#endif
       bool round_robin_for_tasks = false;
 
       std::set<Processor> distinct_targets;
@@ -2734,11 +3713,30 @@ namespace Legion {
         if (it->second->get_operation_kind() == Operation::TASK_OP_KIND)
           slice_tasks[slice_index].push_back(it->first);
       }
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalTemplate::prepare_parallel_replay(ReplayPlan &plan)
+    //--------------------------------------------------------------------------
+    {
+      std::vector<Instruction*> &instructions = plan.instructions;
+      std::vector<std::vector<Instruction*> > &slices = plan.slices;
+      std::map<unsigned, unsigned> &crossing_events = plan.crossing_events;
+      const std::vector<unsigned> &gen = plan.gen;
+      const std::map<TraceLocalID, unsigned> &slice_indices_by_owner = 
+        plan.slice_indices_by_owner;
+      slices.resize(replay_parallelism);
+      std::vector<unsigned> slice_indices_by_inst;
+      slice_indices_by_inst.resize(instructions.size());
+#ifdef DEBUG_LEGION
+      for (unsigned idx = 1; idx < instructions.size(); ++idx)
+        slice_indices_by_inst[idx] = -1U;
+#endif
       for (unsigned idx = 1; idx < instructions.size(); ++idx)
       {
         Instruction *inst = instructions[idx];
         const TraceLocalID &owner = inst->owner;
-        std::map<TraceLocalID, unsigned>::iterator finder =
+        std::map<TraceLocalID, unsigned>::const_iterator finder =
           slice_indices_by_owner.find(owner);
 #ifdef DEBUG_LEGION
         assert(finder != slice_indices_by_owner.end());
@@ -2773,9 +3771,7 @@ namespace Legion {
                   new_rhs.insert(finder->second);
                 else
                 {
-                  unsigned new_crossing_event = events.size();
-                  events.resize(events.size() + 1);
-                  user_events.resize(events.size());
+                  unsigned new_crossing_event = plan.num_events++;
                   crossing_events[rh] = new_crossing_event;
                   new_rhs.insert(new_crossing_event);
                   slices[generator_slice].push_back(
@@ -2836,9 +3832,7 @@ namespace Legion {
                 *event_to_check = finder->second;
               else
               {
-                unsigned new_crossing_event = events.size();
-                events.resize(events.size() + 1);
-                user_events.resize(events.size());
+                unsigned new_crossing_event = plan.num_events++;
                 crossing_events[ev] = new_crossing_event;
                 *event_to_check = new_crossing_event;
                 slices[generator_slice].push_back(
@@ -2852,23 +3846,30 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::transitive_reduction(void)
+    void PhysicalTemplate::transitive_reduction(ReplayPlan &plan)
     //--------------------------------------------------------------------------
     {
+      std::vector<Instruction*> &instructions = plan.instructions;
       // Transitive reduction inspired by Klaus Simon,
       // "An improved algorithm for transitive closure on acyclic digraphs"
+      // Only merges can have redundant preconditions, and a precondition
+      // of a merge is redundant if another one of its preconditions can 
+      // reach it. We cover the events with chains and track for each 
+      // event the latest position on every chain that can reach it, so
+      // the cost is proportional to the number of events times the number
+      // of chains, which is close to the width of the graph.
 
       // First, build a DAG and find nodes with no incoming edges
       std::vector<unsigned> topo_order;
       topo_order.reserve(instructions.size());
-      std::vector<unsigned> inv_topo_order(events.size(), -1U);
+      std::vector<unsigned> inv_topo_order(plan.num_events, -1U);
       std::vector<std::vector<unsigned> > incoming;
       std::vector<std::vector<unsigned> > outgoing;
-      incoming.resize(events.size());
-      outgoing.resize(events.size());
+      incoming.resize(plan.num_events);
+      outgoing.resize(plan.num_events);
 
-      for (std::map<unsigned, unsigned>::iterator it = frontiers.begin();
-           it != frontiers.end(); ++it)
+      for (std::map<unsigned, unsigned>::iterator it = 
+            plan.frontiers.begin(); it != plan.frontiers.end(); ++it)
       {
         inv_topo_order[it->second] = topo_order.size();
         topo_order.push_back(it->second);
@@ -3005,102 +4006,112 @@ namespace Legion {
         ++idx;
       }
 
-      // Third, construct a chain decomposition
+      // Third, construct a chain decomposition by walking backwards
+      // from the latest event in topological order that is not on a chain
       unsigned num_chains = 0;
       std::vector<unsigned> chain_indices(topo_order.size(), -1U);
-
       int pos = chain_indices.size() - 1;
       while (true)
       {
-        while (chain_indices[pos] != -1U && pos >= 0)
+        while ((pos >= 0) && (chain_indices[pos] != -1U))
           --pos;
         if (pos < 0) break;
         unsigned curr = topo_order[pos];
-        while (incoming[curr].size() > 0)
+        chain_indices[pos] = num_chains;
+        while (true)
         {
-          chain_indices[inv_topo_order[curr]] = num_chains;
           const std::vector<unsigned> &in = incoming[curr];
           bool found = false;
           for (unsigned iidx = 0; iidx < in.size(); ++iidx)
           {
-            unsigned next = in[iidx];
-            if (chain_indices[inv_topo_order[next]] == -1U)
+            const unsigned rank = inv_topo_order[in[iidx]];
+            if (chain_indices[rank] == -1U)
             {
               found = true;
-              curr = next;
-              chain_indices[inv_topo_order[curr]] = num_chains;
+              curr = in[iidx];
+              chain_indices[rank] = num_chains;
               break;
             }
           }
           if (!found) break;
         }
-        chain_indices[inv_topo_order[curr]] = num_chains;
         ++num_chains;
       }
 
-      // Fourth, find the frontiers of chains that are connected to each node
-      std::vector<std::vector<int> > all_chain_frontiers;
-      std::vector<std::vector<unsigned> > incoming_reduced;
-      all_chain_frontiers.resize(topo_order.size());
-      incoming_reduced.resize(topo_order.size());
+      std::vector<MergeEvent*> merges(plan.num_events, NULL);
+      for (unsigned idx = 0; idx < instructions.size(); ++idx)
+      {
+        if (instructions[idx]->get_kind() != MERGE_EVENT)
+          continue;
+        MergeEvent *merge = instructions[idx]->as_merge_event();
+        if (merge->rhs.size() > 1)
+          merges[merge->lhs] = merge;
+      }
+
+      // Lastly, compute for each event the latest position on each chain
+      // that can reach it, in topological order. A precondition of a merge
+      // is redundant if a position at or after it on its chain already 
+      // reaches the merge. We only keep the positions of an event until
+      // all the events that depend on it have been visited.
+      std::vector<std::vector<int> > chain_frontiers(topo_order.size());
+      std::vector<unsigned> remaining_uses(topo_order.size());
+      for (unsigned idx = 0; idx < topo_order.size(); ++idx)
+        remaining_uses[idx] = outgoing[topo_order[idx]].size();
       for (unsigned idx = 0; idx < topo_order.size(); ++idx)
       {
-        std::vector<int> chain_frontiers(num_chains, -1);
         const std::vector<unsigned> &in = incoming[topo_order[idx]];
-        std::vector<unsigned> &in_reduced = incoming_reduced[idx];
+        std::vector<int> &frontier = chain_frontiers[idx];
+        frontier.resize(num_chains, -1);
         for (unsigned iidx = 0; iidx < in.size(); ++iidx)
         {
-          int rank = inv_topo_order[in[iidx]];
+          const unsigned rank = inv_topo_order[in[iidx]];
 #ifdef DEBUG_LEGION
-          assert((unsigned)rank < idx);
+          assert(rank < idx);
 #endif
-          const std::vector<int> &pred_chain_frontiers =
-            all_chain_frontiers[rank];
+          const std::vector<int> &pred_frontier = chain_frontiers[rank];
           for (unsigned k = 0; k < num_chains; ++k)
-            chain_frontiers[k] =
-              std::max(chain_frontiers[k], pred_chain_frontiers[k]);
+            if (frontier[k] < pred_frontier[k])
+              frontier[k] = pred_frontier[k];
         }
+        MergeEvent *merge = merges[topo_order[idx]];
+        std::set<unsigned> new_rhs;
         for (unsigned iidx = 0; iidx < in.size(); ++iidx)
         {
-          int rank = inv_topo_order[in[iidx]];
-          unsigned chain_idx = chain_indices[rank];
-          if (chain_frontiers[chain_idx] < rank)
+          const unsigned rank = inv_topo_order[in[iidx]];
+          const unsigned chain_idx = chain_indices[rank];
+          if (frontier[chain_idx] < (int)rank)
           {
-            in_reduced.push_back(in[iidx]);
-            chain_frontiers[chain_idx] = rank;
+            frontier[chain_idx] = rank;
+            if (merge != NULL)
+              new_rhs.insert(in[iidx]);
           }
         }
-#ifdef DEBUG_LEGION
-        assert(in.size() == 0 || in_reduced.size() > 0);
-#endif
-        all_chain_frontiers[idx].swap(chain_frontiers);
-      }
-
-      // Lastly, suppress transitive dependences using chains
-      for (unsigned idx = 0; idx < instructions.size(); ++idx)
-        if (instructions[idx]->get_kind() == MERGE_EVENT)
+        // Release the positions of any predecessors we were the last user of
+        for (unsigned iidx = 0; iidx < in.size(); ++iidx)
         {
-          MergeEvent *merge = instructions[idx]->as_merge_event();
-          const std::vector<unsigned> &in_reduced =
-            incoming_reduced[inv_topo_order[merge->lhs]];
-          std::set<unsigned> new_rhs;
-          for (unsigned iidx = 0; iidx < in_reduced.size(); ++iidx)
-          {
+          const unsigned rank = inv_topo_order[in[iidx]];
+          if (--remaining_uses[rank] == 0)
+            std::vector<int>().swap(chain_frontiers[rank]);
+        }
+        if (remaining_uses[idx] == 0)
+          std::vector<int>().swap(frontier);
+        if (merge == NULL)
+          continue;
 #ifdef DEBUG_LEGION
-            assert(merge->rhs.find(in_reduced[iidx]) != merge->rhs.end());
+        assert(!new_rhs.empty());
 #endif
-            new_rhs.insert(in_reduced[iidx]);
-          }
-          if (new_rhs.size() < merge->rhs.size())
-            merge->rhs.swap(new_rhs);
-        }
+        if (new_rhs.size() < merge->rhs.size())
+          merge->rhs.swap(new_rhs);
+      }
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::propagate_copies(std::vector<unsigned> &gen)
+    void PhysicalTemplate::propagate_copies(ReplayPlan &plan)
     //--------------------------------------------------------------------------
     {
-      std::vector<int> substs(events.size(), -1);
+      std::vector<Instruction*> &instructions = plan.instructions;
+      std::vector<unsigned> &gen = plan.gen;
+      std::vector<int> substs(plan.num_events, -1);
       std::vector<Instruction*> new_instructions;
       new_instructions.reserve(instructions.size());
       for (unsigned idx = 0; idx < instructions.size(); ++idx)
@@ -3222,12 +4233,12 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void PhysicalTemplate::push_complete_replays()
+    void PhysicalTemplate::push_complete_replays(ReplayPlan &plan)
     //--------------------------------------------------------------------------
     {
-      for (unsigned idx = 0; idx < slices.size(); ++idx)
+      for (unsigned idx = 0; idx < plan.slices.size(); ++idx)
       {
-        std::vector<Instruction*> &instructions = slices[idx];
+        std::vector<Instruction*> &instructions = plan.slices[idx];
         std::vector<Instruction*> new_instructions;
         new_instructions.reserve(instructions.size());
         std::vector<Instruction*> complete_replays;
@@ -4310,8 +5321,11 @@ namespace Legion {
     {
       ApEvent wait_on = get_completion_for_deletion();
       DeleteTemplateArgs args(this);
+      RtEvent precondition = Runtime::protect_event(wait_on);
+      if (pending_plan != NULL)
+        precondition = Runtime::merge_events(precondition, optimization_done);
       return implicit_runtime->issue_runtime_meta_task(args, LG_LOW_PRIORITY,
-          Runtime::protect_event(wait_on));
+                                                       precondition);
     }
 
     //--------------------------------------------------------------------------
@@ -4330,6 +5344,18 @@ namespace Legion {
       delete pargs->tpl;
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void PhysicalTemplate::handle_optimize_template(const void *args)
+    //--------------------------------------------------------------------------
+    {
+      const OptimizeTemplateArgs *pargs = (const OptimizeTemplateArgs*)args;
+      PhysicalTemplate *tpl = pargs->tpl;
+#ifdef DEBUG_LEGION
+      assert(tpl->pending_plan != NULL);
+#endif
+      tpl->optimize(*tpl->pending_plan, true/*background*/);
+    }
+
     //--------------------------------------------------------------------------
     inline void PhysicalTemplate::record_last_user(const PhysicalInstance &inst,
                                                    RegionNode *node,
@@ -4375,7 +5401,8 @@ namespace Legion {
     inline void PhysicalTemplate::find_last_users(const PhysicalInstance &inst,
                                                   RegionNode *node,
                                                   unsigned field,
-                                                  std::set<unsigned> &users)
+                                                  std::set<unsigned> &users,
+                                        std::map<unsigned, unsigned> &frontiers)
     //--------------------------------------------------------------------------
     {
       InstanceAccess key(inst, field);
@@ -4627,8 +5654,23 @@ namespace Legion {
                                    const std::map<unsigned, unsigned> &rewrite)
     //--------------------------------------------------------------------------
     {
-      assert(false);
-      return NULL;
+      std::map<unsigned, unsigned>::const_iterator lhs_finder =
+        rewrite.find(lhs);
+#ifdef DEBUG_LEGION
+      assert(lhs_finder != rewrite.end());
+#endif
+      std::set<unsigned> new_rhs;
+      for (std::set<unsigned>::const_iterator it = rhs.begin();
+           it != rhs.end(); ++it)
+      {
+        std::map<unsigned, unsigned>::const_iterator rhs_finder =
+          rewrite.find(*it);
+#ifdef DEBUG_LEGION
+        assert(rhs_finder != rewrite.end());
+#endif
+        new_rhs.insert(rhs_finder->second);
+      }
+      return new MergeEvent(tpl, lhs_finder->second, new_rhs, owner);
     }
 
     /////////////////////////////////////////////////////////////
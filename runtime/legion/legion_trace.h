@@ -212,12 +212,31 @@ namespace Legion {
     public:
       struct OperationInfo {
       public:
-        OperationInfo(Operation *op)
-          : kind(op->get_operation_kind()), count(op->get_region_count()) { }
+        OperationInfo(void)
+          : kind(Operation::LAST_OP_KIND), count(0), fingerprint(0) { }
+        OperationInfo(Operation *op);
+      public:
+        bool operator==(const OperationInfo &rhs) const
+          { return (kind == rhs.kind) && (count == rhs.count) &&
+                   (fingerprint == rhs.fingerprint); }
+        bool matches(Operation *op) const;
       public:
         Operation::OpKind kind;
         unsigned count;
+        // Only computed for task launches so that traces loaded 
+        // from a previous run can check that the launches match,
+        // traces with any other operations are never cached
+        uint64_t fingerprint;
       }; 
+      // The contents of a trace cache file that might be replayed
+      struct CachedTrace {
+      public:
+        std::string file_name;
+        std::vector<OperationInfo> op_info;
+        std::deque<LegionVector<DependenceRecord>::aligned> dependences;
+        std::map<unsigned,LegionVector<AliasChildren>::aligned> 
+                                                          aliased_children;
+      };
     public:
       DynamicTrace(TraceID tid, TaskContext *ctx, bool logical_only);
       DynamicTrace(const DynamicTrace &rhs);
@@ -237,6 +256,25 @@ namespace Legion {
     public:
       // Called by analysis thread
       void end_trace_capture(void);
+    public:
+      // Traces can be saved at the end of their capture and loaded
+      // again when a later run of the application begins them. Each
+      // file is named by the prefix and a hash of its operations.
+      bool attach_cache_files(const std::string &prefix,
+                              unsigned long long machine_hash,
+                              bool load_cache = true);
+      const std::string& get_cache_prefix(void) const { return cache_prefix; }
+      static unsigned long long compute_machine_hash(Runtime *runtime);
+      // Called by task execution thread to see if the trace loaded from
+      // the cache file did not match and needs to be captured again
+      bool has_diverged_cache(void) const { return cache_diverged; }
+    protected:
+      bool load_cached_trace(void);
+      void save_cached_trace(void) const;
+      bool matches_cached_operation(Operation *op, unsigned index) const;
+      bool select_cache_candidate(Operation *op, unsigned index);
+      void swap_cache_candidate(CachedTrace &candidate);
+      void register_conservative_dependences(Operation *op, GenerationID gen);
     public:
       virtual void record_static_dependences(Operation *op,
                           const std::vector<StaticDependence> *dependences);
@@ -287,6 +325,55 @@ namespace Legion {
       const TraceID tid;
       bool fixed;
       bool tracing;
+    protected:
+      std::string cache_prefix;
+      // The file of the cached trace being replayed
+      std::string cache_file;
+      unsigned long long cache_machine_hash;
+      // Other cache files for this trace that were written by runs that
+      // issued different operations, we switch to one of them if the
+      // operations issued so far match it better
+      std::vector<CachedTrace> cache_candidates;
+      // Set for traces loaded from a cache file until the first
+      // replay of the trace has checked all the launch fingerprints
+      bool check_fingerprints;
+      // Set by the analysis thread if the operations did not match the
+      // ones in the cache file so the recorded dependences can't be used
+      volatile bool cache_diverged;
+    };
+
+    /**
+     * \class AutoTraceDetector
+     * This class watches the stream of task launches in a context
+     * that is not being traced by the application and detects when
+     * the most recent launches complete a sequence that has been
+     * issued back-to-back enough times that it is worth tracing.
+     */
+    class AutoTraceDetector {
+    public:
+      AutoTraceDetector(unsigned min_length);
+      AutoTraceDetector(const AutoTraceDetector &rhs);
+      ~AutoTraceDetector(void);
+    public:
+      AutoTraceDetector& operator=(const AutoTraceDetector &rhs);
+    public:
+      // Returns the length of the repeated sequence that is completed
+      // by the launch with this fingerprint or zero if there is none
+      unsigned record_launch(uint64_t fingerprint);
+      void get_sequence(unsigned length,
+                        std::vector<uint64_t> &sequence) const;
+      void reset(void);
+    public:
+      static uint64_t compute_fingerprint(TaskOp *task);
+    protected:
+      const unsigned min_length;
+      // Circular buffer of the most recent fingerprints
+      std::vector<uint64_t> history;
+      // For each candidate length, the number of consecutive launches
+      // that matched the launch that many positions before them
+      std::vector<unsigned> match_runs;
+      unsigned next_index;
+      unsigned total_launches;
     };
 
     class TraceOp : public FenceOp {
@@ -486,11 +573,25 @@ namespace Legion {
     public:
       Runtime * const runtime;
       const LegionTrace *logical_trace;
+    private:
+      void select_template(PhysicalTemplate *tpl);
+      void update_precondition_views(void);
+      uint64_t compute_state_signature(
+          LegionMap<InstanceView*,FieldMask>::aligned &current_valid) const;
     private:
       mutable LocalLock trace_lock;
       PhysicalTemplate* current_template;
       std::vector<PhysicalTemplate*> templates;
       unsigned nonreplayable_count;
+      // Templates indexed by a signature of the physical state 
+      // that satisfied their preconditions the last time that
+      // they were selected for replay
+      std::map<uint64_t,PhysicalTemplate*> template_index;
+      // All the views that appear in the preconditions of any template
+      LegionMap<InstanceView*,FieldMask>::aligned precondition_views;
+      std::map<InstanceView*,ContextID> precondition_contexts;
+      // Logical clock for finding the least recently used template
+      unsigned long long template_clock;
     public:
       std::vector<Processor> replay_targets;
       ApEvent previous_template_completion;
@@ -536,6 +637,33 @@ namespace Legion {
       public:
         PhysicalTemplate *tpl;
       };
+      struct OptimizeTemplateArgs : 
+        public LgTaskArgs<OptimizeTemplateArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_OPTIMIZE_TEMPLATE_ID;
+      public:
+        OptimizeTemplateArgs(PhysicalTemplate *t)
+          : LgTaskArgs<OptimizeTemplateArgs>(0), tpl(t) { }
+      public:
+        PhysicalTemplate *tpl;
+      };
+      // The instructions and replay slices that the optimization
+      // passes work on. Templates can be replayed from one plan
+      // while a better one is optimized in the background.
+      struct ReplayPlan {
+      public:
+        ReplayPlan(void) : num_events(0) { }
+      public:
+        std::vector<Instruction*> instructions;
+        // The generator of events[idx] is instructions[gen[idx]]
+        std::vector<unsigned> gen;
+        std::map<unsigned, unsigned> frontiers;
+        std::map<unsigned, unsigned> crossing_events;
+        std::vector<std::vector<Instruction*> > slices;
+        std::vector<std::vector<TraceLocalID> > slice_tasks;
+        std::map<TraceLocalID, unsigned> slice_indices_by_owner;
+        unsigned num_events;
+      };
     public:
       PhysicalTemplate(PhysicalTrace *trace, ApEvent fence_event);
       PhysicalTemplate(const PhysicalTemplate &rhs);
@@ -552,8 +680,13 @@ namespace Legion {
                                      FieldMask fields);
       static bool check_logical_open(RegionTreeNode *node, ContextID ctx,
                           LegionMap<IndexSpaceNode*, FieldMask>::aligned projs);
+      bool check_logical_preconditions(void);
     public:
       bool check_preconditions(void);
+      // Check against the valid fields of each precondition view 
+      // that the caller already captured from the physical state
+      bool check_preconditions(
+          const LegionMap<InstanceView*,FieldMask>::aligned &current_valid);
       bool check_replayable(void) const;
       void register_operation(Operation *op);
       void execute_all(void);
@@ -562,14 +695,19 @@ namespace Legion {
                                     Operation *invalidator);
     public:
       void finalize(bool has_blocking_call);
-      void optimize(void);
-      void elide_fences(std::vector<unsigned> &gen);
-      void propagate_merges(std::vector<unsigned> &gen);
-      void transitive_reduction(void);
-      void propagate_copies(std::vector<unsigned> &gen);
-      void prepare_parallel_replay(const std::vector<unsigned> &gen);
-      void push_complete_replays();
+      void optimize(ReplayPlan &plan, bool background);
+      void elide_fences(ReplayPlan &plan);
+      void propagate_merges(ReplayPlan &plan);
+      void transitive_reduction(ReplayPlan &plan);
+      void propagate_copies(ReplayPlan &plan);
+      void prepare_parallel_replay(ReplayPlan &plan);
+      void push_complete_replays(ReplayPlan &plan);
       void generate_summary_operations(void);
+    protected:
+      void initialize_plan(ReplayPlan &plan, bool clone);
+      void assign_replay_slices(ReplayPlan &plan);
+      void install_plan(ReplayPlan &plan);
+      void delete_instructions(void);
       void dump_template(void);
       void dump_instructions(const std::vector<Instruction*> &instructions);
     public:
@@ -581,6 +719,8 @@ namespace Legion {
       inline bool is_recording(void) const { return recording; }
       inline bool is_replaying(void) const { return !recording; }
       inline bool is_replayable(void) const { return replayable; }
+      inline unsigned long long get_last_use(void) const { return last_use; }
+      inline void set_last_use(unsigned long long use) { last_use = use; }
     protected:
       static std::string view_to_string(const InstanceView *view);
       static std::string view_to_string(const FillView *view);
@@ -670,6 +810,7 @@ namespace Legion {
     public:
       static void handle_replay_slice(const void *args);
       static void handle_delete_template(const void *args);
+      static void handle_optimize_template(const void *args);
     private:
       void update_valid_view(bool is_reduction,
                              bool has_read,
@@ -681,7 +822,8 @@ namespace Legion {
       void record_last_user(const PhysicalInstance &inst, RegionNode *node,
                             unsigned field, unsigned user, bool read);
       void find_last_users(const PhysicalInstance &inst, RegionNode *node,
-                           unsigned field, std::set<unsigned> &users);
+                           unsigned field, std::set<unsigned> &users,
+                           std::map<unsigned, unsigned> &frontiers);
     private:
       PhysicalTrace *trace;
       volatile bool recording;
@@ -689,6 +831,12 @@ namespace Legion {
       mutable LocalLock template_lock;
       const unsigned fence_completion_id;
       const unsigned replay_parallelism;
+      unsigned long long last_use;
+    private:
+      // Plan being optimized in the background, it is installed
+      // before the first replay after the optimization is done
+      ReplayPlan *pending_plan;
+      RtEvent optimization_done;
     private:
       RtUserEvent replay_ready;
       RtEvent replay_done;
@@ -309,6 +309,7 @@ namespace Legion {
       LG_PARTITION_SEMANTIC_INFO_REQ_TASK_ID,
       LG_INDEX_SPACE_DEFER_CHILD_TASK_ID,
       LG_INDEX_PART_DEFER_CHILD_TASK_ID,
+      LG_INDEX_PART_CHILD_CREATION_TASK_ID,
       LG_SELECT_TUNABLE_TASK_ID,
       LG_DEFERRED_ENQUEUE_OP_ID,
       LG_DEFERRED_ENQUEUE_TASK_ID,
@@ -339,6 +340,10 @@ namespace Legion {
       LG_REMOTE_PHYSICAL_RESPONSE_TASK_ID,
       LG_REPLAY_SLICE_ID,
       LG_DELETE_TEMPLATE_ID,
+      LG_OPTIMIZE_TEMPLATE_ID,
+      LG_PROFILER_WRITER_TASK_ID,
+      LG_FLUSH_REFERENCE_UPDATES_TASK_ID,
+      LG_BALANCE_TASK_COMPLETE_TASK_ID,
       LG_MESSAGE_ID, // These two must be the last two
       LG_RETRY_SHUTDOWN_TASK_ID,
       LG_LAST_TASK_ID, // This one should always be last
@@ -396,6 +401,7 @@ namespace Legion {
         "Partition Semantic Request",                             \
         "Defer Index Space Child Request",                        \
         "Defer Index Partition Child Request",                    \
+        "Index Partition Child Creation",                         \
         "Select Tunable",                                         \
         "Deferred Enqueue Op",                                    \
         "Deferred Enqueue Task",                                  \
@@ -426,6 +432,10 @@ namespace Legion {
         "Remote Physical Context Response",                       \
         "Replay Physical Trace",                                  \
         "Delete Physical Template",                               \
+        "Optimize Physical Template",                             \
+        "Profiler Writer",                                        \
+        "Flush Remote Reference Updates",                         \
+        "Load Balance Task Completion",                           \
         "Remote Message",                                         \
         "Retry Shutdown",                                         \
       };
@@ -437,6 +447,7 @@ namespace Legion {
       PREMAP_TASK_CALL,
       SLICE_TASK_CALL,
       MAP_TASK_CALL,
+      MAP_TASKS_CALL,
       SELECT_VARIANT_CALL,
       POSTMAP_TASK_CALL,
       TASK_SELECT_SOURCES_CALL,
@@ -490,6 +501,7 @@ namespace Legion {
       "premap_task",                                \
       "slice_task",                                 \
       "map_task",                                   \
+      "map_tasks",                                  \
       "select_task_variant",                        \
       "postmap_task",                               \
       "select_task_sources",                        \
@@ -644,6 +656,7 @@ namespace Legion {
       DISTRIBUTED_VALID_UPDATE,
       DISTRIBUTED_GC_UPDATE,
       DISTRIBUTED_RESOURCE_UPDATE,
+      DISTRIBUTED_BATCH_UPDATE,
       DISTRIBUTED_INVALIDATE,
       DISTRIBUTED_DEACTIVATE,
       DISTRIBUTED_CREATE_ADD,
@@ -784,6 +797,7 @@ namespace Legion {
         "Distributed Valid Update",                                   \
         "Distributed GC Update",                                      \
         "Distributed Resource Update",                                \
+        "Distributed Batch Update",                                   \
         "Distributed Invalidate",                                     \
         "Distributed Deactivate",                                     \
         "Distributed Create Add",                                     \
@@ -1194,6 +1208,94 @@ namespace Legion {
       "Physical Trace Optimize",                                      \
     };
 
+    // Counters maintained by the runtime which are reported
+    // to the profiler with their values at the end of the run
+    enum RuntimeCounterKind {
+      INTERSECTION_CACHE_HIT_COUNTER,
+      INTERSECTION_CACHE_MISS_COUNTER,
+      INTERSECTION_CACHE_EVICTION_COUNTER,
+      INSTANCE_LOOKUPS_COUNTER,
+      INSTANCE_LOOKUP_CANDIDATES_COUNTER,
+      REFERENCE_UPDATES_BATCHED_COUNTER,
+      REFERENCE_UPDATES_CANCELLED_COUNTER,
+      REFERENCE_BATCH_MESSAGES_COUNTER,
+      AUTO_TRACE_OBSERVED_COUNTER,
+      AUTO_TRACE_CAPTURED_COUNTER,
+      AUTO_TRACE_REPLAYED_COUNTER,
+      AUTO_TRACE_DIVERGENCES_COUNTER,
+      TRACE_TEMPLATE_HITS_COUNTER,
+      TRACE_TEMPLATE_MISSES_COUNTER,
+      TRACE_TEMPLATE_RERECORDS_COUNTER,
+      TRACE_TEMPLATE_EVICTIONS_COUNTER,
+      TEMPLATE_OPTIMIZATIONS_COUNTER,
+      TEMPLATE_BACKGROUND_OPTIMIZATIONS_COUNTER,
+      TEMPLATE_FENCE_ELISION_TIME_COUNTER,
+      TEMPLATE_MERGE_PROPAGATION_TIME_COUNTER,
+      TEMPLATE_TRANSITIVE_REDUCTION_TIME_COUNTER,
+      TEMPLATE_COPY_PROPAGATION_TIME_COUNTER,
+      TEMPLATE_PARALLEL_REPLAY_TIME_COUNTER,
+      PROFILER_DROPPED_RECORDS_COUNTER,
+      PROFILER_SAMPLE_RATE_COUNTER,
+      LAST_RUNTIME_COUNTER_KIND, // This one must be last
+    };
+
+#define RUNTIME_COUNTER_DESCRIPTIONS(name)                            \
+    const char *name[LAST_RUNTIME_COUNTER_KIND] = {                   \
+      "Intersection Cache Hits",                                      \
+      "Intersection Cache Misses",                                    \
+      "Intersection Cache Evictions",                                 \
+      "Instance Lookups",                                             \
+      "Instance Lookup Candidates Examined",                          \
+      "Remote Reference Updates Batched",                             \
+      "Remote Reference Updates Cancelled",                           \
+      "Remote Reference Batch Messages",                              \
+      "Auto Trace Operations Observed",                               \
+      "Auto Trace Operations Captured",                               \
+      "Auto Trace Operations Replayed",                               \
+      "Auto Trace Divergences",                                       \
+      "Trace Template Index Hits",                                    \
+      "Trace Template Index Misses",                                  \
+      "Trace Template Re-records",                                    \
+      "Trace Template Evictions",                                     \
+      "Trace Templates Optimized",                                    \
+      "Trace Templates Optimized in Background",                      \
+      "Template Fence Elision Time (us)",                             \
+      "Template Merge Propagation Time (us)",                         \
+      "Template Transitive Reduction Time (us)",                      \
+      "Template Copy Propagation Time (us)",                          \
+      "Template Parallel Replay Preparation Time (us)",               \
+      "Profiler Dropped Records",                                     \
+      "Profiler Sample Rate",                                         \
+    };
+
+    // Intervals of the operation pipeline whose latencies are measured
+    // for each kind of operation when running with -lg:op_stages
+    enum OpStageKind {
+      OP_STAGE_QUEUED, // created until dependence analysis starts
+      OP_STAGE_PREPIPELINE, // overlaps with being queued
+      OP_STAGE_DEPENDENCE_ANALYSIS,
+      OP_STAGE_DEPENDENCE_WAIT, // until mapping dependences are satisfied
+      OP_STAGE_MAPPING, // includes physical analysis
+      OP_STAGE_EXECUTION,
+      OP_STAGE_COMPLETION,
+      OP_STAGE_COMMIT,
+      OP_STAGE_TOTAL, // created until committed
+      LAST_OP_STAGE_KIND, // This one must be last
+    };
+
+#define OP_STAGE_DESCRIPTIONS(name)                                   \
+    const char *name[LAST_OP_STAGE_KIND] = {                          \
+      "Queued",                                                       \
+      "Prepipeline",                                                  \
+      "Dependence Analysis",                                          \
+      "Dependence Wait",                                              \
+      "Mapping",                                                      \
+      "Execution",                                                    \
+      "Completion",                                                   \
+      "Commit",                                                       \
+      "Total",                                                        \
+    };
+
     enum SemanticInfoKind {
       INDEX_SPACE_SEMANTIC,
       INDEX_PARTITION_SEMANTIC,
@@ -1274,6 +1376,7 @@ namespace Legion {
 
     // legion_ops.h
     class Operation;
+    class OpStageLatencies;
     class SpeculativeOp;
     class MapOp;
     class CopyOp;
@@ -1381,6 +1484,7 @@ namespace Legion {
     class LegionTrace;
     class StaticTrace;
     class DynamicTrace;
+    class AutoTraceDetector;
     class TraceCaptureOp;
     class TraceCompleteOp;
     class TraceReplayOp;
@@ -1588,6 +1692,7 @@ namespace Legion {
     extern Realm::Logger log_variant;          \
     extern Realm::Logger log_allocation;       \
     extern Realm::Logger log_prof;             \
+    extern Realm::Logger log_prof_summary;     \
     extern Realm::Logger log_garbage;          \
     extern Realm::Logger log_spy;              \
     extern Realm::Logger log_shutdown;
@@ -177,6 +177,35 @@ namespace Legion {
       finish_mapper_call(info);
     }
 
+    //--------------------------------------------------------------------------
+    void MapperManager::invoke_map_tasks(TaskOp *task,
+                                         std::vector<const Task*> *tasks,
+                                      std::vector<Mapper::MapTaskInput> *inputs,
+                                    std::vector<Mapper::MapTaskOutput> *outputs,
+                                         MappingCallInfo *info)
+    //--------------------------------------------------------------------------
+    {
+      if (info == NULL)
+      {
+        RtEvent continuation_precondition;
+        info = begin_mapper_call(MAP_TASKS_CALL,
+                                 task, continuation_precondition);
+        // Build a continuation if necessary
+        if (continuation_precondition.exists())
+        {
+          MapperContinuation4<TaskOp,std::vector<const Task*>,
+                              std::vector<Mapper::MapTaskInput>,
+                              std::vector<Mapper::MapTaskOutput>,
+                              &MapperManager::invoke_map_tasks>
+                      continuation(this, task, tasks, inputs, outputs, info);
+          continuation.defer(runtime, continuation_precondition, task);
+          return;
+        }
+      }
+      mapper->map_tasks(info, *tasks, *inputs, *outputs);
+      finish_mapper_call(info);
+    }
+
     //--------------------------------------------------------------------------
     void MapperManager::invoke_select_task_variant(TaskOp *task,
                                             Mapper::SelectVariantInput *input,
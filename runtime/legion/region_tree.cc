@@ -39,14 +39,14 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     RegionTreeForest::RegionTreeForest(Runtime *rt)
-      : runtime(rt)
+      : runtime(rt), intersection_cache(this)
     //--------------------------------------------------------------------------
     {
     }
 
     //--------------------------------------------------------------------------
     RegionTreeForest::RegionTreeForest(const RegionTreeForest &rhs)
-      : runtime(NULL)
+      : runtime(NULL), intersection_cache(this)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -434,6 +434,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       IndexPartNode *new_part = get_node(pid);
+      new_part->create_all_children();
       return new_part->create_equal_children(op, granularity);
     }
 
@@ -447,6 +448,7 @@ namespace Legion {
       IndexPartNode *new_part = get_node(pid);
       IndexPartNode *node1 = get_node(handle1);
       IndexPartNode *node2 = get_node(handle2);
+      new_part->create_all_children();
       return new_part->create_by_union(op, node1, node2);
     }
 
@@ -460,6 +462,7 @@ namespace Legion {
       IndexPartNode *new_part = get_node(pid);
       IndexPartNode *node1 = get_node(handle1);
       IndexPartNode *node2 = get_node(handle2);
+      new_part->create_all_children();
       return new_part->create_by_intersection(op, node1, node2);
     }
 
@@ -472,6 +475,7 @@ namespace Legion {
     {
       IndexPartNode *new_part = get_node(pid);
       IndexPartNode *node = get_node(part);
+      new_part->create_all_children();
       return new_part->create_by_intersection(op, node, dominates); 
     }
 
@@ -485,6 +489,7 @@ namespace Legion {
       IndexPartNode *new_part = get_node(pid);
       IndexPartNode *node1 = get_node(handle1);
       IndexPartNode *node2 = get_node(handle2);
+      new_part->create_all_children();
       return new_part->create_by_difference(op, node1, node2);
     }
 
@@ -496,6 +501,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       IndexPartNode *new_part = get_node(pid);
+      new_part->create_all_children();
       return new_part->create_by_restriction(transform, extent); 
     }
 
@@ -545,6 +551,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       IndexPartNode *partition = get_node(pending);
+      partition->create_all_children();
       return partition->parent->create_by_field(op, partition, 
                                                 instances, instances_ready);
     }
@@ -559,6 +566,7 @@ namespace Legion {
     {
       IndexPartNode *partition = get_node(pending);
       IndexPartNode *projection = get_node(proj);
+      partition->create_all_children();
       return partition->parent->create_by_image(op, partition, projection,
                                         instances, instances_ready);
     }
@@ -573,6 +581,7 @@ namespace Legion {
     {
       IndexPartNode *partition = get_node(pending);
       IndexPartNode *projection = get_node(proj);
+      partition->create_all_children();
       return partition->parent->create_by_image_range(op, partition, projection,
                                               instances, instances_ready);
     }
@@ -587,6 +596,7 @@ namespace Legion {
     {
       IndexPartNode *partition = get_node(pending);
       IndexPartNode *projection = get_node(proj);
+      partition->create_all_children();
       return partition->parent->create_by_preimage(op, partition, projection,
                                            instances, instances_ready);
     }
@@ -601,6 +611,7 @@ namespace Legion {
     {
       IndexPartNode *partition = get_node(pending);
       IndexPartNode *projection = get_node(proj);
+      partition->create_all_children();
       return partition->parent->create_by_preimage_range(op, partition, 
                                 projection, instances, instances_ready);
     }
@@ -3319,6 +3330,23 @@ namespace Legion {
       return result;
     }
 
+    //--------------------------------------------------------------------------
+    void RegionTreeForest::record_nodes(
+                                   const std::vector<IndexSpaceNode*> &nodes)
+    //--------------------------------------------------------------------------
+    {
+      // Hold the lookup lock once for the whole batch
+      AutoLock l_lock(lookup_lock);
+      for (std::vector<IndexSpaceNode*>::const_iterator it = 
+            nodes.begin(); it != nodes.end(); it++)
+      {
+#ifdef DEBUG_LEGION
+        assert(index_nodes.find((*it)->handle) == index_nodes.end());
+#endif
+        index_nodes[(*it)->handle] = *it;
+      }
+    }
+
     //--------------------------------------------------------------------------
     IndexPartNode* RegionTreeForest::create_node(IndexPartition p, 
                                                  IndexSpaceNode *parent,
@@ -4722,6 +4750,354 @@ namespace Legion {
                                                          can_fail, wait_until);
     }
 
+    /////////////////////////////////////////////////////////////
+    // Intersection Cache 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    IntersectionCache::IntersectionCache(RegionTreeForest *f)
+      : forest(f), hits(0), misses(0), evictions(0)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    IntersectionCache::IntersectionCache(const IntersectionCache &rhs)
+      : forest(NULL)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+    }
+
+    //--------------------------------------------------------------------------
+    IntersectionCache::~IntersectionCache(void)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < LEGION_INTERSECTION_CACHE_SHARDS; idx++)
+      {
+        CacheShard &shard = shards[idx];
+        for (std::map<TestKey,CacheEntry>::const_iterator it = 
+              shard.entries.begin(); it != shard.entries.end(); it++)
+          destroy_result(it->second.value);
+        for (std::map<TestKey,RetiredEntry>::const_iterator it = 
+              shard.retired.begin(); it != shard.retired.end(); it++)
+          destroy_result(it->second.value);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    IntersectionCache& IntersectionCache::operator=(
+                                                  const IntersectionCache &rhs)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+      return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    bool IntersectionCache::find_result(IndexTreeNode *lhs, IndexTreeNode *rhs,
+                                        TestKind kind, TestResult &result,
+                                        bool need_intersection)
+    //--------------------------------------------------------------------------
+    {
+      CacheShard &shard = find_shard(lhs);
+      {
+        // Need the exclusive lock to update the reference bit
+        AutoLock s_lock(shard.shard_lock);
+        std::map<TestKey,CacheEntry>::const_iterator finder = 
+          shard.entries.find(TestKey(lhs, rhs, kind));
+        if ((finder != shard.entries.end()) && (!need_intersection ||
+              (kind != INTERSECTION_TEST) || 
+              finder->second.value.intersection_valid))
+        {
+          shard.referenced[finder->second.slot] = true;
+          result = finder->second.value;
+          __sync_fetch_and_add(&hits, 1);
+          return true;
+        }
+        // Retired results always have a valid intersection
+        if ((finder == shard.entries.end()) && 
+            revive_result(shard, TestKey(lhs, rhs, kind), result))
+        {
+          __sync_fetch_and_add(&hits, 1);
+          return true;
+        }
+      }
+      __sync_fetch_and_add(&misses, 1);
+      return false;
+    }
+
+    //--------------------------------------------------------------------------
+    bool IntersectionCache::record_result(IndexTreeNode *lhs, 
+                  IndexTreeNode *rhs, TestKind kind, const TestResult &result)
+    //--------------------------------------------------------------------------
+    {
+      const TestKey key(lhs, rhs, kind);
+      CacheShard &shard = find_shard(lhs);
+      AutoLock s_lock(shard.shard_lock);
+      std::map<TestKey,CacheEntry>::iterator finder = shard.entries.find(key);
+      if (finder != shard.entries.end())
+      {
+        // Never replace a computed intersection, either we lost
+        // the race or it is more precise than what we have
+        if (finder->second.value.result && 
+            finder->second.value.intersection_valid &&
+            (kind == INTERSECTION_TEST))
+          return false;
+        finder->second.value = result;
+        shard.referenced[finder->second.slot] = true;
+        return true;
+      }
+      // If we have a retired intersection then it is at least as 
+      // precise as what we were given so bring it back instead
+      TestResult retired;
+      if (revive_result(shard, key, retired))
+        return false;
+      const unsigned slot = find_free_slot(shard);
+      CacheEntry &entry = shard.entries[key];
+      entry.value = result;
+      entry.slot = slot;
+      shard.ring[slot] = key;
+      shard.referenced[slot] = true;
+      shard.node_slots[lhs].insert(slot);
+      shard.node_slots[rhs].insert(slot);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void IntersectionCache::invalidate_node(IndexTreeNode *node)
+    //--------------------------------------------------------------------------
+    {
+      // Entries are sharded by their left-hand node so we have to 
+      // check all the shards for entries with the node on the right
+      for (unsigned idx = 0; idx < LEGION_INTERSECTION_CACHE_SHARDS; idx++)
+      {
+        CacheShard &shard = shards[idx];
+        AutoLock s_lock(shard.shard_lock);
+        // Nothing can be using the intersections of a deleted node
+        // so now we can finally destroy any that were retired
+        destroy_retired(shard, node);
+        std::map<IndexTreeNode*,std::set<unsigned> >::iterator finder = 
+          shard.node_slots.find(node);
+        if (finder == shard.node_slots.end())
+          continue;
+        // Copy the slots since evicting will modify the set
+        const std::vector<unsigned> to_evict(finder->second.begin(),
+                                             finder->second.end());
+        for (std::vector<unsigned>::const_iterator it = 
+              to_evict.begin(); it != to_evict.end(); it++)
+          evict_slot(shard, *it, false/*retire*/);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void IntersectionCache::report_profiling(LegionProfiler *profiler) const
+    //--------------------------------------------------------------------------
+    {
+      profiler->record_runtime_counter(INTERSECTION_CACHE_HIT_COUNTER, hits);
+      profiler->record_runtime_counter(INTERSECTION_CACHE_MISS_COUNTER, 
+                                       misses);
+      profiler->record_runtime_counter(INTERSECTION_CACHE_EVICTION_COUNTER,
+                                       evictions);
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned IntersectionCache::find_free_slot(CacheShard &shard)
+    //--------------------------------------------------------------------------
+    {
+      if (!shard.free_slots.empty())
+      {
+        const unsigned result = shard.free_slots.back();
+        shard.free_slots.pop_back();
+        return result;
+      }
+      const unsigned max_entries = forest->runtime->max_intersection_cache_size;
+      // A capacity of zero means the cache is unbounded
+      const size_t shard_capacity = (max_entries == 0) ? 0 :
+        std::max(1U, max_entries / LEGION_INTERSECTION_CACHE_SHARDS);
+      if ((shard_capacity == 0) || (shard.ring.size() < shard_capacity))
+      {
+        shard.ring.push_back(TestKey());
+        shard.referenced.push_back(false);
+        return (shard.ring.size() - 1);
+      }
+      // Run the clock until we find an entry that hasn't been
+      // referenced since the last time the hand passed over it
+      while (true)
+      {
+        const unsigned slot = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.ring.size();
+        if (shard.referenced[slot])
+        {
+          shard.referenced[slot] = false;
+          continue;
+        }
+        evict_slot(shard, slot, true/*retire*/);
+        __sync_fetch_and_add(&evictions, 1);
+#ifdef DEBUG_LEGION
+        assert(shard.free_slots.back() == slot);
+#endif
+        shard.free_slots.pop_back();
+        return slot;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void IntersectionCache::evict_slot(CacheShard &shard, unsigned slot,
+                                       bool retire)
+    //--------------------------------------------------------------------------
+    {
+      const TestKey key = shard.ring[slot];
+      std::map<TestKey,CacheEntry>::iterator finder = shard.entries.find(key);
+#ifdef DEBUG_LEGION
+      assert(finder != shard.entries.end());
+      assert(finder->second.slot == slot);
+#endif
+      // Operations that got this intersection from the cache might
+      // still be using it so we retire it rather than destroying it
+      if (retire)
+        retire_result(shard, key, finder->second.value);
+      else
+        destroy_result(finder->second.value);
+      shard.entries.erase(finder);
+      std::map<IndexTreeNode*,std::set<unsigned> >::iterator lhs_finder = 
+        shard.node_slots.find(key.lhs);
+#ifdef DEBUG_LEGION
+      assert(lhs_finder != shard.node_slots.end());
+#endif
+      lhs_finder->second.erase(slot);
+      if (lhs_finder->second.empty())
+        shard.node_slots.erase(lhs_finder);
+      std::map<IndexTreeNode*,std::set<unsigned> >::iterator rhs_finder = 
+        shard.node_slots.find(key.rhs);
+      if (rhs_finder != shard.node_slots.end())
+      {
+        rhs_finder->second.erase(slot);
+        if (rhs_finder->second.empty())
+          shard.node_slots.erase(rhs_finder);
+      }
+      shard.ring[slot] = TestKey();
+      shard.referenced[slot] = false;
+      shard.free_slots.push_back(slot);
+    }
+
+    //--------------------------------------------------------------------------
+    bool IntersectionCache::revive_result(CacheShard &shard, 
+                                          const TestKey &key, TestResult &result)
+    //--------------------------------------------------------------------------
+    {
+      std::map<TestKey,RetiredEntry>::iterator finder = 
+        shard.retired.find(key);
+      if (finder == shard.retired.end())
+        return false;
+      result = finder->second.value;
+      erase_retired(shard, finder, false/*destroy*/);
+      // This might evict and retire something else
+      const unsigned slot = find_free_slot(shard);
+      CacheEntry &entry = shard.entries[key];
+      entry.value = result;
+      entry.slot = slot;
+      shard.ring[slot] = key;
+      shard.referenced[slot] = true;
+      shard.node_slots[key.lhs].insert(slot);
+      shard.node_slots[key.rhs].insert(slot);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void IntersectionCache::retire_result(CacheShard &shard, 
+                                 const TestKey &key, const TestResult &result)
+    //--------------------------------------------------------------------------
+    {
+      // Results without an intersection have nothing to reclaim
+      if (!result.result || !result.intersection_valid)
+        return;
+#ifdef DEBUG_LEGION
+      assert(shard.retired.find(key) == shard.retired.end());
+#endif
+      RetiredEntry &entry = shard.retired[key];
+      entry.value = result;
+      entry.order = shard.next_retired++;
+      shard.retired_order[entry.order] = key;
+      shard.retired_nodes[key.lhs].insert(key);
+      shard.retired_nodes[key.rhs].insert(key);
+      // Bound the memory held by retired intersections by destroying
+      // the oldest ones, these have gone the longest without being
+      // revived so they are the least likely to still be in use
+      while (shard.retired.size() > LEGION_MAX_RETIRED_INTERSECTIONS)
+      {
+        std::map<TestKey,RetiredEntry>::iterator oldest = 
+          shard.retired.find(shard.retired_order.begin()->second);
+#ifdef DEBUG_LEGION
+        assert(oldest != shard.retired.end());
+#endif
+        erase_retired(shard, oldest, true/*destroy*/);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void IntersectionCache::destroy_retired(CacheShard &shard, 
+                                            IndexTreeNode *node)
+    //--------------------------------------------------------------------------
+    {
+      std::map<IndexTreeNode*,std::set<TestKey> >::iterator finder = 
+        shard.retired_nodes.find(node);
+      if (finder == shard.retired_nodes.end())
+        return;
+      // Copy the keys since erasing will modify the set
+      const std::vector<TestKey> to_destroy(finder->second.begin(),
+                                            finder->second.end());
+      for (std::vector<TestKey>::const_iterator it = 
+            to_destroy.begin(); it != to_destroy.end(); it++)
+      {
+        std::map<TestKey,RetiredEntry>::iterator retired_finder = 
+          shard.retired.find(*it);
+#ifdef DEBUG_LEGION
+        assert(retired_finder != shard.retired.end());
+#endif
+        erase_retired(shard, retired_finder, true/*destroy*/);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void IntersectionCache::erase_retired(CacheShard &shard,
+                  std::map<TestKey,RetiredEntry>::iterator finder, bool destroy)
+    //--------------------------------------------------------------------------
+    {
+      const TestKey key = finder->first;
+      if (destroy)
+        destroy_result(finder->second.value);
+      shard.retired_order.erase(finder->second.order);
+      shard.retired.erase(finder);
+      std::map<IndexTreeNode*,std::set<TestKey> >::iterator node_finder =
+        shard.retired_nodes.find(key.lhs);
+#ifdef DEBUG_LEGION
+      assert(node_finder != shard.retired_nodes.end());
+#endif
+      node_finder->second.erase(key);
+      if (node_finder->second.empty())
+        shard.retired_nodes.erase(node_finder);
+      node_finder = shard.retired_nodes.find(key.rhs);
+      if (node_finder != shard.retired_nodes.end())
+      {
+        node_finder->second.erase(key);
+        if (node_finder->second.empty())
+          shard.retired_nodes.erase(node_finder);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void IntersectionCache::destroy_result(const TestResult &result)
+    //--------------------------------------------------------------------------
+    {
+      if (!result.result || !result.intersection_valid)
+        return;
+      DestroyHelper helper(result.intersection);
+      NT_TemplateHelper::demux<DestroyHelper>(result.type_tag, &helper);
+    }
+
     /////////////////////////////////////////////////////////////
     // Index Tree Node 
     /////////////////////////////////////////////////////////////
@@ -6324,6 +6700,138 @@ namespace Legion {
 #endif
     }
 
+    //--------------------------------------------------------------------------
+    void IndexPartNode::create_all_children(void)
+    //--------------------------------------------------------------------------
+    {
+      // Only the owner can make children and children of pending
+      // partitions are made one at a time as their spaces are computed
+      if (!is_owner() || partial_pending.exists())
+        return;
+      {
+        AutoLock n_lock(node_lock,1,false/*exclusive*/);
+        if (color_map.size() == size_t(total_children))
+          return;
+      }
+      // Enumerate the colors outside the lock since it might need to wait
+      std::vector<LegionColor> all_colors;
+      all_colors.reserve(total_children);
+      if (total_children == max_linearized_color)
+      {
+        for (LegionColor color = 0; color < total_children; color++)
+          all_colors.push_back(color);
+      }
+      else
+      {
+        ColorSpaceIterator *itr = color_space->create_color_space_iterator();
+        while (itr->is_valid())
+          all_colors.push_back(itr->yield_color());
+        delete itr;
+      }
+      // Claim all the children that nobody else has made or is making
+      // so that anyone else asking for them will wait for us to finish
+      std::vector<LegionColor> colors;
+      const RtUserEvent children_ready = Runtime::create_rt_user_event();
+      {
+        AutoLock n_lock(node_lock);
+        for (std::vector<LegionColor>::const_iterator it = 
+              all_colors.begin(); it != all_colors.end(); it++)
+        {
+          if (color_map.find(*it) != color_map.end())
+            continue;
+          if (pending_child_map.find(*it) != pending_child_map.end())
+            continue;
+          pending_child_map[*it] = children_ready;
+          colors.push_back(*it);
+        }
+      }
+      if (colors.empty())
+      {
+        Runtime::trigger_event(children_ready);
+        return;
+      }
+      // Fan out the construction and registration of the children
+      // across the utility processors in chunks
+      std::vector<IndexSpaceNode*> children(colors.size(), NULL);
+      const size_t chunk = LEGION_CHILD_CREATION_CHUNK_SIZE;
+      if (colors.size() > chunk)
+      {
+        std::set<RtEvent> created_events;
+        for (size_t start = 0; start < colors.size(); start += chunk)
+        {
+          const size_t stop = ((start + chunk) < colors.size()) ?
+            (start + chunk) : colors.size();
+          ChildCreationArgs args(this, &colors, &children, start, stop);
+          created_events.insert(context->runtime->issue_runtime_meta_task(
+                                        args, LG_LATENCY_WORK_PRIORITY));
+        }
+        const RtEvent created = Runtime::merge_events(created_events);
+        if (created.exists() && !created.has_triggered())
+          created.wait();
+      }
+      else
+        create_children(colors, children, 0, colors.size());
+      // Put them all in the lookup tables in one critical section each
+      context->record_nodes(children);
+      {
+        AutoLock n_lock(node_lock);
+        for (std::vector<IndexSpaceNode*>::const_iterator it = 
+              children.begin(); it != children.end(); it++)
+        {
+#ifdef DEBUG_LEGION
+          assert(color_map.find((*it)->color) == color_map.end());
+#endif
+          color_map[(*it)->color] = *it;
+          pending_child_map.erase((*it)->color);
+        }
+      }
+      Runtime::trigger_event(children_ready);
+      if (context->runtime->legion_spy_enabled)
+      {
+        for (std::vector<IndexSpaceNode*>::const_iterator it = 
+              children.begin(); it != children.end(); it++)
+          LegionSpy::log_index_subspace(handle.id, (*it)->handle.id,
+                                        (*it)->get_domain_point_color());
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void IndexPartNode::create_children(const std::vector<LegionColor> &colors,
+                                        std::vector<IndexSpaceNode*> &children,
+                                        size_t start_index, size_t stop_index)
+    //--------------------------------------------------------------------------
+    {
+      LocalReferenceMutator mutator;
+      for (size_t idx = start_index; idx < stop_index; idx++)
+      {
+        IndexSpace is(context->runtime->get_unique_index_space_id(),
+                      handle.get_tree_id(), handle.get_type_tag());
+        DistributedID did = context->runtime->get_available_distributed_id();
+        IndexSpaceCreator creator(context, is, NULL/*realm is*/, this, 
+                                  colors[idx], did, partition_ready);
+        NT_TemplateHelper::demux<IndexSpaceCreator>(is.get_type_tag(),
+                                                    &creator);
+        IndexSpaceNode *child = creator.result;
+#ifdef DEBUG_LEGION
+        assert(child != NULL);
+        assert(child->is_owner());
+#endif
+        // Same as what create_node does for the owner
+        child->add_base_valid_ref(APPLICATION_REF, &mutator);
+        child->register_with_runtime(&mutator);
+        children[idx] = child;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void IndexPartNode::handle_child_creation(const void *args)
+    //--------------------------------------------------------------------------
+    {
+      const ChildCreationArgs *cargs = (const ChildCreationArgs*)args;
+      cargs->proxy_this->create_children(*(cargs->colors), *(cargs->children),
+                                         cargs->start_index, cargs->stop_index);
+    }
+
     //--------------------------------------------------------------------------
     size_t IndexPartNode::get_num_children(void) const
     //--------------------------------------------------------------------------
@@ -38,7 +38,151 @@ namespace Legion {
       PhysicalInstance inst;
       size_t field_offset;
     };
-    
+
+    /**
+     * \class IntersectionCache
+     * A bounded cache of the results of intersection and dominance
+     * tests between pairs of index tree nodes. There is one of these
+     * for each region tree forest. Results are spread across shards
+     * that are each protected by their own lock so that probes from
+     * different nodes do not contend with each other. When a shard
+     * reaches its share of the capacity it evicts entries using a
+     * clock policy. All the results involving a node are invalidated
+     * when that node is deleted. Evicted intersections may still be
+     * in use by operations that found them in the cache so they are 
+     * retired rather than destroyed and only reclaimed once one of
+     * their nodes is deleted, the same as if they had never been
+     * evicted. A retired intersection is revived if it is needed again.
+     * Each shard retires at most LEGION_MAX_RETIRED_INTERSECTIONS
+     * intersections and destroys the oldest ones beyond that.
+     */
+    class IntersectionCache {
+    public:
+      enum TestKind {
+        INTERSECTION_TEST,
+        DOMINANCE_TEST,
+      };
+      struct TestKey {
+      public:
+        TestKey(void) : lhs(NULL), rhs(NULL), kind(INTERSECTION_TEST) { }
+        TestKey(IndexTreeNode *l, IndexTreeNode *r, TestKind k)
+          : lhs(l), rhs(r), kind(k) { }
+      public:
+        inline bool operator<(const TestKey &key) const
+        {
+          if (lhs < key.lhs) return true;
+          if (lhs > key.lhs) return false;
+          if (rhs < key.rhs) return true;
+          if (rhs > key.rhs) return false;
+          return (kind < key.kind);
+        }
+      public:
+        IndexTreeNode *lhs, *rhs;
+        TestKind kind;
+      };
+      struct TestResult {
+      public:
+        TestResult(void)
+          : type_tag(0), result(false), intersection_valid(false) { }
+        TestResult(bool res)
+          : type_tag(0), result(res), intersection_valid(!res) { }
+        TestResult(const Domain &is, TypeTag tag)
+          : intersection(is), type_tag(tag),
+            result(true), intersection_valid(true) { }
+      public:
+        Domain intersection;
+        TypeTag type_tag;
+        // Whether there is an intersection or domination
+        bool result;
+        bool intersection_valid;
+      };
+      struct DestroyHelper {
+      public:
+        DestroyHelper(const Domain &is) : intersection(is) { }
+      public:
+        template<typename N, typename T>
+        static inline void demux(DestroyHelper *helper)
+        {
+          Realm::IndexSpace<N::N,T> space = helper->intersection;
+          space.destroy();
+        }
+      public:
+        const Domain &intersection;
+      };
+    protected:
+      struct CacheEntry {
+      public:
+        TestResult value;
+        unsigned slot;
+      };
+      struct RetiredEntry {
+      public:
+        TestResult value;
+        unsigned long long order;
+      };
+      struct CacheShard {
+      public:
+        CacheShard(void) : hand(0), next_retired(0) { }
+      public:
+        LocalLock shard_lock;
+        std::map<TestKey,CacheEntry> entries;
+        // The clock ring of keys and their reference bits
+        std::vector<TestKey> ring;
+        std::vector<bool> referenced;
+        std::vector<unsigned> free_slots;
+        // Slots for each node that is named by an entry in this shard
+        std::map<IndexTreeNode*,std::set<unsigned> > node_slots;
+        // Evicted intersections that cannot be destroyed yet
+        std::map<TestKey,RetiredEntry> retired;
+        // Retired keys from oldest to newest
+        std::map<unsigned long long,TestKey> retired_order;
+        std::map<IndexTreeNode*,std::set<TestKey> > retired_nodes;
+        unsigned hand;
+        unsigned long long next_retired;
+      };
+    public:
+      IntersectionCache(RegionTreeForest *forest);
+      IntersectionCache(const IntersectionCache &rhs);
+      ~IntersectionCache(void);
+    public:
+      IntersectionCache& operator=(const IntersectionCache &rhs);
+    public:
+      // Returns true if there is a cached result for the test, if
+      // need_intersection is set then intersection tests will only
+      // hit if the cached result has a valid intersection
+      bool find_result(IndexTreeNode *lhs, IndexTreeNode *rhs, TestKind kind,
+                       TestResult &result, bool need_intersection = false);
+      // Returns false if the result was not recorded because there
+      // is already a more precise result in the cache, in which case
+      // the caller still owns any intersection in the result
+      bool record_result(IndexTreeNode *lhs, IndexTreeNode *rhs,
+                         TestKind kind, const TestResult &result);
+      void invalidate_node(IndexTreeNode *node);
+    public:
+      void report_profiling(LegionProfiler *profiler) const;
+    protected:
+      inline CacheShard& find_shard(IndexTreeNode *lhs)
+        { return shards[(uintptr_t(lhs) >> 4) %
+                        LEGION_INTERSECTION_CACHE_SHARDS]; }
+      unsigned find_free_slot(CacheShard &shard);
+      void evict_slot(CacheShard &shard, unsigned slot, bool retire);
+      bool revive_result(CacheShard &shard, const TestKey &key, 
+                         TestResult &result);
+      void retire_result(CacheShard &shard, const TestKey &key,
+                         const TestResult &result);
+      void destroy_retired(CacheShard &shard, IndexTreeNode *node);
+      void erase_retired(CacheShard &shard, 
+                         std::map<TestKey,RetiredEntry>::iterator finder,
+                         bool destroy);
+      static void destroy_result(const TestResult &result);
+    public:
+      RegionTreeForest *const forest;
+    protected:
+      CacheShard shards[LEGION_INTERSECTION_CACHE_SHARDS];
+    protected:
+      unsigned long long hits, misses, evictions;
+    };
+
     /**
      * \class RegionTreeForest
      * "In the darkness of the forest resides the one true magic..."
@@ -527,6 +671,8 @@ namespace Legion {
                                   Deserializer &derez);
       RegionNode*     create_node(LogicalRegion r, PartitionNode *par);
       PartitionNode*  create_node(LogicalPartition p, RegionNode *par);
+      // Record a batch of newly made index space nodes in the lookup table
+      void record_nodes(const std::vector<IndexSpaceNode*> &nodes);
     public:
       IndexSpaceNode* get_node(IndexSpace space);
       IndexPartNode*  get_node(IndexPartition part, RtEvent *defer = NULL);
@@ -646,6 +792,7 @@ namespace Legion {
                                          bool can_fail, bool wait_until);
     public:
       Runtime *const runtime;
+      IntersectionCache intersection_cache;
     protected:
       mutable LocalLock lookup_lock;
     private:
@@ -714,8 +861,6 @@ namespace Legion {
       bool destroyed;
     protected:
       LocalLock &node_lock;
-    protected:
-      std::map<IndexTreeNode*,bool> dominators;
     protected:
       LegionMap<SemanticTag,SemanticInfo>::aligned semantic_info;
     protected:
@@ -1050,22 +1195,9 @@ namespace Legion {
      */
     template<int DIM, typename T>
     class IndexSpaceNodeT : public IndexSpaceNode,
-                            public LegionHeapify<IndexSpaceNodeT<DIM,T> > {
+                            public LegionSlabify<IndexSpaceNodeT<DIM,T> > {
     public:
-      struct IntersectInfo {
-      public:
-        IntersectInfo(void)
-          : has_intersection(false), intersection_valid(false) { }
-        IntersectInfo(bool has)
-          : has_intersection(has), intersection_valid(!has) { }
-        IntersectInfo(const Realm::IndexSpace<DIM,T> &is)
-          : intersection(is), has_intersection(true), 
-            intersection_valid(true) { }
-      public:
-        Realm::IndexSpace<DIM,T> intersection;
-        bool has_intersection;
-        bool intersection_valid;
-      };
+      static const AllocationType alloc_type = INDEX_SPACE_NODE_ALLOC;
     public:
       IndexSpaceNodeT(RegionTreeForest *ctx, IndexSpace handle,
                       IndexPartNode *parent, LegionColor color, 
@@ -1124,6 +1256,13 @@ namespace Legion {
       virtual bool intersects_with(IndexPartNode *rhs, bool compute = true);
       virtual bool dominates(IndexSpaceNode *rhs);
       virtual bool dominates(IndexPartNode *rhs);
+    public:
+      // Same as intersects_with, but if result is non-NULL then
+      // it will also be filled in with the precise intersection
+      bool compute_intersection(IndexSpaceNode *rhs, bool compute,
+                                Realm::IndexSpace<DIM,T> *result);
+      bool compute_intersection(IndexPartNode *rhs, bool compute,
+                                Realm::IndexSpace<DIM,T> *result);
     public:
       virtual void pack_index_space(Serializer &rez, bool include_size) const;
       virtual void unpack_index_space(Deserializer &derez,
@@ -1272,8 +1411,6 @@ namespace Legion {
       void compute_linearization_metadata(void);
     protected:
       Realm::IndexSpace<DIM,T> realm_index_space;
-    protected:
-      std::map<IndexTreeNode*,IntersectInfo> intersections;
     protected: // linearization meta-data, computed on demand
       Realm::Point<DIM,long long> strides;
       Realm::Point<DIM,long long> offset;
@@ -1543,6 +1680,23 @@ namespace Legion {
         const RtUserEvent to_trigger;
         const AddressSpaceID source;
       };
+      struct ChildCreationArgs : public LgTaskArgs<ChildCreationArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_INDEX_PART_CHILD_CREATION_TASK_ID;
+      public:
+        ChildCreationArgs(IndexPartNode *proxy, 
+                          const std::vector<LegionColor> *cols,
+                          std::vector<IndexSpaceNode*> *chil,
+                          size_t start, size_t stop)
+          : LgTaskArgs<ChildCreationArgs>(implicit_provenance),
+            proxy_this(proxy), colors(cols), children(chil),
+            start_index(start), stop_index(stop) { }
+      public:
+        IndexPartNode *const proxy_this;
+        const std::vector<LegionColor> *const colors;
+        std::vector<IndexSpaceNode*> *const children;
+        const size_t start_index, stop_index;
+      };
       class RemoteDisjointnessFunctor {
       public:
         RemoteDisjointnessFunctor(Serializer &r, Runtime *rt)
@@ -1607,6 +1761,11 @@ namespace Legion {
       IndexSpaceNode* get_child(const LegionColor c, RtEvent *defer = NULL);
       void add_child(IndexSpaceNode *child);
       void remove_child(const LegionColor c);
+      void create_all_children(void);
+      void create_children(const std::vector<LegionColor> &colors,
+                           std::vector<IndexSpaceNode*> &children,
+                           size_t start_index, size_t stop_index);
+      static void handle_child_creation(const void *args);
       size_t get_num_children(void) const;
       void get_subspace_preconditions(std::set<ApEvent> &preconditions);
     public:
@@ -1707,22 +1866,9 @@ namespace Legion {
      */
     template<int DIM, typename T>
     class IndexPartNodeT : public IndexPartNode,
-                           public LegionHeapify<IndexPartNodeT<DIM,T> > {
+                           public LegionSlabify<IndexPartNodeT<DIM,T> > {
     public:
-      struct IntersectInfo {
-      public:
-        IntersectInfo(void)
-          : has_intersection(false), intersection_valid(false) { }
-        IntersectInfo(bool has)
-          : has_intersection(has), intersection_valid(!has) { }
-        IntersectInfo(const Realm::IndexSpace<DIM,T> &is)
-          : intersection(is), has_intersection(true), 
-            intersection_valid(true) { }
-      public:
-        Realm::IndexSpace<DIM,T> intersection;
-        bool has_intersection;
-        bool intersection_valid;
-      };
+      static const AllocationType alloc_type = INDEX_PART_NODE_ALLOC;
     public:
       IndexPartNodeT(RegionTreeForest *ctx, IndexPartition p,
                      IndexSpaceNode *par, IndexSpaceNode *color_space,
@@ -1751,8 +1897,6 @@ namespace Legion {
       Realm::IndexSpace<DIM,T> partition_union_space;
       ApEvent partition_union_ready;
       bool has_union_space, union_space_tight;
-    protected:
-      std::map<IndexTreeNode*,IntersectInfo> intersections;
     };
 
     /**
@@ -2515,7 +2659,9 @@ namespace Legion {
      * \class RegionNode
      * Represent a region in a region tree
      */
-    class RegionNode : public RegionTreeNode, public LegionHeapify<RegionNode> {
+    class RegionNode : public RegionTreeNode, public LegionSlabify<RegionNode> {
+    public:
+      static const AllocationType alloc_type = REGION_NODE_ALLOC;
     public:
       struct SemanticRequestArgs : public LgTaskArgs<SemanticRequestArgs> {
       public:
@@ -2729,7 +2875,9 @@ namespace Legion {
      * Represent an instance of a partition in a region tree.
      */
     class PartitionNode : public RegionTreeNode, 
-                          public LegionHeapify<PartitionNode> {
+                          public LegionSlabify<PartitionNode> {
+    public:
+      static const AllocationType alloc_type = PARTITION_NODE_ALLOC;
     public:
       struct SemanticRequestArgs : public LgTaskArgs<SemanticRequestArgs> {
       public:
@@ -57,12 +57,7 @@ namespace Legion {
       Realm::IndexSpace<DIM,T> local_space;
       get_realm_index_space(local_space, true/*tight*/);
       local_space.destroy();
-      for (typename std::map<IndexTreeNode*,IntersectInfo>::iterator it =
-            intersections.begin(); it != intersections.end(); it++)
-      {
-        if (it->second.has_intersection && it->second.intersection_valid)
-          it->second.intersection.destroy();
-      }
+      context->intersection_cache.invalidate_node(this);
     }
 
     //--------------------------------------------------------------------------
@@ -818,20 +813,36 @@ namespace Legion {
                                                  bool compute)
     //--------------------------------------------------------------------------
     {
+      return compute_intersection(rhs, compute, NULL/*result*/);
+    }
+
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    bool IndexSpaceNodeT<DIM,T>::compute_intersection(IndexSpaceNode *rhs,
+                           bool compute, Realm::IndexSpace<DIM,T> *result_space)
+    //--------------------------------------------------------------------------
+    {
 #ifdef DEBUG_LEGION
       assert(rhs->handle.get_type_tag() == handle.get_type_tag());
+      assert(compute || (result_space == NULL));
 #endif
       if (rhs == this)
+      {
+        if (result_space != NULL)
+          get_realm_index_space(*result_space, true/*tight*/);
         return true;
+      }
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-          finder = intersections.find(rhs);
+        IntersectionCache::TestResult cached;
         // Only return the value if we either didn't want to compute
         // or we already have valid intersections
-        if ((finder != intersections.end()) && 
-            (!compute || finder->second.intersection_valid))
-          return finder->second.has_intersection;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST, cached, compute))
+        {
+          if ((result_space != NULL) && cached.result)
+            *result_space = cached.intersection;
+          return cached.result;
+        }
       }
       IndexSpaceNodeT<DIM,T> *rhs_node = 
         static_cast<IndexSpaceNodeT<DIM,T>*>(rhs);
@@ -844,8 +855,9 @@ namespace Legion {
         {
           if (temp == this)
           {
-            AutoLock n_lock(node_lock);
-            intersections[rhs] = IntersectInfo(true/*result*/);
+            context->intersection_cache.record_result(this, rhs,
+                IntersectionCache::INTERSECTION_TEST,
+                IntersectionCache::TestResult(true/*result*/));
             return true;
           }
           if (temp->parent == NULL)
@@ -870,20 +882,23 @@ namespace Legion {
       // Always tighten these tests so that they are precise
       Realm::IndexSpace<DIM,T> tight_intersection = intersection.tighten();
       bool result = !tight_intersection.empty();
-      AutoLock n_lock(node_lock);
       if (result)
       {
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator finder =
-          intersections.find(rhs);
-        // Check to make sure we didn't lose the race
-        if ((finder == intersections.end()) || 
-            (compute && !finder->second.intersection_valid))
-          intersections[rhs] = IntersectInfo(tight_intersection);
-        else
-          tight_intersection.destroy(); // clean up spaces if we didn't save it
+        if (result_space != NULL)
+          *result_space = tight_intersection;
+        // Check to make sure we didn't lose the race, if we did then
+        // clean up the space unless the caller is going to use it
+        if (!context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST,
+              IntersectionCache::TestResult(Domain(tight_intersection),
+                                            handle.get_type_tag())) &&
+            (result_space == NULL))
+          tight_intersection.destroy();
       }
       else
-        intersections[rhs] = IntersectInfo(false/*result*/);
+        context->intersection_cache.record_result(this, rhs,
+            IntersectionCache::INTERSECTION_TEST,
+            IntersectionCache::TestResult(false/*result*/));
       intersection.destroy();
       return result;
     }
@@ -894,18 +909,30 @@ namespace Legion {
                                                  bool compute)
     //--------------------------------------------------------------------------
     {
+      return compute_intersection(rhs, compute, NULL/*result*/);
+    }
+
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    bool IndexSpaceNodeT<DIM,T>::compute_intersection(IndexPartNode *rhs,
+                           bool compute, Realm::IndexSpace<DIM,T> *result_space)
+    //--------------------------------------------------------------------------
+    {
 #ifdef DEBUG_LEGION
       assert(rhs->handle.get_type_tag() == handle.get_type_tag());
+      assert(compute || (result_space == NULL));
 #endif
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-          finder = intersections.find(rhs);
+        IntersectionCache::TestResult cached;
         // Only return the value if we know we are valid and we didn't
         // want to compute anything or we already did compute it
-        if ((finder != intersections.end()) &&
-            (!compute || finder->second.intersection_valid))
-          return finder->second.has_intersection;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST, cached, compute))
+        {
+          if ((result_space != NULL) && cached.result)
+            *result_space = cached.intersection;
+          return cached.result;
+        }
       }
       IndexPartNodeT<DIM,T> *rhs_node = 
         static_cast<IndexPartNodeT<DIM,T>*>(rhs);
@@ -918,8 +945,9 @@ namespace Legion {
         {
           if (temp->parent == this)
           {
-            AutoLock n_lock(node_lock);
-            intersections[rhs] = IntersectInfo(true/*result*/);
+            context->intersection_cache.record_result(this, rhs,
+                IntersectionCache::INTERSECTION_TEST,
+                IntersectionCache::TestResult(true/*result*/));
             return true;
           }
           temp = temp->parent->parent;
@@ -941,20 +969,23 @@ namespace Legion {
       // Always tighten these tests so that they are precise
       Realm::IndexSpace<DIM,T> tight_intersection = intersection.tighten();
       bool result = !tight_intersection.empty();
-      AutoLock n_lock(node_lock);
       if (result)
       {
-        // Check to make sure we didn't lose the race
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator finder =
-          intersections.find(rhs);
-        if ((finder == intersections.end()) ||
-            (compute && !finder->second.intersection_valid))
-          intersections[rhs] = IntersectInfo(tight_intersection);
-        else
+        if (result_space != NULL)
+          *result_space = tight_intersection;
+        // Check to make sure we didn't lose the race, if we did then
+        // clean up the space unless the caller is going to use it
+        if (!context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST,
+              IntersectionCache::TestResult(Domain(tight_intersection),
+                                            handle.get_type_tag())) &&
+            (result_space == NULL))
           tight_intersection.destroy();
       }
       else
-        intersections[rhs] = IntersectInfo(false/*result*/);
+        context->intersection_cache.record_result(this, rhs,
+            IntersectionCache::INTERSECTION_TEST,
+            IntersectionCache::TestResult(false/*result*/));
       intersection.destroy();
       return result;
     }
@@ -970,11 +1001,10 @@ namespace Legion {
       if (rhs == this)
         return true;
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,bool>::const_iterator finder = 
-          dominators.find(rhs);
-        if (finder != dominators.end())
-          return finder->second;
+        IntersectionCache::TestResult cached;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST, cached))
+          return cached.result;
       }
       IndexSpaceNodeT<DIM,T> *rhs_node = 
         static_cast<IndexSpaceNodeT<DIM,T>*>(rhs);
@@ -985,8 +1015,9 @@ namespace Legion {
       {
         if (temp == this)
         {
-          AutoLock n_lock(node_lock);
-          dominators[rhs] = true;
+          context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST,
+              IntersectionCache::TestResult(true/*result*/));
           return true;
         }
         if (temp->parent == NULL)
@@ -1019,8 +1050,9 @@ namespace Legion {
         rhs_node->get_realm_index_space(rhs_space, true/*tight*/);
         result = local_space.bounds.contains(rhs_space);
       }
-      AutoLock n_lock(node_lock);
-      dominators[rhs] = result;
+      context->intersection_cache.record_result(this, rhs,
+          IntersectionCache::DOMINANCE_TEST,
+          IntersectionCache::TestResult(result));
       return result;
     }
 
@@ -1033,11 +1065,10 @@ namespace Legion {
       assert(rhs->handle.get_type_tag() == handle.get_type_tag());
 #endif
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,bool>::const_iterator finder = 
-          dominators.find(rhs);
-        if (finder != dominators.end())
-          return finder->second;
+        IntersectionCache::TestResult cached;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST, cached))
+          return cached.result;
       }
       IndexPartNodeT<DIM,T> *rhs_node = 
         static_cast<IndexPartNodeT<DIM,T>*>(rhs);
@@ -1048,8 +1079,9 @@ namespace Legion {
       {
         if (temp->parent == this)
         {
-          AutoLock n_lock(node_lock);
-          dominators[rhs] = true;
+          context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST,
+              IntersectionCache::TestResult(true/*result*/));
           return true;
         }
         temp = temp->parent->parent;
@@ -1080,8 +1112,9 @@ namespace Legion {
         rhs_node->get_union_index_space(rhs_space, true/*tight*/);
         result = local_space.bounds.contains(rhs_space);
       }
-      AutoLock n_lock(node_lock);
-      dominators[rhs] = result;
+      context->intersection_cache.record_result(this, rhs,
+          IntersectionCache::DOMINANCE_TEST,
+          IntersectionCache::TestResult(result));
       return result;
     }
 
@@ -2598,17 +2631,8 @@ namespace Legion {
         if (intersect->is_index_space_node())
         {
           IndexSpaceNode *intersect_node = intersect->as_index_space_node();
-          if (intersects_with(intersect_node))
-          {
-            AutoLock n_lock(node_lock,1,false/*exclusive*/);
-            typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-              finder = intersections.find(intersect_node);
-#ifdef DEBUG_LEGION
-            assert(finder != intersections.end());
-#endif
-            intersection = finder->second.intersection;
-          }
-          else
+          if (!compute_intersection(intersect_node, true/*compute*/,
+                                    &intersection))
           {
 #ifdef LEGION_SPY
             ApUserEvent new_result = Runtime::create_ap_user_event();
@@ -2622,17 +2646,8 @@ namespace Legion {
         else
         {
           IndexPartNode *intersect_node = intersect->as_index_part_node();
-          if (intersects_with(intersect_node))
-          {
-            AutoLock n_lock(node_lock,1,false/*exclusive*/);
-            typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-              finder = intersections.find(intersect_node);
-#ifdef DEBUG_LEGION
-            assert(finder != intersections.end());
-#endif
-            intersection = finder->second.intersection;
-          }
-          else
+          if (!compute_intersection(intersect_node, true/*compute*/,
+                                    &intersection))
           {
 #ifdef LEGION_SPY
             ApUserEvent new_result = Runtime::create_ap_user_event();
@@ -2741,37 +2756,29 @@ namespace Legion {
         if (intersect->is_index_space_node())
         {
           IndexSpaceNode *intersect_node = intersect->as_index_space_node();
-          if (intersects_with(intersect_node))
-          {
-            AutoLock n_lock(node_lock,1,false/*exclusive*/);
-            typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-              finder = intersections.find(intersect_node);
 #ifdef DEBUG_LEGION
-            assert(finder != intersections.end());
+#ifndef NDEBUG
+          const bool has_intersection =
 #endif
-            intersection = finder->second.intersection;
-          }
+#endif
+            compute_intersection(intersect_node, true/*compute*/,
+                                 &intersection);
 #ifdef DEBUG_LEGION
-          else
-            assert(false);
+          assert(has_intersection);
 #endif
         }
         else
         {
           IndexPartNode *intersect_node = intersect->as_index_part_node();
-          if (intersects_with(intersect_node))
-          {
-            AutoLock n_lock(node_lock,1,false/*exclusive*/);
-            typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-              finder = intersections.find(intersect_node);
 #ifdef DEBUG_LEGION
-            assert(finder != intersections.end());
+#ifndef NDEBUG
+          const bool has_intersection =
 #endif
-            intersection = finder->second.intersection;
-          }
+#endif
+            compute_intersection(intersect_node, true/*compute*/,
+                                 &intersection);
 #ifdef DEBUG_LEGION
-          else
-            assert(false);
+          assert(has_intersection);
 #endif
         }
         if (context->runtime->profiler != NULL)
@@ -3058,10 +3065,7 @@ namespace Legion {
     { 
       if (has_union_space && !partition_union_space.empty())
         partition_union_space.destroy();
-      for (typename std::map<IndexTreeNode*,IntersectInfo>::iterator it = 
-            intersections.begin(); it != intersections.end(); it++)
-        if (it->second.has_intersection && it->second.intersection_valid)
-          it->second.intersection.destroy();
+      context->intersection_cache.invalidate_node(this);
     }
 
     //--------------------------------------------------------------------------
@@ -3114,12 +3118,10 @@ namespace Legion {
       assert(rhs->handle.get_type_tag() == handle.get_type_tag());
 #endif
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-          finder = intersections.find(rhs);
-        if ((finder != intersections.end()) &&
-            (!compute || finder->second.intersection_valid))
-          return finder->second.has_intersection;
+        IntersectionCache::TestResult cached;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST, cached, compute))
+          return cached.result;
       }
       IndexSpaceNodeT<DIM,T> *rhs_node = 
         static_cast<IndexSpaceNodeT<DIM,T>*>(rhs);
@@ -3132,8 +3134,9 @@ namespace Legion {
         {
           if (temp->parent == this)
           {
-            AutoLock n_lock(node_lock);
-            intersections[rhs] = IntersectInfo(true/*result*/);
+            context->intersection_cache.record_result(this, rhs,
+                IntersectionCache::INTERSECTION_TEST,
+                IntersectionCache::TestResult(true/*result*/));
             return true;
           }
           temp = temp->parent->parent;
@@ -3156,20 +3159,19 @@ namespace Legion {
       // Always tighten these tests so that they are precise
       Realm::IndexSpace<DIM,T> tight_intersection = intersection.tighten();
       bool result = !tight_intersection.empty();
-      AutoLock n_lock(node_lock);
       if (result)
       {
         // Check to make sure we didn't lose the race
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator finder =
-          intersections.find(rhs);
-        if ((finder == intersections.end()) ||
-            (compute && !finder->second.intersection_valid))
-          intersections[rhs] = IntersectInfo(tight_intersection);
-        else
+        if (!context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST,
+              IntersectionCache::TestResult(Domain(tight_intersection),
+                                            handle.get_type_tag())))
           tight_intersection.destroy();
       }
       else
-        intersections[rhs] = IntersectInfo(false/*result*/);
+        context->intersection_cache.record_result(this, rhs,
+            IntersectionCache::INTERSECTION_TEST,
+            IntersectionCache::TestResult(false/*result*/));
       intersection.destroy();
       return result;
     }
@@ -3185,14 +3187,12 @@ namespace Legion {
       if (rhs == this)
         return true;
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator 
-          finder = intersections.find(rhs);
+        IntersectionCache::TestResult cached;
         // Only return the value if we know we are valid and we didn't
         // want to compute anything or we already did compute it
-        if ((finder != intersections.end()) &&
-            (!compute || finder->second.intersection_valid))
-          return finder->second.has_intersection;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST, cached, compute))
+          return cached.result;
       }
       IndexPartNodeT<DIM,T> *rhs_node = 
         static_cast<IndexPartNodeT<DIM,T>*>(rhs);
@@ -3205,8 +3205,9 @@ namespace Legion {
         {
           if (temp == this)
           {
-            AutoLock n_lock(node_lock);
-            intersections[rhs] = IntersectInfo(true/*result*/);
+            context->intersection_cache.record_result(this, rhs,
+                IntersectionCache::INTERSECTION_TEST,
+                IntersectionCache::TestResult(true/*result*/));
             return true;
           }
           temp = temp->parent->parent;
@@ -3229,20 +3230,19 @@ namespace Legion {
       // Always tighten these tests so that they are precise
       Realm::IndexSpace<DIM,T> tight_intersection = intersection.tighten();
       bool result = !tight_intersection.empty();
-      AutoLock n_lock(node_lock);
       if (result)
       {
         // Check to make sure we didn't lose the race
-        typename std::map<IndexTreeNode*,IntersectInfo>::const_iterator finder =
-          intersections.find(rhs);
-        if ((finder == intersections.end()) ||
-            (compute && !finder->second.intersection_valid))
-          intersections[rhs] = IntersectInfo(tight_intersection);
-        else
+        if (!context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::INTERSECTION_TEST,
+              IntersectionCache::TestResult(Domain(tight_intersection),
+                                            handle.get_type_tag())))
           tight_intersection.destroy();
       }
       else
-        intersections[rhs] = IntersectInfo(false/*result*/);
+        context->intersection_cache.record_result(this, rhs,
+            IntersectionCache::INTERSECTION_TEST,
+            IntersectionCache::TestResult(false/*result*/));
       intersection.destroy();
       return result;
     }
@@ -3256,11 +3256,10 @@ namespace Legion {
       assert(rhs->handle.get_type_tag() == handle.get_type_tag());
 #endif
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,bool>::const_iterator finder = 
-          dominators.find(rhs);
-        if (finder != dominators.end())
-          return finder->second;
+        IntersectionCache::TestResult cached;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST, cached))
+          return cached.result;
       }
       IndexSpaceNodeT<DIM,T> *rhs_node = 
         static_cast<IndexSpaceNodeT<DIM,T>*>(rhs);
@@ -3271,8 +3270,9 @@ namespace Legion {
       {
         if (temp->parent == this)
         {
-          AutoLock n_lock(node_lock);
-          dominators[rhs] = true;
+          context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST,
+              IntersectionCache::TestResult(true/*result*/));
           return true;
         }
         temp = temp->parent->parent;
@@ -3304,8 +3304,9 @@ namespace Legion {
         rhs_node->get_realm_index_space(rhs_space, true/*tight*/);
         result = union_space.bounds.contains(rhs_space);
       }
-      AutoLock n_lock(node_lock);
-      dominators[rhs] = result;
+      context->intersection_cache.record_result(this, rhs,
+          IntersectionCache::DOMINANCE_TEST,
+          IntersectionCache::TestResult(result));
       return result;
     }
     
@@ -3320,11 +3321,10 @@ namespace Legion {
       if (rhs == this)
         return true;
       {
-        AutoLock n_lock(node_lock,1,false/*exclusive*/);
-        typename std::map<IndexTreeNode*,bool>::const_iterator finder = 
-          dominators.find(rhs);
-        if (finder != dominators.end())
-          return finder->second;
+        IntersectionCache::TestResult cached;
+        if (context->intersection_cache.find_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST, cached))
+          return cached.result;
       }
       IndexPartNodeT<DIM,T> *rhs_node = 
         static_cast<IndexPartNodeT<DIM,T>*>(rhs);
@@ -3335,8 +3335,9 @@ namespace Legion {
       {
         if (temp == this)
         {
-          AutoLock n_lock(node_lock);
-          dominators[rhs] = true;
+          context->intersection_cache.record_result(this, rhs,
+              IntersectionCache::DOMINANCE_TEST,
+              IntersectionCache::TestResult(true/*result*/));
           return true;
         }
         temp = temp->parent->parent;
@@ -3368,8 +3369,9 @@ namespace Legion {
         rhs_node->get_union_index_space(rhs_space, true/*tight*/);
         result = union_space.bounds.contains(rhs_space);
       }
-      AutoLock n_lock(node_lock);
-      dominators[rhs] = result;
+      context->intersection_cache.record_result(this, rhs,
+          IntersectionCache::DOMINANCE_TEST,
+          IntersectionCache::TestResult(result));
       return result;
     }
 
@@ -63,6 +63,7 @@ namespace Legion {
     Realm::Logger log_variant("variants");
     Realm::Logger log_allocation("allocation");
     Realm::Logger log_prof("legion_prof");
+    Realm::Logger log_prof_summary("legion_prof_summary");
     Realm::Logger log_garbage("legion_gc");
     Realm::Logger log_shutdown("shutdown");
     namespace LegionSpy {
@@ -2528,9 +2529,11 @@ namespace Legion {
                                        bool no_steal, bool replay)
       : runtime(rt), local_proc(proc), proc_kind(kind), 
         stealing_disabled(no_steal), replay_execution(replay), 
-        next_local_index(0), task_scheduler_enabled(false), 
-        outstanding_task_scheduler(false),
-        total_active_contexts(0), total_active_mappers(0)
+        balance_threshold((no_steal || replay) ? 0 : rt->load_balance_threshold),
+        next_local_index(0), incoming_tasks(NULL), 
+        task_scheduler_enabled(false), outstanding_task_scheduler(false),
+        total_active_contexts(0), total_active_mappers(0), ready_load(0),
+        mapped_load(0)
     //--------------------------------------------------------------------------
     {
       context_states.resize(LEGION_DEFAULT_CONTEXTS);
@@ -2546,7 +2549,7 @@ namespace Legion {
     ProcessorManager::ProcessorManager(const ProcessorManager &rhs)
       : runtime(NULL), local_proc(Processor::NO_PROC),
         proc_kind(Processor::LOC_PROC), stealing_disabled(false), 
-        replay_execution(false)
+        replay_execution(false), balance_threshold(0)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -2557,6 +2560,9 @@ namespace Legion {
     ProcessorManager::~ProcessorManager(void)
     //--------------------------------------------------------------------------
     {
+#ifdef DEBUG_LEGION
+      assert(incoming_tasks == NULL);
+#endif
       mapper_states.clear();
     }
 
@@ -2679,7 +2685,15 @@ namespace Legion {
     void ProcessorManager::perform_scheduling(void)
     //--------------------------------------------------------------------------
     {
-      perform_mapping_operations(); 
+      // Keep doing passes in this meta-task as long as the mappers are
+      // making progress so we don't pay for a new meta-task every pass
+      for (unsigned pass = 1; perform_mapping_operations() && 
+            (pass < runtime->max_scheduler_passes); pass++)
+      {
+        AutoLock q_lock(queue_lock,1,false/*exclusive*/);
+        if (!task_scheduler_enabled)
+          break;
+      }
       // Now re-take the lock and re-check the condition to see 
       // if the next scheduling task should be launched
       AutoLock q_lock(queue_lock);
@@ -2839,6 +2853,12 @@ namespace Legion {
     {
       log_run.spew("handling a steal request on processor " IDFMT " "
                          "from processor " IDFMT "", local_proc.id,thief.id);
+      // The runtime decides what can be stolen if it is balancing load
+      if (balance_threshold > 0)
+      {
+        process_balanced_steal_request(thief, thieves);
+        return;
+      }
       // Iterate over the task descriptions, asking the appropriate mapper
       // whether we can steal the task
       std::set<TaskOp*> stolen;
@@ -2955,6 +2975,8 @@ namespace Legion {
           }
           if (!local_stolen.empty())
           {
+            map_state.ready_count -= local_stolen.size();
+            ready_load -= local_stolen.size();
             for (std::vector<TaskOp*>::const_iterator it = 
                   local_stolen.begin(); it != local_stolen.end(); it++)
             {
@@ -3015,9 +3037,24 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     void ProcessorManager::process_advertisement(Processor advertiser,
-                                                 MapperID mid)
+                                                 MapperID mid, unsigned load)
     //--------------------------------------------------------------------------
     {
+      if (balance_threshold > 0)
+      {
+        // Only processors of the same kind can run our tasks
+        if (advertiser.kind() != proc_kind)
+          return;
+        if (advertiser.address_space() != runtime->address_space)
+        {
+          AutoLock b_lock(balance_lock);
+          remote_load_hints[advertiser] = load;
+        }
+        // If we're idle and they have work then go get some
+        if ((get_total_load() == 0) && (load >= balance_threshold))
+          balance_load(mid);
+        return;
+      }
       MapperManager *mapper = find_mapper(mid);
       mapper->process_advertisement(advertiser);
       // See if this mapper would like to try stealing again
@@ -3036,27 +3073,69 @@ namespace Legion {
 #endif
       // have to do this when we are not holding the lock
       task->activate_outstanding_task();
-      // We can do this without holding the lock because the
-      // vector is of a fixed size
-      ContextID ctx_id = task->get_context()->get_context_id();
+      // Push the task onto the incoming list without taking any locks
+      TaskOp *head = incoming_tasks;
+      while (true)
+      {
+        task->next_ready_task = head;
+        TaskOp *previous = 
+          __sync_val_compare_and_swap(&incoming_tasks, head, task);
+        if (previous == head)
+          break;
+        head = previous;
+      }
+      // If the list already had tasks on it then whoever put the first
+      // one there is responsible for moving ours to the ready queues 
+      if (head != NULL)
+        return;
       AutoLock q_lock(queue_lock);
-#ifdef DEBUG_LEGION
-      assert(mapper_states.find(task->map_id) != mapper_states.end());
-#endif
-      // Update the state for the context
-      ContextState &state = context_states[ctx_id];
-      if (state.active && (state.owned_tasks == 0))
-        increment_active_contexts();
-      state.owned_tasks++;
-      // Also update the queue for the mapper
-      MapperState &map_state = mapper_states[task->map_id];
-      if (map_state.ready_queue.empty() || map_state.deferral_event.exists())
-      {
-        // Clear our deferral event since we are changing state
-        map_state.deferral_event = RtEvent::NO_RT_EVENT;
-        increment_active_mappers();
+      drain_incoming_tasks();
+    }
+
+    //--------------------------------------------------------------------------
+    void ProcessorManager::drain_incoming_tasks(void)
+    //--------------------------------------------------------------------------
+    {
+      // Better be called while holding the queue lock
+      TaskOp *head = 
+        __sync_lock_test_and_set(&incoming_tasks, (TaskOp*)NULL);
+      // Reverse the list so tasks are added in the order they arrived
+      TaskOp *ordered = NULL;
+      while (head != NULL)
+      {
+        TaskOp *next = head->next_ready_task;
+        head->next_ready_task = ordered;
+        ordered = head;
+        head = next;
+      }
+      while (ordered != NULL)
+      {
+        TaskOp *task = ordered;
+        // Unlink it before it is visible in a ready queue
+        ordered = task->next_ready_task;
+        task->next_ready_task = NULL;
+        ContextID ctx_id = task->get_context()->get_context_id();
+#ifdef DEBUG_LEGION
+        assert(mapper_states.find(task->map_id) != mapper_states.end());
+#endif
+        // Update the state for the context
+        ContextState &state = context_states[ctx_id];
+        if (state.active && (state.owned_tasks == 0))
+          increment_active_contexts();
+        state.owned_tasks++;
+        // Also update the queue for the mapper
+        MapperState &map_state = mapper_states[task->map_id];
+        if (map_state.ready_queue.empty() || 
+            map_state.deferral_event.exists())
+        {
+          // Clear our deferral event since we are changing state
+          map_state.deferral_event = RtEvent::NO_RT_EVENT;
+          increment_active_mappers();
+        }
+        map_state.ready_queue.push_back(task);
+        map_state.ready_count++;
+        ready_load++;
       }
-      map_state.ready_queue.push_back(task);
     }
 
     //--------------------------------------------------------------------------
@@ -3072,11 +3151,13 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void ProcessorManager::perform_mapping_operations(void)
+    bool ProcessorManager::perform_mapping_operations(void)
     //--------------------------------------------------------------------------
     {
+      bool mapped_tasks = false;
       std::multimap<Processor,MapperID> stealing_targets;
       std::vector<MapperID> mappers_with_stealable_work;
+      std::vector<std::pair<MapperID,unsigned> > mappers_with_load;
       std::vector<std::pair<MapperID,MapperManager*> > current_mappers;
       // Take a snapshot of our current mappers
       {
@@ -3253,6 +3334,8 @@ namespace Legion {
           }
           if (!to_trigger.empty())
           {
+            map_state.ready_count -= to_trigger.size();
+            ready_load -= to_trigger.size();
             for (std::vector<TaskOp*>::const_iterator it = 
                   to_trigger.begin(); it != to_trigger.end(); it++)
             {
@@ -3266,6 +3349,12 @@ namespace Legion {
                 decrement_active_contexts();
             }
           }
+          // Include the tasks that we already mapped onto this processor
+          // since they are the backlog that the ready tasks will wait on
+          if ((balance_threshold > 0) && (map_state.ready_count > 0) &&
+              ((map_state.ready_count + mapped_load) >= balance_threshold))
+            mappers_with_load.push_back(std::pair<MapperID,unsigned>(
+                  map_id, map_state.ready_count + mapped_load));
           if (!stealing_disabled && !rqueue.empty())
           {
             for (std::list<TaskOp*>::const_iterator it =
@@ -3286,6 +3375,8 @@ namespace Legion {
             map_state.queue_waiter = RtUserEvent::NO_RT_USER_EVENT;
           }
         }
+        if (!to_trigger.empty())
+          mapped_tasks = true;
         // Now we can trigger our tasks that the mapper selected
         for (std::vector<TaskOp*>::const_iterator it = 
               to_trigger.begin(); it != to_trigger.end(); it++)
@@ -3316,6 +3407,27 @@ namespace Legion {
       // Finally issue any steal requeusts
       if (!stealing_disabled && !stealing_targets.empty())
         runtime->send_steal_request(stealing_targets, local_proc);
+
+      if (balance_threshold > 0)
+      {
+        // Let other processors know if we have more work than we 
+        // can handle, otherwise if we're out of work go find some
+        if (!mappers_with_load.empty())
+        {
+          for (std::vector<std::pair<MapperID,unsigned> >::const_iterator 
+                it = mappers_with_load.begin(); 
+                it != mappers_with_load.end(); it++)
+            advertise_load(it->first, it->second);
+        }
+        else if (get_total_load() == 0)
+        {
+          for (std::vector<std::pair<MapperID,MapperManager*> >::
+                const_iterator it = current_mappers.begin(); 
+                it != current_mappers.end(); it++)
+            balance_load(it->first);
+        }
+      }
+      return mapped_tasks;
     }
 
     //--------------------------------------------------------------------------
@@ -3331,6 +3443,280 @@ namespace Legion {
         runtime->send_advertisements(failed_waiters, map_id, local_proc);
     }
 
+    //--------------------------------------------------------------------------
+    unsigned ProcessorManager::steal_ready_tasks(MapperID map_id,
+                                                 std::set<TaskOp*> &stolen)
+    //--------------------------------------------------------------------------
+    {
+      std::list<TaskOp*> queue_copy;
+      RtEvent queue_copy_ready;
+      // Pull out the current tasks for this mapper
+      // Need to iterate until we get access to the queue
+      do
+      {
+        if (queue_copy_ready.exists() && !queue_copy_ready.has_triggered())
+        {
+          queue_copy_ready.wait();
+          queue_copy_ready = RtEvent::NO_RT_EVENT;
+        }
+        AutoLock q_lock(queue_lock);
+        std::map<MapperID,MapperState>::iterator finder = 
+          mapper_states.find(map_id);
+        if (finder == mapper_states.end())
+          return 0;
+        MapperState &map_state = finder->second;
+        if (!map_state.queue_guard)
+        {
+          // Not worth stealing if we're not over the threshold
+          if ((map_state.ready_count == 0) ||
+              ((map_state.ready_count + mapped_load) < balance_threshold))
+            return (map_state.ready_count + mapped_load);
+          map_state.ready_queue.swap(queue_copy);
+          // Set the queue guard so no one else tries to
+          // read the ready queue while we've checked it out
+          map_state.queue_guard = true;
+        }
+        else
+        {
+          // Make an event if necessary
+          if (!map_state.queue_waiter.exists())
+            map_state.queue_waiter = Runtime::create_rt_user_event();
+          // Record that we need to wait on it
+          queue_copy_ready = map_state.queue_waiter;
+        }
+      } while (queue_copy_ready.exists());
+      // Give away up to half of our tasks starting from the back of the
+      // queue since those are the ones that we would map last. Only 
+      // individual tasks and slices can be moved and we never steal a 
+      // task more than once so tasks don't bounce between processors.
+      const size_t max_steals = (queue_copy.size() + 1) / 2;
+      std::vector<TaskOp*> local_stolen;
+      for (std::list<TaskOp*>::iterator it = queue_copy.end(); 
+            (it != queue_copy.begin()) && 
+            (local_stolen.size() < max_steals); /*nothing*/)
+      {
+        it--;
+        const TaskOp::TaskKind kind = (*it)->get_task_kind();
+        if (((kind == TaskOp::INDIVIDUAL_TASK_KIND) ||
+             (kind == TaskOp::SLICE_TASK_KIND)) && 
+            ((*it)->steal_count == 0) && (*it)->prepare_steal())
+        {
+          (*it)->mark_stolen();
+          local_stolen.push_back(*it);
+          it = queue_copy.erase(it);
+        }
+      }
+      unsigned remaining;
+      {
+        // Retake the lock, put any tasks still in the ready queue
+        // back into the queue and remove the queue guard
+        AutoLock q_lock(queue_lock);
+        MapperState &map_state = mapper_states[map_id];
+#ifdef DEBUG_LEGION
+        assert(map_state.queue_guard);
+#endif
+        std::list<TaskOp*> &rqueue = map_state.ready_queue;
+        if (!queue_copy.empty())
+        {
+          // Put any new items on the back of the queue
+          if (!rqueue.empty())
+          {
+            for (std::list<TaskOp*>::const_iterator it = 
+                  rqueue.begin(); it != rqueue.end(); it++)
+              queue_copy.push_back(*it);
+          }
+          rqueue.swap(queue_copy);
+        }
+        else if (rqueue.empty())
+        {
+          if (map_state.deferral_event.exists())
+            map_state.deferral_event = RtEvent::NO_RT_EVENT;
+          else
+            decrement_active_mappers();
+        }
+        if (!local_stolen.empty())
+        {
+          map_state.ready_count -= local_stolen.size();
+          ready_load -= local_stolen.size();
+          for (std::vector<TaskOp*>::const_iterator it = 
+                local_stolen.begin(); it != local_stolen.end(); it++)
+          {
+            ContextID ctx_id = (*it)->get_context()->get_context_id();
+            ContextState &state = context_states[ctx_id];
+#ifdef DEBUG_LEGION
+            assert(state.owned_tasks > 0);
+#endif
+            state.owned_tasks--;
+            if (state.active && (state.owned_tasks == 0))
+              decrement_active_contexts();
+          }
+        }
+        remaining = map_state.ready_count + mapped_load;
+        // Remove the queue guard
+        map_state.queue_guard = false;
+        if (map_state.queue_waiter.exists())
+        {
+          Runtime::trigger_event(map_state.queue_waiter);
+          map_state.queue_waiter = RtUserEvent::NO_RT_USER_EVENT;
+        }
+      }
+      for (std::vector<TaskOp*>::const_iterator it = 
+            local_stolen.begin(); it != local_stolen.end(); it++)
+      {
+        (*it)->deactivate_outstanding_task();
+        stolen.insert(*it);
+      }
+      return remaining;
+    }
+
+    //--------------------------------------------------------------------------
+    void ProcessorManager::process_balanced_steal_request(Processor thief,
+                                           const std::vector<MapperID> &thieves)
+    //--------------------------------------------------------------------------
+    {
+      std::set<Processor> thief_set;
+      thief_set.insert(thief);
+      for (std::vector<MapperID>::const_iterator it = 
+            thieves.begin(); it != thieves.end(); it++)
+      {
+        // Same race as for normal steal requests with mapper startup
+        if (find_mapper(*it) == NULL)
+          continue;
+        std::set<TaskOp*> stolen;
+        const unsigned remaining = steal_ready_tasks(*it, stolen);
+        if (!stolen.empty())
+        {
+#ifdef DEBUG_LEGION
+          for (std::set<TaskOp*>::const_iterator sit = stolen.begin();
+                sit != stolen.end(); sit++)
+            log_task.debug("task %s (ID %lld) stolen from processor " IDFMT
+                           " by processor " IDFMT " for load balancing", 
+                           (*sit)->get_task_name(), (*sit)->get_unique_id(),
+                           local_proc.id, thief.id);
+#endif
+          runtime->send_tasks(thief, stolen);
+        }
+        else
+        {
+          // Remember them so we can tell them when we have work
+          AutoLock b_lock(balance_lock);
+          failed_thieves[*it].insert(thief);
+        }
+        // Always tell the thief how much work we have left so that
+        // it can update its load hint for this processor
+        runtime->send_advertisements(thief_set, *it, local_proc, remaining);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void ProcessorManager::balance_load(MapperID map_id)
+    //--------------------------------------------------------------------------
+    {
+      if (find_mapper(map_id) == NULL)
+        return;
+      // Local processors publish their load so we can steal from 
+      // them directly without going through any of the mappers
+      ProcessorManager *victim = runtime->find_load_balance_victim(this);
+      if (victim != NULL)
+      {
+        std::set<TaskOp*> stolen;
+        victim->steal_ready_tasks(map_id, stolen);
+        if (!stolen.empty())
+        {
+          runtime->send_tasks(local_proc, stolen);
+          return;
+        }
+      }
+      // Otherwise try the remote processor with the most work
+      Processor target = Processor::NO_PROC;
+      {
+        AutoLock b_lock(balance_lock);
+        unsigned max_load = 0;
+        std::map<Processor,unsigned>::iterator best = remote_load_hints.end();
+        for (std::map<Processor,unsigned>::iterator it = 
+              remote_load_hints.begin(); it != remote_load_hints.end(); it++)
+        {
+          if ((it->second < balance_threshold) || (it->second <= max_load))
+            continue;
+          max_load = it->second;
+          best = it;
+        }
+        if (best != remote_load_hints.end())
+        {
+          target = best->first;
+          // Don't ask them again until they tell us how much work is left
+          best->second = 0;
+        }
+      }
+      if (target.exists())
+      {
+        std::multimap<Processor,MapperID> targets;
+        targets.insert(std::pair<const Processor,MapperID>(target, map_id));
+        runtime->send_steal_request(targets, local_proc);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void ProcessorManager::advertise_load(MapperID map_id, unsigned load)
+    //--------------------------------------------------------------------------
+    {
+      // Wake up any idle local processors so they can steal from us
+      runtime->advertise_local_load(this, map_id, load);
+      // Tell any remote thieves that failed to steal from us before
+      std::set<Processor> thieves;
+      {
+        AutoLock b_lock(balance_lock);
+        std::map<MapperID,std::set<Processor> >::iterator finder = 
+          failed_thieves.find(map_id);
+        if (finder == failed_thieves.end())
+          return;
+        thieves.swap(finder->second);
+        failed_thieves.erase(finder);
+      }
+      runtime->send_advertisements(thieves, map_id, local_proc, load);
+    }
+
+    //--------------------------------------------------------------------------
+    void ProcessorManager::record_mapped_task(RtEvent task_complete)
+    //--------------------------------------------------------------------------
+    {
+      if (balance_threshold == 0)
+        return;
+      __sync_fetch_and_add(&mapped_load, 1);
+      BalanceTaskCompleteArgs args(this);
+      runtime->issue_runtime_meta_task(args, LG_LATENCY_WORK_PRIORITY,
+                                       task_complete);
+    }
+
+    //--------------------------------------------------------------------------
+    void ProcessorManager::complete_mapped_task(void)
+    //--------------------------------------------------------------------------
+    {
+      // If that was the last of our work then go find some more
+      if ((__sync_sub_and_fetch(&mapped_load, 1) > 0) || (ready_load > 0))
+        return;
+      std::vector<MapperID> current_mappers;
+      {
+        AutoLock m_lock(mapper_lock, 0/*mode*/, false/*exclusive*/);
+        for (std::map<MapperID,std::pair<MapperManager*,bool> >::
+              const_iterator it = mappers.begin(); it != mappers.end(); it++)
+          current_mappers.push_back(it->first);
+      }
+      for (std::vector<MapperID>::const_iterator it = 
+            current_mappers.begin(); it != current_mappers.end(); it++)
+        balance_load(*it);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void ProcessorManager::handle_balance_task_complete(
+                                                               const void *args)
+    //--------------------------------------------------------------------------
+    {
+      const BalanceTaskCompleteArgs *bargs = 
+        (const BalanceTaskCompleteArgs*)args;
+      bargs->proxy_this->complete_mapped_task();
+    }
+
     /////////////////////////////////////////////////////////////
     // Memory Manager 
     /////////////////////////////////////////////////////////////
@@ -3339,7 +3725,10 @@ namespace Legion {
     MemoryManager::MemoryManager(Memory m, Runtime *rt)
       : memory(m), owner_space(m.address_space()), 
         is_owner(m.address_space() == rt->address_space),
-        capacity(m.capacity()), remaining_capacity(capacity), runtime(rt)
+        capacity(m.capacity()), remaining_capacity(capacity), runtime(rt),
+        eviction_rounds(0), evicted_instances(0), evicted_bytes(0),
+        failed_allocations(0), instance_lookups(0), 
+        lookup_candidates_examined(0)
     //--------------------------------------------------------------------------
     {
     }
@@ -3389,6 +3778,7 @@ namespace Legion {
           assert(it->second.current_state != PENDING_COLLECTED_STATE);
           assert(it->second.current_state != PENDING_ACQUIRE_STATE);
 #endif
+          remove_eviction_candidate(it->first, it->second);
           if (it->second.current_state != COLLECTABLE_STATE)
           {
             RtUserEvent deferred_collect = Runtime::create_rt_user_event();
@@ -3407,7 +3797,10 @@ namespace Legion {
         {
           for (std::vector<PhysicalManager*>::const_iterator it = 
                 to_remove.begin(); it != to_remove.end(); it++)
+          {
+            remove_instance_from_index(*it);
             current_instances.erase(*it);
+          }
         }
       }
       for (std::map<PhysicalManager*,RtEvent>::const_iterator it = 
@@ -3426,6 +3819,11 @@ namespace Legion {
     {
       if (!is_owner)
         return;
+      if ((eviction_rounds > 0) || (failed_allocations > 0))
+        log_inst.info("Memory " IDFMT " evicted %lld instances (%lld bytes) "
+                      "in %lld rounds with %lld failed allocations",
+                      memory.id, evicted_instances, evicted_bytes,
+                      eviction_rounds, failed_allocations);
       // No need for the lock, no one should be doing anything at this point
       for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
             current_instances.begin(); it != current_instances.end(); it++)
@@ -3450,6 +3848,8 @@ namespace Legion {
       // that we were made valid to begin with
       InstanceInfo &info = current_instances[manager];
       info.instance_size = inst_size;
+      add_instance_to_index(manager);
+      add_eviction_candidate(manager, info);
     }
 
     //--------------------------------------------------------------------------
@@ -3457,10 +3857,14 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoLock m_lock(manager_lock);
- #ifdef DEBUG_LEGION
-      assert(current_instances.find(manager) != current_instances.end());
+      std::map<PhysicalManager*,InstanceInfo>::iterator finder = 
+        current_instances.find(manager);
+#ifdef DEBUG_LEGION
+      assert(finder != current_instances.end());
 #endif     
-      current_instances.erase(manager);
+      remove_eviction_candidate(manager, finder->second);
+      remove_instance_from_index(manager);
+      current_instances.erase(finder);
     }
 
     //--------------------------------------------------------------------------
@@ -3480,7 +3884,11 @@ namespace Legion {
              (finder->second.current_state == VALID_STATE));
 #endif
       if (finder->second.current_state == COLLECTABLE_STATE)
+      {
+        remove_eviction_candidate(manager, finder->second);
         finder->second.current_state = ACTIVE_STATE;
+        add_eviction_candidate(manager, finder->second);
+      }
       // Otherwise stay in our current state
 #ifdef DEBUG_LEGION
 #ifndef NDEBUG
@@ -3518,6 +3926,7 @@ namespace Legion {
 #endif
           Runtime::trigger_event(info.deferred_collect);
           // Now we can delete our entry because it has been deleted
+          remove_instance_from_index(manager);
           current_instances.erase(finder);
           remove_reference = true;
         }
@@ -3534,10 +3943,16 @@ namespace Legion {
           // currently allow the mappers to reuse them
           perform_deletion = true;
           remove_reference = true;
+          remove_eviction_candidate(manager, info);
+          remove_instance_from_index(manager);
           current_instances.erase(finder);
         }
         else // didn't collect it yet
+        {
+          remove_eviction_candidate(manager, info);
           info.current_state = COLLECTABLE_STATE;
+          add_eviction_candidate(manager, info);
+        }
       }
       if (perform_deletion)
         manager->perform_deletion(RtEvent::NO_RT_EVENT);
@@ -3562,7 +3977,10 @@ namespace Legion {
              (finder->second.current_state == VALID_STATE));
 #endif
       if (finder->second.current_state == ACTIVE_STATE)
+      {
+        remove_eviction_candidate(manager, finder->second);
         finder->second.current_state = VALID_STATE;
+      }
       // Otherwise we stay in the state we are currently in
 #ifdef DEBUG_LEGION
 #ifndef NDEBUG
@@ -3586,7 +4004,10 @@ namespace Legion {
              (finder->second.current_state == PENDING_COLLECTED_STATE));
 #endif
       if (finder->second.current_state == VALID_STATE)
+      {
         finder->second.current_state = ACTIVE_STATE;
+        add_eviction_candidate(manager, finder->second);
+      }
       // Otherwise we stay in whatever state we should be in
 #ifdef DEBUG_LEGION
 #ifndef NDEBUG
@@ -3616,6 +4037,7 @@ namespace Legion {
       if (finder->second.current_state != PENDING_ACQUIRE_STATE)
         assert(finder->second.pending_acquires == 0);
 #endif
+      remove_eviction_candidate(manager, finder->second);
       finder->second.current_state = PENDING_ACQUIRE_STATE;
       finder->second.pending_acquires++;
       return true;
@@ -4068,6 +4490,7 @@ namespace Legion {
 #ifdef DEBUG_LEGION
           assert(it->second.current_state != PENDING_ACQUIRE_STATE);
 #endif
+          remove_eviction_candidate(it->first, it->second);
           if (it->second.current_state != COLLECTABLE_STATE)
           {
 #ifdef DEBUG_LEGION
@@ -4101,7 +4524,10 @@ namespace Legion {
         {
           for (std::vector<PhysicalManager*>::const_iterator it = 
                 to_remove.begin(); it != to_remove.end(); it++)
+          {
+            remove_instance_from_index(*it);
             current_instances.erase(*it);
+          }
         }
       }
       for (std::map<PhysicalManager*,std::pair<RtEvent,bool> >::
@@ -4166,7 +4592,9 @@ namespace Legion {
               finder->second.mapper_priorities.erase(key);
               if (finder->second.mapper_priorities.empty())
               {
+                remove_eviction_candidate(manager, finder->second);
                 finder->second.min_priority = 0;
+                add_eviction_candidate(manager, finder->second);
                 remove_never_gc_ref = true;
               }
             }
@@ -4213,7 +4641,11 @@ namespace Legion {
             if (info.min_priority == GC_NEVER_PRIORITY)
               remove_duplicate = true; // lost the race
             else
+            {
+              remove_eviction_candidate(manager, info);
               info.min_priority = GC_NEVER_PRIORITY;
+              add_eviction_candidate(manager, info);
+            }
             info.mapper_priorities[key] = GC_NEVER_PRIORITY;
           }
           if (remove_duplicate && 
@@ -4237,6 +4669,7 @@ namespace Legion {
           std::map<std::pair<MapperID,Processor>,GCPriority> 
             &mapper_priorities = finder->second.mapper_priorities;
           std::pair<MapperID,Processor> key(mapper_id,processor);
+          remove_eviction_candidate(manager, finder->second);
           // If the new priority is NEVER_GC and we were already at NEVER_GC
           // then we need to remove the redundant reference when we are done
           if ((priority == GC_NEVER_PRIORITY) && 
@@ -4294,6 +4727,7 @@ namespace Legion {
             if (priority < finder->second.min_priority)
               finder->second.min_priority = priority;
           }
+          add_eviction_candidate(manager, finder->second);
         }
       }
       if (remove_min_reference && 
@@ -4760,7 +5194,11 @@ namespace Legion {
             std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
               current_instances.find(manager);
             if (finder == current_instances.end())
+            {
               current_instances[manager] = InstanceInfo();
+              add_instance_to_index(manager);
+              add_eviction_candidate(manager, current_instances[manager]);
+            }
             if (created && min_priority)
             {
               std::pair<MapperID,Processor> key(mapper_id,processor);
@@ -4768,7 +5206,11 @@ namespace Legion {
               if (info.min_priority == GC_NEVER_PRIORITY)
                 remove_duplicate_valid = true;
               else
+              {
+                remove_eviction_candidate(manager, info);
                 info.min_priority = GC_NEVER_PRIORITY;
+                add_eviction_candidate(manager, info);
+              }
               info.mapper_priorities[key] = GC_NEVER_PRIORITY;
             }
           }
@@ -4797,14 +5239,22 @@ namespace Legion {
             std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
               current_instances.find(manager);
             if (finder == current_instances.end())
+            {
               current_instances[manager] = InstanceInfo();
+              add_instance_to_index(manager);
+              add_eviction_candidate(manager, current_instances[manager]);
+            }
             if (min_priority)
             {
               InstanceInfo &info = current_instances[manager];
               if (info.min_priority == GC_NEVER_PRIORITY)
                 remove_duplicate_valid = true;
               else
+              {
+                remove_eviction_candidate(manager, info);
                 info.min_priority = GC_NEVER_PRIORITY;
+                add_eviction_candidate(manager, info);
+              }
               info.mapper_priorities[key] = GC_NEVER_PRIORITY;
             }
           }
@@ -5028,25 +5478,9 @@ namespace Legion {
                                 bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
-      // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
-      {
-        AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
-        }
-      }
+      find_candidate_instances(regions, constraints.field_constraint,
+                     false/*valid only*/, tight_region_bounds, candidates);
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -5081,25 +5515,9 @@ namespace Legion {
                                       bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
-      // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
-      {
-        AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == PENDING_COLLECTED_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
-        }
-      }
+      find_candidate_instances(regions, constraints->field_constraint,
+                     false/*valid only*/, tight_region_bounds, candidates);
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -5135,23 +5553,9 @@ namespace Legion {
                                      bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
-      // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
-      {
-        AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
-        }
-      }
+      find_candidate_instances(regions, constraints.field_constraint,
+                     true/*valid only*/, tight_region_bounds, candidates);
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -5187,23 +5591,9 @@ namespace Legion {
                                      bool tight_region_bounds, bool remote)
     //--------------------------------------------------------------------------
     {
-      // Hold the lock while iterating here
       std::deque<PhysicalManager*> candidates;
-      {
-        AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          // Skip any unattached external instances too
-          if (it->second.unattached_external)
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
-        }
-      }
+      find_candidate_instances(regions, constraints->field_constraint,
+                     true/*valid only*/, tight_region_bounds, candidates);
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -5231,6 +5621,214 @@ namespace Legion {
       return found;
     }
 
+    //--------------------------------------------------------------------------
+    void MemoryManager::find_candidate_instances(
+                                      const std::vector<LogicalRegion> &regions,
+                                      const FieldConstraint &fields,
+                                      bool valid_only, bool tight_region_bounds,
+                                      std::deque<PhysicalManager*> &candidates)
+    //--------------------------------------------------------------------------
+    {
+      // Any instance that can satisfy the request must be bounded by a 
+      // region that is an ancestor of all the regions so we only need to
+      // look at the nodes on the path from the first region to the root.
+      // Tight bounds for a single region only permit that exact region.
+      std::vector<RegionNode*> bounding_nodes;
+      if (!regions.empty())
+      {
+        RegionNode *node = runtime->forest->get_node(regions[0]);
+        bounding_nodes.push_back(node);
+        if (!tight_region_bounds || (regions.size() > 1))
+        {
+          while (node->parent != NULL)
+          {
+            node = node->parent->parent;
+            bounding_nodes.push_back(node);
+          }
+        }
+      }
+      size_t examined = 0;
+      {
+        // Hold the lock while iterating here
+        AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
+        if (!regions.empty())
+        {
+          std::map<RegionTreeID,InstanceTreeIndex>::const_iterator 
+            tree_finder = instance_index.find(regions[0].get_tree_id());
+          if (tree_finder != instance_index.end())
+          {
+            for (std::vector<RegionNode*>::const_iterator nit = 
+                  bounding_nodes.begin(); nit != bounding_nodes.end(); nit++)
+            {
+              InstanceTreeIndex::const_iterator node_finder = 
+                tree_finder->second.find(*nit);
+              if (node_finder == tree_finder->second.end())
+                continue;
+              for (std::map<LayoutDescription*,std::set<PhysicalManager*> >::
+                    const_iterator lit = node_finder->second.begin(); 
+                    lit != node_finder->second.end(); lit++)
+              {
+                // All the instances with the same layout have the same
+                // fields so we only need to test the fields once
+                if (!lit->first->constraints->field_constraint.entails(fields))
+                  continue;
+                for (std::set<PhysicalManager*>::const_iterator it = 
+                      lit->second.begin(); it != lit->second.end(); it++)
+                {
+                  examined++;
+                  std::map<PhysicalManager*,InstanceInfo>::const_iterator
+                    finder = current_instances.find(*it);
+#ifdef DEBUG_LEGION
+                  assert(finder != current_instances.end());
+#endif
+                  if (!is_candidate_instance(finder->second, valid_only))
+                    continue;
+                  (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+                  candidates.push_back(*it);
+                }
+              }
+            }
+          }
+        }
+        else
+        {
+          // No regions to search with so everything is a candidate
+          for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
+                current_instances.begin(); it != current_instances.end(); it++)
+          {
+            examined++;
+            if (!is_candidate_instance(it->second, valid_only))
+              continue;
+            it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
+            candidates.push_back(it->first);
+          }
+        }
+      }
+      if (runtime->profiler != NULL)
+      {
+        __sync_fetch_and_add(&instance_lookups, 1);
+        __sync_fetch_and_add(&lookup_candidates_examined, examined);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::accumulate_lookup_counters(
+           unsigned long long &lookups, unsigned long long &examined) const
+    //--------------------------------------------------------------------------
+    {
+      lookups += instance_lookups;
+      examined += lookup_candidates_examined;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ bool MemoryManager::is_candidate_instance(
+                                      const InstanceInfo &info, bool valid_only)
+    //--------------------------------------------------------------------------
+    {
+      // Skip any unattached external instances
+      if (info.unattached_external)
+        return false;
+      // Valid lookups only consider ones that are currently valid
+      if (valid_only)
+        return (info.current_state == VALID_STATE);
+      // Otherwise skip it if has already been collected
+      return (info.current_state != PENDING_COLLECTED_STATE);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::add_instance_to_index(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      // Virtual instances never get recorded
+      if ((manager->region_node == NULL) || (manager->layout == NULL))
+        return;
+      instance_index[manager->region_node->handle.get_tree_id()]
+        [manager->region_node][manager->layout].insert(manager);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::remove_instance_from_index(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      if ((manager->region_node == NULL) || (manager->layout == NULL))
+        return;
+      std::map<RegionTreeID,InstanceTreeIndex>::iterator tree_finder = 
+        instance_index.find(manager->region_node->handle.get_tree_id());
+#ifdef DEBUG_LEGION
+      assert(tree_finder != instance_index.end());
+#endif
+      InstanceTreeIndex::iterator node_finder = 
+        tree_finder->second.find(manager->region_node);
+#ifdef DEBUG_LEGION
+      assert(node_finder != tree_finder->second.end());
+#endif
+      std::map<LayoutDescription*,std::set<PhysicalManager*> >::iterator 
+        layout_finder = node_finder->second.find(manager->layout);
+#ifdef DEBUG_LEGION
+      assert(layout_finder != node_finder->second.end());
+#endif
+      layout_finder->second.erase(manager);
+      if (!layout_finder->second.empty())
+        return;
+      node_finder->second.erase(layout_finder);
+      if (!node_finder->second.empty())
+        return;
+      tree_finder->second.erase(node_finder);
+      if (tree_finder->second.empty())
+        instance_index.erase(tree_finder);
+    }
+
+    //--------------------------------------------------------------------------
+    std::set<MemoryManager::EvictionCandidate>* 
+                 MemoryManager::find_eviction_candidates(InstanceState state)
+    //--------------------------------------------------------------------------
+    {
+      switch (state)
+      {
+        case COLLECTABLE_STATE:
+          return &collectable_candidates;
+        case ACTIVE_STATE:
+          return &active_candidates;
+        default:
+          break;
+      }
+      return NULL;
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::add_eviction_candidate(PhysicalManager *manager,
+                                               const InstanceInfo &info)
+    //--------------------------------------------------------------------------
+    {
+      std::set<EvictionCandidate> *candidates = 
+        find_eviction_candidates(info.current_state);
+      if (candidates == NULL)
+        return;
+      const EvictionCandidate candidate(info.min_priority,
+                                    manager->get_instance_size(), manager);
+#ifdef DEBUG_LEGION
+      assert(candidates->find(candidate) == candidates->end());
+#endif
+      candidates->insert(candidate);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::remove_eviction_candidate(PhysicalManager *manager,
+                                                  const InstanceInfo &info)
+    //--------------------------------------------------------------------------
+    {
+      std::set<EvictionCandidate> *candidates = 
+        find_eviction_candidates(info.current_state);
+      if (candidates == NULL)
+        return;
+      const EvictionCandidate candidate(info.min_priority,
+                                    manager->get_instance_size(), manager);
+#ifdef DEBUG_LEGION
+      assert(candidates->find(candidate) != candidates->end());
+#endif
+      candidates->erase(candidate);
+    }
+
     //--------------------------------------------------------------------------
     void MemoryManager::release_candidate_references(
                            const std::deque<PhysicalManager*> &candidates) const
@@ -5295,54 +5893,29 @@ namespace Legion {
         *footprint = needed_size;
       if ((manager != NULL) || (needed_size == 0))
         return manager;
-      // If that didn't work then we're going to try to delete some instances
-      // from this memory to make space. We do this in four separate passes:
-      // 1. Delete immediately collectable objects larger than what we need
-      // 2. Delete immediately collectable objects smaller than what we need
-      // 3. Delete deferred collectable objects larger than what we need
-      // 4. Delete deferred collectable objects smaller than what we need
-      // If we get through all these and still can't collect then we're screwed
-      // Keep trying to delete large collectable instances first
-      while (!delete_by_size_and_state(needed_size, COLLECTABLE_STATE, 
-                                       true/*large only*/))
-      {
-        // See if we can make the instance
-        PhysicalManager *result = 
-          builder.create_physical_instance(runtime->forest);
-        if (result != NULL)
-          return result;
-      }
-      // Then try deleting as many small collectable instances next
-      while (!delete_by_size_and_state(needed_size, COLLECTABLE_STATE,
-                                       false/*large only*/))
-      {
-        // See if we can make the instance
-        PhysicalManager *result = 
-          builder.create_physical_instance(runtime->forest);
-        if (result != NULL)
-          return result;
-      }
-      // Now switch to large objects still in the active state
-      while (!delete_by_size_and_state(needed_size, ACTIVE_STATE,
-                                       true/*large only*/))
-      {
-        // See if we can make the instance
-        PhysicalManager *result = 
-          builder.create_physical_instance(runtime->forest);
-        if (result != NULL)
-          return result;
+      // If that didn't work then we're going to try to evict some instances
+      // from this memory to make space. First we evict instances that can
+      // be collected immediately and then switch to instances that will be
+      // collected once they are no longer in use. Each round of eviction
+      // frees at least the amount of space that we need.
+      const InstanceState eviction_states[2] = 
+        { COLLECTABLE_STATE, ACTIVE_STATE };
+      for (unsigned idx = 0; idx < 2; idx++)
+      {
+        while (evict_instances(needed_size, eviction_states[idx]))
+        {
+          // See if we can make the instance
+          PhysicalManager *result = 
+            builder.create_physical_instance(runtime->forest);
+          if (result != NULL)
+            return result;
+        }
       }
-      // Finally switch to doing small objects in the active state
-      while (!delete_by_size_and_state(needed_size, ACTIVE_STATE,
-                                       false/*large only*/))
+      // If we made it here well then we failed 
       {
-        // See if we can make the instance
-        PhysicalManager *result = 
-          builder.create_physical_instance(runtime->forest);
-        if (result != NULL)
-          return result;
+        AutoLock m_lock(manager_lock);
+        failed_allocations++;
       }
-      // If we made it here well then we failed 
       return NULL;
     }
 
@@ -5374,6 +5947,8 @@ namespace Legion {
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,p)] = priority;
+        add_instance_to_index(manager);
+        add_eviction_candidate(manager, info);
       }
       // Now we can add any references that we need to
       if (acquire)
@@ -5409,6 +5984,8 @@ namespace Legion {
         InstanceInfo &info = current_instances[manager];
         info.instance_size = instance_size;
         info.unattached_external = true;
+        add_instance_to_index(manager);
+        add_eviction_candidate(manager, info);
       }
     }
 
@@ -5431,87 +6008,93 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    bool MemoryManager::delete_by_size_and_state(const size_t needed_size,
-                                          InstanceState state, bool larger_only)
+    bool MemoryManager::evict_instances(const size_t needed_size,
+                                        InstanceState state)
     //--------------------------------------------------------------------------
     {
-      bool pass_complete = true;
-      size_t total_deleted = 0;
+#ifdef DEBUG_LEGION
+      assert((state == COLLECTABLE_STATE) || (state == ACTIVE_STATE));
+#endif
       std::map<PhysicalManager*,RtEvent> to_delete;
       {
         AutoLock m_lock(manager_lock);
-        if (state == COLLECTABLE_STATE)
+        // The candidates are already ordered by their garbage collection
+        // priority (highest first) and then by size (largest first)
+        std::set<EvictionCandidate> &candidates = 
+          *find_eviction_candidates(state);
+        if (candidates.empty())
+          return false;
+        // Pick the victims one priority level at a time. Within a level
+        // prefer the smallest single instance that frees enough space
+        // since only a contiguous hole of the right size will help a
+        // fragmented memory, otherwise take the largest ones first.
+        std::vector<PhysicalManager*> victims;
+        size_t total_deleted = 0;
+        std::set<EvictionCandidate>::iterator level_start = 
+          candidates.begin();
+        while ((total_deleted < needed_size) && 
+                (level_start != candidates.end()))
         {
-          for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-                current_instances.begin(); it != current_instances.end(); it++)
+          const GCPriority priority = level_start->priority;
+          const size_t remaining = needed_size - total_deleted;
+          // Sizes are decreasing so the one before the first instance
+          // that is too small is the best fit if it is in this level
+          std::set<EvictionCandidate>::iterator best_fit = 
+            candidates.lower_bound(
+                EvictionCandidate(priority, remaining - 1, NULL));
+          if (best_fit != level_start)
           {
-            if (it->second.current_state != COLLECTABLE_STATE)
-              continue;
-            const size_t inst_size = it->first->get_instance_size();
-            if ((inst_size >= needed_size) || !larger_only)
-            {
-              // Resource references will flow out
-              to_delete[it->first] = RtEvent::NO_RT_EVENT;
-              total_deleted += inst_size;
-              if (total_deleted >= needed_size)
-              {
-                // If we exit early we are not done with this pass
-                pass_complete = false;
-                break;
-              }
-            }
+            best_fit--;
+            victims.push_back(best_fit->manager);
+            total_deleted += best_fit->size;
+            break;
           }
-          if (!to_delete.empty())
+          while ((level_start != candidates.end()) &&
+                 (level_start->priority == priority) &&
+                 (total_deleted < needed_size))
           {
-            for (std::map<PhysicalManager*,RtEvent>::const_iterator it = 
-                  to_delete.begin(); it != to_delete.end(); it++)
-              current_instances.erase(it->first);
+            victims.push_back(level_start->manager);
+            total_deleted += level_start->size;
+            level_start++;
           }
         }
-        else
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              victims.begin(); it != victims.end(); it++)
         {
-#ifdef DEBUG_LEGION
-          assert(state == ACTIVE_STATE);
-#endif
-          for (std::map<PhysicalManager*,InstanceInfo>::iterator it = 
-                current_instances.begin(); it != current_instances.end(); it++)
+          InstanceInfo &info = current_instances[*it];
+          remove_eviction_candidate(*it, info);
+          if (state == COLLECTABLE_STATE)
           {
-            if (it->second.current_state != ACTIVE_STATE)
-              continue;
-            const size_t inst_size = it->first->get_instance_size();
-            if ((inst_size >= needed_size) || !larger_only)
-            {
-              RtUserEvent deferred_collect = Runtime::create_rt_user_event();
-              to_delete[it->first] = deferred_collect;
-              // Add our own reference here as this flows out
-              it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-              // Update the state information
-              it->second.current_state = PENDING_COLLECTED_STATE;
-              it->second.deferred_collect = deferred_collect;
-              total_deleted += inst_size;
-              if (total_deleted >= needed_size)
-              {
-                // If we exit early we are not done with this pass
-                pass_complete = false;
-                break;
-              }
-            }
+            // Resource references will flow out
+            to_delete[*it] = RtEvent::NO_RT_EVENT;
+            remove_instance_from_index(*it);
+            current_instances.erase(*it);
+          }
+          else
+          {
+            RtUserEvent deferred_collect = Runtime::create_rt_user_event();
+            to_delete[*it] = deferred_collect;
+            // Add our own reference here as this flows out
+            (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+            // Update the state information
+            info.current_state = PENDING_COLLECTED_STATE;
+            info.deferred_collect = deferred_collect;
           }
         }
+        eviction_rounds++;
+        evicted_instances += victims.size();
+        evicted_bytes += total_deleted;
       }
       // Now that we've release the lock we can do the deletions
       // and remove any references that we are holding
-      if (!to_delete.empty())
+      for (std::map<PhysicalManager*,RtEvent>::const_iterator it = 
+            to_delete.begin(); it != to_delete.end(); it++)
       {
-        for (std::map<PhysicalManager*,RtEvent>::const_iterator it = 
-              to_delete.begin(); it != to_delete.end(); it++)
-        {
-          it->first->perform_deletion(it->second);
-          if (it->first->remove_base_resource_ref(MEMORY_MANAGER_REF))
-            delete it->first;
-        }
+        it->first->perform_deletion(it->second);
+        if (it->first->remove_base_resource_ref(MEMORY_MANAGER_REF))
+          delete it->first;
       }
-      return pass_complete;
+      return true;
     }
 
     //--------------------------------------------------------------------------
@@ -5548,6 +6131,7 @@ namespace Legion {
         assert(finder->second.current_state != PENDING_COLLECTED_STATE);
         assert(finder->second.current_state != PENDING_ACQUIRE_STATE);
 #endif
+        remove_eviction_candidate(manager, finder->second);
         if (finder->second.current_state != COLLECTABLE_STATE)
         {
           finder->second.current_state = PENDING_COLLECTED_STATE;
@@ -5556,7 +6140,10 @@ namespace Legion {
           manager->add_base_resource_ref(MEMORY_MANAGER_REF);
         }
         else // Reference will flow out
+        {
+          remove_instance_from_index(manager);
           current_instances.erase(finder);
+        }
       }
       // Perform the deletion contingent on references being removed
       manager->perform_deletion(deferred_collect);
@@ -6160,6 +6747,11 @@ namespace Legion {
               runtime->handle_did_remote_resource_update(derez);
               break;
             }
+          case DISTRIBUTED_BATCH_UPDATE:
+            {
+              runtime->handle_did_remote_batch_update(derez);
+              break;
+            }
           case DISTRIBUTED_INVALIDATE:
             {
               runtime->handle_did_remote_invalidate(derez);
@@ -9138,6 +9730,8 @@ namespace Legion {
         machine(m), address_space(unique), 
         total_address_spaces(address_spaces.size()),
         runtime_stride(address_spaces.size()), profiler(NULL),
+        op_stage_latencies(config.op_stage_timing ? 
+                           new OpStageLatencies(this) : NULL),
         forest(new RegionTreeForest(this)), virtual_manager(NULL), 
         num_utility_procs(local_utilities.empty() ? locals.size() : 
                           local_utilities.size()), input_args(args),
@@ -9149,6 +9743,15 @@ namespace Legion {
         gc_epoch_size(config.gc_epoch_size),
         max_local_fields(config.max_local_fields),
         max_replay_parallelism(config.max_replay_parallelism),
+        max_intersection_cache_size(config.max_intersection_cache_size),
+        reference_batch_size(config.reference_batch_size),
+        load_balance_threshold(config.load_balance_threshold),
+        max_scheduler_passes(config.max_scheduler_passes),
+        auto_trace_min_length(config.auto_trace_min_length),
+        max_trace_templates(config.max_trace_templates),
+        background_optimization_threshold(
+            config.background_optimization_threshold),
+        trace_cache_directory(config.trace_cache_directory),
         program_order_execution(config.program_order_execution),
         dump_physical_traces(config.dump_physical_traces),
         no_tracing(config.no_tracing),
@@ -9210,7 +9813,16 @@ namespace Legion {
         unique_library_projection_id(LEGION_INITIAL_LIBRARY_ID_OFFSET),
         unique_library_task_id(LEGION_INITIAL_LIBRARY_ID_OFFSET),
         unique_distributed_id((unique == 0) ? runtime_stride : unique),
-        gc_epoch_counter(0)
+        gc_epoch_counter(0), reference_flush_scheduled(false),
+        batched_reference_updates(0), cancelled_reference_updates(0),
+        reference_batch_messages(0), auto_trace_observed_operations(0),
+        auto_trace_captured_operations(0), auto_trace_replayed_operations(0),
+        auto_trace_divergences(0), template_hits(0), template_misses(0),
+        template_rerecords(0), template_evictions(0),
+        template_optimizations(0), template_background_optimizations(0),
+        template_fence_elision_time(0), template_merge_propagation_time(0),
+        template_transitive_reduction_time(0), 
+        template_copy_propagation_time(0), template_parallel_replay_time(0)
     //--------------------------------------------------------------------------
     {
       log_run.debug("Initializing high-level runtime in address space %x",
@@ -9331,7 +9943,7 @@ namespace Legion {
     Runtime::Runtime(const Runtime &rhs)
       : external(NULL), mapper_runtime(NULL), machine(rhs.machine), 
         address_space(0), total_address_spaces(0), runtime_stride(0), 
-        profiler(NULL), forest(NULL), 
+        profiler(NULL), op_stage_latencies(NULL), forest(NULL), 
         num_utility_procs(rhs.num_utility_procs), input_args(rhs.input_args),
         initial_task_window_size(rhs.initial_task_window_size),
         initial_task_window_hysteresis(rhs.initial_task_window_hysteresis),
@@ -9341,6 +9953,15 @@ namespace Legion {
         gc_epoch_size(rhs.gc_epoch_size), 
         max_local_fields(rhs.max_local_fields),
         max_replay_parallelism(rhs.max_replay_parallelism),
+        max_intersection_cache_size(rhs.max_intersection_cache_size),
+        reference_batch_size(rhs.reference_batch_size),
+        load_balance_threshold(rhs.load_balance_threshold),
+        max_scheduler_passes(rhs.max_scheduler_passes),
+        auto_trace_min_length(rhs.auto_trace_min_length),
+        max_trace_templates(rhs.max_trace_templates),
+        background_optimization_threshold(
+            rhs.background_optimization_threshold),
+        trace_cache_directory(rhs.trace_cache_directory),
         program_order_execution(rhs.program_order_execution),
         dump_physical_traces(rhs.dump_physical_traces),
         no_tracing(rhs.no_tracing),
@@ -9401,6 +10022,8 @@ namespace Legion {
         delete profiler;
         profiler = NULL;
       }
+      if (op_stage_latencies != NULL)
+        delete op_stage_latencies;
       delete forest;
       delete external;
       delete mapper_runtime;
@@ -9823,11 +10446,19 @@ namespace Legion {
                                     config.prof_logfile,
                                     total_address_spaces,
                                     config.prof_footprint_threshold,
-                                    config.prof_target_latency);
+                                    config.prof_target_latency,
+                                    config.prof_summary_interval,
+                                    config.prof_sample_rate,
+                                    config.prof_perf_counters);
       LG_MESSAGE_DESCRIPTIONS(lg_message_descriptions);
       profiler->record_message_kinds(lg_message_descriptions, LAST_SEND_KIND);
       MAPPER_CALL_NAMES(lg_mapper_calls);
       profiler->record_mapper_call_kinds(lg_mapper_calls, LAST_MAPPER_CALL);
+      RUNTIME_COUNTER_DESCRIPTIONS(lg_runtime_counters);
+      profiler->record_runtime_counter_kinds(lg_runtime_counters,
+                                             LAST_RUNTIME_COUNTER_KIND);
+      OP_STAGE_DESCRIPTIONS(lg_op_stages);
+      profiler->record_op_stage_kinds(lg_op_stages, LAST_OP_STAGE_KIND);
 #ifdef DETAILED_LEGION_PROF
       RUNTIME_CALL_DESCRIPTIONS(lg_runtime_calls);
       profiler->record_runtime_call_kinds(lg_runtime_calls, 
@@ -10224,8 +10855,68 @@ namespace Legion {
       for (std::map<Memory,MemoryManager*>::const_iterator it =
            memory_managers.begin(); it != memory_managers.end(); it++)
         it->second->finalize();
+      if (op_stage_latencies != NULL)
+      {
+        if (profiler != NULL)
+          op_stage_latencies->report_profiling(profiler);
+        else
+          op_stage_latencies->log_summary();
+      }
       if (profiler != NULL)
+      {
+        forest->intersection_cache.report_profiling(profiler);
+        unsigned long long instance_lookups = 0, lookup_candidates = 0;
+        for (std::map<Memory,MemoryManager*>::const_iterator it =
+             memory_managers.begin(); it != memory_managers.end(); it++)
+          it->second->accumulate_lookup_counters(instance_lookups,
+                                                 lookup_candidates);
+        profiler->record_runtime_counter(INSTANCE_LOOKUPS_COUNTER,
+                                         instance_lookups);
+        profiler->record_runtime_counter(INSTANCE_LOOKUP_CANDIDATES_COUNTER,
+                                         lookup_candidates);
+        profiler->record_runtime_counter(REFERENCE_UPDATES_BATCHED_COUNTER,
+                                         batched_reference_updates);
+        profiler->record_runtime_counter(REFERENCE_UPDATES_CANCELLED_COUNTER,
+                                         cancelled_reference_updates);
+        profiler->record_runtime_counter(REFERENCE_BATCH_MESSAGES_COUNTER,
+                                         reference_batch_messages);
+        profiler->record_runtime_counter(AUTO_TRACE_OBSERVED_COUNTER,
+                                         auto_trace_observed_operations);
+        profiler->record_runtime_counter(AUTO_TRACE_CAPTURED_COUNTER,
+                                         auto_trace_captured_operations);
+        profiler->record_runtime_counter(AUTO_TRACE_REPLAYED_COUNTER,
+                                         auto_trace_replayed_operations);
+        profiler->record_runtime_counter(AUTO_TRACE_DIVERGENCES_COUNTER,
+                                         auto_trace_divergences);
+        profiler->record_runtime_counter(TRACE_TEMPLATE_HITS_COUNTER,
+                                         template_hits);
+        profiler->record_runtime_counter(TRACE_TEMPLATE_MISSES_COUNTER,
+                                         template_misses);
+        profiler->record_runtime_counter(TRACE_TEMPLATE_RERECORDS_COUNTER,
+                                         template_rerecords);
+        profiler->record_runtime_counter(TRACE_TEMPLATE_EVICTIONS_COUNTER,
+                                         template_evictions);
+        profiler->record_runtime_counter(TEMPLATE_OPTIMIZATIONS_COUNTER,
+                                         template_optimizations);
+        profiler->record_runtime_counter(
+            TEMPLATE_BACKGROUND_OPTIMIZATIONS_COUNTER,
+            template_background_optimizations);
+        profiler->record_runtime_counter(TEMPLATE_FENCE_ELISION_TIME_COUNTER,
+                                         template_fence_elision_time);
+        profiler->record_runtime_counter(
+            TEMPLATE_MERGE_PROPAGATION_TIME_COUNTER,
+            template_merge_propagation_time);
+        profiler->record_runtime_counter(
+            TEMPLATE_TRANSITIVE_REDUCTION_TIME_COUNTER,
+            template_transitive_reduction_time);
+        profiler->record_runtime_counter(
+            TEMPLATE_COPY_PROPAGATION_TIME_COUNTER,
+            template_copy_propagation_time);
+        profiler->record_runtime_counter(
+            TEMPLATE_PARALLEL_REPLAY_TIME_COUNTER,
+            template_parallel_replay_time);
         profiler->finalize();
+      }
     }
     
     //--------------------------------------------------------------------------
@@ -13687,7 +14378,8 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     void Runtime::send_advertisements(const std::set<Processor> &targets,
-                                            MapperID map_id, Processor source)
+                                      MapperID map_id, Processor source,
+                                      unsigned load)
     //--------------------------------------------------------------------------
     {
       std::set<MessageManager*> already_sent;
@@ -13699,7 +14391,7 @@ namespace Legion {
         if (finder != proc_managers.end())
         {
           // still local
-          finder->second->process_advertisement(source, map_id);
+          finder->second->process_advertisement(source, map_id, load);
         }
         else
         {
@@ -13712,6 +14404,7 @@ namespace Legion {
             RezCheck z(rez);
             rez.serialize(source);
             rez.serialize(map_id);
+            rez.serialize(load);
           }
           messenger->send_message(rez, ADVERTISEMENT_MESSAGE, 
                                   MAPPER_VIRTUAL_CHANNEL, true/*flush*/);
@@ -14153,6 +14846,15 @@ namespace Legion {
                                     REFERENCE_VIRTUAL_CHANNEL, true/*flush*/);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::send_did_remote_batch_update(AddressSpaceID target,
+                                               Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      find_messenger(target)->send_message(rez, DISTRIBUTED_BATCH_UPDATE,
+                                    REFERENCE_VIRTUAL_CHANNEL, true/*flush*/);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::send_did_remote_invalidate(AddressSpaceID target,
                                              Serializer &rez)
@@ -14941,11 +15643,13 @@ namespace Legion {
       derez.deserialize(source);
       MapperID map_id;
       derez.deserialize(map_id);
+      unsigned load;
+      derez.deserialize(load);
       // Just advertise it to all the managers
       for (std::map<Processor,ProcessorManager*>::const_iterator it = 
             proc_managers.begin(); it != proc_managers.end(); it++)
       {
-        it->second->process_advertisement(source, map_id);
+        it->second->process_advertisement(source, map_id, load);
       }
     }
 
@@ -15293,6 +15997,13 @@ namespace Legion {
       DistributedCollectable::handle_did_remote_resource_update(this, derez); 
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::handle_did_remote_batch_update(Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DistributedCollectable::handle_did_remote_batch_update(this, derez);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::handle_did_remote_invalidate(Deserializer &derez)
     //--------------------------------------------------------------------------
@@ -16405,6 +17116,61 @@ namespace Legion {
       proc_managers[p]->add_to_local_ready_queue(op, priority, wait_on);
     }
 
+    //--------------------------------------------------------------------------
+    ProcessorManager* Runtime::find_load_balance_victim(
+                                           const ProcessorManager *thief) const
+    //--------------------------------------------------------------------------
+    {
+      // The set of processor managers never changes after start-up so we
+      // can look at their published loads without holding any locks
+      ProcessorManager *victim = NULL;
+      unsigned max_load = 0;
+      for (std::map<Processor,ProcessorManager*>::const_iterator it = 
+            proc_managers.begin(); it != proc_managers.end(); it++)
+      {
+        if ((it->second == thief) || (it->second->proc_kind != thief->proc_kind))
+          continue;
+        // Only the ready tasks can move but the tasks already mapped
+        // there are what they will be waiting behind
+        if (it->second->get_ready_load() == 0)
+          continue;
+        const unsigned load = it->second->get_total_load();
+        if ((load < load_balance_threshold) || (load <= max_load))
+          continue;
+        max_load = load;
+        victim = it->second;
+      }
+      return victim;
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::advertise_local_load(const ProcessorManager *source,
+                                       MapperID map_id, unsigned load)
+    //--------------------------------------------------------------------------
+    {
+      for (std::map<Processor,ProcessorManager*>::const_iterator it = 
+            proc_managers.begin(); it != proc_managers.end(); it++)
+      {
+        if ((it->second == source) || 
+            (it->second->proc_kind != source->proc_kind))
+          continue;
+        // Only idle processors need to hear about it
+        if (it->second->get_total_load() > 0)
+          continue;
+        it->second->process_advertisement(source->local_proc, map_id, load);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::record_mapped_task(Processor p, ApEvent task_complete)
+    //--------------------------------------------------------------------------
+    {
+      std::map<Processor,ProcessorManager*>::const_iterator finder = 
+        proc_managers.find(p);
+      if (finder != proc_managers.end())
+        finder->second->record_mapped_task(protect_event(task_complete));
+    }
+
     //--------------------------------------------------------------------------
     Processor Runtime::find_processor_group(const std::vector<Processor> &procs)
     //--------------------------------------------------------------------------
@@ -16685,6 +17451,215 @@ namespace Legion {
       return false;
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::defer_remote_reference_removal(AddressSpaceID target,
+                                                 DistributedID did,
+                                                 ReferenceKind kind,
+                                                 unsigned count)
+    //--------------------------------------------------------------------------
+    {
+      std::map<DistributedID,PendingReferenceRemovals> to_send;
+      bool schedule_flush = false;
+      {
+        AutoLock r_lock(reference_batch_lock);
+        std::map<DistributedID,PendingReferenceRemovals> &pending = 
+          pending_reference_removals[target];
+        PendingReferenceRemovals &removals = pending[did];
+        switch (kind)
+        {
+          case VALID_REF_KIND:
+            {
+              removals.valid_refs += count;
+              break;
+            }
+          case GC_REF_KIND:
+            {
+              removals.gc_refs += count;
+              break;
+            }
+          case RESOURCE_REF_KIND:
+            {
+              removals.resource_refs += count;
+              break;
+            }
+          default:
+            assert(false);
+        }
+        batched_reference_updates++;
+        // Send this batch now if it is full, otherwise make sure that
+        // there is a flush coming to pick it up later
+        if (pending.size() >= reference_batch_size)
+        {
+          to_send.swap(pending);
+          pending_reference_removals.erase(target);
+        }
+        else if (!reference_flush_scheduled)
+        {
+          reference_flush_scheduled = true;
+          schedule_flush = true;
+        }
+      }
+      if (!to_send.empty())
+        send_remote_reference_removals(target, to_send);
+      if (schedule_flush)
+      {
+        FlushReferenceUpdatesArgs args;
+        // Low priority so that we pick up as many updates as we
+        // can from the other meta-tasks that are running right now
+        issue_runtime_meta_task(args, LG_LOW_PRIORITY);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned Runtime::cancel_remote_reference_removals(AddressSpaceID target,
+                                                       DistributedID did,
+                                                       ReferenceKind kind,
+                                                       unsigned count)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock r_lock(reference_batch_lock);
+      std::map<AddressSpaceID,
+        std::map<DistributedID,PendingReferenceRemovals> >::iterator 
+          target_finder = pending_reference_removals.find(target);
+      if (target_finder == pending_reference_removals.end())
+        return count;
+      std::map<DistributedID,PendingReferenceRemovals>::iterator finder = 
+        target_finder->second.find(did);
+      if (finder == target_finder->second.end())
+        return count;
+      unsigned *pending = NULL;
+      switch (kind)
+      {
+        case VALID_REF_KIND:
+          {
+            pending = &finder->second.valid_refs;
+            break;
+          }
+        case GC_REF_KIND:
+          {
+            pending = &finder->second.gc_refs;
+            break;
+          }
+        case RESOURCE_REF_KIND:
+          {
+            pending = &finder->second.resource_refs;
+            break;
+          }
+        default:
+          assert(false);
+      }
+      // The remote node still holds the references that we have not
+      // removed yet so an addition can simply cancel out a removal
+      const unsigned cancelled = (count < *pending) ? count : *pending;
+      *pending -= cancelled;
+      cancelled_reference_updates += cancelled;
+      if ((finder->second.valid_refs == 0) && (finder->second.gc_refs == 0) &&
+          (finder->second.resource_refs == 0))
+      {
+        target_finder->second.erase(finder);
+        if (target_finder->second.empty())
+          pending_reference_removals.erase(target_finder);
+      }
+      return (count - cancelled);
+    }
+
+    //--------------------------------------------------------------------------
+    bool Runtime::flush_remote_reference_removals(void)
+    //--------------------------------------------------------------------------
+    {
+      std::map<AddressSpaceID,
+        std::map<DistributedID,PendingReferenceRemovals> > to_send;
+      {
+        AutoLock r_lock(reference_batch_lock);
+        to_send.swap(pending_reference_removals);
+        reference_flush_scheduled = false;
+      }
+      for (std::map<AddressSpaceID,std::map<DistributedID,
+            PendingReferenceRemovals> >::const_iterator it = 
+            to_send.begin(); it != to_send.end(); it++)
+        send_remote_reference_removals(it->first, it->second);
+      return !to_send.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::send_remote_reference_removals(AddressSpaceID target,
+          const std::map<DistributedID,PendingReferenceRemovals> &removals)
+    //--------------------------------------------------------------------------
+    {
+      Serializer rez;
+      {
+        RezCheck z(rez);
+        rez.serialize<size_t>(removals.size());
+        for (std::map<DistributedID,PendingReferenceRemovals>::const_iterator
+              it = removals.begin(); it != removals.end(); it++)
+        {
+          rez.serialize(it->first);
+          rez.serialize(it->second.valid_refs);
+          rez.serialize(it->second.gc_refs);
+          rez.serialize(it->second.resource_refs);
+        }
+      }
+      send_did_remote_batch_update(target, rez);
+      __sync_fetch_and_add(&reference_batch_messages, 1);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::record_auto_trace_statistics(unsigned long long observed,
+                                               unsigned long long captured,
+                                               unsigned long long replayed,
+                                               unsigned long long divergences)
+    //--------------------------------------------------------------------------
+    {
+      if (observed > 0)
+        __sync_fetch_and_add(&auto_trace_observed_operations, observed);
+      if (captured > 0)
+        __sync_fetch_and_add(&auto_trace_captured_operations, captured);
+      if (replayed > 0)
+        __sync_fetch_and_add(&auto_trace_replayed_operations, replayed);
+      if (divergences > 0)
+        __sync_fetch_and_add(&auto_trace_divergences, divergences);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::record_template_statistics(unsigned long long hits,
+                                             unsigned long long misses,
+                                             unsigned long long rerecords,
+                                             unsigned long long evictions)
+    //--------------------------------------------------------------------------
+    {
+      if (hits > 0)
+        __sync_fetch_and_add(&template_hits, hits);
+      if (misses > 0)
+        __sync_fetch_and_add(&template_misses, misses);
+      if (rerecords > 0)
+        __sync_fetch_and_add(&template_rerecords, rerecords);
+      if (evictions > 0)
+        __sync_fetch_and_add(&template_evictions, evictions);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::record_template_optimization(bool background,
+                                   unsigned long long fence_elision_time,
+                                   unsigned long long merge_propagation_time,
+                                   unsigned long long transitive_reduction_time,
+                                   unsigned long long copy_propagation_time,
+                                   unsigned long long parallel_replay_time)
+    //--------------------------------------------------------------------------
+    {
+      __sync_fetch_and_add(&template_optimizations, 1);
+      if (background)
+        __sync_fetch_and_add(&template_background_optimizations, 1);
+      __sync_fetch_and_add(&template_fence_elision_time, fence_elision_time);
+      __sync_fetch_and_add(&template_merge_propagation_time, 
+                           merge_propagation_time);
+      __sync_fetch_and_add(&template_transitive_reduction_time,
+                           transitive_reduction_time);
+      __sync_fetch_and_add(&template_copy_propagation_time,
+                           copy_propagation_time);
+      __sync_fetch_and_add(&template_parallel_replay_time,
+                           parallel_replay_time);
+    }
+
     //--------------------------------------------------------------------------
     LogicalView* Runtime::find_or_request_logical_view(DistributedID did,
                                                        RtEvent &ready)
@@ -17085,6 +18060,10 @@ namespace Legion {
                                            bool phase_one)
     //--------------------------------------------------------------------------
     {
+      // Any reference removals we are still holding onto need to 
+      // be sent before we can be sure that there is nothing left to do
+      if (flush_remote_reference_removals())
+        shutdown_manager->record_outstanding_tasks();
       if (has_outstanding_tasks())
       {
         shutdown_manager->record_outstanding_tasks();
@@ -18591,6 +19570,16 @@ namespace Legion {
           return "Variant Implementation";
         case LAYOUT_CONSTRAINTS_ALLOC:
           return "Layout Constraints";
+        case INDEX_SPACE_NODE_ALLOC:
+          return "Index Space Node";
+        case INDEX_PART_NODE_ALLOC:
+          return "Index Partition Node";
+        case REGION_NODE_ALLOC:
+          return "Region Node";
+        case PARTITION_NODE_ALLOC:
+          return "Partition Node";
+        case SLAB_ALLOC:
+          return "Unused Slab Memory";
         default:
           assert(false); // should never get here
       }
@@ -19210,6 +20199,14 @@ namespace Legion {
         INT_ARG("-lg:epoch", config.gc_epoch_size);
         INT_ARG("-lg:local", config.max_local_fields);
         INT_ARG("-lg:parallel_replay", config.max_replay_parallelism);
+        INT_ARG("-lg:intersection_cache", config.max_intersection_cache_size);
+        INT_ARG("-lg:reference_batch", config.reference_batch_size);
+        INT_ARG("-lg:balance", config.load_balance_threshold);
+        INT_ARG("-lg:sched_passes", config.max_scheduler_passes);
+        INT_ARG("-lg:auto_trace", config.auto_trace_min_length);
+        INT_ARG("-lg:max_templates", config.max_trace_templates);
+        INT_ARG("-lg:background_opt",
+                config.background_optimization_threshold);
         if (!strcmp(argv[i],"-lg:no_dyn"))
           config.dynamic_independence_tests = false;
         BOOL_ARG("-lg:spy",config.legion_spy_enabled);
@@ -19253,6 +20250,11 @@ namespace Legion {
           config.serializer_type = argv[++i];
           continue;
         }
+        if (!strcmp(argv[i],"-lg:trace_cache"))
+        {
+          config.trace_cache_directory = argv[++i];
+          continue;
+        }
         if (!strcmp(argv[i],"-lg:prof_logfile"))
         {
           config.prof_logfile = argv[++i];
@@ -19264,6 +20266,10 @@ namespace Legion {
           continue;
         }
         INT_ARG("-lg:prof_latency",config.prof_target_latency);
+        INT_ARG("-lg:prof_summary",config.prof_summary_interval);
+        INT_ARG("-lg:prof_sample",config.prof_sample_rate);
+        BOOL_ARG("-lg:prof_counters",config.prof_perf_counters);
+        BOOL_ARG("-lg:op_stages",config.op_stage_timing);
 
         BOOL_ARG("-lg:debug_ok",config.slow_config_ok);
         
@@ -20172,6 +21178,8 @@ namespace Legion {
           {
             const Operation::DeferredReadyArgs *deferred_ready_args = 
               (const Operation::DeferredReadyArgs*)args;
+            deferred_ready_args->proxy_this->record_stage_time(
+                                              Operation::OP_READY_TIME);
             deferred_ready_args->proxy_this->trigger_ready();
             break;
           }
@@ -20273,6 +21281,11 @@ namespace Legion {
             ProcessorManager::handle_defer_mapper(args);
             break;
           }
+        case LG_BALANCE_TASK_COMPLETE_TASK_ID:
+          {
+            ProcessorManager::handle_balance_task_complete(args);
+            break;
+          }
         case LG_DEFERRED_RECYCLE_ID:
           {
             const DeferredRecycleArgs *deferred_recycle_args = 
@@ -20681,6 +21694,11 @@ namespace Legion {
             IndexSpaceNode::handle_tighten_index_space(args);
             break;
           }
+        case LG_INDEX_PART_CHILD_CREATION_TASK_ID:
+          {
+            IndexPartNode::handle_child_creation(args);
+            break;
+          }
         case LG_REMOTE_PHYSICAL_REQUEST_TASK_ID:
           {
             RemoteContext::defer_physical_request(args);
@@ -20701,6 +21719,21 @@ namespace Legion {
             PhysicalTemplate::handle_delete_template(args);
             break;
           }
+        case LG_OPTIMIZE_TEMPLATE_ID:
+          {
+            PhysicalTemplate::handle_optimize_template(args);
+            break;
+          }
+        case LG_PROFILER_WRITER_TASK_ID:
+          {
+            LegionProfiler::handle_profiler_writer(args);
+            break;
+          }
+        case LG_FLUSH_REFERENCE_UPDATES_TASK_ID:
+          {
+            runtime->flush_remote_reference_removals();
+            break;
+          }
         case LG_RETRY_SHUTDOWN_TASK_ID:
           {
             const ShutdownManager::RetryShutdownArgs *shutdown_args = 
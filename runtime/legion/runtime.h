@@ -591,6 +591,17 @@ namespace Legion {
         const MapperID map_id;
         const RtEvent deferral_event;
       };
+      struct BalanceTaskCompleteArgs :
+        public LgTaskArgs<BalanceTaskCompleteArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_BALANCE_TASK_COMPLETE_TASK_ID;
+      public:
+        BalanceTaskCompleteArgs(ProcessorManager *proxy)
+          : LgTaskArgs<BalanceTaskCompleteArgs>(implicit_provenance),
+            proxy_this(proxy) { }
+      public:
+        ProcessorManager *const proxy_this;
+      };
       struct MapperMessage {
       public:
         MapperMessage(void)
@@ -633,7 +644,15 @@ namespace Legion {
     public:
       void process_steal_request(Processor thief, 
                                  const std::vector<MapperID> &thieves);
-      void process_advertisement(Processor advertiser, MapperID mid);
+      void process_advertisement(Processor advertiser, MapperID mid,
+                                 unsigned load);
+      unsigned steal_ready_tasks(MapperID mid, std::set<TaskOp*> &stolen);
+      inline unsigned get_ready_load(void) const { return ready_load; }
+      inline unsigned get_total_load(void) const 
+        { return ready_load + mapped_load; }
+      void record_mapped_task(RtEvent task_complete);
+      void complete_mapped_task(void);
+      static void handle_balance_task_complete(const void *args);
     public:
       void add_to_ready_queue(TaskOp *op);
       void add_to_local_ready_queue(Operation *op, LgPriority priority,
@@ -642,8 +661,14 @@ namespace Legion {
       inline void find_visible_memories(std::set<Memory> &visible) const
         { visible = visible_memories; }
     protected:
-      void perform_mapping_operations(void);
+      void drain_incoming_tasks(void);
+      bool perform_mapping_operations(void);
       void issue_advertisements(MapperID mid);
+    protected:
+      void process_balanced_steal_request(Processor thief,
+                                          const std::vector<MapperID> &thieves);
+      void balance_load(MapperID mid);
+      void advertise_load(MapperID mid, unsigned load);
     protected:
       void increment_active_contexts(void);
       void decrement_active_contexts(void);
@@ -659,10 +684,17 @@ namespace Legion {
       const bool stealing_disabled;
       // are we doing replay execution
       const bool replay_execution;
+      // Ready tasks needed before the runtime balances load
+      const unsigned balance_threshold;
     protected:
       // Local queue state
       mutable LocalLock local_queue_lock;
       unsigned next_local_index;
+    protected:
+      // Tasks are pushed here without holding any locks and the first
+      // thread to make the list non-empty moves them to the ready queues,
+      // the list is linked through the next_ready_task field of each task
+      TaskOp *volatile incoming_tasks;
     protected:
       // Scheduling state
       mutable LocalLock queue_lock;
@@ -686,11 +718,12 @@ namespace Legion {
       struct MapperState {
       public:
         MapperState(void)
-          : queue_guard(false) { }
+          : ready_count(0), queue_guard(false) { }
       public:
         std::list<TaskOp*> ready_queue;
         RtEvent deferral_event;
         RtUserEvent queue_waiter;
+        unsigned ready_count;
         bool queue_guard;
       };
       // State for each mapper for scheduling purposes
@@ -699,6 +732,18 @@ namespace Legion {
       mutable LocalLock mapper_lock;
       // The set of visible memories from this processor
       std::set<Memory> visible_memories;
+    protected:
+      // Total number of ready tasks across all the mappers, this is 
+      // read without the queue lock by other processor managers
+      volatile unsigned ready_load;
+      // Number of tasks mapped onto this processor that have not
+      // finished running yet, also read without any locks
+      volatile unsigned mapped_load;
+      // Last known loads of remote processors and the remote thieves
+      // to tell when we have work again for runtime load balancing
+      mutable LocalLock balance_lock;
+      std::map<Processor,unsigned> remote_load_hints;
+      std::map<MapperID,std::set<Processor> > failed_thieves;
     };
 
     /**
@@ -744,6 +789,25 @@ namespace Legion {
         // For tracking external instances and whether they can be used
         bool unattached_external;
       };
+      struct EvictionCandidate {
+      public:
+        EvictionCandidate(GCPriority p, size_t s, PhysicalManager *m)
+          : priority(p), size(s), manager(m) { }
+      public:
+        // Higher priorities get collected first and then larger instances
+        inline bool operator<(const EvictionCandidate &rhs) const
+        {
+          if (priority > rhs.priority) return true;
+          if (priority < rhs.priority) return false;
+          if (size > rhs.size) return true;
+          if (size < rhs.size) return false;
+          return (manager < rhs.manager);
+        }
+      public:
+        GCPriority priority;
+        size_t size;
+        PhysicalManager *manager;
+      };
     public:
       MemoryManager(Memory mem, Runtime *rt);
       MemoryManager(const MemoryManager &rhs);
@@ -836,8 +900,25 @@ namespace Legion {
                                     const std::vector<LogicalRegion> &regions,
                                     MappingInstance &result, bool acquire, 
                                     bool tight_region_bounds, bool remote);
+      void find_candidate_instances(const std::vector<LogicalRegion> &regions,
+                                    const FieldConstraint &fields,
+                                    bool valid_only, bool tight_region_bounds,
+                                    std::deque<PhysicalManager*> &candidates);
+      static bool is_candidate_instance(const InstanceInfo &info, 
+                                        bool valid_only);
       void release_candidate_references(const std::deque<PhysicalManager*>
                                                         &candidates) const;
+      // These must be called while holding the manager lock
+      void add_instance_to_index(PhysicalManager *manager);
+      void remove_instance_from_index(PhysicalManager *manager);
+      // These must also be called while holding the manager lock and
+      // bracket any change to the state or priority of an instance
+      void add_eviction_candidate(PhysicalManager *manager,
+                                  const InstanceInfo &info);
+      void remove_eviction_candidate(PhysicalManager *manager,
+                                     const InstanceInfo &info);
+      std::set<EvictionCandidate>* find_eviction_candidates(
+                                                  InstanceState state);
     protected:
       // We serialize all allocation attempts in a memory in order to 
       // ensure find_and_create calls will remain atomic
@@ -846,10 +927,12 @@ namespace Legion {
       PhysicalManager* allocate_physical_instance(InstanceBuilder &builder,
                                                   size_t *footprint);
     public:
-      bool delete_by_size_and_state(const size_t needed_size, 
-                                    InstanceState state, bool larger_only); 
+      bool evict_instances(const size_t needed_size, InstanceState state);
       void attach_external_instance(PhysicalManager *manager);
       RtEvent detach_external_instance(PhysicalManager *manager);
+    public:
+      void accumulate_lookup_counters(unsigned long long &lookups,
+                                      unsigned long long &examined) const;
     public:
       // The memory that we are managing
       const Memory memory;
@@ -872,9 +955,29 @@ namespace Legion {
       // It is only valid on the owner node
       LegionMap<PhysicalManager*,InstanceInfo,
                 MEMORY_INSTANCES_ALLOC>::tracked current_instances;
+      // An index over the current instances by region tree, then by the
+      // region bounding each instance and its layout (which determines
+      // its set of fields) so that lookups only need to consider the
+      // instances that might be able to satisfy a request
+      typedef std::map<RegionNode*,
+        std::map<LayoutDescription*,std::set<PhysicalManager*> > >
+                                                          InstanceTreeIndex;
+      std::map<RegionTreeID,InstanceTreeIndex> instance_index;
+      // The instances that can be evicted in each state kept in the
+      // order that evict_instances will consider them
+      std::set<EvictionCandidate> collectable_candidates;
+      std::set<EvictionCandidate> active_candidates;
       // Keep track of outstanding requuests for allocations which 
       // will be tried in the order that they arrive
       std::deque<RtUserEvent> pending_allocation_attempts;
+      // Statistics about evictions in this memory
+      long long eviction_rounds;
+      long long evicted_instances;
+      long long evicted_bytes;
+      long long failed_allocations;
+      // Statistics about instance lookups in this memory
+      unsigned long long instance_lookups;
+      unsigned long long lookup_candidates_examined;
     };
 
     /**
@@ -1469,6 +1572,16 @@ namespace Legion {
             gc_epoch_size(LEGION_DEFAULT_GC_EPOCH_SIZE),
             max_local_fields(LEGION_DEFAULT_LOCAL_FIELDS),
             max_replay_parallelism(LEGION_DEFAULT_MAX_REPLAY_PARALLELISM),
+            max_intersection_cache_size(
+                LEGION_DEFAULT_INTERSECTION_CACHE_SIZE),
+            reference_batch_size(LEGION_DEFAULT_REFERENCE_BATCH_SIZE),
+            load_balance_threshold(LEGION_DEFAULT_LOAD_BALANCE_THRESHOLD),
+            max_scheduler_passes(LEGION_DEFAULT_SCHEDULER_PASSES),
+            auto_trace_min_length(LEGION_DEFAULT_AUTO_TRACE_MIN_LENGTH),
+            max_trace_templates(LEGION_DEFAULT_MAX_TRACE_TEMPLATES),
+            background_optimization_threshold(
+                LEGION_DEFAULT_BACKGROUND_OPTIMIZATION_THRESHOLD),
+            trace_cache_directory(NULL),
             program_order_execution(false),
             dump_physical_traces(false),
             no_tracing(false),
@@ -1505,7 +1618,11 @@ namespace Legion {
             serializer_type("binary"),
             prof_logfile(NULL),
             prof_footprint_threshold(128 << 20),
-            prof_target_latency(100) { }
+            prof_target_latency(100),
+            prof_summary_interval(60),
+            prof_sample_rate(1),
+            prof_perf_counters(false),
+            op_stage_timing(false) { }
       public:
         int delay_start;
         mutable int legion_collective_radix;
@@ -1521,6 +1638,14 @@ namespace Legion {
         unsigned gc_epoch_size;
         unsigned max_local_fields;
         unsigned max_replay_parallelism;
+        unsigned max_intersection_cache_size;
+        unsigned reference_batch_size;
+        unsigned load_balance_threshold;
+        unsigned max_scheduler_passes;
+        unsigned auto_trace_min_length;
+        unsigned max_trace_templates;
+        unsigned background_optimization_threshold;
+        const char *trace_cache_directory;
       public:
         bool program_order_execution;
         bool dump_physical_traces;
@@ -1556,6 +1681,10 @@ namespace Legion {
         const char *prof_logfile;
         size_t prof_footprint_threshold;
         size_t prof_target_latency;
+        unsigned prof_summary_interval;
+        unsigned prof_sample_rate;
+        bool prof_perf_counters;
+        bool op_stage_timing;
       public:
         void configure_collective_settings(int total_spaces) const;
       };
@@ -1569,6 +1698,25 @@ namespace Legion {
       public:
         const DistributedID did;
       }; 
+      struct FlushReferenceUpdatesArgs : 
+        public LgTaskArgs<FlushReferenceUpdatesArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_FLUSH_REFERENCE_UPDATES_TASK_ID;
+      public:
+        FlushReferenceUpdatesArgs(void)
+          : LgTaskArgs<FlushReferenceUpdatesArgs>(0) { }
+      };
+      // Reference removals for a distributed collectable on its 
+      // owner node that have been buffered but not yet sent
+      struct PendingReferenceRemovals {
+      public:
+        PendingReferenceRemovals(void)
+          : valid_refs(0), gc_refs(0), resource_refs(0) { }
+      public:
+        unsigned valid_refs;
+        unsigned gc_refs;
+        unsigned resource_refs;
+      };
       struct TopFinishArgs : public LgTaskArgs<TopFinishArgs> {
       public:
         static const LgTaskID TASK_ID = LG_TOP_FINISH_TASK_ID;
@@ -1647,6 +1795,8 @@ namespace Legion {
       const unsigned total_address_spaces;
       const unsigned runtime_stride; // stride for uniqueness
       LegionProfiler *profiler;
+      // Only non-NULL when we are timing operation stages
+      OpStageLatencies *const op_stage_latencies;
       RegionTreeForest *const forest;
       VirtualManager *virtual_manager;
       Processor utility_group;
@@ -1661,6 +1811,14 @@ namespace Legion {
       const unsigned gc_epoch_size;
       const unsigned max_local_fields;
       const unsigned max_replay_parallelism;
+      const unsigned max_intersection_cache_size;
+      const unsigned reference_batch_size;
+      const unsigned load_balance_threshold;
+      const unsigned max_scheduler_passes;
+      const unsigned auto_trace_min_length;
+      const unsigned max_trace_templates;
+      const unsigned background_optimization_threshold;
+      const char *const trace_cache_directory;
     public:
       const bool program_order_execution;
       const bool dump_physical_traces;
@@ -2185,7 +2343,8 @@ namespace Legion {
       void send_steal_request(const std::multimap<Processor,MapperID> &targets,
                               Processor thief);
       void send_advertisements(const std::set<Processor> &targets,
-                              MapperID map_id, Processor source);
+                              MapperID map_id, Processor source,
+                              unsigned load = 0);
       void send_index_space_node(AddressSpaceID target, Serializer &rez);
       void send_index_space_request(AddressSpaceID target, Serializer &rez);
       void send_index_space_return(AddressSpaceID target, Serializer &rez);
@@ -2247,6 +2406,8 @@ namespace Legion {
       void send_did_remote_gc_update(AddressSpaceID target, Serializer &rez);
       void send_did_remote_resource_update(AddressSpaceID target,
                                            Serializer &rez);
+      void send_did_remote_batch_update(AddressSpaceID target, 
+                                        Serializer &rez);
       void send_did_remote_invalidate(AddressSpaceID target, Serializer &rez);
       void send_did_remote_deactivate(AddressSpaceID target, Serializer &rez);
       void send_did_add_create_reference(AddressSpaceID target,Serializer &rez);
@@ -2426,6 +2587,7 @@ namespace Legion {
       void handle_did_remote_valid_update(Deserializer &derez);
       void handle_did_remote_gc_update(Deserializer &derez);
       void handle_did_remote_resource_update(Deserializer &derez);
+      void handle_did_remote_batch_update(Deserializer &derez);
       void handle_did_remote_invalidate(Deserializer &derez);
       void handle_did_remote_deactivate(Deserializer &derez);
       void handle_did_create_add(Deserializer &derez);
@@ -2609,6 +2771,13 @@ namespace Legion {
                               RtEvent wait_on = RtEvent::NO_RT_EVENT);
       void add_to_local_queue(Processor p, Operation *op, LgPriority priority,
                               RtEvent wait_on = RtEvent::NO_RT_EVENT);
+    public:
+      // Runtime load balancing between the local processor managers
+      ProcessorManager* find_load_balance_victim(
+                                      const ProcessorManager *thief) const;
+      void advertise_local_load(const ProcessorManager *source,
+                                MapperID map_id, unsigned load);
+      void record_mapped_task(Processor p, ApEvent task_complete);
     public:
       inline Processor find_utility_group(void) { return utility_group; }
       Processor find_processor_group(const std::vector<Processor> &procs);
@@ -2634,6 +2803,34 @@ namespace Legion {
       DistributedCollectable* weak_find_distributed_collectable(
                                                            DistributedID did);
       bool find_pending_collectable_location(DistributedID did,void *&location);
+    public:
+      // Batching of reference removals sent to owner nodes
+      void defer_remote_reference_removal(AddressSpaceID target,
+                                          DistributedID did, 
+                                          ReferenceKind kind,
+                                          unsigned count);
+      unsigned cancel_remote_reference_removals(AddressSpaceID target,
+                                                DistributedID did,
+                                                ReferenceKind kind,
+                                                unsigned count);
+      bool flush_remote_reference_removals(void);
+      void send_remote_reference_removals(AddressSpaceID target,
+        const std::map<DistributedID,PendingReferenceRemovals> &removals);
+    public:
+      void record_auto_trace_statistics(unsigned long long observed,
+                                        unsigned long long captured,
+                                        unsigned long long replayed,
+                                        unsigned long long divergences);
+      void record_template_statistics(unsigned long long hits,
+                                      unsigned long long misses,
+                                      unsigned long long rerecords,
+                                      unsigned long long evictions);
+      void record_template_optimization(bool background,
+                                 unsigned long long fence_elision_time,
+                                 unsigned long long merge_propagation_time,
+                                 unsigned long long transitive_reduction_time,
+                                 unsigned long long copy_propagation_time,
+                                 unsigned long long parallel_replay_time);
     public:
       LogicalView* find_or_request_logical_view(DistributedID did,
                                                 RtEvent &ready);
@@ -2984,6 +3181,37 @@ namespace Legion {
       LegionSet<GarbageCollectionEpoch*,
                 RUNTIME_GC_EPOCH_ALLOC>::tracked  pending_gc_epochs;
       unsigned gc_epoch_counter;
+    protected:
+      mutable LocalLock reference_batch_lock;
+      std::map<AddressSpaceID,
+        std::map<DistributedID,PendingReferenceRemovals> > 
+                                          pending_reference_removals;
+      bool reference_flush_scheduled;
+      unsigned long long batched_reference_updates;
+      unsigned long long cancelled_reference_updates;
+      unsigned long long reference_batch_messages;
+    protected:
+      // Statistics about automatically detected traces
+      unsigned long long auto_trace_observed_operations;
+      unsigned long long auto_trace_captured_operations;
+      unsigned long long auto_trace_replayed_operations;
+      unsigned long long auto_trace_divergences;
+    protected:
+      // Statistics about the selection of physical trace templates
+      unsigned long long template_hits;
+      unsigned long long template_misses;
+      unsigned long long template_rerecords;
+      unsigned long long template_evictions;
+    protected:
+      // Statistics about the optimization of physical templates,
+      // the times of the passes are in microseconds
+      unsigned long long template_optimizations;
+      unsigned long long template_background_optimizations;
+      unsigned long long template_fence_elision_time;
+      unsigned long long template_merge_propagation_time;
+      unsigned long long template_transitive_reduction_time;
+      unsigned long long template_copy_propagation_time;
+      unsigned long long template_parallel_replay_time;
     protected:
       // The runtime keeps track of remote contexts so they
       // can be re-used by multiple tasks that get sent remotely
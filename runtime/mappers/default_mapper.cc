@@ -69,12 +69,14 @@ namespace Legion {
         stealing_enabled(STATIC_STEALING_ENABLED),
         max_schedule_count(STATIC_MAX_SCHEDULE_COUNT),
         memoize(STATIC_MEMOIZE),
-        map_locally(STATIC_MAP_LOCALLY)
+        map_locally(STATIC_MAP_LOCALLY), concurrent(false), map_in_bulk(false),
+        cost_sample_rate(0), mapping_cache(NULL)
     //--------------------------------------------------------------------------
     {
       log_mapper.spew("Initializing the default mapper for "
                             "processor " IDFMT "",
                  local_proc.id);
+      const char *mapping_cache_file = NULL;
       // Check to see if there any input arguments to parse
       {
         int argc = HighLevelRuntime::get_input_args().argc;
@@ -97,10 +99,21 @@ namespace Legion {
           BOOL_ARG("-dm:steal", stealing_enabled);
           BOOL_ARG("-dm:bft", breadth_first_traversal);
           INT_ARG("-dm:sched", max_schedule_count);
+          INT_ARG("-dm:cost_sample", cost_sample_rate);
           BOOL_ARG("-dm:memoize", memoize);
           BOOL_ARG("-dm:map_locally", map_locally);
+          BOOL_ARG("-dm:concurrent", concurrent);
+          BOOL_ARG("-dm:bulk", map_in_bulk);
 #undef BOOL_ARG
 #undef INT_ARG
+          if (!strcmp(argv[i], "-dm:mapping_cache")) {
+            if ((i+1) < argc)
+              mapping_cache_file = argv[++i];
+            else
+              log_mapper.warning("Ignoring -dm:mapping_cache flag which "
+                                 "is missing its file name argument");
+            continue;
+          }
         }
       }
       if (stealing_enabled)
@@ -286,12 +299,40 @@ namespace Legion {
       for (int i = 0; i < 3; i++)
         random_number_generator[i] = (unsigned short)((local_proc.id & 
                             (short_mask << (i*short_bits))) >> (i*short_bits));
+      cost_sample_count = 0;
+      if (mapping_cache_file != NULL)
+      {
+        // Decisions are only reusable on the same shape of machine
+        // so hash the number of nodes and the local processors
+        const unsigned long long c1 = 0x5491C27F12DB3FA5;
+        const unsigned long long c2 = 353435097;
+        unsigned long long machine_hash = c1 + c2 * total_nodes;
+        machine_hash = machine_hash * c1 + c2 * local_cpus.size();
+        machine_hash = machine_hash * c1 + c2 * local_gpus.size();
+        machine_hash = machine_hash * c1 + c2 * local_ios.size();
+        machine_hash = machine_hash * c1 + c2 * local_pys.size();
+        machine_hash = machine_hash * c1 + c2 * local_procsets.size();
+        machine_hash = machine_hash * c1 + c2 * local_omps.size();
+        // Each node gets its own file so they don't clobber each other
+        char file_name[4096];
+        if (total_nodes > 1)
+          snprintf(file_name, sizeof(file_name), "%s.%d", 
+                   mapping_cache_file, node_id);
+        else
+          snprintf(file_name, sizeof(file_name), "%s", mapping_cache_file);
+        mapping_cache = Utilities::PersistentMappingCache::acquire(
+                                                    file_name, machine_hash);
+        log_mapper.info("Default mapper on processor " IDFMT " loaded %zd "
+                        "mapping decisions from %s", local_proc.id,
+                        mapping_cache->get_loaded_decisions(), file_name);
+      }
     }
 
     //--------------------------------------------------------------------------
     long DefaultMapper::default_generate_random_integer(void) const
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(random_lock);
       return nrand48(random_number_generator);
     }
     
@@ -299,6 +340,7 @@ namespace Legion {
     double DefaultMapper::default_generate_random_real(void) const
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(random_lock);
       return erand48(random_number_generator);
     }
 
@@ -320,6 +362,10 @@ namespace Legion {
       log_mapper.spew("Deleting default mapper for processor " IDFMT "",
                   local_proc.id);
       free(const_cast<char*>(mapper_name));
+      if ((mapping_cache != NULL) && 
+          !Utilities::PersistentMappingCache::release(mapping_cache))
+        log_mapper.warning("Default mapper failed to save mapping decisions "
+                           "to the mapping cache file");
     }
 
     //--------------------------------------------------------------------------
@@ -343,6 +389,10 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Default mapper operates with the serialized re-entrant sync model
+      // unless it has been asked to run concurrently in which case all
+      // of its caches are protected by their own locks
+      if (concurrent)
+        return CONCURRENT_MAPPER_MODEL;
       return SERIALIZED_REENTRANT_MAPPER_MODEL;
     }
 
@@ -359,6 +409,9 @@ namespace Legion {
       // This is the best choice for the default mapper assuming
       // there is locality in the remote mapped tasks
       output.map_locally = map_locally;
+      // Points of index space launches share most of their mapping
+      // decisions so we can map all the points of each slice together
+      output.map_in_bulk = map_in_bulk && task.is_index_space;
     }
 
     //--------------------------------------------------------------------------
@@ -491,6 +544,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_cpu(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock p_lock(processor_lock);
       Processor result = local_cpus[next_local_cpu++];
       if (next_local_cpu == local_cpus.size())
         next_local_cpu = 0;
@@ -503,6 +557,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_cpu();
+      AutoCacheLock p_lock(processor_lock);
       if (!next_global_cpu.exists())
       {
         global_cpu_query = new Machine::ProcessorQuery(machine);
@@ -523,6 +578,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_gpu(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock p_lock(processor_lock);
       Processor result = local_gpus[next_local_gpu++];
       if (next_local_gpu == local_gpus.size())
         next_local_gpu = 0;
@@ -535,6 +591,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_gpu();
+      AutoCacheLock p_lock(processor_lock);
       if (!next_global_gpu.exists())
       {
         global_gpu_query = new Machine::ProcessorQuery(machine);
@@ -555,6 +612,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_io(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock p_lock(processor_lock);
       Processor result = local_ios[next_local_io++];
       if (next_local_io == local_ios.size())
         next_local_io = 0;
@@ -567,6 +625,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_io();
+      AutoCacheLock p_lock(processor_lock);
       if (!next_global_io.exists())
       {
         global_io_query = new Machine::ProcessorQuery(machine);
@@ -587,6 +646,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_py(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock p_lock(processor_lock);
       Processor result = local_pys[next_local_py++];
       if (next_local_py == local_pys.size())
         next_local_py = 0;
@@ -599,6 +659,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_py();
+      AutoCacheLock p_lock(processor_lock);
       if (!next_global_py.exists())
       {
         global_py_query = new Machine::ProcessorQuery(machine);
@@ -619,6 +680,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_procset(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock p_lock(processor_lock);
       Processor result = local_procsets[next_local_procset++];
       if (next_local_procset == local_procsets.size())
         next_local_procset = 0;
@@ -631,6 +693,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_procset();
+      AutoCacheLock p_lock(processor_lock);
       if (!next_global_procset.exists())
       {
         global_procset_query = new Machine::ProcessorQuery(machine);
@@ -651,6 +714,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_omp(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock p_lock(processor_lock);
       Processor result = local_omps[next_local_omp++];
       if (next_local_omp == local_omps.size())
         next_local_omp = 0;
@@ -663,6 +727,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_omp();
+      AutoCacheLock p_lock(processor_lock);
       if (!next_global_omp.exists())
       {
         global_omp_query = new Machine::ProcessorQuery(machine);
@@ -686,12 +751,26 @@ namespace Legion {
                                      Processor::Kind specific)
     //--------------------------------------------------------------------------
     {
+      // The cost model ranks variants by the measured costs for the size
+      // of this particular task and those keep changing with every sample
+      // so we never cache the choice when it is enabled
+      const bool use_cache = (cost_sample_rate == 0);
       // Do a quick test to see if we have cached the result
-      std::map<TaskID,VariantInfo>::const_iterator finder = 
+      VariantInfo cached;
+      bool has_cached = false;
+      if (use_cache)
+      {
+        AutoCacheLock v_lock(variant_lock, false/*exclusive*/);
+        std::map<TaskID,VariantInfo>::const_iterator finder = 
                                         preferred_variants.find(task.task_id);
-      if (finder != preferred_variants.end() && 
-          (!needs_tight_bound || finder->second.tight_bound))
-        return finder->second;
+        if (finder != preferred_variants.end())
+        {
+          cached = finder->second;
+          has_cached = true;
+        }
+      }
+      if (has_cached && (!needs_tight_bound || cached.tight_bound))
+        return cached;
 
       Machine::ProcessorQuery all_procsets(machine);
       all_procsets.only_kind(Processor::PROC_SET);
@@ -722,8 +801,7 @@ namespace Legion {
         std::string kindString;
         variants.clear();
         Processor::Kind best_kind = Processor::NO_KIND;
-        if (finder == preferred_variants.end() || 
-            (specific != Processor::NO_KIND))
+        if (!has_cached || (specific != Processor::NO_KIND))
         {
           // Do the weak part first and figure out which processor kind
           // we want to focus on first
@@ -810,7 +888,7 @@ namespace Legion {
         {
           // We already know which kind to focus, so just get our 
           // variants for this processor kind
-          best_kind = finder->second.proc_kind;
+          best_kind = cached.proc_kind;
           runtime->find_valid_variants(ctx, task.task_id, 
                                               variants, best_kind);
         }
@@ -895,7 +973,11 @@ namespace Legion {
               }
             }
           }
-          preferred_variants[task.task_id] = result;
+          if (use_cache)
+          {
+            AutoCacheLock v_lock(variant_lock);
+            preferred_variants[task.task_id] = result;
+          }
         }
         return result;
       }
@@ -922,6 +1004,52 @@ namespace Legion {
       ranking.push_back(Processor::LOC_PROC);
       if (local_ios.size() > 0) ranking.push_back(Processor::IO_PROC);
       if (local_pys.size() > 0) ranking.push_back(Processor::PY_PROC);
+      if ((cost_sample_rate == 0) || (ranking.size() < 2))
+        return;
+      // With the cost model, put any kinds we haven't measured enough 
+      // first so that we try them, then order the rest by the cheapest
+      // variant that we measured for tasks of this size
+      const unsigned size_bucket = default_compute_size_bucket(ctx, task);
+      std::vector<Processor::Kind> unmeasured;
+      std::vector<std::pair<double,Processor::Kind> > measured;
+      {
+        AutoCacheLock c_lock(cost_lock, false/*exclusive*/);
+        for (std::vector<Processor::Kind>::const_iterator it = 
+              ranking.begin(); it != ranking.end(); it++)
+        {
+          bool found = false;
+          double best_cost = 0.0;
+          for (std::map<CostKey,CostEstimate>::const_iterator cit = 
+                cost_estimates.lower_bound(
+                  CostKey(task.task_id, *it, size_bucket, 0)); cit !=
+                cost_estimates.end(); cit++)
+          {
+            if ((cit->first.task_id != task.task_id) ||
+                (cit->first.kind != *it) ||
+                (cit->first.size_bucket != size_bucket))
+              break;
+            if (cit->second.samples < COST_MODEL_MIN_SAMPLES)
+            {
+              found = false;
+              break;
+            }
+            if (!found || (cit->second.average < best_cost))
+            {
+              best_cost = cit->second.average;
+              found = true;
+            }
+          }
+          if (found)
+            measured.push_back(std::pair<double,Processor::Kind>(best_cost,*it));
+          else
+            unmeasured.push_back(*it);
+        }
+      }
+      std::stable_sort(measured.begin(), measured.end());
+      ranking = unmeasured;
+      for (std::vector<std::pair<double,Processor::Kind> >::const_iterator 
+            it = measured.begin(); it != measured.end(); it++)
+        ranking.push_back(it->second);
     }
 
     //--------------------------------------------------------------------------
@@ -935,6 +1063,22 @@ namespace Legion {
                                       const TaskLayoutConstraintSet &layout2)
     //--------------------------------------------------------------------------
     {
+      if (cost_sample_rate > 0)
+      {
+        // Try any variant we haven't measured enough first, 
+        // otherwise pick the one that has been faster so far
+        const unsigned size_bucket = default_compute_size_bucket(ctx, task);
+        CostEstimate cost1, cost2;
+        default_find_cost_estimate(
+            CostKey(task.task_id, kind, size_bucket, vid1), cost1);
+        default_find_cost_estimate(
+            CostKey(task.task_id, kind, size_bucket, vid2), cost2);
+        if (cost1.samples < COST_MODEL_MIN_SAMPLES)
+          return vid1;
+        if (cost2.samples < COST_MODEL_MIN_SAMPLES)
+          return vid2;
+        return (cost2.average < cost1.average) ? vid2 : vid1;
+      }
       // TODO: better algorithm for picking the best variants on this machine
       // For now we do something really stupid, chose the larger variant
       // ID because if it was registered later is likely more specialized :)
@@ -1203,11 +1347,14 @@ namespace Legion {
         if(exset.processor_constraint.can_use(Processor::PROC_SET)) {
 
            // Before we do anything else, see if it is in the cache
-           std::map<Domain,std::vector<TaskSlice> >::const_iterator finder =
-             procset_slices_cache.find(input.domain);
-           if (finder != procset_slices_cache.end()) {
-                   output.slices = finder->second;
-                   return;
+           {
+             AutoCacheLock s_lock(slices_lock, false/*exclusive*/);
+             std::map<Domain,std::vector<TaskSlice> >::const_iterator finder =
+               procset_slices_cache.find(input.domain);
+             if (finder != procset_slices_cache.end()) {
+                     output.slices = finder->second;
+                     return;
+             }
            }
 
           output.slices.resize(input.domain.get_volume());
@@ -1222,6 +1369,7 @@ namespace Legion {
           }
 
           // Save the result in the cache
+          AutoCacheLock s_lock(slices_lock);
           procset_slices_cache[input.domain] = output.slices;
           return;
         }
@@ -1285,21 +1433,27 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Before we do anything else, see if it is in the cache
-      std::map<Domain,std::vector<TaskSlice> >::const_iterator finder = 
-        cached_slices.find(input.domain);
-      if (finder != cached_slices.end()) {
-        output.slices = finder->second;
-        return;
+      {
+        AutoCacheLock s_lock(slices_lock, false/*exclusive*/);
+        std::map<Domain,std::vector<TaskSlice> >::const_iterator finder = 
+          cached_slices.find(input.domain);
+        if (finder != cached_slices.end()) {
+          output.slices = finder->second;
+          return;
+        }
       }
 
 #if 1
-      // The two-level decomposition doesn't work so for now do a
-      // simple one-level decomposition across all the processors.
+      // The two-level decomposition with recursive slicing doesn't work
+      // so instead we do the whole hierarchical decomposition here, first
+      // across nodes, then NUMA domains, and then processors.
       Machine::ProcessorQuery all_procs(machine);
       all_procs.only_kind(local[0].kind());
       if ((task.tag & SAME_ADDRESS_SPACE) != 0)
 	all_procs.local_address_space();
       std::vector<Processor> procs(all_procs.begin(), all_procs.end());
+      std::vector<std::vector<std::vector<Processor> > > hierarchy;
+      default_group_processors(procs, hierarchy);
 
       switch (input.domain.get_dim())
       {
@@ -1307,9 +1461,7 @@ namespace Legion {
         case DIM: \
           { \
             DomainT<DIM,coord_t> point_space = input.domain; \
-            Point<DIM,coord_t> num_blocks(procs.size()); \
-            default_decompose_points<DIM>(point_space, procs, \
-                  num_blocks, false/*recurse*/, \
+            default_decompose_hierarchically<DIM>(point_space, hierarchy, \
                   stealing_enabled, output.slices); \
             break; \
           }
@@ -1409,6 +1561,7 @@ namespace Legion {
 #endif
 
       // Save the result in the cache
+      AutoCacheLock s_lock(slices_lock);
       cached_slices[input.domain] = output.slices;
     }
 
@@ -1421,10 +1574,86 @@ namespace Legion {
     {
       log_mapper.spew("Default map_task in %s", get_mapper_name());
       Processor::Kind target_kind = task.target_proc.kind();
-      // Get the variant that we are going to use to map this task
-      VariantInfo chosen = default_find_preferred_variant(task, ctx,
+      // Get the variant that we are going to use to map this task, if a
+      // previous run already picked one for us we can skip the policy
+      VariantInfo chosen;
+      std::vector<Memory> target_memories;
+      const bool persistent_hit = (mapping_cache != NULL) &&
+        default_find_persistent_decision(ctx, task, target_kind, 
+                                         chosen, target_memories);
+      if (!persistent_hit)
+      {
+        chosen = default_find_preferred_variant(task, ctx,
+                        true/*needs tight bound*/, true/*cache*/, target_kind);
+        target_memories.resize(task.regions.size(), Memory::NO_MEMORY);
+      }
+      if (default_map_task_instances(ctx, task, input, output, 
+                                     chosen, target_memories) &&
+          (mapping_cache != NULL) && !persistent_hit)
+        default_record_persistent_decision(task, target_kind, 
+                                           chosen, target_memories);
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::map_tasks(const MapperContext                ctx,
+                                  const std::vector<const Task*>&    tasks,
+                                  const std::vector<MapTaskInput>&   inputs,
+                                        std::vector<MapTaskOutput>&  outputs)
+    //--------------------------------------------------------------------------
+    {
+      log_mapper.spew("Default map_tasks in %s", get_mapper_name());
+      if (tasks.empty())
+        return;
+      // All the points come from the same slice so they share their task
+      // ID, target processor and region requirement signatures. Make the
+      // variant and memory decisions once and then only do the instance
+      // work for each of the points.
+      const Task &first = *tasks[0];
+      const Processor::Kind target_kind = first.target_proc.kind();
+      VariantInfo chosen;
+      std::vector<Memory> target_memories;
+      const bool persistent_hit = (mapping_cache != NULL) &&
+        default_find_persistent_decision(ctx, first, target_kind, 
+                                         chosen, target_memories);
+      if (!persistent_hit)
+      {
+        chosen = default_find_preferred_variant(first, ctx,
                         true/*needs tight bound*/, true/*cache*/, target_kind);
+        target_memories.resize(first.regions.size(), Memory::NO_MEMORY);
+      }
+      bool needs_record = (mapping_cache != NULL) && !persistent_hit;
+      for (unsigned idx = 0; idx < tasks.size(); idx++)
+      {
+        const Task &task = *tasks[idx];
+        // Anything not headed to the same processor gets mapped on its own
+        if (task.target_proc != first.target_proc)
+        {
+          map_task(ctx, task, inputs[idx], outputs[idx]);
+          continue;
+        }
+        if (default_map_task_instances(ctx, task, inputs[idx], outputs[idx],
+                                       chosen, target_memories) && 
+            needs_record)
+        {
+          default_record_persistent_decision(task, target_kind,
+                                             chosen, target_memories);
+          needs_record = false;
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool DefaultMapper::default_map_task_instances(const MapperContext ctx,
+                                    const Task &task, 
+                                    const MapTaskInput &input,
+                                    MapTaskOutput &output,
+                                    const VariantInfo &chosen,
+                                    std::vector<Memory> &target_memories)
+    //--------------------------------------------------------------------------
+    {
       output.chosen_variant = chosen.variant;
+      if (cost_sample_rate > 0)
+        default_request_cost_sample(ctx, task, chosen.variant, output);
       output.task_priority = default_policy_select_task_priority(ctx, task);
       output.postmap_task = false;
       // Figure out our target processors
@@ -1469,9 +1698,10 @@ namespace Legion {
                   reduction_indexes.begin(); it != 
                   reduction_indexes.end(); it++)
             {
-              Memory target_memory = default_policy_select_target_memory(ctx,
-                                                         task.target_proc,
-                                                         task.regions[*it]);
+              if (!target_memories[*it].exists())
+                target_memories[*it] = default_policy_select_target_memory(
+                                  ctx, task.target_proc, task.regions[*it]);
+              const Memory target_memory = target_memories[*it];
               std::set<FieldID> copy = task.regions[*it].privilege_fields;
               size_t footprint;
               if (!default_create_custom_instances(ctx, task.target_proc,
@@ -1484,7 +1714,7 @@ namespace Legion {
               }
             }
           }
-          return;
+          return true;
         }
       }
       // Should we cache this task?
@@ -1494,30 +1724,38 @@ namespace Legion {
       // First, let's see if we've cached a result of this task mapping
       const unsigned long long task_hash = compute_task_hash(task);
       std::pair<TaskID,Processor> cache_key(task.task_id, task.target_proc);
-      std::map<std::pair<TaskID,Processor>,
-               std::list<CachedTaskMapping> >::const_iterator 
-        finder = cached_task_mappings.find(cache_key);
+      CachedMappingShard &shard = find_mapping_shard(cache_key);
       // This flag says whether we need to recheck the field constraints,
       // possibly because a new field was allocated in a region, so our old
       // cached physical instance(s) is(are) no longer valid
       bool needs_field_constraint_check = false;
-      if (cache_policy == DEFAULT_CACHE_POLICY_ENABLE && finder != cached_task_mappings.end())
+      if (cache_policy == DEFAULT_CACHE_POLICY_ENABLE)
       {
         bool found = false;
         bool has_reductions = false;
-        // Iterate through and see if we can find one with our variant and hash
-        for (std::list<CachedTaskMapping>::const_iterator it = 
-              finder->second.begin(); it != finder->second.end(); it++)
         {
-          if ((it->variant == output.chosen_variant) &&
-              (it->task_hash == task_hash))
+          AutoCacheLock m_lock(shard.lock, false/*exclusive*/);
+          std::map<std::pair<TaskID,Processor>,
+                   std::list<CachedTaskMapping> >::const_iterator 
+            finder = shard.mappings.find(cache_key);
+          // Iterate through and see if we can find one with our 
+          // variant and hash
+          if (finder != shard.mappings.end())
           {
-            // Have to copy it before we do the external call which 
-            // might invalidate our iterator
-            output.chosen_instances = it->mapping;
-            has_reductions = it->has_reductions;
-            found = true;
-            break;
+            for (std::list<CachedTaskMapping>::const_iterator it = 
+                  finder->second.begin(); it != finder->second.end(); it++)
+            {
+              if ((it->variant == output.chosen_variant) &&
+                  (it->task_hash == task_hash))
+              {
+                // Have to copy it before we do the external call which 
+                // might invalidate our iterator
+                output.chosen_instances = it->mapping;
+                has_reductions = it->has_reductions;
+                found = true;
+                break;
+              }
+            }
           }
         }
         if (found)
@@ -1552,7 +1790,7 @@ namespace Legion {
           // See if we can acquire these instances still
           if (runtime->acquire_and_filter_instances(ctx, 
                                                      output.chosen_instances))
-            return;
+            return false;
           // We need to check the constraints here because we had a
           // prior mapping and it failed, which may be the result
           // of a change in the allocated fields of a field space
@@ -1594,9 +1832,11 @@ namespace Legion {
             missing_fields[idx].empty())
           continue;
         // See if this is a reduction      
-        Memory target_memory = default_policy_select_target_memory(ctx,
+        if (!target_memories[idx].exists())
+          target_memories[idx] = default_policy_select_target_memory(ctx,
                                                          task.target_proc,
                                                          task.regions[idx]);
+        const Memory target_memory = target_memories[idx];
         if (task.regions[idx].privilege == REDUCE)
         {
           has_reductions = true;
@@ -1659,7 +1899,8 @@ namespace Legion {
       }
       if (cache_policy == DEFAULT_CACHE_POLICY_ENABLE) {
         // Now that we are done, let's cache the result so we can use it later
-        std::list<CachedTaskMapping> &map_list = cached_task_mappings[cache_key];
+        AutoCacheLock m_lock(shard.lock);
+        std::list<CachedTaskMapping> &map_list = shard.mappings[cache_key];
         map_list.push_back(CachedTaskMapping());
         CachedTaskMapping &cached_result = map_list.back();
         cached_result.task_hash = task_hash;
@@ -1675,6 +1916,7 @@ namespace Legion {
           }
         }
       }
+      return true;
     }
 
     //--------------------------------------------------------------------------
@@ -1783,15 +2025,18 @@ namespace Legion {
         const std::vector<std::vector<PhysicalInstance> > &post_filter)
     //--------------------------------------------------------------------------
     {
-      std::map<std::pair<TaskID,Processor>,
-               std::list<CachedTaskMapping> >::iterator
-                 finder = cached_task_mappings.find(cache_key);
-      if (finder != cached_task_mappings.end())
+      // Keep a list of instances for which we need to downgrade
+      // their garbage collection priorities since we are no
+      // longer caching the results
+      std::deque<PhysicalInstance> to_downgrade;
+      CachedMappingShard &shard = find_mapping_shard(cache_key);
       {
-        // Keep a list of instances for which we need to downgrade
-        // their garbage collection priorities since we are no
-        // longer caching the results
-        std::deque<PhysicalInstance> to_downgrade;
+        AutoCacheLock m_lock(shard.lock);
+        std::map<std::pair<TaskID,Processor>,
+                 std::list<CachedTaskMapping> >::iterator
+                   finder = shard.mappings.find(cache_key);
+        if (finder == shard.mappings.end())
+          return;
         for (std::list<CachedTaskMapping>::iterator it = 
               finder->second.begin(); it != finder->second.end(); it++)
         {
@@ -1839,17 +2084,16 @@ namespace Legion {
           }
         }
         if (finder->second.empty())
-          cached_task_mappings.erase(finder);
-        if (!to_downgrade.empty())
-        {
-          for (std::deque<PhysicalInstance>::const_iterator it =
-                to_downgrade.begin(); it != to_downgrade.end(); it++)
-          {
-            if (it->is_external_instance())
-              continue;
-            runtime->set_garbage_collection_priority(ctx, *it, 0/*priority*/);
-          }
-        }
+          shard.mappings.erase(finder);
+      }
+      // Do the downgrades after releasing the lock since these
+      // calls can pre-empt this mapper call
+      for (std::deque<PhysicalInstance>::const_iterator it =
+            to_downgrade.begin(); it != to_downgrade.end(); it++)
+      {
+        if (it->is_external_instance())
+          continue;
+        runtime->set_garbage_collection_priority(ctx, *it, 0/*priority*/);
       }
     }
 
@@ -2029,14 +2273,17 @@ namespace Legion {
 
       // TODO: deal with the updates in machine model which will
       //       invalidate this cache
-      std::map<Processor,Memory>::iterator it;
-      if (prefer_rdma)
       {
-	it = cached_rdma_target_memory.find(target_proc);
-	if (it != cached_rdma_target_memory.end()) return it->second;
-      } else {
-        it = cached_target_memory.find(target_proc);
-	if (it != cached_target_memory.end()) return it->second;
+        AutoCacheLock m_lock(memory_lock, false/*exclusive*/);
+        std::map<Processor,Memory>::const_iterator it;
+        if (prefer_rdma)
+        {
+	  it = cached_rdma_target_memory.find(target_proc);
+	  if (it != cached_rdma_target_memory.end()) return it->second;
+        } else {
+          it = cached_target_memory.find(target_proc);
+	  if (it != cached_target_memory.end()) return it->second;
+        }
       }
 
       // Find the visible memories from the processor for the given kind
@@ -2073,6 +2320,7 @@ namespace Legion {
         }
       }
       assert(best_memory.exists());
+      AutoCacheLock m_lock(memory_lock);
       if (prefer_rdma)
       {
 	if (!best_rdma_memory.exists()) best_rdma_memory = best_memory;
@@ -2101,18 +2349,22 @@ namespace Legion {
         force_new_instances = true;
         std::pair<Memory::Kind,ReductionOpID> constraint_key(
             target_memory.kind(), req.redop);
-        std::map<std::pair<Memory::Kind,ReductionOpID>,LayoutConstraintID>::
-          const_iterator finder = reduction_constraint_cache.find(
+        {
+          AutoCacheLock c_lock(constraint_lock, false/*exclusive*/);
+          std::map<std::pair<Memory::Kind,ReductionOpID>,LayoutConstraintID>::
+            const_iterator finder = reduction_constraint_cache.find(
                                                             constraint_key);
-        // No need to worry about field constraint checks here
-        // since we don't actually have any field constraints
-        if (finder != reduction_constraint_cache.end())
-          return finder->second;
+          // No need to worry about field constraint checks here
+          // since we don't actually have any field constraints
+          if (finder != reduction_constraint_cache.end())
+            return finder->second;
+        }
         LayoutConstraintSet constraints;
         default_policy_select_constraints(ctx, constraints, target_memory, req);
         LayoutConstraintID result = 
           runtime->register_layout(ctx, constraints);
         // Save the result
+        AutoCacheLock c_lock(constraint_lock);
         reduction_constraint_cache[constraint_key] = result;
         return result;
       }
@@ -2123,17 +2375,27 @@ namespace Legion {
       // See if we've already made a constraint set for this layout
       std::pair<Memory::Kind,FieldSpace> constraint_key(target_memory.kind(),
                                                req.region.get_field_space());
-      std::map<std::pair<Memory::Kind,FieldSpace>,LayoutConstraintID>::
-        const_iterator finder = layout_constraint_cache.find(constraint_key);
-      if (finder != layout_constraint_cache.end())
+      LayoutConstraintID cached = 0;
+      bool has_cached = false;
+      {
+        AutoCacheLock c_lock(constraint_lock, false/*exclusive*/);
+        std::map<std::pair<Memory::Kind,FieldSpace>,LayoutConstraintID>::
+          const_iterator finder = layout_constraint_cache.find(constraint_key);
+        if (finder != layout_constraint_cache.end())
+        {
+          cached = finder->second;
+          has_cached = true;
+        }
+      }
+      if (has_cached)
       {
         // If we don't need a constraint check we are already good
         if (!needs_field_constraint_check)
-          return finder->second;
+          return cached;
         // Check that the fields still are the same, if not, fall through
         // so that we make a new set of constraints
         const LayoutConstraintSet &old_constraints =
-                runtime->find_layout_constraints(ctx, finder->second);
+                runtime->find_layout_constraints(ctx, cached);
         // Should be only one unless things have changed
         const std::vector<FieldID> &old_set = 
                           old_constraints.field_constraint.get_field_set();
@@ -2154,7 +2416,7 @@ namespace Legion {
             }
           }
           if (still_equal)
-            return finder->second;
+            return cached;
         }
         // Otherwise we fall through and make a new constraint which
         // will also update the cache
@@ -2169,6 +2431,7 @@ namespace Legion {
       // call could have registered the exact same registration constraints
       // here if we were preempted during the registration call. The 
       // constraint sets are identical though so it's all good.
+      AutoCacheLock c_lock(constraint_lock);
       layout_constraint_cache[constraint_key] = result;
       return result; 
     }
@@ -2564,8 +2827,36 @@ namespace Legion {
     {
       log_mapper.spew("Default report_profiling for Task in %s", 
                       get_mapper_name());
-      // We don't ask for any task profiling right now so assert if we see this
-      assert(false);
+      // We only ask for task profiling for the cost model
+      assert(cost_sample_rate > 0);
+      CostKey key;
+      {
+        AutoCacheLock c_lock(cost_lock);
+        std::map<UniqueID,CostKey>::iterator finder = 
+          pending_cost_samples.find(task.get_unique_id());
+        if (finder == pending_cost_samples.end())
+          return;
+        key = finder->second;
+        pending_cost_samples.erase(finder);
+      }
+      ProfilingMeasurements::OperationTimeline timeline;
+      if (!input.profiling_responses.get_measurement(timeline) ||
+          (timeline.start_time == 
+           ProfilingMeasurements::OperationTimeline::INVALID_TIMESTAMP) ||
+          (timeline.end_time == 
+           ProfilingMeasurements::OperationTimeline::INVALID_TIMESTAMP))
+        return;
+      const double cost = timeline.end_time - timeline.start_time;
+      {
+        AutoCacheLock c_lock(cost_lock);
+        CostEstimate &estimate = cost_estimates[key];
+        estimate.samples++;
+        // A plain average until we have enough history and then 
+        // an exponential one so we can follow changes in behavior
+        const unsigned weight = (estimate.samples < COST_MODEL_HISTORY) ?
+          estimate.samples : COST_MODEL_HISTORY;
+        estimate.average += (cost - estimate.average) / weight;
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -3261,6 +3552,184 @@ namespace Legion {
       return false; 
     }
 
+    //--------------------------------------------------------------------------
+    unsigned DefaultMapper::default_compute_size_bucket(MapperContext ctx,
+                                                        const Task &task)
+    //--------------------------------------------------------------------------
+    {
+      // Sum up the number of points in all the region requirements, for
+      // projection requirements estimate the size of one subregion
+      size_t total_points = 0;
+      for (unsigned idx = 0; idx < task.regions.size(); idx++)
+      {
+        const RegionRequirement &req = task.regions[idx];
+        if (req.region.exists())
+          total_points += runtime->get_index_space_domain(ctx,
+              req.region.get_index_space()).get_volume();
+        else if (req.partition.exists())
+        {
+          const IndexPartition ip = req.partition.get_index_partition();
+          const size_t colors = 
+            runtime->get_index_partition_color_space(ctx, ip).get_volume();
+          if (colors > 0)
+            total_points += runtime->get_index_space_domain(ctx,
+              runtime->get_parent_index_space(ctx, ip)).get_volume() / colors;
+        }
+      }
+      unsigned bucket = 0;
+      while (total_points > 1)
+      {
+        total_points >>= 1;
+        bucket++;
+      }
+      return bucket;
+    }
+
+    //--------------------------------------------------------------------------
+    bool DefaultMapper::default_find_cost_estimate(const CostKey &key,
+                                                   CostEstimate &estimate) const
+    //--------------------------------------------------------------------------
+    {
+      AutoCacheLock c_lock(cost_lock, false/*exclusive*/);
+      std::map<CostKey,CostEstimate>::const_iterator finder = 
+        cost_estimates.find(key);
+      if (finder == cost_estimates.end())
+        return false;
+      estimate = finder->second;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_request_cost_sample(MapperContext ctx,
+                                                    const Task &task,
+                                                    VariantID variant,
+                                                    MapTaskOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      const CostKey key(task.task_id, task.target_proc.kind(),
+                        default_compute_size_bucket(ctx, task), variant);
+      // Always measure variants we don't know enough about yet, 
+      // otherwise only sample every so often to track changes
+      CostEstimate estimate;
+      default_find_cost_estimate(key, estimate);
+      if ((estimate.samples >= COST_MODEL_MIN_SAMPLES) &&
+          ((__sync_fetch_and_add(&cost_sample_count, 1) % 
+            cost_sample_rate) != 0))
+        return;
+      output.task_prof_requests.add_measurement<
+                          ProfilingMeasurements::OperationTimeline>();
+      AutoCacheLock c_lock(cost_lock);
+      pending_cost_samples[task.get_unique_id()] = key;
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_group_processors(
+                         const std::vector<Processor> &procs,
+                         std::vector<std::vector<std::vector<Processor> > > &hier)
+                                                                          const
+    //--------------------------------------------------------------------------
+    {
+      // Processors belong to the same NUMA domain if the socket memory
+      // with the highest bandwidth to them is the same, machines without
+      // socket memories just have one domain per node
+      std::map<AddressSpace,std::map<Memory,std::vector<Processor> > > groups;
+      std::vector<Machine::ProcessorMemoryAffinity> affinity(1);
+      for (std::vector<Processor>::const_iterator it = 
+            procs.begin(); it != procs.end(); it++)
+      {
+        Memory numa_memory = Memory::NO_MEMORY;
+        unsigned best_bandwidth = 0;
+        Machine::MemoryQuery socket_memories(machine);
+        socket_memories.only_kind(Memory::SOCKET_MEM);
+        socket_memories.has_affinity_to(*it);
+        for (Machine::MemoryQuery::iterator mit = socket_memories.begin();
+              mit != socket_memories.end(); mit++)
+        {
+          affinity.clear();
+          machine.get_proc_mem_affinity(affinity, *it, *mit);
+          if (affinity.empty())
+            continue;
+          if (!numa_memory.exists() || 
+              (affinity[0].bandwidth > best_bandwidth))
+          {
+            numa_memory = *mit;
+            best_bandwidth = affinity[0].bandwidth;
+          }
+        }
+        groups[it->address_space()][numa_memory].push_back(*it);
+      }
+      hier.clear();
+      hier.reserve(groups.size());
+      for (std::map<AddressSpace,std::map<Memory,std::vector<Processor> > >::
+            const_iterator nit = groups.begin(); nit != groups.end(); nit++)
+      {
+        hier.resize(hier.size() + 1);
+        for (std::map<Memory,std::vector<Processor> >::const_iterator dit =
+              nit->second.begin(); dit != nit->second.end(); dit++)
+          hier.back().push_back(dit->second);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool DefaultMapper::default_find_persistent_decision(MapperContext ctx,
+                                      const Task &task, Processor::Kind kind,
+                                      VariantInfo &chosen,
+                                      std::vector<Memory> &target_memories)
+    //--------------------------------------------------------------------------
+    {
+      Utilities::PersistentMappingCache::Decision decision;
+      if (!mapping_cache->find_decision(
+            Utilities::PersistentMappingCache::compute_key(task, kind), 
+            decision))
+        return false;
+      if (decision.memory_kinds.size() != task.regions.size())
+        return false;
+      // Make sure the variant still exists in this run
+      std::vector<VariantID> variants;
+      runtime->find_valid_variants(ctx, task.task_id, variants, kind);
+      if (std::find(variants.begin(), variants.end(), decision.variant) ==
+          variants.end())
+        return false;
+      chosen.variant = decision.variant;
+      chosen.proc_kind = kind;
+      chosen.tight_bound = decision.tight_bound;
+      chosen.is_inner = decision.is_inner;
+      // Turn the memory kinds back into memories visible to the target
+      // processor, anything we can't find is left to the normal policy
+      target_memories.resize(task.regions.size(), Memory::NO_MEMORY);
+      for (unsigned idx = 0; idx < task.regions.size(); idx++)
+      {
+        if (decision.memory_kinds[idx] == 
+            Utilities::PersistentMappingCache::NO_MEMORY_KIND)
+          continue;
+        Machine::MemoryQuery visible_memories(machine);
+        visible_memories.has_affinity_to(task.target_proc);
+        visible_memories.only_kind(
+            static_cast<Memory::Kind>(decision.memory_kinds[idx]));
+        target_memories[idx] = visible_memories.first();
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_record_persistent_decision(const Task &task,
+                              Processor::Kind kind, const VariantInfo &chosen,
+                              const std::vector<Memory> &target_memories)
+    //--------------------------------------------------------------------------
+    {
+      Utilities::PersistentMappingCache::Decision decision;
+      decision.variant = chosen.variant;
+      decision.tight_bound = chosen.tight_bound;
+      decision.is_inner = chosen.is_inner;
+      decision.memory_kinds.resize(target_memories.size(),
+                          Utilities::PersistentMappingCache::NO_MEMORY_KIND);
+      for (unsigned idx = 0; idx < target_memories.size(); idx++)
+        if (target_memories[idx].exists())
+          decision.memory_kinds[idx] = target_memories[idx].kind();
+      mapping_cache->record_decision(
+          Utilities::PersistentMappingCache::compute_key(task, kind), decision);
+    }
+
     //--------------------------------------------------------------------------
     bool DefaultMapper::default_policy_select_must_epoch_processors(
                               MapperContext ctx,
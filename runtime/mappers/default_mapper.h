@@ -107,6 +107,83 @@ namespace Legion {
         std::vector<std::vector<PhysicalInstance> > mapping;
         bool                                        has_reductions;
       };
+      /**
+       * \class CacheLock
+       * A reader-writer lock protecting one of the caches of the
+       * default mapper so that it can run with the concurrent mapper
+       * model. These locks must never be held across a call into 
+       * the mapper runtime since that can pre-empt the mapper call.
+       */
+      class CacheLock {
+      public:
+        inline void lock(bool exclusive = true)
+        {
+          Realm::Event wait_on = exclusive ? 
+            reservation.wrlock() : reservation.rdlock();
+          while (wait_on.exists())
+          {
+            wait_on.wait();
+            wait_on = exclusive ? reservation.wrlock() : reservation.rdlock();
+          }
+        }
+        inline void unlock(void) { reservation.unlock(); }
+      protected:
+        Realm::FastReservation reservation;
+      };
+      class AutoCacheLock {
+      public:
+        AutoCacheLock(CacheLock &l, bool exclusive = true)
+          : cache_lock(l) { cache_lock.lock(exclusive); }
+        ~AutoCacheLock(void) { cache_lock.unlock(); }
+      private:
+        AutoCacheLock(const AutoCacheLock &rhs);
+        AutoCacheLock& operator=(const AutoCacheLock &rhs);
+      protected:
+        CacheLock &cache_lock;
+      };
+      // Cached task mappings are sharded by task ID and target processor 
+      // so concurrent map_task calls rarely contend for the same lock
+      struct CachedMappingShard {
+      public:
+        CacheLock lock;
+        std::map<std::pair<TaskID,Processor>,
+                 std::list<CachedTaskMapping> > mappings;
+      };
+      static const unsigned CACHED_MAPPING_SHARDS = 16;
+      // Measured execution times of tasks for the cost model, the
+      // size bucket is the log2 of the number of points the task touches
+      struct CostKey {
+      public:
+        CostKey(void) 
+          : task_id(0), kind(Processor::NO_KIND), size_bucket(0), variant(0) { }
+        CostKey(TaskID t, Processor::Kind k, unsigned s, VariantID v)
+          : task_id(t), kind(k), size_bucket(s), variant(v) { }
+      public:
+        inline bool operator<(const CostKey &rhs) const
+        {
+          if (task_id != rhs.task_id) return (task_id < rhs.task_id);
+          if (kind != rhs.kind) return (kind < rhs.kind);
+          if (size_bucket != rhs.size_bucket) 
+            return (size_bucket < rhs.size_bucket);
+          return (variant < rhs.variant);
+        }
+      public:
+        TaskID task_id;
+        Processor::Kind kind;
+        unsigned size_bucket;
+        VariantID variant;
+      };
+      struct CostEstimate {
+      public:
+        CostEstimate(void) : samples(0), average(0.0) { }
+      public:
+        unsigned samples;
+        double average; // nanoseconds
+      };
+      // Samples needed before we trust an estimate
+      static const unsigned COST_MODEL_MIN_SAMPLES = 4;
+      // Older samples decay with this weight once we have enough of them
+      static const unsigned COST_MODEL_HISTORY = 16;
       struct MapperMsgHdr {
       public:
         MapperMsgHdr(void) : magic(0xABCD), type(INVALID_MESSAGE) { }
@@ -149,6 +226,10 @@ namespace Legion {
                             const Task&              task,
                             const MapTaskInput&      input,
                                   MapTaskOutput&     output);
+      virtual void map_tasks(const MapperContext                ctx,
+                             const std::vector<const Task*>&    tasks,
+                             const std::vector<MapTaskInput>&   inputs,
+                                   std::vector<MapTaskOutput>&  outputs);
       virtual void select_task_variant(const MapperContext          ctx,
                                        const Task&                  task,
                                        const SelectVariantInput&    input,
@@ -449,10 +530,37 @@ namespace Legion {
       void default_create_copy_instance(MapperContext ctx, const Copy &copy,
                               const RegionRequirement &req, unsigned index,
                               std::vector<PhysicalInstance> &instances);
+      void default_group_processors(const std::vector<Processor> &procs,
+                              std::vector<std::vector<
+                                std::vector<Processor> > > &hierarchy) const;
+      unsigned default_compute_size_bucket(MapperContext ctx, 
+                                           const Task &task);
+      bool default_find_cost_estimate(const CostKey &key,
+                                      CostEstimate &estimate) const;
+      void default_request_cost_sample(MapperContext ctx, const Task &task,
+                                       VariantID variant, 
+                                       MapTaskOutput &output);
       LogicalRegion default_find_common_ancestor(MapperContext ctx,
                                       const std::set<LogicalRegion> &regions);
       bool have_proc_kind_variant(const MapperContext ctx, TaskID id,
 				  Processor::Kind kind);
+      // Returns true if it selected the target memories itself rather
+      // than reusing a cached mapping
+      bool default_map_task_instances(MapperContext ctx, const Task &task,
+                              const MapTaskInput &input, MapTaskOutput &output,
+                              const VariantInfo &chosen,
+                              std::vector<Memory> &target_memories);
+      bool default_find_persistent_decision(MapperContext ctx,
+                              const Task &task, Processor::Kind kind,
+                              VariantInfo &chosen,
+                              std::vector<Memory> &target_memories);
+      void default_record_persistent_decision(const Task &task,
+                              Processor::Kind kind, const VariantInfo &chosen,
+                              const std::vector<Memory> &target_memories);
+      inline CachedMappingShard& find_mapping_shard(
+                                 const std::pair<TaskID,Processor> &key)
+        { return cached_task_mappings[(key.first ^ key.second.id) %
+                                      CACHED_MAPPING_SHARDS]; }
     protected: // static helper methods
       static const char* create_default_name(Processor p);
       template<int DIM>
@@ -474,6 +582,16 @@ namespace Legion {
       static Point<DIM,coord_t> default_select_num_blocks(
                             long long int factor, 
                             const Rect<DIM,coord_t> &rect_to_factor);
+      template<int DIM>
+      static void default_decompose_hierarchically(
+                            const DomainT<DIM,coord_t> &point_space,
+                            const std::vector<std::vector<
+                              std::vector<Processor> > > &hierarchy,
+                            bool stealable, std::vector<TaskSlice> &slices);
+      template<int DIM>
+      static void default_split_rect(const Rect<DIM,coord_t> &rect,
+                            size_t num_pieces,
+                            std::vector<Rect<DIM,coord_t> > &pieces);
       static unsigned long long compute_task_hash(const Task &task);
       static inline bool physical_sort_func(
                          const std::pair<PhysicalInstance,unsigned> &left,
@@ -486,6 +604,7 @@ namespace Legion {
       const Machine         machine;
       const char *const     mapper_name;
     protected:
+      mutable CacheLock random_lock;
       mutable unsigned short random_number_generator[3];
     protected: 
       // Make these data structures mutable anticipating when the machine
@@ -507,6 +626,7 @@ namespace Legion {
       std::vector<Processor> remote_pys;
     protected:
       // For doing round-robining of tasks onto processors
+      CacheLock processor_lock;
       unsigned next_local_gpu, next_local_cpu, next_local_io,
                next_local_procset, next_local_omp, next_local_py;
       Processor next_global_gpu, next_global_cpu, next_global_io,
@@ -516,21 +636,28 @@ namespace Legion {
                               *global_omp_query, *global_py_query;
     protected: 
       // Cached mapping information about the application
+      mutable CacheLock                        slices_lock;
       std::map<Domain,std::vector<TaskSlice> > gpu_slices_cache,
                                                cpu_slices_cache,
                                                io_slices_cache,
                                                procset_slices_cache,
                                                omp_slices_cache,
                                                py_slices_cache;
+      CacheLock                                variant_lock;
       std::map<TaskID,VariantInfo>             preferred_variants; 
-      std::map<std::pair<TaskID,Processor>,
-               std::list<CachedTaskMapping> >  cached_task_mappings;
+      CachedMappingShard      cached_task_mappings[CACHED_MAPPING_SHARDS];
+      CacheLock                                constraint_lock;
       std::map<std::pair<Memory::Kind,FieldSpace>,
                LayoutConstraintID>             layout_constraint_cache;
       std::map<std::pair<Memory::Kind,ReductionOpID>,
                LayoutConstraintID>             reduction_constraint_cache;
+      CacheLock                                memory_lock;
       std::map<Processor,Memory>               cached_target_memory,
 	                                       cached_rdma_target_memory;
+      mutable CacheLock                        cost_lock;
+      std::map<CostKey,CostEstimate>           cost_estimates;
+      std::map<UniqueID,CostKey>               pending_cost_samples;
+      unsigned                                 cost_sample_count;
     protected:
       // The maximum number of tasks a mapper will allow to be stolen at a time
       // Controlled by -dm:thefts
@@ -551,6 +678,25 @@ namespace Legion {
       // Whether to map tasks locally
       // Controlled by -dm:map_locally (false by default)
       bool map_locally;
+      // Whether to run with the concurrent mapper model so that many
+      // mapper calls can be performed at once for the same processor.
+      // Mappers derived from the default mapper need to protect any
+      // state of their own before turning this on.
+      // Controlled by -dm:concurrent (false by default)
+      bool concurrent;
+      // Whether to map all the points of each slice of an index space
+      // launch with a single map_tasks call. Mappers derived from the
+      // default mapper that override map_task need to override
+      // map_tasks as well before turning this on.
+      // Controlled by -dm:bulk (false by default)
+      bool map_in_bulk;
+      // Measure the execution time of one in every this many tasks and
+      // use the measurements to pick variants and processor kinds
+      // Controlled by -dm:cost_sample (0 disables the cost model)
+      unsigned cost_sample_rate;
+      // Variant and memory decisions shared with previous runs
+      // Controlled by -dm:mapping_cache <file> (disabled by default)
+      Utilities::PersistentMappingCache *mapping_cache;
     };
 
   }; // namespace Mapping
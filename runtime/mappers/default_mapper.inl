@@ -151,7 +151,90 @@ namespace Legion {
         result[next_dim] *= next_prime;
         dim_chunks[next_dim] /= next_prime;
       }
-      return Point<DIM,coord_t>(result);
+      Point<DIM,coord_t> num_blocks;
+      for (int i = 0; i < DIM; i++)
+        num_blocks[i] = result[i];
+      return num_blocks;
+    }
+
+    //--------------------------------------------------------------------------
+    template<int DIM>
+    /*static*/ void DefaultMapper::default_decompose_hierarchically(
+                  const DomainT<DIM,coord_t> &point_space,
+                  const std::vector<std::vector<std::vector<Processor> > > &hier,
+                  bool stealable, std::vector<TaskSlice> &slices)
+    //--------------------------------------------------------------------------
+    {
+      // Split the points across the nodes first, then across the NUMA
+      // domains of each node, and finally across the processors of each
+      // NUMA domain so that neighboring points stay close to each other
+      std::vector<Rect<DIM,coord_t> > node_rects;
+      default_split_rect<DIM>(point_space.bounds, hier.size(), node_rects);
+      for (unsigned n = 0; n < hier.size(); n++)
+      {
+        std::vector<Rect<DIM,coord_t> > domain_rects;
+        default_split_rect<DIM>(node_rects[n], hier[n].size(), domain_rects);
+        for (unsigned d = 0; d < hier[n].size(); d++)
+        {
+          const std::vector<Processor> &procs = hier[n][d];
+          std::vector<Rect<DIM,coord_t> > proc_rects;
+          default_split_rect<DIM>(domain_rects[d], procs.size(), proc_rects);
+          for (unsigned p = 0; p < procs.size(); p++)
+          {
+            if (proc_rects[p].empty())
+              continue;
+            // Construct a new slice space based on the new bounds 
+            // and any existing sparsity map, tighten if necessary
+            DomainT<DIM,coord_t> slice_space;
+            slice_space.bounds = proc_rects[p];
+            slice_space.sparsity = point_space.sparsity;
+            if (!slice_space.dense())
+              slice_space = slice_space.tighten();
+            if (slice_space.volume() > 0) {
+              TaskSlice slice;
+              slice.domain = slice_space;
+              slice.proc = procs[p];
+              slice.recurse = false;
+              slice.stealable = stealable;
+              slices.push_back(slice);
+            }
+          }
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    template<int DIM>
+    /*static*/ void DefaultMapper::default_split_rect(
+                                       const Rect<DIM,coord_t> &rect,
+                                       size_t num_pieces,
+                                       std::vector<Rect<DIM,coord_t> > &pieces)
+    //--------------------------------------------------------------------------
+    {
+      pieces.clear();
+      pieces.reserve(num_pieces);
+      if (rect.empty())
+      {
+        pieces.resize(num_pieces, rect);
+        return;
+      }
+      const Point<DIM,coord_t> num_blocks = 
+        default_select_num_blocks<DIM>(num_pieces, rect);
+      Point<DIM,coord_t> zeroes;
+      for (int i = 0; i < DIM; i++)
+        zeroes[i] = 0;
+      Point<DIM,coord_t> ones;
+      for (int i = 0; i < DIM; i++)
+        ones[i] = 1;
+      Point<DIM,coord_t> num_points = rect.hi - rect.lo + ones;
+      Rect<DIM,coord_t> blocks(zeroes, num_blocks - ones);
+      for (PointInRectIterator<DIM> pir(blocks); pir(); pir++) {
+        Point<DIM,coord_t> block_lo = *pir;
+        Point<DIM,coord_t> block_hi = *pir + ones;
+        pieces.push_back(Rect<DIM,coord_t>(
+              num_points * block_lo / num_blocks + rect.lo,
+              num_points * block_hi / num_blocks + rect.lo - ones));
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -19,6 +19,12 @@
 #include <algorithm>
 #include <limits>
 
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 namespace Legion {
   namespace Mapping {
     namespace Utilities {
@@ -1043,6 +1049,269 @@ namespace Legion {
       //------------------------------------------------------------------------
       {
       }
+
+      /**********************************
+       * Persistent Mapping Cache
+       **********************************/
+
+      /*static*/ std::map<std::string,PersistentMappingCache*> 
+                                      PersistentMappingCache::open_caches;
+      /*static*/ volatile int PersistentMappingCache::open_caches_lock = 0;
+      /*static*/ const unsigned PersistentMappingCache::NO_MEMORY_KIND;
+
+      //------------------------------------------------------------------------
+      PersistentMappingCache::PersistentMappingCache(const char *name,
+                                                     unsigned long long m)
+        : file_name(name), machine_hash(m), references(0),
+          mapped_base(NULL), mapped_size(0), num_loaded(0)
+      //------------------------------------------------------------------------
+      {
+      }
+
+      //------------------------------------------------------------------------
+      PersistentMappingCache::~PersistentMappingCache(void)
+      //------------------------------------------------------------------------
+      {
+        if (mapped_base != NULL)
+          munmap(mapped_base, mapped_size);
+      }
+
+      //------------------------------------------------------------------------
+      /*static*/ PersistentMappingCache* PersistentMappingCache::acquire(
+                             const char *file_name, unsigned long long machine)
+      //------------------------------------------------------------------------
+      {
+        while (__sync_lock_test_and_set(&open_caches_lock, 1))
+          while (open_caches_lock) { }
+        PersistentMappingCache *result = NULL;
+        std::map<std::string,PersistentMappingCache*>::const_iterator finder =
+          open_caches.find(file_name);
+        if (finder == open_caches.end())
+        {
+          result = new PersistentMappingCache(file_name, machine);
+          result->load();
+          open_caches[file_name] = result;
+        }
+        else
+          result = finder->second;
+        result->references++;
+        __sync_lock_release(&open_caches_lock);
+        return result;
+      }
+
+      //------------------------------------------------------------------------
+      /*static*/ bool PersistentMappingCache::release(
+                                                 PersistentMappingCache *cache)
+      //------------------------------------------------------------------------
+      {
+        while (__sync_lock_test_and_set(&open_caches_lock, 1))
+          while (open_caches_lock) { }
+        assert(cache->references > 0);
+        const bool last = (--cache->references == 0);
+        if (last)
+          open_caches.erase(cache->file_name);
+        __sync_lock_release(&open_caches_lock);
+        if (!last)
+          return true;
+        const bool result = cache->save();
+        delete cache;
+        return result;
+      }
+
+      //------------------------------------------------------------------------
+      /*static*/ unsigned long long PersistentMappingCache::compute_key(
+                                        const Task &task, Processor::Kind kind)
+      //------------------------------------------------------------------------
+      {
+        // Same mixing as the default mapper's task hash, but only over
+        // the parts of the task that are stable from one run to the next
+        const unsigned long long c1 = 0x5491C27F12DB3FA5;
+        const unsigned long long c2 = 353435097;
+        unsigned long long result = c1 + c2 * task.task_id;
+        result = result * c1 + c2 * kind;
+        for (unsigned idx = 0; idx < task.regions.size(); idx++)
+        {
+          const RegionRequirement &req = task.regions[idx];
+          result = result * c1 + c2 * req.privilege;
+          result = result * c1 + c2 * req.prop;
+          result = result * c1 + c2 * req.redop;
+          result = result * c1 + c2 * req.tag;
+          result = result * c1 + c2 * req.handle_type;
+          for (std::set<FieldID>::const_iterator it = 
+                req.privilege_fields.begin(); it != 
+                req.privilege_fields.end(); it++)
+            result = result * c1 + c2 * (*it);
+        }
+        return result;
+      }
+
+      //------------------------------------------------------------------------
+      bool PersistentMappingCache::find_decision(unsigned long long key,
+                                                 Decision &decision)
+      //------------------------------------------------------------------------
+      {
+        lock();
+        std::map<unsigned long long,Decision>::const_iterator finder = 
+          new_decisions.find(key);
+        if (finder != new_decisions.end())
+        {
+          decision = finder->second;
+          unlock();
+          return true;
+        }
+        // The loaded decisions are never modified after startup
+        unlock();
+        std::map<unsigned long long,const unsigned*>::const_iterator 
+          loaded = loaded_decisions.find(key);
+        if (loaded == loaded_decisions.end())
+          return false;
+        decode(loaded->second, decision);
+        return true;
+      }
+
+      //------------------------------------------------------------------------
+      void PersistentMappingCache::record_decision(unsigned long long key,
+                                                   const Decision &decision)
+      //------------------------------------------------------------------------
+      {
+        lock();
+        new_decisions[key] = decision;
+        unlock();
+      }
+
+      //------------------------------------------------------------------------
+      void PersistentMappingCache::load(void)
+      //------------------------------------------------------------------------
+      {
+        const int fd = open(file_name.c_str(), O_RDONLY);
+        if (fd < 0)
+          return;
+        struct stat info;
+        if ((fstat(fd, &info) != 0) || 
+            (size_t(info.st_size) < sizeof(FileHeader)))
+        {
+          close(fd);
+          return;
+        }
+        void *base = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+          return;
+        const FileHeader *header = static_cast<const FileHeader*>(base);
+        // Ignore files from a different version or a different machine
+        if ((header->magic != FILE_MAGIC) || 
+            (header->version != FILE_VERSION) ||
+            (header->machine != machine_hash))
+        {
+          munmap(base, info.st_size);
+          return;
+        }
+        mapped_base = base;
+        mapped_size = info.st_size;
+        const unsigned *next = reinterpret_cast<const unsigned*>(header + 1);
+        const unsigned *end = reinterpret_cast<const unsigned*>(
+                              static_cast<const char*>(base) + mapped_size);
+        for (unsigned long long idx = 0; idx < header->num_records; idx++)
+        {
+          // Stop at the first truncated record
+          if ((next + 5) > end)
+            break;
+          const unsigned num_regions = next[4];
+          if ((next + 5 + num_regions) > end)
+            break;
+          const unsigned long long key = 
+            (static_cast<unsigned long long>(next[1]) << 32) | next[0];
+          loaded_decisions[key] = next;
+          next += (5 + num_regions);
+        }
+        num_loaded = loaded_decisions.size();
+      }
+
+      //------------------------------------------------------------------------
+      bool PersistentMappingCache::save(void)
+      //------------------------------------------------------------------------
+      {
+        // Nothing to do if we didn't learn anything new this run
+        if (new_decisions.empty())
+          return true;
+        // Write to a temporary file and then rename it so that readers
+        // never see a partially written cache
+        const std::string temp_name = file_name + ".tmp";
+        FILE *f = fopen(temp_name.c_str(), "wb");
+        if (f == NULL)
+          return false;
+        std::vector<unsigned> records;
+        unsigned long long num_records = 0;
+        for (std::map<unsigned long long,const unsigned*>::const_iterator it =
+              loaded_decisions.begin(); it != loaded_decisions.end(); it++)
+        {
+          if (new_decisions.find(it->first) != new_decisions.end())
+            continue;
+          records.insert(records.end(), it->second, 
+                         it->second + 5 + it->second[4]);
+          num_records++;
+        }
+        for (std::map<unsigned long long,Decision>::const_iterator it =
+              new_decisions.begin(); it != new_decisions.end(); it++)
+        {
+          records.push_back(unsigned(it->first));
+          records.push_back(unsigned(it->first >> 32));
+          records.push_back(it->second.variant);
+          records.push_back((it->second.tight_bound ? 1 : 0) | 
+                            (it->second.is_inner ? 2 : 0));
+          records.push_back(it->second.memory_kinds.size());
+          records.insert(records.end(), it->second.memory_kinds.begin(),
+                         it->second.memory_kinds.end());
+          num_records++;
+        }
+        FileHeader header;
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        header.machine = machine_hash;
+        header.num_records = num_records;
+        bool success = (fwrite(&header, sizeof(header), 1, f) == 1);
+        if (success && !records.empty())
+          success = (fwrite(&records.front(), sizeof(unsigned), 
+                            records.size(), f) == records.size());
+        if (fclose(f) != 0)
+          success = false;
+        if (success)
+          success = (rename(temp_name.c_str(), file_name.c_str()) == 0);
+        if (!success)
+          unlink(temp_name.c_str());
+        return success;
+      }
+
+      //------------------------------------------------------------------------
+      void PersistentMappingCache::lock(void)
+      //------------------------------------------------------------------------
+      {
+        Realm::Event wait_on = reservation.wrlock();
+        while (wait_on.exists())
+        {
+          wait_on.wait();
+          wait_on = reservation.wrlock();
+        }
+      }
+
+      //------------------------------------------------------------------------
+      void PersistentMappingCache::unlock(void)
+      //------------------------------------------------------------------------
+      {
+        reservation.unlock();
+      }
+
+      //------------------------------------------------------------------------
+      /*static*/ void PersistentMappingCache::decode(const unsigned *record,
+                                                     Decision &decision)
+      //------------------------------------------------------------------------
+      {
+        decision.variant = record[2];
+        decision.tight_bound = ((record[3] & 1) != 0);
+        decision.is_inner = ((record[3] & 2) != 0);
+        decision.memory_kinds.assign(record + 5, record + 5 + record[4]);
+      }
+
     }; // namespace Utilities
   }; // namespace Mapping
 }; // namespace Legion
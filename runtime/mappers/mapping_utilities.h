@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <string>
 
 namespace Legion {
   namespace Mapping {
@@ -282,6 +283,84 @@ namespace Legion {
         OptionMap profiling_options;
       };
 
+      /**
+       * A cache of mapping decisions that persists across runs of the
+       * same application on the same shape of machine. Decisions are
+       * keyed by a hash of the task ID, the signature of its region
+       * requirements and the kind of target processor. The cache file
+       * is memory mapped when the first mapper using it is created and
+       * all the decisions (old and new) are written back out when the
+       * last mapper using it is destroyed. Only decisions that remain
+       * meaningful in a new process are stored (variants and memory 
+       * kinds), never instances or layout constraint IDs.
+       */
+      class PersistentMappingCache {
+      public:
+        struct Decision {
+        public:
+          Decision(void)
+            : variant(0), tight_bound(false), is_inner(false) { }
+        public:
+          VariantID variant;
+          bool tight_bound;
+          bool is_inner;
+          // One entry per region requirement, NO_MEMORY_KIND if the
+          // region requirement did not need an instance
+          std::vector<unsigned> memory_kinds;
+        };
+        static const unsigned NO_MEMORY_KIND = ~0U;
+      public:
+        static PersistentMappingCache* acquire(const char *file_name,
+                                               unsigned long long machine);
+        // Returns false if the cache was the last reference and
+        // it failed to write the cache file back out
+        static bool release(PersistentMappingCache *cache);
+      public:
+        static unsigned long long compute_key(const Task &task,
+                                              Processor::Kind kind);
+        bool find_decision(unsigned long long key, Decision &decision);
+        void record_decision(unsigned long long key, const Decision &decision);
+        size_t get_loaded_decisions(void) const { return num_loaded; }
+      protected:
+        PersistentMappingCache(const char *file_name, 
+                               unsigned long long machine);
+        ~PersistentMappingCache(void);
+        PersistentMappingCache(const PersistentMappingCache &rhs);
+        PersistentMappingCache& operator=(const PersistentMappingCache &rhs);
+      protected:
+        void load(void);
+        bool save(void);
+        void lock(void);
+        void unlock(void);
+        static void decode(const unsigned *record, Decision &decision);
+      protected:
+        // On-disk layout: a header followed by records of the form
+        // key (two words), variant, flags, number of regions, memory kinds
+        struct FileHeader {
+          unsigned magic;
+          unsigned version;
+          unsigned long long machine;
+          unsigned long long num_records;
+        };
+        static const unsigned FILE_MAGIC = 0x4C474D43; // "LGMC"
+        static const unsigned FILE_VERSION = 1;
+      protected:
+        const std::string file_name;
+        const unsigned long long machine_hash;
+        unsigned references;
+        Realm::FastReservation reservation;
+        // Memory mapped contents of the file from the previous run
+        void *mapped_base;
+        size_t mapped_size;
+        size_t num_loaded;
+        std::map<unsigned long long,const unsigned*> loaded_decisions;
+        // Decisions made during this run
+        std::map<unsigned long long,Decision> new_decisions;
+      protected:
+        static std::map<std::string,PersistentMappingCache*> open_caches;
+        static volatile int open_caches_lock;
+      };
+
     }; // namespace Utilities
   }; // namespace Mapping
 }; // namespace Legion
@@ -84,6 +84,9 @@
       REMOTE_SPARSITY_REQUEST_MSGID,
       APPROX_IMAGE_RESPONSE_MSGID,
       SET_CONTRIB_COUNT_MSGID,
+      REMOTE_SPARSITY_APPROX_MSGID,
+      REMOTE_SPARSITY_PARTIAL_REQUEST_MSGID,
+      REMOTE_SPARSITY_PARTIAL_CONTRIB_MSGID,
       REMOTE_ID_REQUEST_MSGID,
       REMOTE_ID_RESPONSE_MSGID,
       REMOTE_IB_ALLOC_REQUEST_MSGID,
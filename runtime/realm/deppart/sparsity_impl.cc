@@ -164,6 +164,21 @@ namespace Realm {
     return static_cast<SparsityMapImpl<N,T> *>(this)->make_valid(precise);
   }
 
+  template <int N, typename T>
+  Event SparsityMapPublicImpl<N,T>::make_valid(const Rect<N,T>& bounds)
+  {
+    return static_cast<SparsityMapImpl<N,T> *>(this)->make_valid(bounds);
+  }
+
+  template <int N, typename T>
+  const std::vector<SparsityMapEntry<N,T> >& SparsityMapPublicImpl<N,T>::get_entries(const Rect<N,T>& bounds)
+  {
+    // once the full list is here, there's no reason to look anywhere else
+    if(entries_valid)
+      return entries;
+    return static_cast<SparsityMapImpl<N,T> *>(this)->get_entries(bounds);
+  }
+
   // membership test between two (presumably-different) sparsity maps are not
   //  cheap - try bounds-based checks first (see IndexSpace::overlaps)
   template <int N, typename T>
@@ -190,8 +205,8 @@ namespace Realm {
 	}
       }
     } else {
-      const std::vector<SparsityMapEntry<N,T> >& entries1 = get_entries();
-      const std::vector<SparsityMapEntry<N,T> >& entries2 = other->get_entries();
+      const std::vector<SparsityMapEntry<N,T> >& entries1 = get_entries(bounds);
+      const std::vector<SparsityMapEntry<N,T> >& entries2 = other->get_entries(bounds);
       for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it1 = entries1.begin();
 	  it1 != entries1.end();
 	  it1++) {
@@ -292,6 +307,93 @@ namespace Realm {
     return e;
   }
 
+  // requests just the precise entries that overlap 'bounds' - remote nodes fetch
+  //  (and cache) those entries rather than the whole list
+  template <int N, typename T>
+  Event SparsityMapImpl<N,T>::make_valid(const Rect<N,T>& bounds)
+  {
+    // early out
+    if(this->entries_valid)
+      return Event::NO_EVENT;
+
+    // the creator node has to compute the whole thing anyway
+    if(NodeID(ID(me).sparsity_creator_node()) == my_node_id)
+      return make_valid(true /*precise*/);
+
+    bool request = false;
+    bool request_all = false;
+    Event e = Event::NO_EVENT;
+    {
+      AutoHSLLock al(mutex);
+
+      if(this->entries_valid)
+	return Event::NO_EVENT;
+
+      // if the full list is already on its way, just wait for that
+      if(precise_requested) {
+	if(!precise_ready_event.exists())
+	  precise_ready_event = GenEventImpl::create_genevent()->current_event();
+	return precise_ready_event;
+      }
+
+      // otherwise look for an earlier request that covers this one
+      for(typename std::list<PartialEntries>::const_iterator it = partial_entries.begin();
+	  it != partial_entries.end();
+	  it++)
+	if(it->bounds.contains(bounds))
+	  return (it->valid ? Event::NO_EVENT : it->ready_event);
+
+      // a client that keeps asking about new rectangles is better off with
+      //  a single fetch of everything than a round trip per rectangle
+      if(partial_entries.size() >= MAX_PARTIAL_REQUESTS) {
+	request_all = true;
+      } else {
+	e = GenEventImpl::create_genevent()->current_event();
+	partial_entries.push_back(PartialEntries());
+	PartialEntries& partial = partial_entries.back();
+	partial.bounds = bounds;
+	partial.ready_event = e;
+	partial.valid = false;
+	request = true;
+      }
+    }
+
+    // (this takes the lock again and handles any races with other requests)
+    if(request_all)
+      return make_valid(true /*precise*/);
+
+    if(request)
+      RemoteSparsityPartialRequestMessage::send_request(ID(me).sparsity_creator_node(),
+							me, bounds);
+
+    return e;
+  }
+
+  template <int N, typename T>
+  const std::vector<SparsityMapEntry<N,T> >& SparsityMapImpl<N,T>::get_entries(const Rect<N,T>& bounds)
+  {
+    Event e = make_valid(bounds);
+    if(e.exists()) {
+      // TODO: warn here?
+      e.wait();
+    }
+
+    if(this->entries_valid)
+      return this->entries;
+
+    AutoHSLLock al(mutex);
+    for(typename std::list<PartialEntries>::const_iterator it = partial_entries.begin();
+	it != partial_entries.end();
+	it++)
+      if(it->valid && it->bounds.contains(bounds))
+	return it->entries;
+
+    // shouldn't get here - either the full list or a covering partial list
+    //  must be valid once the event has triggered
+    assert(0);
+    return this->entries;
+  }
+
 
   // methods used in the population of a sparsity map
 
@@ -616,8 +718,9 @@ namespace Realm {
   void SparsityMapImpl<N,T>::remote_data_reply(NodeID requestor, bool reply_precise, bool reply_approx)
   {
     if(reply_approx) {
-      // TODO
       assert(this->approx_valid);
+      log_part.info() << "sending approx data: sparsity=" << me << " target=" << requestor;
+      RemoteSparsityApproxMessage::send_request<N,T>(requestor, me, this->approx_rects);
     }
 
     if(reply_precise) {
@@ -668,6 +771,50 @@ namespace Realm {
     return lhs.bounds.lo.x < rhs.bounds.lo.x;
   }
 
+  template <int N, typename T>
+  class LowerBoundComparator {
+  public:
+    LowerBoundComparator(int _dim) : dim(_dim) {}
+    bool operator()(const SparsityMapEntry<N,T>& lhs,
+		    const SparsityMapEntry<N,T>& rhs) const
+    {
+      return lhs.bounds.lo[dim] < rhs.bounds.lo[dim];
+    }
+  protected:
+    int dim;
+  };
+
+  // arranges entries [lo, hi) into a k-d tree (see SparsityMapPublicImpl::entry_tree)
+  //  rooted at 'node' - 1-D entries are already sorted, so they are left in place
+  template <int N, typename T>
+  static void build_entry_tree(std::vector<SparsityMapEntry<N,T> >& entries,
+			       std::vector<Rect<N,T> >& tree,
+			       size_t node, size_t lo, size_t hi, size_t leaf_size)
+  {
+    Rect<N,T> bbox = entries[lo].bounds;
+    for(size_t i = lo + 1; i < hi; i++)
+      bbox = bbox.union_bbox(entries[i].bounds);
+    if(node >= tree.size())
+      tree.resize(node + 1);
+    tree[node] = bbox;
+
+    if((hi - lo) <= leaf_size)
+      return;
+
+    size_t mid = (lo + hi) >> 1;
+    if(N > 1) {
+      int split_dim = 0;
+      for(int d = 1; d < N; d++)
+	if((double(bbox.hi[d]) - double(bbox.lo[d])) >
+	   (double(bbox.hi[split_dim]) - double(bbox.lo[split_dim])))
+	  split_dim = d;
+      std::nth_element(entries.begin() + lo, entries.begin() + mid, entries.begin() + hi,
+		       LowerBoundComparator<N,T>(split_dim));
+    }
+    build_entry_tree(entries, tree, 2*node + 1, lo, mid, leaf_size);
+    build_entry_tree(entries, tree, 2*node + 2, mid, hi, leaf_size);
+  }
+
   template <int N, typename T>
   static void compute_approximation(const std::vector<SparsityMapEntry<N,T> >& entries,
 				    std::vector<Rect<N,T> >& approx_rects,
@@ -742,6 +889,145 @@ namespace Realm {
     // std::cout << " ]]]\n";
   }
 
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::remote_approx_reply(const Rect<N,T>* rects, size_t count)
+  {
+    Event trigger_approx = Event::NO_EVENT;
+    std::vector<PartitioningMicroOp *> approx_waiters_copy;
+    {
+      AutoHSLLock al(mutex);
+
+      // the precise data may have arrived first, in which case we've already
+      //  computed the same approximation locally
+      if(this->approx_valid)
+	return;
+
+      this->approx_rects.assign(rects, rects + count);
+      this->approx_valid = true;
+      approx_requested = false;
+      if(approx_ready_event.exists()) {
+	trigger_approx = approx_ready_event;
+	approx_ready_event = Event::NO_EVENT;
+      }
+      approx_waiters_copy.swap(approx_waiters);
+    }
+
+    for(std::vector<PartitioningMicroOp *>::const_iterator it = approx_waiters_copy.begin();
+	it != approx_waiters_copy.end();
+	it++)
+      (*it)->sparsity_map_ready(this, false);
+
+    if(trigger_approx.exists())
+      GenEventImpl::trigger(trigger_approx, false /*!poisoned*/);
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::remote_partial_request(NodeID requestor, const Rect<N,T>& bounds)
+  {
+    // first sanity check - we should be the owner of the data
+    assert(NodeID(ID(me).sparsity_creator_node()) == my_node_id);
+
+    bool reply = false;
+    {
+      AutoHSLLock al(mutex);
+
+      remote_sharers.add(requestor);
+
+      if(this->entries_valid)
+	reply = true;
+      else
+	remote_partial_waiters.push_back(std::make_pair(requestor, bounds));
+    }
+
+    if(reply)
+      remote_partial_reply(requestor, bounds);
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::remote_partial_reply(NodeID requestor, const Rect<N,T>& bounds)
+  {
+    assert(this->entries_valid);
+
+    // gather the rectangles that overlap the requested bounds
+    std::vector<Rect<N,T> > rects;
+    for(size_t idx = this->next_overlapping_entry(this->entries, bounds, 0);
+	idx < this->entries.size();
+	idx = this->next_overlapping_entry(this->entries, bounds, idx + 1)) {
+      typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = this->entries.begin() + idx;
+      // partial replies only carry rectangles - an entry that needs a bitmap
+      //  or another sparsity map cannot be described to the requestor, so fail
+      //  loudly here rather than send it an incomplete list of entries
+      if((it->bitmap != 0) || it->sparsity.exists()) {
+	log_part.fatal() << "cannot send partial sparsity data: sparsity=" << me
+			 << " target=" << requestor << " bounds=" << bounds
+			 << " entry=" << it->bounds
+			 << (it->bitmap ? " (bitmap)" : " (sparsity map)");
+	abort();
+      }
+      rects.push_back(it->bounds);
+    }
+
+    log_part.info() << "sending partial data: sparsity=" << me << " target=" << requestor
+		    << " bounds=" << bounds << " rects=" << rects.size();
+
+    int seq_id = fragment_assembler.get_sequence_id();
+    int seq_count = 0;
+
+    const Rect<N,T> *rdata = rects.empty() ? 0 : &rects[0];
+    size_t remaining = rects.size();
+    // every fragment carries the requested bounds as well
+    const size_t max_to_send = ((DeppartConfig::cfg_max_bytes_per_packet / sizeof(Rect<N,T>)) - 1);
+    // send partial messages first
+    while(remaining > max_to_send) {
+      RemoteSparsityPartialContribMessage::send_request<N,T>(requestor, me, seq_id, 0,
+							     bounds, rdata, max_to_send);
+      seq_count++;
+      remaining -= max_to_send;
+      rdata += max_to_send;
+    }
+    // final message includes the count of all messages (including this one!)
+    RemoteSparsityPartialContribMessage::send_request<N,T>(requestor, me,
+							   seq_id, seq_count + 1,
+							   bounds, rdata, remaining);
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::contribute_partial_rects(const Rect<N,T>& bounds,
+						      const Rect<N,T>* rects, size_t count,
+						      bool last)
+  {
+    Event trigger = Event::NO_EVENT;
+    {
+      AutoHSLLock al(mutex);
+
+      typename std::list<PartialEntries>::iterator it = partial_entries.begin();
+      while((it != partial_entries.end()) && (it->valid || (it->bounds != bounds)))
+	it++;
+      assert(it != partial_entries.end());
+
+      size_t first = it->entries.size();
+      it->entries.resize(first + count);
+      for(size_t i = 0; i < count; i++) {
+	it->entries[first + i].bounds = rects[i];
+	it->entries[first + i].sparsity.id = 0;
+	it->entries[first + i].bitmap = 0;
+      }
+
+      if(last) {
+	if(N == 1)
+	  std::sort(it->entries.begin(), it->entries.end(),
+		    non_overlapping_bounds_1d_comp<N,T>);
+	it->valid = true;
+	// the event may already have been triggered if the full list showed up first
+	trigger = it->ready_event;
+	it->ready_event = Event::NO_EVENT;
+      }
+    }
+
+    if(trigger.exists())
+      GenEventImpl::trigger(trigger, false /*!poisoned*/);
+  }
+
   template <int N, typename T>
   void SparsityMapImpl<N,T>::finalize(void)
   {
@@ -765,12 +1051,18 @@ namespace Realm {
 	assert(this->entries[i-1].bounds.hi.x < (this->entries[i].bounds.lo.x - 1));
     }
 
+    // index the entries so that overlap queries don't have to scan all of them -
+    //  this has to happen before entries_valid is set since readers don't lock
+    this->entry_tree.clear();
+    if(!this->entries.empty())
+      build_entry_tree(this->entries, this->entry_tree, 0, 0, this->entries.size(),
+		       SparsityMapPublicImpl<N,T>::ENTRY_TREE_LEAF_SIZE);
+
     // now that we've got our entries nice and tidy, build a bounded approximation of them
-    if(true /*ID(me).sparsity_creator_node() == my_node_id*/) {
-      assert(!this->approx_valid);
-      compute_approximation(this->entries, this->approx_rects, DeppartConfig::cfg_max_rects_in_approximation);
-      this->approx_valid = true;
-    }
+    //  (unless a remote node already received it from the creator)
+    std::vector<Rect<N,T> > new_approx_rects;
+    if(!this->approx_valid)
+      compute_approximation(this->entries, new_approx_rects, DeppartConfig::cfg_max_rects_in_approximation);
 
 #ifdef DEBUG_PARTITIONING
     std::cout << "finalizing " << this << ", " << this->entries.size() << " entries" << std::endl;
@@ -785,10 +1077,22 @@ namespace Realm {
     NodeSet sendto_precise, sendto_approx;
     Event trigger_precise = Event::NO_EVENT;
     Event trigger_approx = Event::NO_EVENT;
+    std::vector<Event> trigger_partials;
     std::vector<PartitioningMicroOp *> precise_waiters_copy, approx_waiters_copy;
+    std::vector<std::pair<NodeID, Rect<N,T> > > partial_waiters_copy;
     {
       AutoHSLLock al(mutex);
 
+      if(!this->approx_valid) {
+	this->approx_rects.swap(new_approx_rects);
+	this->approx_valid = true;
+      }
+      approx_requested = false;
+      if(approx_ready_event.exists()) {
+	trigger_approx = approx_ready_event;
+	approx_ready_event = Event::NO_EVENT;
+      }
+
       assert(!this->entries_valid);
       this->entries_valid = true;
       precise_requested = false;
@@ -797,11 +1101,23 @@ namespace Realm {
 	precise_ready_event = Event::NO_EVENT;
       }
 
+      // anybody waiting on a partial list can use the full one instead
+      for(typename std::list<PartialEntries>::iterator it = partial_entries.begin();
+	  it != partial_entries.end();
+	  it++)
+	if(it->ready_event.exists()) {
+	  trigger_partials.push_back(it->ready_event);
+	  it->ready_event = Event::NO_EVENT;
+	}
+
       precise_waiters_copy.swap(precise_waiters);
       approx_waiters_copy.swap(approx_waiters);
 
       sendto_precise = remote_precise_waiters;
       remote_precise_waiters.clear();
+      sendto_approx = remote_approx_waiters;
+      remote_approx_waiters.clear();
+      partial_waiters_copy.swap(remote_partial_waiters);
     }
 
     for(std::vector<PartitioningMicroOp *>::const_iterator it = precise_waiters_copy.begin();
@@ -833,6 +1149,16 @@ namespace Realm {
 	}
     }
 
+    for(typename std::vector<std::pair<NodeID, Rect<N,T> > >::const_iterator it = partial_waiters_copy.begin();
+	it != partial_waiters_copy.end();
+	it++)
+      remote_partial_reply(it->first, it->second);
+
+    for(std::vector<Event>::const_iterator it = trigger_partials.begin();
+	it != trigger_partials.end();
+	it++)
+      GenEventImpl::trigger(*it, false /*!poisoned*/);
+
     if(trigger_approx.exists())
       GenEventImpl::trigger(trigger_approx, false /*!poisoned*/);
 
@@ -978,6 +1304,145 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class RemoteSparsityApproxMessage
+
+  template <typename NT, typename T>
+  inline /*static*/ void RemoteSparsityApproxMessage::DecodeHelper::demux(const RequestArgs *args,
+									  const void *data, size_t datalen)
+  {
+    SparsityMap<NT::N,T> sparsity;
+    sparsity.id = args->sparsity_id;
+
+    log_part.info() << "received sparsity approx: sparsity=" << sparsity << " len=" << datalen;
+    size_t count = datalen / sizeof(Rect<NT::N,T>);
+    assert((datalen % sizeof(Rect<NT::N,T>)) == 0);
+    SparsityMapImpl<NT::N,T>::lookup(sparsity)->remote_approx_reply((const Rect<NT::N,T> *)data,
+								    count);
+  }
+
+  /*static*/ void RemoteSparsityApproxMessage::handle_request(RequestArgs args,
+							      const void *data, size_t datalen)
+  {
+    NT_TemplateHelper::demux<DecodeHelper>(args.type_tag, &args, data, datalen);
+  }
+
+  template <int N, typename T>
+  /*static*/ void RemoteSparsityApproxMessage::send_request(NodeID target,
+							    SparsityMap<N,T> sparsity,
+							    const std::vector<Rect<N,T> >& approx_rects)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.type_tag = NT_TemplateHelper::encode_tag<N,T>();
+    args.sparsity_id = sparsity.id;
+
+    Message::request(target, args,
+		     (approx_rects.empty() ? 0 : &approx_rects[0]),
+		     approx_rects.size() * sizeof(Rect<N,T>),
+		     PAYLOAD_COPY);
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class RemoteSparsityPartialRequestMessage
+
+  template <typename NT, typename T>
+  inline /*static*/ void RemoteSparsityPartialRequestMessage::DecodeHelper::demux(const RequestArgs *args,
+										  const void *data, size_t datalen)
+  {
+    SparsityMap<NT::N,T> sparsity;
+    sparsity.id = args->sparsity_id;
+
+    assert(datalen == sizeof(Rect<NT::N,T>));
+    const Rect<NT::N,T>& bounds = *(const Rect<NT::N,T> *)data;
+    log_part.info() << "received partial sparsity request: sparsity=" << sparsity << " bounds=" << bounds;
+    SparsityMapImpl<NT::N,T>::lookup(sparsity)->remote_partial_request(args->sender, bounds);
+  }
+
+  /*static*/ void RemoteSparsityPartialRequestMessage::handle_request(RequestArgs args,
+								      const void *data, size_t datalen)
+  {
+    NT_TemplateHelper::demux<DecodeHelper>(args.type_tag, &args, data, datalen);
+  }
+
+  template <int N, typename T>
+  /*static*/ void RemoteSparsityPartialRequestMessage::send_request(NodeID target,
+								    SparsityMap<N,T> sparsity,
+								    const Rect<N,T>& bounds)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.type_tag = NT_TemplateHelper::encode_tag<N,T>();
+    args.sparsity_id = sparsity.id;
+
+    Message::request(target, args, &bounds, sizeof(Rect<N,T>), PAYLOAD_COPY);
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class RemoteSparsityPartialContribMessage
+
+  template <typename NT, typename T>
+  inline /*static*/ void RemoteSparsityPartialContribMessage::DecodeHelper::demux(const RequestArgs *args,
+										  const void *data, size_t datalen)
+  {
+    SparsityMap<NT::N,T> sparsity;
+    sparsity.id = args->sparsity_id;
+
+    log_part.info() << "received partial contribution: sparsity=" << sparsity << " len=" << datalen;
+    assert(datalen >= sizeof(Rect<NT::N,T>));
+    assert((datalen % sizeof(Rect<NT::N,T>)) == 0);
+    // first rectangle is the bounds of the request, the rest are the entries
+    const Rect<NT::N,T> *rects = (const Rect<NT::N,T> *)data;
+    size_t count = (datalen / sizeof(Rect<NT::N,T>)) - 1;
+    bool last_fragment = fragment_assembler.add_fragment(args->sender,
+							 args->sequence_id,
+							 args->sequence_count);
+    SparsityMapImpl<NT::N,T>::lookup(sparsity)->contribute_partial_rects(rects[0],
+									 rects + 1,
+									 count,
+									 last_fragment);
+  }
+
+  /*static*/ void RemoteSparsityPartialContribMessage::handle_request(RequestArgs args,
+								      const void *data, size_t datalen)
+  {
+    NT_TemplateHelper::demux<DecodeHelper>(args.type_tag, &args, data, datalen);
+  }
+
+  template <int N, typename T>
+  /*static*/ void RemoteSparsityPartialContribMessage::send_request(NodeID target,
+								    SparsityMap<N,T> sparsity,
+								    int sequence_id,
+								    int sequence_count,
+								    const Rect<N,T>& bounds,
+								    const Rect<N,T> *rects,
+								    size_t count)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.type_tag = NT_TemplateHelper::encode_tag<N,T>();
+    args.sparsity_id = sparsity.id;
+    args.sequence_id = sequence_id;
+    args.sequence_count = sequence_count;
+
+    std::vector<Rect<N,T> > payload;
+    payload.reserve(count + 1);
+    payload.push_back(bounds);
+    payload.insert(payload.end(), rects, rects + count);
+
+    Message::request(target, args, &payload[0], payload.size() * sizeof(Rect<N,T>),
+		     PAYLOAD_COPY);
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class SetContribCountMessage
@@ -25,6 +25,8 @@
 #include "realm/activemsg.h"
 #include "realm/nodeset.h"
 
+#include <list>
+
 namespace Realm {
 
   class PartitioningMicroOp;
@@ -36,6 +38,9 @@ namespace Realm {
 
     // actual implementation - SparsityMapPublicImpl's version just calls this one
     Event make_valid(bool precise = true);
+    Event make_valid(const Rect<N,T>& bounds);
+    const std::vector<SparsityMapEntry<N,T> >& get_entries(const Rect<N,T>& bounds);
+    using SparsityMapPublicImpl<N,T>::get_entries;
 
     static SparsityMapImpl<N,T> *lookup(SparsityMap<N,T> sparsity);
 
@@ -58,6 +63,13 @@ namespace Realm {
 
     void remote_data_request(NodeID requestor, bool send_precise, bool send_approx);
     void remote_data_reply(NodeID requestor, bool send_precise, bool send_approx);
+    void remote_approx_reply(const Rect<N,T>* rects, size_t count);
+
+    // precise entries for only the part of the sparsity map overlapping a rectangle
+    void remote_partial_request(NodeID requestor, const Rect<N,T>& bounds);
+    void remote_partial_reply(NodeID requestor, const Rect<N,T>& bounds);
+    void contribute_partial_rects(const Rect<N,T>& bounds,
+				  const Rect<N,T>* rects, size_t count, bool last);
 
     SparsityMap<N,T> me;
 
@@ -72,6 +84,20 @@ namespace Realm {
     NodeSet remote_precise_waiters, remote_approx_waiters;
     NodeSet remote_sharers;
     size_t sizeof_precise;
+
+    // entries fetched from the creator node for specific rectangles - a list so
+    //  that references handed out by get_entries(bounds) remain stable
+    // once this many partial requests have been made, we fetch the whole list
+    //  instead so that the list (and the scans over it) stay short
+    static const size_t MAX_PARTIAL_REQUESTS = 16;
+    struct PartialEntries {
+      Rect<N,T> bounds;
+      std::vector<SparsityMapEntry<N,T> > entries;
+      Event ready_event;
+      bool valid;
+    };
+    std::list<PartialEntries> partial_entries;
+    std::vector<std::pair<NodeID, Rect<N,T> > > remote_partial_waiters;
   };
 
   // we need a type-erased wrapper to store in the runtime's lookup table
@@ -144,6 +170,83 @@ namespace Realm {
 			     bool send_precise, bool send_approx);
   };
 
+  struct RemoteSparsityApproxMessage {
+    struct RequestArgs : public BaseMedium {
+      NodeID sender;
+      DynamicTemplates::TagType type_tag;
+      ID::IDType sparsity_id;
+    };
+
+    struct DecodeHelper {
+      template <typename NT, typename T>
+      static void demux(const RequestArgs *args, const void *data, size_t datalen);
+    };
+
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<REMOTE_SPARSITY_APPROX_MSGID,
+                                       RequestArgs,
+                                       handle_request> Message;
+
+    template <int N, typename T>
+    static void send_request(NodeID target, SparsityMap<N,T> sparsity,
+			     const std::vector<Rect<N,T> >& approx_rects);
+  };
+
+  // the rectangle of interest is sent as the payload since it may not fit in
+  //  the message arguments for larger dimensions
+  struct RemoteSparsityPartialRequestMessage {
+    struct RequestArgs : public BaseMedium {
+      NodeID sender;
+      DynamicTemplates::TagType type_tag;
+      ID::IDType sparsity_id;
+    };
+
+    struct DecodeHelper {
+      template <typename NT, typename T>
+      static void demux(const RequestArgs *args, const void *data, size_t datalen);
+    };
+
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<REMOTE_SPARSITY_PARTIAL_REQUEST_MSGID,
+                                       RequestArgs,
+                                       handle_request> Message;
+
+    template <int N, typename T>
+    static void send_request(NodeID target, SparsityMap<N,T> sparsity,
+			     const Rect<N,T>& bounds);
+  };
+
+  // payload is the requested rectangle followed by (a fragment of) the entries
+  //  that overlap it
+  struct RemoteSparsityPartialContribMessage {
+    struct RequestArgs : public BaseMedium {
+      NodeID sender;
+      DynamicTemplates::TagType type_tag;
+      ID::IDType sparsity_id;
+      int sequence_id;
+      int sequence_count;
+    };
+
+    struct DecodeHelper {
+      template <typename NT, typename T>
+      static void demux(const RequestArgs *args, const void *data, size_t datalen);
+    };
+
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<REMOTE_SPARSITY_PARTIAL_CONTRIB_MSGID,
+                                       RequestArgs,
+                                       handle_request> Message;
+
+    template <int N, typename T>
+    static void send_request(NodeID target, SparsityMap<N,T> sparsity,
+			     int sequence_id, int sequence_count,
+			     const Rect<N,T>& bounds,
+			     const Rect<N,T> *rects, size_t count);
+  };
+
   struct SetContribCountMessage {
     struct RequestArgs {
       DynamicTemplates::TagType type_tag;
@@ -1160,13 +1160,13 @@ namespace Realm {
       }
       return true;
     } else {
-      for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = entries.begin();
-	  it != entries.end();
-	  it++) {
-	if(!it->bounds.contains(p)) continue;
-	if(it->sparsity.exists()) {
+      // the entries are disjoint, so at most one of them can contain the point
+      size_t idx = impl->next_overlapping_entry(entries, Rect<N,T>(p, p), 0);
+      if(idx < entries.size()) {
+	const SparsityMapEntry<N,T>& e = entries[idx];
+	if(e.sparsity.exists()) {
 	  assert(0);
-	} else if(it->bitmap != 0) {
+	} else if(e.bitmap != 0) {
 	  assert(0);
 	} else {
 	  return true;
@@ -1186,8 +1186,26 @@ namespace Realm {
       return false;
 
     if(!dense()) {
-      // test against sparsity map too
-      assert(0);
+      // test against sparsity map too - the entries are disjoint, so the rectangle
+      //  is covered exactly when the entries overlapping it account for all of its
+      //  volume - only those entries are needed, which avoids fetching the whole
+      //  map from a remote node
+      SparsityMapPublicImpl<N,T> *impl = sparsity.impl();
+      const std::vector<SparsityMapEntry<N,T> >& entries = impl->get_entries(r);
+      size_t covered = 0;
+      for(size_t i = impl->next_overlapping_entry(entries, r, 0);
+	  i < entries.size();
+	  i = impl->next_overlapping_entry(entries, r, i + 1)) {
+	Rect<N,T> isect = r.intersection(entries[i].bounds);
+	if(entries[i].sparsity.exists()) {
+	  assert(0);
+	} else if(entries[i].bitmap != 0) {
+	  assert(0);
+	} else {
+	  covered += isect.volume();
+	}
+      }
+      return (covered == r.volume());
     }
 
     return true;
@@ -1201,16 +1219,16 @@ namespace Realm {
       return false;
 
     if(!dense()) {
-      // test against sparsity map too
+      // test against sparsity map too - only the entries overlapping 'r' are
+      //  needed, which avoids fetching the whole map from a remote node
       SparsityMapPublicImpl<N,T> *impl = sparsity.impl();
-      const std::vector<SparsityMapEntry<N,T> >& entries = impl->get_entries();
-      for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = entries.begin();
-	  it != entries.end();
-	  it++) {
-	if(!it->bounds.overlaps(r)) continue;
-	if(it->sparsity.exists()) {
+      const std::vector<SparsityMapEntry<N,T> >& entries = impl->get_entries(bounds.intersection(r));
+      size_t idx = impl->next_overlapping_entry(entries, r, 0);
+      if(idx < entries.size()) {
+	const SparsityMapEntry<N,T>& e = entries[idx];
+	if(e.sparsity.exists()) {
 	  assert(0);
-	} else if(it->bitmap != 0) {
+	} else if(e.bitmap != 0) {
 	  assert(0);
 	} else {
 	  return true;
@@ -1242,6 +1260,13 @@ namespace Realm {
     SparsityMapPublicImpl<N,T> *other_impl = other.sparsity.impl();
     // overlap can only be within intersecion of bounds
     Rect<N,T> isect = bounds.intersection(other.bounds);
+    if(isect.empty())
+      return false;
+
+    // the approximations are much smaller (and cheaper to fetch) than the precise
+    //  entries and are guaranteed to be supersets, so use them to rule out overlap
+    if(!impl->overlaps(other_impl, isect, true /*approx*/))
+      return false;
 
     return impl->overlaps(other_impl, isect, false /*!approx*/);
   }
@@ -1705,23 +1730,16 @@ namespace Realm {
     } else {
       s_impl = space.sparsity.impl();
       const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
-      // find the first entry that overlaps our restriction - speed this up with a
-      //  binary search on the low end of the restriction if we're 1-D
-      if(N == 1)
-	cur_entry = bsearch_map_entries(entries, restriction.lo);
-      else
-	cur_entry = 0;
+      // find the first entry that overlaps our restriction
+      cur_entry = s_impl->next_overlapping_entry(entries, restriction, 0);
 
-      while(cur_entry < entries.size()) {
+      if(cur_entry < entries.size()) {
 	const SparsityMapEntry<N,T>& e = entries[cur_entry];
 	rect = restriction.intersection(e.bounds);
-	if(!rect.empty()) {
-	  assert(!e.sparsity.exists());
-	  assert(e.bitmap == 0);
-	  valid = true;
-	  return;
-	}
-	cur_entry++;
+	assert(!e.sparsity.exists());
+	assert(e.bitmap == 0);
+	valid = true;
+	return;
       }
       // if we fall through, there was no intersection
       valid = false;
@@ -1745,23 +1763,16 @@ namespace Realm {
     } else {
       s_impl = space.sparsity.impl();
       const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
-      // find the first entry that overlaps our restriction - speed this up with a
-      //  binary search on the low end of the restriction if we're 1-D
-      if(N == 1)
-	cur_entry = bsearch_map_entries(entries, restriction.lo);
-      else
-	cur_entry = 0;
+      // find the first entry that overlaps our restriction
+      cur_entry = s_impl->next_overlapping_entry(entries, restriction, 0);
 
-      while(cur_entry < entries.size()) {
+      if(cur_entry < entries.size()) {
 	const SparsityMapEntry<N,T>& e = entries[cur_entry];
 	rect = restriction.intersection(e.bounds);
-	if(!rect.empty()) {
-	  assert(!e.sparsity.exists());
-	  assert(e.bitmap == 0);
-	  valid = true;
-	  return;
-	}
-	cur_entry++;
+	assert(!e.sparsity.exists());
+	assert(e.bitmap == 0);
+	valid = true;
+	return;
       }
       // if we fall through, there was no intersection
       valid = false;
@@ -1784,18 +1795,10 @@ namespace Realm {
 
     // move onto the next sparsity entry (that overlaps our restriction)
     const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
-    for(cur_entry++; cur_entry < entries.size(); cur_entry++) {
+    cur_entry = s_impl->next_overlapping_entry(entries, restriction, cur_entry + 1);
+    if(cur_entry < entries.size()) {
       const SparsityMapEntry<N,T>& e = entries[cur_entry];
       rect = restriction.intersection(e.bounds);
-      if(rect.empty()) {
-	// in 1-D, our entries are sorted, so the first one whose bounds fall
-	//   outside our restriction means we're completely done
-	if(N == 1)
-	  break;
-	else
-	  continue;
-      }
-
       assert(!e.sparsity.exists());
       assert(e.bitmap == 0);
       return true;
@@ -52,6 +52,7 @@ namespace Realm {
     PMID_PCTRS_TLB,  // TLB miss counters
     PMID_PCTRS_BP,   // branch predictor performance counters
     PMID_OP_TIMELINE_GPU, // when a task was started and completed on the GPU
+    PMID_PCTRS_CORE, // cycles/instructions/LLC misses/stalls via perf_event
 
     // as the name suggests, this should always be last, allowing apps/runtimes
     // sitting on top of Realm to use some of the ID space
@@ -267,6 +268,17 @@ namespace Realm {
       long long taken_branches;
       long long mispredictions;
     };
+
+    // core counters collected through the Linux perf_event interface rather
+    //  than PAPI - counters that are not supported are reported as -1
+    struct CorePerfCounters {
+      static const ProfilingMeasurementID ID = PMID_PCTRS_CORE;
+      long long total_cycles;
+      long long total_insts;
+      long long llc_misses;
+      long long stalled_cycles_frontend;
+      long long stalled_cycles_backend;
+    };
   };
 
   class ProfilingRequest {
@@ -1221,6 +1221,8 @@ namespace Realm {
       cp.add_option_bool("-ll:force_kthreads", Config::force_kernel_threads);
       cp.add_option_bool("-ll:frsrv_fallback", Config::use_fast_reservation_fallback);
       cp.add_option_int("-ll:machine_query_cache", Config::use_machine_query_cache);
+      bool use_cycle_counter = false;
+      cp.add_option_bool("-ll:cycle_counter", use_cycle_counter);
 
       bool cmdline_ok = cp.parse_command_line(cmdline);
 
@@ -1268,6 +1270,11 @@ namespace Realm {
       }
 #endif
 
+      // switch timestamps over to the cycle counter before anybody (e.g. the
+      //  profilers) starts taking them
+      if(use_cycle_counter && !Clock::enable_cycle_counter())
+        log_runtime.warning() << "no invariant cycle counter available - using OS clock for timestamps";
+
       core_map = CoreMap::discover_core_map(hyperthread_sharing);
       core_reservations = new CoreReservationSet(core_map);
 
@@ -1327,6 +1334,9 @@ namespace Realm {
       RemoteSparsityRequestMessage::Message::add_handler_entries("Remote Sparsity Request AM");
       ApproxImageResponseMessage::Message::add_handler_entries("Approx Image Response AM");
       SetContribCountMessage::Message::add_handler_entries("Set Contrib Count AM");
+      RemoteSparsityApproxMessage::Message::add_handler_entries("Remote Sparsity Approx AM");
+      RemoteSparsityPartialRequestMessage::Message::add_handler_entries("Remote Sparsity Partial Request AM");
+      RemoteSparsityPartialContribMessage::Message::add_handler_entries("Remote Sparsity Partial Contrib AM");
       RemoteIDRequestMessage::Message::add_handler_entries("Remote ID Request AM");
       RemoteIDResponseMessage::Message::add_handler_entries("Remote ID Response AM");
       RemoteIBAllocRequestAsync::Message::add_handler_entries("Remote IB Alloc Request AM");
@@ -106,6 +106,14 @@ namespace Realm {
     //  dense array of bits describing the validity of each point in the rectangle
 
     const std::vector<SparsityMapEntry<N,T> >& get_entries(void);
+
+    // precise entries can also be requested for just the part of a sparsity map that
+    //  overlaps a given rectangle - on nodes other than the creator, this fetches only
+    //  the entries that overlap the rectangle rather than the whole list - the returned
+    //  list is guaranteed to include every entry overlapping 'bounds' but may include
+    //  others as well
+    Event make_valid(const Rect<N,T>& bounds);
+    const std::vector<SparsityMapEntry<N,T> >& get_entries(const Rect<N,T>& bounds);
     
     // a sparsity map can exist in an approximate form as well - this is a bounded list of rectangles
     //  that are guaranteed to cover all actual entries
@@ -117,9 +125,28 @@ namespace Realm {
     bool overlaps(SparsityMapPublicImpl<N,T> *other,
 		  const Rect<N,T>& bounds, bool approx);
 
+    // returns the index of the first entry in 'list' at or after 'start' that overlaps
+    //  'r', or list.size() if there is none - 'list' is either the full list from
+    //  get_entries() or one from get_entries(bounds)
+    // the full list is indexed by a k-d tree (see below), so finding all k entries that
+    //  overlap a rectangle only visits the parts of the tree that overlap it rather than
+    //  scanning the whole list - partial lists are small and are just scanned
+    size_t next_overlapping_entry(const std::vector<SparsityMapEntry<N,T> >& list,
+				  const Rect<N,T>& r, size_t start);
+
   protected:
+    size_t search_entry_tree(size_t node, size_t lo, size_t hi,
+			     const Rect<N,T>& r, size_t start) const;
+
     bool entries_valid, approx_valid;
     std::vector<SparsityMapEntry<N,T> > entries;
+    // the entries are arranged (at finalize time) so that every node of an implicit
+    //  binary tree covers a contiguous range of them - node i covers [lo, hi) and its
+    //  children (2i+1 and 2i+2) cover [lo, mid) and [mid, hi) - and each range is split
+    //  at the median along its widest dimension - entry_tree[i] is the bounding box of
+    //  node i's entries
+    static const size_t ENTRY_TREE_LEAF_SIZE = 8;
+    std::vector<Rect<N,T> > entry_tree;
     std::vector<Rect<N,T> > approx_rects;
   };
 
@@ -83,6 +83,41 @@ namespace Realm {
     return approx_rects;
   }
 
+  template <int N, typename T>
+  inline size_t SparsityMapPublicImpl<N,T>::next_overlapping_entry(const std::vector<SparsityMapEntry<N,T> >& list,
+								   const Rect<N,T>& r, size_t start)
+  {
+    if((&list == &entries) && !entry_tree.empty())
+      return search_entry_tree(0, 0, list.size(), r, start);
+
+    for(size_t i = start; i < list.size(); i++)
+      if(list[i].bounds.overlaps(r))
+	return i;
+    return list.size();
+  }
+
+  template <int N, typename T>
+  inline size_t SparsityMapPublicImpl<N,T>::search_entry_tree(size_t node, size_t lo, size_t hi,
+							      const Rect<N,T>& r, size_t start) const
+  {
+    // nothing in this subtree is at or after 'start' or overlaps 'r'
+    if((hi <= start) || !entry_tree[node].overlaps(r))
+      return entries.size();
+
+    if((hi - lo) <= ENTRY_TREE_LEAF_SIZE) {
+      for(size_t i = ((lo < start) ? start : lo); i < hi; i++)
+	if(entries[i].bounds.overlaps(r))
+	  return i;
+      return entries.size();
+    }
+
+    size_t mid = (lo + hi) >> 1;
+    size_t idx = search_entry_tree(2*node + 1, lo, mid, r, start);
+    if(idx < entries.size())
+      return idx;
+    return search_entry_tree(2*node + 2, mid, hi, r, start);
+  }
+
 
 }; // namespace Realm
 
@@ -73,6 +73,12 @@ inline void makecontext_wrap(ucontext_t *u, void (*fn)(), int args, ...) { makec
 #endif
 #endif
 
+#ifdef REALM_USE_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
 #ifndef CHECK_LIBC
 #define CHECK_LIBC(cmd) do { \
   errno = 0; \
@@ -105,8 +111,16 @@ namespace Realm {
   };
 #endif
 
+#ifdef REALM_USE_PERF_EVENTS
+  Logger log_perf("perf_event");
+#endif
+
   namespace ThreadLocal {
     /*extern*/ __thread Thread *current_thread = 0;
+#ifdef REALM_USE_PERF_EVENTS
+    __thread PerfEventCounters::EventGroup *perf_event_group = 0;
+    __thread bool perf_event_group_tried = false;
+#endif
   };
 
   ////////////////////////////////////////////////////////////////////////
@@ -1918,6 +1932,227 @@ namespace Realm {
 #endif
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class PerfEventCounters
+
+#ifdef REALM_USE_PERF_EVENTS
+  namespace PerfEvents {
+    // set to false the first time we can't open a counter so that we only
+    //  complain (and pay for the failing system calls) once
+    volatile bool perf_events_available = true;
+  };
+
+  class PerfEventCounters::EventGroup {
+  public:
+    EventGroup(void);
+    ~EventGroup(void);
+
+    // returns the group for the calling kernel thread, creating it on first
+    //  use, or null if counters cannot be used
+    static EventGroup *get_group(void);
+
+    bool open_events(void);
+    void enable(void);
+    // disables counting and adds everything counted since the last enable()
+    //  to 'counts', scaled up if the kernel had to multiplex the counters
+    void disable(long long *counts);
+
+    int fds[NUM_EVENTS];
+    // position of each event's value in a group read, -1 if not counted
+    int read_index[NUM_EVENTS];
+    int num_open;
+  };
+
+  PerfEventCounters::EventGroup::EventGroup(void)
+    : num_open(0)
+  {
+    for(int i = 0; i < NUM_EVENTS; i++) {
+      fds[i] = -1;
+      read_index[i] = -1;
+    }
+  }
+
+  PerfEventCounters::EventGroup::~EventGroup(void)
+  {
+    for(int i = 0; i < NUM_EVENTS; i++)
+      if(fds[i] >= 0)
+	close(fds[i]);
+  }
+
+  /*static*/ PerfEventCounters::EventGroup *PerfEventCounters::EventGroup::get_group(void)
+  {
+    if(ThreadLocal::perf_event_group || ThreadLocal::perf_event_group_tried)
+      return ThreadLocal::perf_event_group;
+    ThreadLocal::perf_event_group_tried = true;
+    if(!PerfEvents::perf_events_available)
+      return 0;
+    // groups are never freed - kernel threads in Realm live until shutdown
+    //  and the descriptors go away with the process
+    EventGroup *group = new EventGroup;
+    if(group->open_events()) {
+      ThreadLocal::perf_event_group = group;
+    } else {
+      delete group;
+    }
+    return ThreadLocal::perf_event_group;
+  }
+
+  bool PerfEventCounters::EventGroup::open_events(void)
+  {
+    static const unsigned long long configs[NUM_EVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_STALLED_CYCLES_FRONTEND,
+      PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+    };
+    // everything goes in a single group led by the cycle counter so that
+    //  all counters can be started, stopped and read with one system call
+    for(int i = 0; i < NUM_EVENTS; i++) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      if(i == 0) {
+	attr.disabled = 1;
+	attr.read_format = (PERF_FORMAT_GROUP |
+			    PERF_FORMAT_TOTAL_TIME_ENABLED |
+			    PERF_FORMAT_TOTAL_TIME_RUNNING);
+      }
+      int fd = syscall(__NR_perf_event_open, &attr, 0 /*this thread*/,
+		       -1 /*any cpu*/, ((i == 0) ? -1 : fds[0]),
+		       PERF_FLAG_FD_CLOEXEC);
+      if(fd < 0) {
+	if(i == 0) {
+	  // without the leader there's nothing we can do
+	  if(__sync_bool_compare_and_swap(&PerfEvents::perf_events_available,
+					  true, false))
+	    log_perf.warning() << "unable to open hardware performance counters ("
+			       << strerror(errno) << ") - check "
+			       << "/proc/sys/kernel/perf_event_paranoid";
+	  return false;
+	}
+	// not all hardware supports all events (e.g. stall counts)
+	log_perf.debug() << "event " << configs[i] << " not available: "
+			 << strerror(errno);
+	continue;
+      }
+      fds[i] = fd;
+      read_index[i] = num_open++;
+    }
+    return true;
+  }
+
+  void PerfEventCounters::EventGroup::enable(void)
+  {
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  void PerfEventCounters::EventGroup::disable(long long *counts)
+  {
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // { nr, time_enabled, time_running, values[nr] }
+    unsigned long long buffer[3 + NUM_EVENTS];
+    ssize_t bytes = read(fds[0], buffer, sizeof(buffer));
+    if((bytes < (ssize_t)(3 * sizeof(unsigned long long))) ||
+       (buffer[0] != (unsigned long long)num_open))
+      return;
+    const unsigned long long enabled = buffer[1];
+    const unsigned long long running = buffer[2];
+    // the counters never got onto the hardware
+    if(running == 0)
+      return;
+    for(int i = 0; i < NUM_EVENTS; i++) {
+      if(read_index[i] < 0)
+	continue;
+      unsigned long long value = buffer[3 + read_index[i]];
+      if(running < enabled)
+	value = (unsigned long long)((double)value * enabled / running);
+      counts[i] += value;
+    }
+  }
+
+  PerfEventCounters::PerfEventCounters(void)
+    : group(0)
+  {
+    for(int i = 0; i < NUM_EVENTS; i++)
+      event_counts[i] = 0;
+  }
+
+  PerfEventCounters::~PerfEventCounters(void)
+  {
+    assert(group == 0);
+  }
+
+  /*static*/ PerfEventCounters *PerfEventCounters::setup_counters(const ProfilingMeasurementCollection& pmc)
+  {
+    if(!PerfEvents::perf_events_available)
+      return 0;
+    if(!pmc.wants_measurement<ProfilingMeasurements::CorePerfCounters>())
+      return 0;
+    return new PerfEventCounters;
+  }
+
+  void PerfEventCounters::cleanup(void)
+  {
+    delete this;
+  }
+
+  void PerfEventCounters::start(void)
+  {
+    resume();
+  }
+
+  void PerfEventCounters::stop(void)
+  {
+    suspend();
+  }
+
+  void PerfEventCounters::resume(void)
+  {
+    // we might be on a different kernel thread than the last time we ran
+    assert(group == 0);
+    group = EventGroup::get_group();
+    if(group)
+      group->enable();
+  }
+
+  void PerfEventCounters::suspend(void)
+  {
+    if(group) {
+      group->disable(event_counts);
+      group = 0;
+    }
+  }
+
+  void PerfEventCounters::record(ProfilingMeasurementCollection& pmc)
+  {
+    if(!pmc.wants_measurement<ProfilingMeasurements::CorePerfCounters>())
+      return;
+    // every kernel thread opens the same events, so use ours to know which
+    //  ones were actually counted
+    EventGroup *g = EventGroup::get_group();
+    if(!g)
+      return;
+    long long values[NUM_EVENTS];
+    for(int i = 0; i < NUM_EVENTS; i++)
+      values[i] = (g->read_index[i] >= 0) ? event_counts[i] : -1;
+    ProfilingMeasurements::CorePerfCounters ctrs;
+    ctrs.total_cycles            = values[EVENT_CYCLES];
+    ctrs.total_insts             = values[EVENT_INSTRUCTIONS];
+    ctrs.llc_misses              = values[EVENT_LLC_MISSES];
+    ctrs.stalled_cycles_frontend = values[EVENT_STALLED_CYCLES_FRONTEND];
+    ctrs.stalled_cycles_backend  = values[EVENT_STALLED_CYCLES_BACKEND];
+    pmc.add_measurement(ctrs);
+  }
+#endif
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // initialize/cleanup
@@ -43,6 +43,12 @@
 #include <papi.h>
 #endif
 
+// the perf_event interface is available on any reasonably recent Linux
+//  kernel, so it is used unless explicitly disabled
+#if defined(__linux__) && !defined(REALM_NO_PERF_EVENTS)
+#define REALM_USE_PERF_EVENTS
+#endif
+
 namespace Realm {
 
   namespace Threading {
@@ -77,6 +83,9 @@ namespace Realm {
 #ifdef REALM_USE_PAPI
   class PAPICounters;
 #endif
+#ifdef REALM_USE_PERF_EVENTS
+  class PerfEventCounters;
+#endif
 
   //template <class CONDTYPE> class ThreadWaker;
 
@@ -225,6 +234,9 @@ namespace Realm {
 
 #ifdef REALM_USE_PAPI
     PAPICounters *papi_counters;
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    PerfEventCounters *perf_event_counters;
 #endif
   };
 
@@ -453,6 +465,44 @@ namespace Realm {
   };
 #endif
 
+#ifdef REALM_USE_PERF_EVENTS
+  // counts hardware events for a task using perf_event_open - the counters
+  //  themselves belong to the kernel thread the task is running on (a user
+  //  thread may move between kernel threads when it blocks), so these just
+  //  accumulate what was counted each time the task was running
+  class PerfEventCounters {
+  protected:
+    PerfEventCounters(void);
+    ~PerfEventCounters(void);
+
+  public:
+    static PerfEventCounters *setup_counters(const ProfilingMeasurementCollection& pmc);
+    void cleanup(void);
+
+    void start(void);
+    void suspend(void);
+    void resume(void);
+    void stop(void);
+    void record(ProfilingMeasurementCollection& pmc);
+
+    enum EventKind {
+      EVENT_CYCLES,
+      EVENT_INSTRUCTIONS,
+      EVENT_LLC_MISSES,
+      EVENT_STALLED_CYCLES_FRONTEND,
+      EVENT_STALLED_CYCLES_BACKEND,
+      NUM_EVENTS,
+    };
+
+    // the group of perf_event file descriptors for one kernel thread
+    class EventGroup;
+
+  protected:
+    EventGroup *group;
+    long long event_counts[NUM_EVENTS];
+  };
+#endif
+
   // move this somewhere else
 
   class DummyLock {
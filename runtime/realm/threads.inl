@@ -82,6 +82,9 @@ namespace Realm {
     , current_op(0)
     , exception_handler_count(0)
     , signal_count(0)
+#ifdef REALM_USE_PERF_EVENTS
+    , perf_event_counters(0)
+#endif
   {
   }
 
@@ -221,6 +224,9 @@ namespace Realm {
 #ifdef REALM_USE_PAPI
     if(thread->papi_counters) thread->papi_counters->suspend();
 #endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(thread->perf_event_counters) thread->perf_event_counters->suspend();
+#endif
 
     // we're interacting with the scheduler, so check for signals first
     if(thread->signal_count > 0)
@@ -248,6 +254,9 @@ namespace Realm {
     // finally, resume any performance counters
 #ifdef REALM_USE_PAPI
     if(thread->papi_counters) thread->papi_counters->resume();
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(thread->perf_event_counters) thread->perf_event_counters->resume();
 #endif
   }
 
@@ -277,6 +286,9 @@ namespace Realm {
   {
 #ifdef REALM_USE_PAPI
     papi_counters = PAPICounters::setup_counters(pmc);
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    perf_event_counters = PerfEventCounters::setup_counters(pmc);
 #endif
   }
 
@@ -284,6 +296,9 @@ namespace Realm {
   {
 #ifdef REALM_USE_PAPI
     if(papi_counters) papi_counters->start();
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(perf_event_counters) perf_event_counters->start();
 #endif
   }
 
@@ -291,6 +306,9 @@ namespace Realm {
   {
 #ifdef REALM_USE_PAPI
     if(papi_counters) papi_counters->stop();
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(perf_event_counters) perf_event_counters->stop();
 #endif
   }
 
@@ -302,6 +320,13 @@ namespace Realm {
       papi_counters->cleanup();
       papi_counters = 0; // cleanup call might delete, or save it for later
     }
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(perf_event_counters) {
+      perf_event_counters->record(pmc);
+      perf_event_counters->cleanup();
+      perf_event_counters = 0;
+    }
 #endif
   }
 
@@ -19,6 +19,9 @@
 #include "realm/activemsg.h"
 
 #include <string.h>
+#if defined(__x86_64__) && !defined(__MACH__)
+#include <cpuid.h>
+#endif
 #include <list>
 
 pthread_key_t thread_timer_key;
@@ -28,6 +31,136 @@ namespace Realm {
   // if set_zero_time() is not called, relative time will equal absolute time
   /*static*/ long long Clock::zero_time = 0;
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class Clock (cycle counter support)
+  //
+
+  /*static*/ bool Clock::use_cycle_counter = false;
+  /*static*/ Clock::CycleCalibration Clock::calibrations[2];
+  /*static*/ volatile unsigned Clock::calibration_index = 0;
+  /*static*/ volatile int Clock::calibration_lock = 0;
+
+  namespace {
+    // how long (in ns) to measure the counter rate at startup and how often
+    //  to recalibrate it against the OS clock after that
+    const long long CYCLE_STARTUP_CALIBRATION_NS = 10000000LL;
+    const long long CYCLE_RECALIBRATION_NS = 1000000000LL;
+
+    // reads the OS clock bracketed by two counter reads and uses the midpoint
+    //  of the counter readings - returns the width of the bracket
+    unsigned long long sample_clocks(unsigned long long& cycles, long long& ns)
+    {
+      unsigned long long best = ~0ULL;
+      // take the tightest of a few tries to filter out preemption
+      for(int i = 0; i < 5; i++) {
+        unsigned long long c1 = Clock::read_cycle_counter();
+        long long t = Clock::os_time_in_nanoseconds(false);
+        unsigned long long c2 = Clock::read_cycle_counter();
+        if((c2 - c1) < best) {
+          best = c2 - c1;
+          cycles = c1 + ((c2 - c1) >> 1);
+          ns = t;
+        }
+      }
+      return best;
+    }
+
+    bool cycle_counter_usable(void)
+    {
+#if !defined(REALM_HAS_CYCLE_COUNTER)
+      return false;
+#elif defined(__x86_64__)
+      // the TSC must tick at a constant rate regardless of frequency scaling
+      //  and sleep states - CPUID.80000007H:EDX[8]
+      unsigned eax, ebx, ecx, edx;
+      if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || (eax < 0x80000007))
+        return false;
+      __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+      return ((edx & (1U << 8)) != 0);
+#else
+      // the generic timer on aarch64 is architecturally constant-rate
+      return true;
+#endif
+    }
+  };
+
+  /*static*/ bool Clock::enable_cycle_counter(void)
+  {
+    if(use_cycle_counter)
+      return true;
+    if(!cycle_counter_usable())
+      return false;
+
+    unsigned long long c1, c2;
+    long long t1, t2;
+    sample_clocks(c1, t1);
+    do {
+      sample_clocks(c2, t2);
+    } while((t2 - t1) < CYCLE_STARTUP_CALIBRATION_NS);
+    // a counter that isn't moving is no good to us
+    if(c2 <= c1)
+      return false;
+
+    CycleCalibration& c = calibrations[0];
+    c.base_cycles = c2;
+    c.base_ns = t2;
+    c.mult = (((unsigned __int128)(t2 - t1)) << 32) / (c2 - c1);
+    c.os_cycles = c2;
+    c.os_ns = t2;
+    c.next_calibration = c2 + ((((unsigned __int128)CYCLE_RECALIBRATION_NS) << 32) /
+                               c.mult);
+    calibrations[1] = c;
+    calibration_index = 0;
+    __sync_synchronize();
+    use_cycle_counter = true;
+    return true;
+  }
+
+  /*static*/ void Clock::recalibrate_cycle_counter(void)
+  {
+    // only one thread recalibrates - everybody else keeps using the current
+    //  calibration, which is still good for a while
+    if(!__sync_bool_compare_and_swap(&calibration_lock, 0, 1))
+      return;
+    const unsigned old_index = calibration_index;
+    const CycleCalibration& prev = calibrations[old_index];
+    unsigned long long cycles;
+    long long ns;
+    sample_clocks(cycles, ns);
+    // somebody else may have just finished a recalibration
+    if(cycles < prev.next_calibration) {
+      __sync_lock_release(&calibration_lock);
+      return;
+    }
+    CycleCalibration& next = calibrations[1 - old_index];
+    // continue from where the current calibration says we are so that time
+    //  never jumps (or goes backwards)
+    next.base_cycles = cycles;
+    next.base_ns = prev.base_ns + (long long)(((unsigned __int128)(cycles - prev.base_cycles) *
+                                               prev.mult) >> 32);
+    // measure the rate over the whole interval since the last calibration
+    //  against the OS clock
+    unsigned long long rate = prev.mult;
+    if((cycles > prev.os_cycles) && (ns > prev.os_ns))
+      rate = (((unsigned __int128)(ns - prev.os_ns)) << 32) / (cycles - prev.os_cycles);
+    // and then slew to absorb whatever error has built up over the next
+    //  interval, but never by more than 1% so time stays smooth
+    long long error = ns - next.base_ns;
+    long long interval = ((((unsigned __int128)CYCLE_RECALIBRATION_NS) << 32) / rate);
+    long long adjust = (interval > 0) ? (long long)((((__int128)error) << 32) / interval) : 0;
+    long long max_adjust = rate / 100;
+    if(adjust > max_adjust) adjust = max_adjust;
+    if(adjust < -max_adjust) adjust = -max_adjust;
+    next.mult = rate + adjust;
+    next.os_cycles = cycles;
+    next.os_ns = ns;
+    next.next_calibration = cycles + interval;
+    __sync_synchronize();
+    calibration_index = 1 - old_index;
+    __sync_lock_release(&calibration_lock);
+  }
+
 #ifdef DETAILED_TIMERS
   ////////////////////////////////////////////////////////////////////////
   //
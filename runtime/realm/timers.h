@@ -61,8 +61,40 @@ namespace Realm {
     // set_zero_time() should only be called by the runtime init code
     static void set_zero_time(void);
 
+    // relative time can instead come from a cycle counter (invariant TSC on
+    //  x86, CNTVCT on aarch64) that is calibrated against the OS clock at
+    //  startup and then about once a second, which is much cheaper to read
+    //  than the OS clock - returns false if there is no suitable counter
+    // enable_cycle_counter() should only be called by the runtime init code
+    static bool enable_cycle_counter(void);
+    static bool cycle_counter_enabled(void);
+
+    // these always go through the OS clock and are mostly useful for
+    //  comparing against the cycle counter
+    static long long os_time_in_nanoseconds(bool absolute = false);
+    static unsigned long long read_cycle_counter(void);
+
   protected:
+    static long long cycle_counter_time_in_nanoseconds(void);
+    static void recalibrate_cycle_counter(void);
+
     static long long zero_time;
+
+    // calibrations are double-buffered so that readers never see a partial
+    //  update - times are base_ns + ((cycles - base_cycles) * mult) >> 32
+    struct CycleCalibration {
+      unsigned long long base_cycles;
+      long long base_ns;
+      unsigned long long mult;
+      // the OS clock reading the rate was measured from
+      unsigned long long os_cycles;
+      long long os_ns;
+      unsigned long long next_calibration;
+    };
+    static bool use_cycle_counter;
+    static CycleCalibration calibrations[2];
+    static volatile unsigned calibration_index;
+    static volatile int calibration_lock;
   };
 
   class Logger;
@@ -27,6 +27,11 @@
 #include <time.h>
 #endif
 
+// only 64-bit x86 and ARM have cycle counters that we know how to use
+#if !defined(__MACH__) && (defined(__x86_64__) || defined(__aarch64__))
+#define REALM_HAS_CYCLE_COUNTER
+#endif
+
 namespace Realm {
 
   ////////////////////////////////////////////////////////////////////////
@@ -35,6 +40,8 @@ namespace Realm {
 
   inline /*static*/ double Clock::current_time(bool absolute /*= false*/)
   {
+    if(!absolute && use_cycle_counter)
+      return 1e-9 * (cycle_counter_time_in_nanoseconds() - zero_time);
 #ifdef __MACH__
     mach_timespec_t ts;
     clock_serv_t cclock;
@@ -53,6 +60,8 @@ namespace Realm {
   
   inline /*static*/ long long Clock::current_time_in_microseconds(bool absolute /*= false*/)
   {
+    if(!absolute && use_cycle_counter)
+      return (cycle_counter_time_in_nanoseconds() - zero_time) / 1000;
 #ifdef __MACH__
     mach_timespec_t ts;
     clock_serv_t cclock;
@@ -70,6 +79,16 @@ namespace Realm {
   }
   
   inline /*static*/ long long Clock::current_time_in_nanoseconds(bool absolute /*= false*/)
+  {
+    if(!absolute && use_cycle_counter)
+      return cycle_counter_time_in_nanoseconds() - zero_time;
+    long long t = os_time_in_nanoseconds(absolute);
+    if(!absolute)
+      t -= zero_time;
+    return t;
+  }
+
+  inline /*static*/ long long Clock::os_time_in_nanoseconds(bool absolute /*= false*/)
   {
 #ifdef __MACH__
     mach_timespec_t ts;
@@ -81,10 +100,50 @@ namespace Realm {
     struct timespec ts;
     clock_gettime(absolute ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
 #endif
-    long long t = (1000000000LL * ts.tv_sec) + ts.tv_nsec;
-    if(!absolute)
-      t -= zero_time;
-    return t;
+    return (1000000000LL * ts.tv_sec) + ts.tv_nsec;
+  }
+
+  inline /*static*/ unsigned long long Clock::read_cycle_counter(void)
+  {
+#if defined(REALM_HAS_CYCLE_COUNTER) && defined(__x86_64__)
+    unsigned lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((unsigned long long)hi << 32) | lo;
+#elif defined(REALM_HAS_CYCLE_COUNTER) && defined(__aarch64__)
+    unsigned long long cycles;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(cycles));
+    return cycles;
+#else
+    return 0;
+#endif
+  }
+
+  inline /*static*/ bool Clock::cycle_counter_enabled(void)
+  {
+    return use_cycle_counter;
+  }
+
+  inline /*static*/ long long Clock::cycle_counter_time_in_nanoseconds(void)
+  {
+#ifdef REALM_HAS_CYCLE_COUNTER
+    // read the calibration before the counter so the counter is (almost)
+    //  never older than the calibration's base
+    const CycleCalibration *c = &calibrations[calibration_index];
+    unsigned long long cycles = read_cycle_counter();
+    if(cycles >= c->next_calibration) {
+      recalibrate_cycle_counter();
+      c = &calibrations[calibration_index];
+    }
+    // counters on different cores can be very slightly out of sync
+    if(cycles >= c->base_cycles)
+      return c->base_ns + (long long)(((unsigned __int128)(cycles - c->base_cycles) *
+                                       c->mult) >> 32);
+    else
+      return c->base_ns - (long long)(((unsigned __int128)(c->base_cycles - cycles) *
+                                       c->mult) >> 32);
+#else
+    return os_time_in_nanoseconds(false);
+#endif
   }
 
   inline /*static*/ long long Clock::get_zero_time(void)
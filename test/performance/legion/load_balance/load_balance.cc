@@ -0,0 +1,183 @@
+/* Copyright 2019 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how well work is spread across processors when all of the
+// tasks are initially sent to the same processor and their running
+// times vary. Run with and without -lg:balance to compare the runtime
+// load balancing against the static placement. Any task that ran on
+// a processor other than the one it was sent to was stolen.
+
+#include "legion.h"
+#include "default_mapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Legion;
+using namespace Legion::Mapping;
+
+enum
+{
+  TOP_LEVEL_TASK_ID,
+  WORKER_TASK_ID,
+};
+
+//------------------------------------------------------------------------------
+// Command-line Parser
+//------------------------------------------------------------------------------
+static void parse_arguments(char** argv, int argc, unsigned &num_tasks,
+                            unsigned &task_us, unsigned &skew,
+                            unsigned &num_loops)
+{
+  int i = 1;
+  while (i < argc)
+  {
+    if (strcmp(argv[i], "-n") == 0) num_tasks = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-t") == 0) task_us = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-s") == 0) skew = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0) num_loops = atoi(argv[++i]);
+    ++i;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Mapper
+//------------------------------------------------------------------------------
+// Send every worker task to the first processor of the same kind so that
+// only stealing can spread the work to the other processors
+class ImbalancedMapper : public DefaultMapper {
+public:
+  ImbalancedMapper(MapperRuntime *rt, Machine m, Processor local)
+    : DefaultMapper(rt, m, local, "imbalanced_mapper")
+  {
+    Machine::ProcessorQuery procs(machine);
+    procs.local_address_space();
+    procs.only_kind(local.kind());
+    first_proc = procs.first();
+  }
+public:
+  virtual void select_task_options(const MapperContext ctx,
+                                   const Task& task,
+                                   TaskOptions& output)
+  {
+    DefaultMapper::select_task_options(ctx, task, output);
+    if (task.task_id == WORKER_TASK_ID)
+      output.initial_proc = first_proc;
+  }
+protected:
+  Processor first_proc;
+};
+
+static void create_mappers(Machine machine, Runtime *runtime,
+                           const std::set<Processor> &local_procs)
+{
+  for (std::set<Processor>::const_iterator it = local_procs.begin();
+        it != local_procs.end(); it++)
+    runtime->replace_default_mapper(
+        new ImbalancedMapper(runtime->get_mapper_runtime(), machine, *it), *it);
+}
+
+//------------------------------------------------------------------------------
+// Tasks
+//------------------------------------------------------------------------------
+unsigned worker_task(const Task *task,
+                     const std::vector<PhysicalRegion> &regions,
+                     Context ctx, Runtime *runtime)
+{
+  const long long duration = *(const unsigned*)task->args;
+  const long long stop = 
+    Realm::Clock::current_time_in_microseconds() + duration;
+  while (Realm::Clock::current_time_in_microseconds() < stop) { }
+  return task->current_proc.id & 0xffff;
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  unsigned num_tasks = 256;
+  unsigned task_us = 500;
+  unsigned skew = 8;
+  unsigned num_loops = 3;
+  {
+    const InputArgs &command_args = Runtime::get_input_args();
+    parse_arguments(command_args.argv, command_args.argc, num_tasks,
+                    task_us, skew, num_loops);
+  }
+  unsigned num_procs = 0;
+  unsigned first_proc = 0;
+  {
+    Machine::ProcessorQuery procs(Machine::get_machine());
+    procs.local_address_space();
+    procs.only_kind(Processor::LOC_PROC);
+    num_procs = procs.count();
+    first_proc = procs.first().id & 0xffff;
+  }
+  // Every skew-th task runs skew times longer than the others
+  unsigned long long total_us = 0;
+  for (unsigned idx = 0; idx < num_tasks; idx++)
+    total_us += ((skew > 0) && ((idx % skew) == 0)) ? skew * task_us : task_us;
+  printf("Running %u tasks (%.3f ms of work) on %u processors\n",
+         num_tasks, 1e-3 * total_us, num_procs);
+
+  for (unsigned l = 0; l < num_loops; l++)
+  {
+    std::vector<Future> futures(num_tasks);
+    std::vector<unsigned> durations(num_tasks);
+    long long start = Realm::Clock::current_time_in_microseconds();
+    for (unsigned idx = 0; idx < num_tasks; idx++)
+    {
+      durations[idx] = 
+        ((skew > 0) && ((idx % skew) == 0)) ? skew * task_us : task_us;
+      TaskLauncher launcher(WORKER_TASK_ID,
+          TaskArgument(&durations[idx], sizeof(durations[idx])));
+      futures[idx] = runtime->execute_task(ctx, launcher);
+    }
+    std::set<unsigned> used_procs;
+    unsigned stolen = 0;
+    for (unsigned idx = 0; idx < num_tasks; idx++)
+    {
+      const unsigned proc = futures[idx].get_result<unsigned>();
+      used_procs.insert(proc);
+      if (proc != first_proc)
+        stolen++;
+    }
+    long long stop = Realm::Clock::current_time_in_microseconds();
+    const double elapsed = stop - start;
+    printf("Loop %u: %.3f ms on %zd processors (%.1f%% efficiency), "
+           "%u of %u tasks stolen\n", l, 1e-3 * elapsed, used_procs.size(),
+           100.0 * total_us / (elapsed * num_procs), stolen, num_tasks);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  {
+    TaskVariantRegistrar registrar(WORKER_TASK_ID, "worker");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<unsigned,worker_task>(registrar,
+                                                            "worker");
+  }
+  Runtime::add_registration_callback(create_mappers);
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,126 @@
+/* Copyright 2019 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput of the default mapper for large index space
+// launches of empty point tasks that each use one subregion. Run with
+// -dm:concurrent to compare the concurrent and serialized mapper models
+// and with several utility processors (-ll:util) to give the runtime
+// more threads for performing mapper calls.
+
+#include "legion.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Legion;
+
+enum
+{
+  TOP_LEVEL_TASK_ID,
+  POINT_TASK_ID,
+};
+
+enum
+{
+  FID_X = 100,
+};
+
+//------------------------------------------------------------------------------
+// Command-line Parser
+//------------------------------------------------------------------------------
+static void parse_arguments(char** argv, int argc, unsigned &num_points,
+                            unsigned &num_loops)
+{
+  int i = 1;
+  while (i < argc)
+  {
+    if (strcmp(argv[i], "-p") == 0) num_points = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0) num_loops = atoi(argv[++i]);
+    ++i;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Tasks
+//------------------------------------------------------------------------------
+void point_task(const Task *task,
+                const std::vector<PhysicalRegion> &regions,
+                Context ctx, Runtime *runtime)
+{
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  unsigned num_points = 1 << 20;
+  unsigned num_loops = 3;
+  {
+    const InputArgs &command_args = Runtime::get_input_args();
+    parse_arguments(command_args.argv, command_args.argc, num_points,
+                    num_loops);
+  }
+  printf("Mapping index launches of %u points\n", num_points);
+
+  IndexSpaceT<1> launch_space =
+    runtime->create_index_space(ctx, Rect<1>(0, num_points - 1));
+  FieldSpace fs = runtime->create_field_space(ctx);
+  {
+    FieldAllocator allocator = runtime->create_field_allocator(ctx, fs);
+    allocator.allocate_field(sizeof(int), FID_X);
+  }
+  LogicalRegion lr = runtime->create_logical_region(ctx, launch_space, fs);
+  IndexPartition ip = runtime->create_equal_partition(ctx, launch_space,
+                                                      launch_space);
+  LogicalPartition lp = runtime->get_logical_partition(ctx, lr, ip);
+  runtime->fill_field<int>(ctx, lr, lr, FID_X, 0);
+
+  for (unsigned l = 0; l < num_loops; l++)
+  {
+    long long start = Realm::Clock::current_time_in_microseconds();
+    IndexTaskLauncher launcher(POINT_TASK_ID, launch_space,
+                               TaskArgument(), ArgumentMap());
+    launcher.add_region_requirement(
+        RegionRequirement(lp, 0/*projection*/, READ_WRITE, EXCLUSIVE, lr));
+    launcher.add_field(0, FID_X);
+    FutureMap fm = runtime->execute_index_space(ctx, launcher);
+    fm.wait_all_results();
+    long long stop = Realm::Clock::current_time_in_microseconds();
+    printf("Loop %u: %.3f ms (%.0f points/s)\n", l, 1e-3 * (stop - start),
+           1e6 * num_points / double(stop - start));
+  }
+
+  runtime->destroy_logical_region(ctx, lr);
+  runtime->destroy_field_space(ctx, fs);
+  runtime->destroy_index_space(ctx, launch_space);
+}
+
+int main(int argc, char** argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  {
+    TaskVariantRegistrar registrar(POINT_TASK_ID, "point_task");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<point_task>(registrar, "point_task");
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,143 @@
+/* Copyright 2019 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of the create_partition_by_* calls on large color
+// spaces, from issuing the call until every subspace of the partition
+// has been computed.
+
+#include "legion.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Legion;
+
+enum
+{
+  TOP_LEVEL_TASK_ID,
+};
+
+//------------------------------------------------------------------------------
+// Command-line Parser
+//------------------------------------------------------------------------------
+static void parse_arguments(char** argv, int argc, unsigned &num_colors,
+                            unsigned &block_size, unsigned &num_loops)
+{
+  int i = 1;
+  while (i < argc)
+  {
+    if (strcmp(argv[i], "-c") == 0) num_colors = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-b") == 0) block_size = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0) num_loops = atoi(argv[++i]);
+    ++i;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Timing Helpers
+//------------------------------------------------------------------------------
+// Partitioning is deferred so wait for the subspaces to be computed by
+// asking for the domain of every child of the new partition
+static long long wait_for_partition(Context ctx, Runtime *runtime,
+                                    IndexPartition ip, unsigned num_colors,
+                                    long long start)
+{
+  for (unsigned c = 0; c < num_colors; c++)
+    runtime->get_index_space_domain(ctx,
+        runtime->get_index_subspace(ctx, ip, c));
+  return Realm::Clock::current_time_in_microseconds() - start;
+}
+
+static void report(const char *name, unsigned num_colors, long long elapsed)
+{
+  printf("  %-12s %10.3f ms %8.3f us/color\n", name, 1e-3 * elapsed,
+         double(elapsed) / num_colors);
+}
+
+//------------------------------------------------------------------------------
+// Tasks
+//------------------------------------------------------------------------------
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  unsigned num_colors = 65536;
+  unsigned block_size = 4;
+  unsigned num_loops = 3;
+  {
+    const InputArgs &command_args = Runtime::get_input_args();
+    parse_arguments(command_args.argv, command_args.argc, num_colors,
+                    block_size, num_loops);
+  }
+  printf("Creating partitions with %u colors of %u points\n",
+         num_colors, block_size);
+
+  const coord_t num_elements = coord_t(num_colors) * block_size;
+  IndexSpaceT<1> color_space =
+    runtime->create_index_space(ctx, Rect<1>(0, num_colors - 1));
+
+  for (unsigned l = 0; l < num_loops; l++)
+  {
+    printf("Loop %u:\n", l);
+    IndexSpaceT<1> is =
+      runtime->create_index_space(ctx, Rect<1>(0, num_elements - 1));
+
+    long long start = Realm::Clock::current_time_in_microseconds();
+    IndexPartitionT<1> equal =
+      runtime->create_equal_partition(ctx, is, color_space);
+    report("equal", num_colors,
+        wait_for_partition(ctx, runtime, equal, num_colors, start));
+
+    Transform<1,1> transform;
+    transform[0][0] = block_size;
+    Rect<1> extent(0, block_size - 1);
+    start = Realm::Clock::current_time_in_microseconds();
+    IndexPartitionT<1> restricted =
+      runtime->create_partition_by_restriction(ctx, is, color_space,
+          transform, extent, DISJOINT_KIND);
+    report("restriction", num_colors,
+        wait_for_partition(ctx, runtime, restricted, num_colors, start));
+
+    start = Realm::Clock::current_time_in_microseconds();
+    IndexPartitionT<1> unioned =
+      runtime->create_partition_by_union(ctx, is, equal, restricted,
+                                         color_space, ALIASED_KIND);
+    report("union", num_colors,
+        wait_for_partition(ctx, runtime, unioned, num_colors, start));
+
+    start = Realm::Clock::current_time_in_microseconds();
+    IndexPartitionT<1> difference =
+      runtime->create_partition_by_difference(ctx, is, equal, restricted,
+                                              color_space, ALIASED_KIND);
+    report("difference", num_colors,
+        wait_for_partition(ctx, runtime, difference, num_colors, start));
+
+    runtime->destroy_index_space(ctx, is);
+  }
+
+  runtime->destroy_index_space(ctx, color_space);
+}
+
+int main(int argc, char** argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,166 @@
+/* Copyright 2019 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of building and tearing down large region trees:
+// creating partitions with many colors, materializing all of the
+// logical subregions, and deleting the whole tree again.
+
+#include "legion.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace Legion;
+
+enum
+{
+  TOP_LEVEL_TASK_ID,
+};
+
+enum
+{
+  FID_X = 100,
+};
+
+//------------------------------------------------------------------------------
+// Command-line Parser
+//------------------------------------------------------------------------------
+static void parse_arguments(char** argv, int argc, unsigned &num_colors,
+                            unsigned &num_partitions, unsigned &tree_depth,
+                            unsigned &num_loops)
+{
+  int i = 1;
+  while (i < argc)
+  {
+    if (strcmp(argv[i], "-c") == 0) num_colors = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-p") == 0) num_partitions = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-d") == 0) tree_depth = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0) num_loops = atoi(argv[++i]);
+    ++i;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Tree Construction
+//------------------------------------------------------------------------------
+struct Timings {
+  Timings(void) : partition(0), subregions(0), deletion(0), nodes(0) { }
+  long long partition;
+  long long subregions;
+  long long deletion;
+  unsigned long long nodes;
+};
+
+static void build_subtree(Context ctx, Runtime *runtime, LogicalRegion parent,
+                          IndexSpace color_space, unsigned num_partitions,
+                          unsigned depth, Timings &timings)
+{
+  if (depth == 0)
+    return;
+  for (unsigned p = 0; p < num_partitions; ++p)
+  {
+    long long start = Realm::Clock::current_time_in_microseconds();
+    IndexPartition ip = runtime->create_equal_partition(ctx,
+        parent.get_index_space(), color_space);
+    long long mid = Realm::Clock::current_time_in_microseconds();
+    LogicalPartition lp = runtime->get_logical_partition(ctx, parent, ip);
+    Domain colors = runtime->get_index_partition_color_space(ctx, ip);
+    std::vector<LogicalRegion> children;
+    children.reserve(colors.get_volume());
+    for (Domain::DomainPointIterator itr(colors); itr; itr++)
+      children.push_back(
+          runtime->get_logical_subregion_by_color(ctx, lp, itr.p));
+    long long stop = Realm::Clock::current_time_in_microseconds();
+    timings.partition += (mid - start);
+    timings.subregions += (stop - mid);
+    timings.nodes += children.size();
+    for (std::vector<LogicalRegion>::const_iterator it =
+          children.begin(); it != children.end(); it++)
+      build_subtree(ctx, runtime, *it, color_space, 1/*partitions*/,
+                    depth - 1, timings);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Tasks
+//------------------------------------------------------------------------------
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  unsigned num_colors = 1024;
+  unsigned num_partitions = 1;
+  unsigned tree_depth = 1;
+  unsigned num_loops = 5;
+  {
+    const InputArgs &command_args = Runtime::get_input_args();
+    parse_arguments(command_args.argv, command_args.argc, num_colors,
+                    num_partitions, tree_depth, num_loops);
+  }
+  // Make the region big enough that every level can be split evenly
+  unsigned long long num_elements = 1;
+  for (unsigned d = 0; d < tree_depth; d++)
+    num_elements *= num_colors;
+  printf("Building trees with %u colors, %u partitions, depth %u\n",
+         num_colors, num_partitions, tree_depth);
+
+  FieldSpace fs = runtime->create_field_space(ctx);
+  {
+    FieldAllocator allocator = runtime->create_field_allocator(ctx, fs);
+    allocator.allocate_field(sizeof(int), FID_X);
+  }
+  IndexSpace color_space =
+    runtime->create_index_space(ctx, Rect<1>(0, num_colors - 1));
+
+  for (unsigned l = 0; l < num_loops; l++)
+  {
+    Timings timings;
+    IndexSpace is =
+      runtime->create_index_space(ctx, Rect<1>(0, num_elements - 1));
+    LogicalRegion lr = runtime->create_logical_region(ctx, is, fs);
+    build_subtree(ctx, runtime, lr, color_space, num_partitions,
+                  tree_depth, timings);
+    long long start = Realm::Clock::current_time_in_microseconds();
+    runtime->destroy_logical_region(ctx, lr);
+    runtime->destroy_index_space(ctx, is);
+    // Deletions are deferred so the fence makes the timing measurement
+    // wait for them to actually be performed before reading the clock
+    runtime->issue_execution_fence(ctx);
+    long long stop = 
+      runtime->get_current_time_in_microseconds(ctx).get_result<long long>();
+    timings.deletion = stop - start;
+    printf("Loop %u: nodes=%llu partition=%.3f ms subregions=%.3f ms "
+           "deletion=%.3f ms (%.3f us/node)\n", l, timings.nodes,
+           1e-3 * timings.partition, 1e-3 * timings.subregions,
+           1e-3 * timings.deletion,
+           (timings.nodes == 0) ? 0.0 : double(timings.partition +
+             timings.subregions + timings.deletion) / timings.nodes);
+  }
+
+  runtime->destroy_index_space(ctx, color_space);
+  runtime->destroy_field_space(ctx, fs);
+}
+
+int main(int argc, char** argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,113 @@
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+
+#include <time.h>
+#include <unistd.h>
+
+using namespace Realm;
+
+Logger log_app("app");
+
+// Task IDs, some IDs are reserved so start at first available number
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+static int num_reads = 10000000;
+static int drift_seconds = 2;
+
+// measures the cost of a timestamp from the OS clock vs. whatever Clock is
+//  currently using (the cycle counter if -ll:cycle_counter was given and
+//  supported) and then checks how far the two drift apart over time
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  log_app.print() << "cycle counter "
+                  << (Clock::cycle_counter_enabled() ? "enabled" : "disabled");
+
+  // the sums keep the compiler from throwing the reads away
+  long long sum = 0;
+  long long t_start = Clock::os_time_in_nanoseconds();
+  for(int i = 0; i < num_reads; i++)
+    sum += Clock::os_time_in_nanoseconds();
+  long long t_os = Clock::os_time_in_nanoseconds() - t_start;
+
+  t_start = Clock::os_time_in_nanoseconds();
+  for(int i = 0; i < num_reads; i++)
+    sum += Clock::current_time_in_nanoseconds();
+  long long t_clock = Clock::os_time_in_nanoseconds() - t_start;
+
+  log_app.print() << "OS clock: " << ((double)t_os / num_reads) << " ns/read";
+  log_app.print() << "Clock: " << ((double)t_clock / num_reads) << " ns/read";
+
+  // make sure time moves forward monotonically and stays close to the OS
+  //  clock across at least one recalibration
+  long long os_base = Clock::os_time_in_nanoseconds();
+  long long clock_base = Clock::current_time_in_nanoseconds();
+  long long last = clock_base;
+  long long max_error = 0;
+  while(true) {
+    long long t = Clock::current_time_in_nanoseconds();
+    long long os = Clock::os_time_in_nanoseconds();
+    if(t < last) {
+      log_app.error() << "time went backwards: " << last << " -> " << t;
+      exit(1);
+    }
+    last = t;
+    long long error = (t - clock_base) - (os - os_base);
+    if(error < 0) error = -error;
+    if(error > max_error) max_error = error;
+    if((os - os_base) >= (drift_seconds * 1000000000LL))
+      break;
+    usleep(1000);
+  }
+  log_app.print() << "max drift from OS clock over " << drift_seconds
+                  << " s: " << max_error << " ns (checksum " << (sum & 1) << ")";
+
+  // anything more than a millisecond means calibration is broken
+  if(max_error > 1000000) {
+    log_app.error() << "clock drifted too far from OS clock";
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  for(int i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-n")) {
+      num_reads = atoi(argv[++i]);
+      continue;
+    }
+    if(!strcmp(argv[i], "-s")) {
+      drift_seconds = atoi(argv[++i]);
+      continue;
+    }
+  }
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  // select a processor to run the top level task on
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  rt.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  rt.wait_for_shutdown();
+
+  return 0;
+}
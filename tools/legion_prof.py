@@ -1847,6 +1847,11 @@ class State(object):
         self.mapper_calls = {}
         self.runtime_call_kinds = {}
         self.runtime_calls = {}
+        self.runtime_counter_kinds = {}
+        self.runtime_counters = {}
+        self.perf_counters = {}
+        self.op_stage_kinds = {}
+        self.op_stages = {}
         self.instances = {}
         self.has_spy_data = False
         self.spy_state = None
@@ -1854,6 +1859,8 @@ class State(object):
             "MessageDesc": self.log_message_desc,
             "MapperCallDesc": self.log_mapper_call_desc,
             "RuntimeCallDesc": self.log_runtime_call_desc,
+            "RuntimeCounterDesc": self.log_runtime_counter_desc,
+            "OpStageDesc": self.log_op_stage_desc,
             "MetaDesc": self.log_meta_desc,
             "OpDesc": self.log_op_desc,
             "ProcDesc": self.log_proc_desc,
@@ -1877,6 +1884,9 @@ class State(object):
             "MessageInfo": self.log_message_info,
             "MapperCallInfo": self.log_mapper_call_info,
             "RuntimeCallInfo": self.log_runtime_call_info,
+            "RuntimeCounterInfo": self.log_runtime_counter_info,
+            "PerfCounterInfo": self.log_perf_counter_info,
+            "OpStageInfo": self.log_op_stage_info,
             "ProfTaskInfo": self.log_proftask_info
             #"UserInfo": self.log_user_info
         }
@@ -2093,6 +2103,55 @@ class State(object):
         proc = self.find_processor(proc_id)
         proc.add_runtime_call(call)
 
+    def log_runtime_counter_desc(self, kind, name):
+        if kind not in self.runtime_counter_kinds:
+            self.runtime_counter_kinds[kind] = name
+
+    def log_runtime_counter_info(self, kind, proc_id, time, value):
+        assert kind in self.runtime_counter_kinds
+        # Counters are cumulative so only keep the latest sample
+        # reported from each processor for each kind of counter
+        key = (kind, proc_id)
+        if key not in self.runtime_counters or \
+                self.runtime_counters[key][0] <= time:
+            self.runtime_counters[key] = (time, value)
+
+    def log_perf_counter_info(self, op_id, task_id, variant_id, proc_id,
+                              cycles, instructions, llc_misses,
+                              stalled_frontend, stalled_backend):
+        # Sum the counters for each task variant, a total becomes -1 if
+        # any task of that variant was missing the counter
+        key = (task_id, variant_id)
+        values = (cycles, instructions, llc_misses,
+                  stalled_frontend, stalled_backend)
+        if key not in self.perf_counters:
+            self.perf_counters[key] = [0, 0, 0, 0, 0, 0]
+        totals = self.perf_counters[key]
+        totals[0] += 1
+        for idx, value in enumerate(values):
+            if totals[idx+1] < 0 or value < 0:
+                totals[idx+1] = -1
+            else:
+                totals[idx+1] += value
+
+    def log_op_stage_desc(self, kind, name):
+        if kind not in self.op_stage_kinds:
+            self.op_stage_kinds[kind] = name
+
+    def log_op_stage_info(self, op_kind, stage, count, total, max,
+                          p50, p90, p99):
+        # Each node reports its own histograms, counts and totals add up
+        # but percentiles can't be merged so keep the worst of them
+        key = (op_kind, stage)
+        if key not in self.op_stages:
+            self.op_stages[key] = [0, 0, 0, 0, 0, 0]
+        stats = self.op_stages[key]
+        stats[0] += count
+        stats[1] += total
+        for idx, value in enumerate((p50, p90, p99, max)):
+            if value > stats[idx+2]:
+                stats[idx+2] = value
+
     def log_proftask_info(self, proc_id, op_id, start, stop):
         # we don't have a unique op_id for the profiling task itself, so we don't 
         # add to self.operations
@@ -2273,11 +2332,67 @@ class State(object):
         stat.print_stats(verbose)
         print
 
+    def print_runtime_counter_stats(self, verbose):
+        print('****************************************************')
+        print('   RUNTIME COUNTERS')
+        print('****************************************************')
+        totals = {}
+        for (kind, proc_id), (time, value) in self.runtime_counters.iteritems():
+            totals[kind] = totals.get(kind, 0) + value
+        for kind in sorted(self.runtime_counter_kinds.iterkeys()):
+            if kind in totals or verbose:
+                print('  %-40s %d' % (self.runtime_counter_kinds[kind],
+                                      totals.get(kind, 0)))
+        print
+
+    def print_perf_counter_stats(self, verbose):
+        if not self.perf_counters:
+            return
+        print('****************************************************')
+        print('   PERFORMANCE COUNTERS')
+        print('****************************************************')
+        def ratio(num, denom, scale):
+            if num < 0 or denom <= 0:
+                return '     n/a'
+            return '%8.3f' % (scale * float(num) / denom)
+        for key, (count, cycles, insts, misses, frontend, backend) in \
+                sorted(self.perf_counters.iteritems()):
+            print('  %s' % self.find_variant(*key))
+            print('       Tasks:                  %d' % count)
+            print('       Cycles:                 %d' % cycles)
+            print('       Instructions:           %d' % insts)
+            print('       IPC:                    %s' % ratio(insts, cycles, 1))
+            print('       LLC Misses per 1K Insts:%s' % ratio(misses, insts, 1000))
+            print('       Front-End Stall %%:      %s' % ratio(frontend, cycles, 100))
+            print('       Back-End Stall %%:       %s' % ratio(backend, cycles, 100))
+        print
+
+    def print_op_stage_stats(self, verbose):
+        if not self.op_stages:
+            return
+        print('****************************************************')
+        print('   OPERATION STAGE LATENCIES')
+        print('****************************************************')
+        print('  %-20s %-20s %10s %14s %10s %10s %10s %10s %10s' % \
+              ('Operation', 'Stage', 'Count', 'Total (us)', 'Avg (us)',
+               'p50 (us)', 'p90 (us)', 'p99 (us)', 'Max (us)'))
+        for (op_kind, stage), (count, total, p50, p90, p99, max_time) in \
+                sorted(self.op_stages.iteritems()):
+            print('  %-20s %-20s %10d %14d %10.2f %10d %10d %10d %10d' % \
+                  (self.op_kinds.get(op_kind, 'Unknown'),
+                   self.op_stage_kinds.get(stage, 'Unknown'), count, total,
+                   float(total) / count if count > 0 else 0.0,
+                   p50, p90, p99, max_time))
+        print
+
     def print_stats(self, verbose):
         self.print_processor_stats(verbose)
         self.print_memory_stats(verbose)
         self.print_channel_stats(verbose)
         self.print_task_stats(verbose)
+        self.print_runtime_counter_stats(verbose)
+        self.print_perf_counter_stats(verbose)
+        self.print_op_stage_stats(verbose)
 
     def assign_colors(self):
         # Subtract out some colors for which we have special colors
@@ -65,6 +65,8 @@ class LegionProfASCIIDeserializer(LegionDeserializer):
         "MessageDesc": re.compile(prefix + r'Prof Message Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
         "MapperCallDesc": re.compile(prefix + r'Prof Mapper Call Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
         "RuntimeCallDesc": re.compile(prefix + r'Prof Runtime Call Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
+        "RuntimeCounterDesc": re.compile(prefix + r'Prof Runtime Counter Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
+        "OpStageDesc": re.compile(prefix + r'Prof Op Stage Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
         "MetaDesc": re.compile(prefix + r'Prof Meta Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
         "OpDesc": re.compile(prefix + r'Prof Op Desc (?P<kind>[0-9]+) (?P<name>[a-zA-Z0-9_ ]+)'),
         "ProcDesc": re.compile(prefix + r'Prof Proc Desc (?P<proc_id>[a-f0-9]+) (?P<kind>[0-9]+)'),
@@ -88,6 +90,9 @@ class LegionProfASCIIDeserializer(LegionDeserializer):
         "MessageInfo": re.compile(prefix + r'Prof Message Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
         "MapperCallInfo": re.compile(prefix + r'Prof Mapper Call Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<op_id>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
         "RuntimeCallInfo": re.compile(prefix + r'Prof Runtime Call Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
+        "RuntimeCounterInfo": re.compile(prefix + r'Prof Runtime Counter Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<time>[0-9]+) (?P<value>[0-9]+)'),
+        "PerfCounterInfo": re.compile(prefix + r'Prof Perf Counter Info (?P<op_id>[0-9]+) (?P<task_id>[0-9]+) (?P<variant_id>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<cycles>-?[0-9]+) (?P<instructions>-?[0-9]+) (?P<llc_misses>-?[0-9]+) (?P<stalled_frontend>-?[0-9]+) (?P<stalled_backend>-?[0-9]+)'),
+        "OpStageInfo": re.compile(prefix + r'Prof Op Stage Info (?P<op_kind>[0-9]+) (?P<stage>[0-9]+) (?P<count>[0-9]+) (?P<total>[0-9]+) (?P<max>[0-9]+) (?P<p50>[0-9]+) (?P<p90>[0-9]+) (?P<p99>[0-9]+)'),
         "ProfTaskInfo": re.compile(prefix + r'Prof ProfTask Info (?P<proc_id>[a-f0-9]+) (?P<op_id>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)')
         # "UserInfo": re.compile(prefix + r'Prof User Info (?P<proc_id>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+) (?P<name>[$()a-zA-Z0-9_]+)')
     }
@@ -117,6 +122,21 @@ class LegionProfASCIIDeserializer(LegionDeserializer):
         "end": read_time,
         "gpu_start": read_time,
         "gpu_stop": read_time,
+        "time": read_time,
+        "value": long,
+        "cycles": long,
+        "instructions": long,
+        "llc_misses": long,
+        "stalled_frontend": long,
+        "stalled_backend": long,
+        "op_kind": int,
+        "stage": int,
+        "count": long,
+        "total": read_time,
+        "max": read_time,
+        "p50": read_time,
+        "p90": read_time,
+        "p99": read_time,
         "wait_start": read_time,
         "wait_ready": read_time,
         "wait_end": read_time,
@@ -203,11 +223,14 @@ class LegionProfBinaryDeserializer(LegionDeserializer):
         "unsigned":           "I", # unsigned int
         "timestamp_t":        "Q", # unsigned long long
         "unsigned long long": "Q", # unsigned long long
+        "long long":          "q", # long long
         "ProcKind":           "i", # int (really an enum so this depends)
         "MemKind":            "i", # int (really an enum so this depends)
         "MessageKind":        "i", # int (really an enum so this depends)
         "MappingCallKind":    "i", # int (really an enum so this depends)
         "RuntimeCallKind":    "i", # int (really an enum so this depends)
+        "RuntimeCounterKind": "i", # int (really an enum so this depends)
+        "OpStageKind":        "i", # int (really an enum so this depends)
         "DepPartOpKind":      "i", # int (really an enum so this depends)
     }
 